@@ -2,6 +2,7 @@
 #include "mio/mmap.hpp"
 #include "spdlog/spdlog.h"
 
+#include "cpu_dispatch.hpp"
 #include "index_types.hpp"
 #include "util/do_not_optimize_away.hpp"
 #include "util/util.hpp"
@@ -106,7 +107,10 @@ void perftest(IndexType const& index, std::string const& type)
 template <typename IndexType>
 void perftest(const char* index_filename, std::string const& type)
 {
-    spdlog::info("Loading index from {}", index_filename);
+    spdlog::info(
+        "Loading index from {} (document prefix sums: {})",
+        index_filename,
+        pisa::to_string(pisa::kernel_level(pisa::DOCID_PREFIX_SUM_KERNEL)));
     IndexType index;
     mio::mmap_source m(index_filename);
     pisa::mapper::map(index, m, pisa::mapper::map_flags::warmup);
@@ -0,0 +1,537 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <CLI/CLI.hpp>
+#include <fmt/format.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "accumulator/lazy_accumulator.hpp"
+#include "accumulator/simple_accumulator.hpp"
+#include "binary_freq_collection.hpp"
+#include "cpu_dispatch.hpp"
+#include "index_types.hpp"
+#include "topk_queue.hpp"
+#include "util/do_not_optimize_away.hpp"
+#include "util/util.hpp"
+
+using namespace pisa;
+
+namespace {
+
+/// Posting lists that benchmarks run on, either synthetic or read from a collection.
+struct posting_lists {
+    std::string source;
+    std::uint64_t num_docs = 0;
+    std::vector<std::vector<std::uint32_t>> docs;
+    std::vector<std::vector<std::uint32_t>> freqs;
+
+    [[nodiscard]] auto postings() const -> std::size_t
+    {
+        return std::accumulate(
+            docs.begin(), docs.end(), std::size_t(0), [](auto acc, auto const& list) {
+                return acc + list.size();
+            });
+    }
+};
+
+/// Generates `num_lists` lists whose expected lengths follow Zipf's law, the longest one
+/// containing a quarter of the documents, with documents spread uniformly at random and
+/// geometrically distributed frequencies.
+auto zipfian_lists(std::uint64_t num_docs, std::size_t num_lists, std::uint64_t seed)
+    -> posting_lists
+{
+    posting_lists lists{"zipf", num_docs, {}, {}};
+    std::mt19937_64 gen(seed);
+    std::geometric_distribution<std::uint32_t> freq_dist(0.5);
+    for (std::size_t rank = 1; rank <= num_lists; ++rank) {
+        double density = 0.25 / rank;
+        std::geometric_distribution<std::uint32_t> gap_dist(density);
+        std::vector<std::uint32_t> docs;
+        std::vector<std::uint32_t> freqs;
+        for (std::uint64_t doc = gap_dist(gen); doc < num_docs; doc += gap_dist(gen) + 1) {
+            docs.push_back(doc);
+            freqs.push_back(freq_dist(gen) + 1);
+        }
+        if (not docs.empty()) {
+            lists.docs.push_back(std::move(docs));
+            lists.freqs.push_back(std::move(freqs));
+        }
+    }
+    return lists;
+}
+
+/// Reads the `max_lists` longest lists of at least `min_length` postings from a collection, in
+/// the order of the collection.
+auto collection_lists(std::string const& basename, std::size_t min_length, std::size_t max_lists)
+    -> posting_lists
+{
+    binary_freq_collection collection(basename.c_str());
+    std::vector<std::pair<std::size_t, std::size_t>> lengths;
+    std::size_t num_lists = 0;
+    for (auto const& list: collection) {
+        if (list.docs.size() >= min_length) {
+            lengths.emplace_back(list.docs.size(), num_lists);
+        }
+        ++num_lists;
+    }
+    if (lengths.size() > max_lists) {
+        std::nth_element(
+            lengths.begin(),
+            std::next(lengths.begin(), max_lists),
+            lengths.end(),
+            std::greater<>());
+        lengths.resize(max_lists);
+    }
+    std::vector<bool> selected(num_lists, false);
+    for (auto [length, list]: lengths) {
+        selected[list] = true;
+    }
+
+    posting_lists lists{basename, collection.num_docs(), {}, {}};
+    std::size_t idx = 0;
+    for (auto const& list: collection) {
+        if (selected[idx++]) {
+            lists.docs.emplace_back(list.docs.begin(), list.docs.end());
+            lists.freqs.emplace_back(list.freqs.begin(), list.freqs.end());
+        }
+    }
+    return lists;
+}
+
+/// A benchmark case, whose iteration returns the number of items it processed, such as
+/// postings or decoded values, so that cases are compared by time per item.
+struct benchmark_case {
+    std::string family;
+    std::string name;
+    std::optional<std::uint64_t> arg;
+    std::function<std::size_t()> iteration;
+
+    [[nodiscard]] auto id() const -> std::string
+    {
+        auto id = family + "/" + name;
+        return arg ? id + "/" + std::to_string(*arg) : id;
+    }
+};
+
+/// Runs cases selected by a filter, each for a number of repetitions lasting at least a minimum
+/// time, and prints one JSON object per case with the median and minimum time per item.
+class runner {
+  public:
+    runner(std::string const& filter, std::chrono::milliseconds min_time, std::size_t repetitions)
+        : m_filter(filter), m_min_time(min_time), m_repetitions(repetitions)
+    {}
+
+    /// Checks whether the case `id` is selected, e.g., before preparing its data.
+    [[nodiscard]] auto selected(std::string const& id) const -> bool
+    {
+        return std::regex_search(id, m_filter);
+    }
+
+    void run(benchmark_case const& bench, std::string const& source) const
+    {
+        if (not selected(bench.id())) {
+            return;
+        }
+        spdlog::info("Running {}", bench.id());
+        do_not_optimize_away(bench.iteration());
+        std::vector<double> ns_per_item;
+        std::size_t iterations = 0;
+        std::size_t items = 0;
+        for (std::size_t repetition = 0; repetition < m_repetitions; ++repetition) {
+            std::size_t repetition_items = 0;
+            auto start = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::steady_clock::duration::zero();
+            do {
+                repetition_items += bench.iteration();
+                ++iterations;
+                elapsed = std::chrono::steady_clock::now() - start;
+            } while (elapsed < m_min_time);
+            auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+            ns_per_item.push_back(ns / repetition_items);
+            items += repetition_items;
+        }
+        std::sort(ns_per_item.begin(), ns_per_item.end());
+        double median = ns_per_item[ns_per_item.size() / 2];
+
+        stats_line line;
+        line("family", bench.family)("case", bench.name);
+        if (bench.arg) {
+            line("arg", *bench.arg);
+        }
+        line("lists", source)("repetitions", m_repetitions)("iterations", iterations)(
+            "items", items)("ns_per_item", median)("ns_per_item_min", ns_per_item.front())(
+            "items_per_second", 1.0E9 / median);
+    }
+
+  private:
+    std::regex m_filter;
+    std::chrono::milliseconds m_min_time;
+    std::size_t m_repetitions;
+};
+
+/// Decodes document gaps and frequencies of all lists, encoded in blocks as in
+/// `block_posting_list`, but without the skip structures.
+template <typename BlockCodec>
+void decode_benchmark(std::string const& name, posting_lists const& lists, runner const& runner)
+{
+    if (not runner.selected("decode/" + name)) {
+        return;
+    }
+    struct block {
+        std::uint32_t size;
+        std::uint32_t sum_of_values;
+    };
+    std::vector<std::uint8_t> encoded;
+    std::vector<block> blocks;
+    std::vector<std::uint32_t> buf(BlockCodec::block_size);
+    for (std::size_t list = 0; list < lists.docs.size(); ++list) {
+        auto const& docs = lists.docs[list];
+        auto const& freqs = lists.freqs[list];
+        std::int64_t last_doc = -1;
+        for (std::size_t pos = 0; pos < docs.size(); pos += BlockCodec::block_size) {
+            auto size = std::min<std::size_t>(BlockCodec::block_size, docs.size() - pos);
+            auto block_base = last_doc + 1;
+            for (std::size_t i = 0; i < size; ++i) {
+                buf[i] = docs[pos + i] - last_doc - 1;
+                last_doc = docs[pos + i];
+            }
+            auto sum_of_values = static_cast<std::uint32_t>(last_doc - block_base - (size - 1));
+            BlockCodec::encode(buf.data(), sum_of_values, size, encoded);
+            blocks.push_back({static_cast<std::uint32_t>(size), sum_of_values});
+            for (std::size_t i = 0; i < size; ++i) {
+                buf[i] = freqs[pos + i] - 1;
+            }
+            BlockCodec::encode(buf.data(), uint32_t(-1), size, encoded);
+            blocks.push_back({static_cast<std::uint32_t>(size), uint32_t(-1)});
+        }
+    }
+    runner.run(
+        {"decode",
+         name,
+         std::nullopt,
+         [&] {
+             std::uint8_t const* ptr = encoded.data();
+             std::size_t values = 0;
+             for (auto const& b: blocks) {
+                 ptr = BlockCodec::decode(ptr, buf.data(), b.sum_of_values, b.size);
+                 do_not_optimize_away(buf[0]);
+                 values += b.size;
+             }
+             return values;
+         }},
+        lists.source);
+}
+
+/// Decodes documents and frequencies of all lists, encoded as in `freq_index`, sequentially
+/// from the start of each list.
+template <typename DocsSequence, typename FreqsSequence>
+void sequence_decode_benchmark(
+    std::string const& name, posting_lists const& lists, runner const& runner)
+{
+    if (not runner.selected("decode/" + name)) {
+        return;
+    }
+    struct sequence {
+        std::uint64_t docs_offset;
+        std::uint64_t freqs_offset;
+        std::uint64_t freqs_universe;
+        std::uint64_t size;
+    };
+    global_parameters params;
+    bit_vector_builder docs_bits;
+    bit_vector_builder freqs_bits;
+    std::vector<sequence> sequences;
+    for (std::size_t list = 0; list < lists.docs.size(); ++list) {
+        auto const& docs = lists.docs[list];
+        auto const& freqs = lists.freqs[list];
+        auto occurrences = std::accumulate(freqs.begin(), freqs.end(), std::uint64_t(0));
+        sequences.push_back({docs_bits.size(), freqs_bits.size(), occurrences + 1, docs.size()});
+        DocsSequence::write(docs_bits, docs.begin(), lists.num_docs, docs.size(), params);
+        FreqsSequence::write(freqs_bits, freqs.begin(), occurrences + 1, freqs.size(), params);
+    }
+    bit_vector docs_bv(&docs_bits);
+    bit_vector freqs_bv(&freqs_bits);
+    runner.run(
+        {"decode",
+         name,
+         std::nullopt,
+         [&] {
+             std::size_t values = 0;
+             for (auto const& seq: sequences) {
+                 typename DocsSequence::enumerator docs_enum(
+                     docs_bv, seq.docs_offset, lists.num_docs, seq.size, params);
+                 typename FreqsSequence::enumerator freqs_enum(
+                     freqs_bv, seq.freqs_offset, seq.freqs_universe, seq.size, params);
+                 do_not_optimize_away(docs_enum.move(0).second);
+                 do_not_optimize_away(freqs_enum.move(0).second);
+                 for (std::uint64_t pos = 1; pos < seq.size; ++pos) {
+                     do_not_optimize_away(docs_enum.next().second);
+                     do_not_optimize_away(freqs_enum.move(pos).second);
+                 }
+                 values += 2 * seq.size;
+             }
+             return values;
+         }},
+        lists.source);
+}
+
+constexpr std::uint64_t max_skip = 4096;
+
+/// Scans lists with `next()` and looks up documents with `next_geq()` at increasing distances.
+template <typename Index>
+void cursor_benchmarks(std::string const& name, posting_lists const& lists, runner const& runner)
+{
+    auto selected = runner.selected("next/" + name);
+    for (std::uint64_t skip = 1; skip <= max_skip; skip *= 8) {
+        selected = selected or runner.selected(fmt::format("next_geq/{}/{}", name, skip));
+    }
+    if (not selected) {
+        return;
+    }
+    spdlog::info("Building {} index", name);
+    typename Index::builder builder(lists.num_docs, global_parameters{});
+    for (std::size_t list = 0; list < lists.docs.size(); ++list) {
+        auto const& freqs = lists.freqs[list];
+        builder.add_posting_list(
+            lists.docs[list].size(),
+            lists.docs[list].begin(),
+            freqs.begin(),
+            std::accumulate(freqs.begin(), freqs.end(), std::uint64_t(0)));
+    }
+    Index index;
+    builder.build(index);
+
+    runner.run(
+        {"next",
+         name,
+         std::nullopt,
+         [&] {
+             std::size_t postings = 0;
+             for (std::size_t list = 0; list < index.size(); ++list) {
+                 auto cursor = index[list];
+                 for (std::size_t pos = 0; pos < cursor.size(); ++pos) {
+                     do_not_optimize_away(cursor.docid());
+                     do_not_optimize_away(cursor.freq());
+                     cursor.next();
+                 }
+                 postings += cursor.size();
+             }
+             return postings;
+         }},
+        lists.source);
+
+    for (std::uint64_t skip = 1; skip <= max_skip; skip *= 8) {
+        std::vector<std::pair<std::size_t, std::vector<std::uint32_t>>> targets;
+        for (std::size_t list = 0; list < lists.docs.size(); ++list) {
+            auto const& docs = lists.docs[list];
+            if (docs.size() <= skip) {
+                continue;
+            }
+            auto& list_targets = targets.emplace_back(list, std::vector<std::uint32_t>()).second;
+            for (std::size_t pos = skip; pos < docs.size(); pos += skip) {
+                list_targets.push_back(docs[pos]);
+            }
+        }
+        if (targets.empty()) {
+            continue;
+        }
+        runner.run(
+            {"next_geq",
+             name,
+             skip,
+             [&] {
+                 std::size_t calls = 0;
+                 for (auto const& [list, list_targets]: targets) {
+                     auto cursor = index[list];
+                     for (auto target: list_targets) {
+                         cursor.next_geq(target);
+                         do_not_optimize_away(cursor.docid());
+                     }
+                     calls += list_targets.size();
+                 }
+                 return calls;
+             }},
+            lists.source);
+    }
+}
+
+/// Inserts scores in increasing, decreasing, and random order into queues of `k` entries.
+void topk_benchmarks(runner const& runner, std::uint64_t seed)
+{
+    std::size_t const num_scores = 1U << 20U;
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<float> dist(0.0, 100.0);
+    std::vector<float> random(num_scores);
+    std::generate(random.begin(), random.end(), [&] { return dist(gen); });
+    std::vector<float> increasing = random;
+    std::sort(increasing.begin(), increasing.end());
+    std::vector<float> decreasing(increasing.rbegin(), increasing.rend());
+
+    for (auto const& [name, scores]: {
+             std::pair<std::string, std::vector<float> const*>{"increasing", &increasing},
+             std::pair<std::string, std::vector<float> const*>{"decreasing", &decreasing},
+             std::pair<std::string, std::vector<float> const*>{"random", &random},
+         }) {
+        for (std::uint64_t k: {10, 1000}) {
+            runner.run(
+                {"topk_insert",
+                 name,
+                 k,
+                 [&, scores = scores] {
+                     topk_queue topk(k);
+                     std::uint32_t docid = 0;
+                     for (auto score: *scores) {
+                         topk.insert(score, docid++);
+                     }
+                     topk.finalize();
+                     do_not_optimize_away(topk.topk().size());
+                     return scores->size();
+                 }},
+                "uniform");
+        }
+    }
+}
+
+/// Accumulates the scores of the postings of the first lists and collects the top 10 documents.
+template <typename Accumulator>
+void aggregate_benchmark(
+    std::string const& name, posting_lists const& lists, runner const& runner, std::uint64_t seed)
+{
+    if (not runner.selected("aggregate/" + name)) {
+        return;
+    }
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<float> dist(0.0, 10.0);
+    std::vector<std::pair<std::uint32_t, float>> postings;
+    for (std::size_t list = 0; list < std::min<std::size_t>(4, lists.docs.size()); ++list) {
+        for (auto doc: lists.docs[list]) {
+            postings.emplace_back(doc, dist(gen));
+        }
+    }
+    Accumulator accumulator(lists.num_docs);
+    runner.run(
+        {"aggregate",
+         name,
+         std::nullopt,
+         [&] {
+             accumulator.init();
+             for (auto [doc, score]: postings) {
+                 accumulator.accumulate(doc, score);
+             }
+             topk_queue topk(10);
+             accumulator.aggregate(topk);
+             topk.finalize();
+             do_not_optimize_away(topk.topk().size());
+             return lists.num_docs;
+         }},
+        lists.source);
+}
+
+[[nodiscard]] auto cpu_model() -> std::string
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+[[nodiscard]] auto host_name() -> std::string
+{
+    std::array<char, 256> name{};
+    if (gethostname(name.data(), name.size() - 1) != 0) {
+        return "unknown";
+    }
+    return name.data();
+}
+
+}  // namespace
+
+int main(int argc, const char** argv)
+{
+    std::string filter = ".*";
+    std::optional<std::string> collection;
+    std::size_t min_length = 4096;
+    std::size_t max_lists = 1000;
+    std::uint64_t num_docs = 1U << 22U;
+    std::size_t num_lists = 1000;
+    std::uint64_t seed = 1;
+    std::size_t min_time_ms = 200;
+    std::size_t repetitions = 3;
+
+    CLI::App app{
+        "Runs microbenchmarks of codecs, cursors, top-k queues, and accumulators, and prints one "
+        "JSON object per case."};
+    app.add_option("-f,--filter", filter, "Regular expression selecting cases by family/case/arg");
+    auto* collection_opt =
+        app.add_option("-c,--collection", collection, "Collection basename to read lists from");
+    app.add_option("--min-length", min_length, "Minimum length of lists read from the collection")
+        ->needs(collection_opt);
+    app.add_option("--max-lists", max_lists, "Maximum number of lists read from the collection")
+        ->needs(collection_opt);
+    app.add_option("--num-docs", num_docs, "Number of documents of synthetic lists")
+        ->excludes(collection_opt);
+    app.add_option("--num-lists", num_lists, "Number of synthetic lists")->excludes(collection_opt);
+    app.add_option("--seed", seed, "Seed of synthetic lists and scores");
+    app.add_option("--min-time", min_time_ms, "Minimum time of each repetition in milliseconds");
+    app.add_option("--repetitions", repetitions, "Number of repetitions of each case")
+        ->check(CLI::PositiveNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    auto lists = collection ? collection_lists(*collection, min_length, max_lists)
+                            : zipfian_lists(num_docs, num_lists, seed);
+    spdlog::info(
+        "{} lists with {} postings from {}", lists.docs.size(), lists.postings(), lists.source);
+
+    stats_line()("family", std::string("context"))("lists", lists.source)(
+        "num_docs", lists.num_docs)("num_lists", lists.docs.size())("postings", lists.postings())(
+        "host", host_name())("cpu", cpu_model())("compiler", std::string(__VERSION__))(
+        "simd_level", std::string(to_string(simd_level())))(
+        "hardware_concurrency", std::thread::hardware_concurrency());
+
+    runner runner(filter, std::chrono::milliseconds(min_time_ms), repetitions);
+
+#define LOOP_BODY(R, DATA, T)                                                                 \
+    decode_benchmark<BOOST_PP_CAT(T, _index)::block_codec_type>(                              \
+        BOOST_PP_STRINGIZE(T), lists, runner);                                                \
+    /**/
+    BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_BLOCK_INDEX_TYPES);
+#undef LOOP_BODY
+
+#define LOOP_BODY(R, DATA, T)                                                                 \
+    sequence_decode_benchmark<                                                                \
+        BOOST_PP_CAT(T, _index)::docs_sequence_type,                                          \
+        BOOST_PP_CAT(T, _index)::freqs_sequence_type>(BOOST_PP_STRINGIZE(T), lists, runner);  \
+    /**/
+    BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, (ef)(single)(pefuniform)(pefopt));
+#undef LOOP_BODY
+
+#define LOOP_BODY(R, DATA, T)                                                                 \
+    cursor_benchmarks<BOOST_PP_CAT(T, _index)>(BOOST_PP_STRINGIZE(T), lists, runner);         \
+    /**/
+    BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
+#undef LOOP_BODY
+
+    topk_benchmarks(runner, seed);
+    aggregate_benchmark<Simple_Accumulator>("simple", lists, runner, seed);
+    aggregate_benchmark<Lazy_Accumulator<4>>("lazy", lists, runner, seed);
+    return 0;
+}
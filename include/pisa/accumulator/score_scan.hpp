@@ -0,0 +1,72 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include "cpu_dispatch.hpp"
+#include "util/compiler_attribute.hpp"
+
+namespace pisa {
+
+/// Returns the first score in `[first, last)` greater than `threshold`, or `last` if none is.
+[[nodiscard]] inline auto
+find_greater_baseline(float const* first, float const* last, float threshold) -> float const*
+{
+    __m128 threshold_vec = _mm_set1_ps(threshold);
+    for (; first + 4 <= last; first += 4) {
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(first), threshold_vec));
+        if (mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    for (; first != last; ++first) {
+        if (*first > threshold) {
+            return first;
+        }
+    }
+    return last;
+}
+
+PISA_TARGET("avx2")
+[[nodiscard]] inline auto
+find_greater_avx2(float const* first, float const* last, float threshold) -> float const*
+{
+    __m256 threshold_vec = _mm256_set1_ps(threshold);
+    for (; first + 8 <= last; first += 8) {
+        int mask =
+            _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(first), threshold_vec, _CMP_GT_OQ));
+        if (mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    return find_greater_baseline(first, last, threshold);
+}
+
+PISA_TARGET("avx512f")
+[[nodiscard]] inline auto
+find_greater_avx512(float const* first, float const* last, float threshold) -> float const*
+{
+    __m512 threshold_vec = _mm512_set1_ps(threshold);
+    for (; first + 16 <= last; first += 16) {
+        __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(first), threshold_vec, _CMP_GT_OQ);
+        if (mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    return find_greater_baseline(first, last, threshold);
+}
+
+/// Same as above, with the implementation for `level`.
+[[nodiscard]] inline auto find_greater(
+    float const* first,
+    float const* last,
+    float threshold,
+    SimdLevel level = kernel_level(ACCUMULATOR_SCAN_KERNEL)) -> float const*
+{
+    switch (level) {
+    case SimdLevel::Avx512: return find_greater_avx512(first, last, threshold);
+    case SimdLevel::Avx2: return find_greater_avx2(first, last, threshold);
+    default: return find_greater_baseline(first, last, threshold);
+    }
+}
+
+}  // namespace pisa
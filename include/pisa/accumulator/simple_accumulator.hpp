@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <vector>
 
+#include "accumulator/score_scan.hpp"
 #include "topk_queue.hpp"
 
 namespace pisa {
@@ -11,15 +12,17 @@ struct Simple_Accumulator: public std::vector<float> {
     explicit Simple_Accumulator(std::ptrdiff_t size) : std::vector<float>(size) {}
     void init() { std::fill(begin(), end(), 0.0); }
     void accumulate(uint32_t doc, float score) { operator[](doc) += score; }
+    /// Inserts documents into `topk`, skipping runs of scores below its threshold with
+    /// the widest scan kernel available.
     void aggregate(topk_queue& topk)
     {
-        uint64_t docid = 0U;
-        std::for_each(begin(), end(), [&](auto score) {
-            if (topk.would_enter(score)) {
-                topk.insert(score, docid);
-            }
-            docid += 1;
-        });
+        auto level = kernel_level(ACCUMULATOR_SCAN_KERNEL);
+        float const* first = data();
+        float const* last = first + size();
+        for (auto pos = find_greater(first, last, topk.effective_threshold(), level); pos != last;
+             pos = find_greater(pos + 1, last, topk.effective_threshold(), level)) {
+            topk.insert(*pos, pos - first);
+        }
     }
 };
 
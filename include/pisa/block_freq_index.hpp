@@ -18,6 +18,7 @@ template <typename BlockCodec, bool Profile = false>
 class block_freq_index {
   public:
     using index_layout_tag = BlockIndexTag;
+    using block_codec_type = BlockCodec;
     block_freq_index() = default;
     explicit block_freq_index(MemorySource source) : m_source(std::move(source))
     {
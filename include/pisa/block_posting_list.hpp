@@ -1,6 +1,7 @@
 #pragma once
 
 #include "codec/block_codecs.hpp"
+#include "codec/docid_prefix_sum.hpp"
 #include "util/block_profiler.hpp"
 #include "util/util.hpp"
 
@@ -108,7 +109,7 @@ struct block_posting_list {
                 }
                 decode_docs_block(m_cur_block + 1);
             } else {
-                m_cur_docid += m_docs_buf[m_pos_in_block] + 1;
+                m_cur_docid = m_docs_buf[m_pos_in_block];
             }
         }
 
@@ -131,7 +132,7 @@ struct block_posting_list {
             }
 
             while (docid() < lower_bound) {
-                m_cur_docid += m_docs_buf[++m_pos_in_block] + 1;
+                m_cur_docid = m_docs_buf[++m_pos_in_block];
                 assert(m_pos_in_block < m_cur_block_size);
             }
         }
@@ -143,9 +144,8 @@ struct block_posting_list {
             if (PISA_UNLIKELY(block != m_cur_block)) {
                 decode_docs_block(block);
             }
-            while (position() < pos) {
-                m_cur_docid += m_docs_buf[++m_pos_in_block] + 1;
-            }
+            m_pos_in_block = pos % BlockCodec::block_size;
+            m_cur_docid = m_docs_buf[m_pos_in_block];
         }
 
         uint64_t docid() const { return m_cur_docid; }
@@ -272,7 +272,7 @@ struct block_posting_list {
                 m_cur_block_size);
             intrinsics::prefetch(m_freqs_block_data);
 
-            m_docs_buf[0] += cur_base;
+            docid_prefix_sum(m_docs_buf.data(), m_cur_block_size, cur_base);
 
             m_cur_block = block;
             m_pos_in_block = 0;
@@ -312,6 +312,7 @@ struct block_posting_list {
         uint8_t const* m_freqs_block_data{nullptr};
         bool m_freqs_decoded{false};
 
+        /// Document IDs of the current block, prefix-summed from the decoded gaps.
         std::vector<uint32_t> m_docs_buf;
         std::vector<uint32_t> m_freqs_buf;
 
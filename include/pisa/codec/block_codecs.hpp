@@ -120,8 +120,11 @@ class TightVariableByte {
     }
 };
 
-struct interpolative_block {
-    static const uint64_t block_size = 128;
+/// Codes values with binary interpolative coding of their prefix sums, in blocks of up to
+/// `BlockSize` values. Other codecs fall back to it for blocks shorter than their size.
+template <uint64_t BlockSize = 128>
+struct basic_interpolative_block {
+    static constexpr uint64_t block_size = BlockSize;
 
     static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
     {
@@ -168,8 +171,18 @@ struct interpolative_block {
     }
 };
 
-struct optpfor_block {
-    struct codec_type: FastPForLib::OPTPFor<4, FastPForLib::Simple16<false>> {
+using interpolative_block = basic_interpolative_block<>;
+
+/// OptPFor blocks of `BlockSize` values, which must be a multiple of the 32-value packs.
+template <uint64_t BlockSize = 128>
+struct basic_optpfor_block {
+    static_assert(BlockSize % 32 == 0, "OptPFor blocks consist of packs of 32 values");
+
+    struct codec_type: FastPForLib::OPTPFor<BlockSize / 32, FastPForLib::Simple16<false>> {
+        using base_type = FastPForLib::OPTPFor<BlockSize / 32, FastPForLib::Simple16<false>>;
+        using base_type::possLogs;
+        using base_type::tryB;
+
         uint8_t const* force_b{nullptr};
 
         uint32_t findBestB(const uint32_t* in, uint32_t len)
@@ -204,7 +217,7 @@ struct optpfor_block {
         }
     };
 
-    static const uint64_t block_size = codec_type::BlockSize;
+    static constexpr uint64_t block_size = BlockSize;
 
     static void encode(
         uint32_t const* in,
@@ -218,7 +231,7 @@ struct optpfor_block {
         assert(n <= block_size);
 
         if (n < block_size) {
-            interpolative_block::encode(in, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(in, sum_of_values, n, out);
             return;
         }
 
@@ -237,7 +250,7 @@ struct optpfor_block {
         assert(n <= block_size);
 
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
 
         size_t out_len = block_size;
@@ -250,8 +263,11 @@ struct optpfor_block {
     }
 };
 
-struct varint_G8IU_block {
-    static const uint64_t block_size = 128;
+using optpfor_block = basic_optpfor_block<>;
+
+template <uint64_t BlockSize = 128>
+struct basic_varint_G8IU_block {
+    static constexpr uint64_t block_size = BlockSize;
 
     struct codec_type: VarIntG8IU {
         // rewritten version of decodeBlock optimized for when the output
@@ -288,7 +304,7 @@ struct varint_G8IU_block {
         assert(n <= block_size);
 
         if (n < block_size) {
-            interpolative_block::encode(in, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(in, sum_of_values, n, out);
             return;
         }
 
@@ -313,7 +329,7 @@ struct varint_G8IU_block {
         assert(n <= block_size);
 
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
 
         size_t out_len = 0;
@@ -336,4 +352,6 @@ struct varint_G8IU_block {
         return src;
     }
 };
+
+using varint_G8IU_block = basic_varint_G8IU_block<>;
 }  // namespace pisa
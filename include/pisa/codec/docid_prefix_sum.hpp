@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+#include "cpu_dispatch.hpp"
+#include "util/compiler_attribute.hpp"
+
+namespace pisa {
+
+/// Turns `n` decoded document gaps in `values` into document IDs, in place.
+///
+/// The first ID is `base + values[0]`, and every following one is `values[i] + 1` past the
+/// previous, which is how `block_posting_list` encodes documents. Each vector of gaps is
+/// incremented and prefix-summed with in-register shifts, and the carry is the last lane of the
+/// previous vector, so that cursors read IDs instead of accumulating gaps one by one.
+inline void docid_prefix_sum_baseline(std::uint32_t* values, std::size_t n, std::uint32_t base)
+{
+    __m128i one = _mm_set1_epi32(1);
+    __m128i carry = _mm_set1_epi32(base - 1);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto* ptr = reinterpret_cast<__m128i*>(values + i);
+        __m128i x = _mm_add_epi32(_mm_loadu_si128(ptr), one);
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128(ptr, x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+    std::uint32_t last = _mm_cvtsi128_si32(carry);
+    for (; i < n; ++i) {
+        last += values[i] + 1;
+        values[i] = last;
+    }
+}
+
+PISA_TARGET("avx2")
+inline void docid_prefix_sum_avx2(std::uint32_t* values, std::size_t n, std::uint32_t base)
+{
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i last_lane = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_set1_epi32(base - 1);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto* ptr = reinterpret_cast<__m256i*>(values + i);
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256(ptr), one);
+        // Shifts are within 128-bit lanes, so the low lane's total is added to the high one.
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        x = _mm256_add_epi32(
+            x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+        x = _mm256_add_epi32(x, carry);
+        _mm256_storeu_si256(ptr, x);
+        carry = _mm256_permutevar8x32_epi32(x, last_lane);
+    }
+    std::uint32_t last = _mm256_cvtsi256_si32(carry);
+    return docid_prefix_sum_baseline(values + i, n - i, last + 1);
+}
+
+PISA_TARGET("avx512f")
+inline void docid_prefix_sum_avx512(std::uint32_t* values, std::size_t n, std::uint32_t base)
+{
+    __m512i zero = _mm512_setzero_si512();
+    __m512i one = _mm512_set1_epi32(1);
+    __m512i last_lane = _mm512_set1_epi32(15);
+    __m512i carry = _mm512_set1_epi32(base - 1);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_add_epi32(_mm512_loadu_si512(values + i), one);
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 15));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 14));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 12));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 8));
+        x = _mm512_add_epi32(x, carry);
+        _mm512_storeu_si512(values + i, x);
+        carry = _mm512_permutexvar_epi32(last_lane, x);
+    }
+    std::uint32_t last = _mm512_cvtsi512_si32(carry);
+    return docid_prefix_sum_baseline(values + i, n - i, last + 1);
+}
+
+/// Same as above, with the implementation for `level`.
+inline void docid_prefix_sum(
+    std::uint32_t* values,
+    std::size_t n,
+    std::uint32_t base,
+    SimdLevel level = kernel_level(DOCID_PREFIX_SUM_KERNEL))
+{
+    switch (level) {
+    case SimdLevel::Avx512: return docid_prefix_sum_avx512(values, n, base);
+    case SimdLevel::Avx2: return docid_prefix_sum_avx2(values, n, base);
+    default: return docid_prefix_sum_baseline(values, n, base);
+    }
+}
+
+}  // namespace pisa
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "codec/block_codecs.hpp"
+#include "codec/simdbp.hpp"
+#include "codec/streamvbyte.hpp"
+#include "codec/varintgb.hpp"
+#include "dec_time_prediction.hpp"
+
+namespace pisa {
+
+/// Codecs that blocks of a `hybrid_block` index are encoded with. The value is stored as a
+/// one-byte tag in front of each encoded block.
+enum class hybrid_codec : std::uint8_t { simdbp, optpfor, streamvbyte, varintgb };
+
+constexpr std::size_t num_hybrid_codecs = 4;
+
+constexpr std::array<hybrid_codec, num_hybrid_codecs> hybrid_codecs{
+    hybrid_codec::simdbp, hybrid_codec::optpfor, hybrid_codec::streamvbyte, hybrid_codec::varintgb};
+
+[[nodiscard]] auto to_string(hybrid_codec codec) -> std::string_view;
+
+/// \returns the codec named `name` (`simdbp`, `optpfor`, `streamvbyte`, or `varintgb`), if any
+[[nodiscard]] auto parse_hybrid_codec(std::string_view name) -> std::optional<hybrid_codec>;
+
+/// Chooses the codec of each block as the one minimizing `size + lambda * time`, where `size` is
+/// the encoded size in bytes, and `time` is the decoding time predicted from the features of the
+/// block (see `dec_time_prediction.hpp`). With `lambda = 0`, every block is encoded as compactly
+/// as possible, while larger values trade space for decoding speed.
+class hybrid_selector {
+  public:
+    using predictors_type = std::array<time_prediction::predictor, num_hybrid_codecs>;
+
+    hybrid_selector(float lambda, predictors_type predictors)
+        : m_lambda(lambda), m_predictors(std::move(predictors))
+    {}
+
+    /// Returns the selector used to build `block_hybrid` indexes, configured with the
+    /// `PISA_HYBRID_LAMBDA` environment variable and the predictors read from the file at
+    /// `PISA_HYBRID_PREDICTORS`.
+    [[nodiscard]] static auto get() -> hybrid_selector const&;
+
+    [[nodiscard]] auto lambda() const -> float { return m_lambda; }
+
+    [[nodiscard]] auto
+    cost(hybrid_codec codec, time_prediction::feature_vector const& features) const -> float
+    {
+        return features[time_prediction::feature_type::size]
+            + m_lambda * m_predictors[static_cast<std::size_t>(codec)](features);
+    }
+
+  private:
+    float m_lambda;
+    predictors_type m_predictors;
+};
+
+/// Reads predictors from lines of the form `<codec> <feature> <weight> [<feature> <weight>...]`,
+/// where a feature is either one of `PISA_FEATURE_TYPES` or `bias`. Codecs without a line are
+/// predicted to decode in no time.
+[[nodiscard]] auto read_hybrid_predictors(std::istream& is) -> hybrid_selector::predictors_type;
+
+/// Encodes each block with one of the codecs of `hybrid_codec`, chosen by a `hybrid_selector`.
+struct hybrid_block {
+    static constexpr uint64_t block_size = 128;
+
+    static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
+    {
+        encode(hybrid_selector::get(), in, sum_of_values, n, out);
+    }
+
+    static void encode(
+        hybrid_selector const& selector,
+        uint32_t const* in,
+        uint32_t sum_of_values,
+        size_t n,
+        std::vector<uint8_t>& out)
+    {
+        assert(n <= block_size);
+        thread_local std::vector<uint8_t> buf;
+        thread_local std::vector<uint8_t> best_buf;
+        time_prediction::feature_vector features;
+        time_prediction::values_statistics(std::vector<uint32_t>(in, in + n), features);
+
+        auto best_codec = hybrid_codec::simdbp;
+        float best_cost = std::numeric_limits<float>::infinity();
+        for (auto codec: hybrid_codecs) {
+            buf.clear();
+            encode_with(codec, in, sum_of_values, n, buf);
+            features[time_prediction::feature_type::size] = buf.size();
+            if (float cost = selector.cost(codec, features); cost < best_cost) {
+                best_codec = codec;
+                best_cost = cost;
+                std::swap(buf, best_buf);
+            }
+        }
+        out.push_back(static_cast<uint8_t>(best_codec));
+        out.insert(out.end(), best_buf.begin(), best_buf.end());
+    }
+
+    /// Encodes a block with `codec` regardless of the selector.
+    static void encode(
+        hybrid_codec codec,
+        uint32_t const* in,
+        uint32_t sum_of_values,
+        size_t n,
+        std::vector<uint8_t>& out)
+    {
+        out.push_back(static_cast<uint8_t>(codec));
+        encode_with(codec, in, sum_of_values, n, out);
+    }
+
+    static uint8_t const* decode(uint8_t const* in, uint32_t* out, uint32_t sum_of_values, size_t n)
+    {
+        assert(n <= block_size);
+        switch (static_cast<hybrid_codec>(*in)) {
+        case hybrid_codec::simdbp: return simdbp_block::decode(in + 1, out, sum_of_values, n);
+        case hybrid_codec::optpfor: return optpfor_block::decode(in + 1, out, sum_of_values, n);
+        case hybrid_codec::streamvbyte:
+            return streamvbyte_block::decode(in + 1, out, sum_of_values, n);
+        case hybrid_codec::varintgb: return varintgb_block::decode(in + 1, out, sum_of_values, n);
+        }
+        throw std::runtime_error("Unknown codec of hybrid block");
+    }
+
+    /// Returns the codec of the block encoded at `in`.
+    static hybrid_codec codec(uint8_t const* in) { return static_cast<hybrid_codec>(*in); }
+
+  private:
+    static void encode_with(
+        hybrid_codec codec,
+        uint32_t const* in,
+        uint32_t sum_of_values,
+        size_t n,
+        std::vector<uint8_t>& out)
+    {
+        switch (codec) {
+        case hybrid_codec::simdbp: return simdbp_block::encode(in, sum_of_values, n, out);
+        case hybrid_codec::optpfor: return optpfor_block::encode(in, sum_of_values, n, out);
+        case hybrid_codec::streamvbyte: return streamvbyte_block::encode(in, sum_of_values, n, out);
+        case hybrid_codec::varintgb: return varintgb_block::encode(in, sum_of_values, n, out);
+        }
+    }
+};
+
+}  // namespace pisa
@@ -8,14 +8,15 @@
 #include "util/util.hpp"
 
 namespace pisa {
-struct maskedvbyte_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_maskedvbyte_block {
+    static constexpr uint64_t block_size = BlockSize;
     static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
     {
         assert(n <= block_size);
         auto* src = const_cast<uint32_t*>(in);
         if (n < block_size) {
-            interpolative_block::encode(src, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(src, sum_of_values, n, out);
             return;
         }
         thread_local std::vector<uint8_t> buf(2 * block_size * sizeof(uint32_t));
@@ -26,10 +27,12 @@ struct maskedvbyte_block {
     {
         assert(n <= block_size);
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
         auto read = masked_vbyte_decode(in, out, n);
         return in + read;
     }
 };
+
+using maskedvbyte_block = basic_maskedvbyte_block<>;
 }  // namespace pisa
@@ -4,8 +4,9 @@
 #include "codec/block_codecs.hpp"
 
 namespace pisa {
-struct qmx_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_qmx_block {
+    static constexpr uint64_t block_size = BlockSize;
     static const uint64_t overflow = 512;
 
     static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
@@ -13,7 +14,7 @@ struct qmx_block {
         assert(n <= block_size);
         auto* src = const_cast<uint32_t*>(in);
         if (n < block_size) {
-            interpolative_block::encode(src, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(src, sum_of_values, n, out);
             return;
         }
         thread_local QMX::compress_integer_qmx_improved qmx_codec;
@@ -28,7 +29,7 @@ struct qmx_block {
         static QMX::compress_integer_qmx_improved qmx_codec;  // decodeBlock is thread-safe
         assert(n <= block_size);
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
         uint32_t enc_len = 0;
         in = TightVariableByte::decode(in, &enc_len, 1);
@@ -41,4 +42,6 @@ struct qmx_block {
         return in + enc_len;
     }
 };
+
+using qmx_block = basic_qmx_block<>;
 }  // namespace pisa
@@ -9,32 +9,45 @@ extern "C" {
 }
 
 namespace pisa {
-struct simdbp_block {
-    static const uint64_t block_size = 128;
+/// SIMD-BP128 blocks of `BlockSize` values. Full blocks are packed in groups of 128 values,
+/// each with its own bit width, so a block of 128 is encoded as with the original codec.
+template <uint64_t BlockSize = 128>
+struct basic_simdbp_block {
+    static constexpr uint64_t pack_size = 128;
+    static_assert(BlockSize % pack_size == 0, "SIMD-BP128 packs groups of 128 values");
+
+    static constexpr uint64_t block_size = BlockSize;
     static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
     {
         assert(n <= block_size);
         auto* src = const_cast<uint32_t*>(in);
         if (n < block_size) {
-            interpolative_block::encode(src, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(src, sum_of_values, n, out);
             return;
         }
-        uint32_t b = maxbits(in);
-        thread_local std::vector<uint8_t> buf(8 * n);
-        uint8_t* buf_ptr = buf.data();
-        *buf_ptr++ = b;
-        simdpackwithoutmask(src, (__m128i*)buf_ptr, b);
-        out.insert(out.end(), buf.data(), buf.data() + b * sizeof(__m128i) + 1);
+        thread_local std::vector<uint8_t> buf(8 * pack_size);
+        for (size_t pos = 0; pos < n; pos += pack_size) {
+            uint32_t b = maxbits(in + pos);
+            uint8_t* buf_ptr = buf.data();
+            *buf_ptr++ = b;
+            simdpackwithoutmask(src + pos, (__m128i*)buf_ptr, b);
+            out.insert(out.end(), buf.data(), buf.data() + b * sizeof(__m128i) + 1);
+        }
     }
     static uint8_t const* decode(uint8_t const* in, uint32_t* out, uint32_t sum_of_values, size_t n)
     {
         assert(n <= block_size);
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
-        uint32_t b = *in++;
-        simdunpack((const __m128i*)in, out, b);
-        return in + b * sizeof(__m128i);
+        for (size_t pos = 0; pos < n; pos += pack_size) {
+            uint32_t b = *in++;
+            simdunpack((const __m128i*)in, out + pos, b);
+            in += b * sizeof(__m128i);
+        }
+        return in;
     }
 };
+
+using simdbp_block = basic_simdbp_block<>;
 }  // namespace pisa
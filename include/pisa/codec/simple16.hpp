@@ -3,8 +3,9 @@
 
 namespace pisa {
 
-struct simple16_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_simple16_block {
+    static constexpr uint64_t block_size = BlockSize;
 
     static void
     encode(uint32_t const* in, uint32_t /* sum_of_values */, size_t n, std::vector<uint8_t>& out)
@@ -33,4 +34,6 @@ struct simple16_block {
         return ret;
     }
 };
+
+using simple16_block = basic_simple16_block<>;
 }  // namespace pisa
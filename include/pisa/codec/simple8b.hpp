@@ -3,8 +3,9 @@
 
 namespace pisa {
 
-struct simple8b_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_simple8b_block {
+    static constexpr uint64_t block_size = BlockSize;
 
     static void
     encode(uint32_t const* in, uint32_t /* sum_of_values */, size_t n, std::vector<uint8_t>& out)
@@ -27,4 +28,6 @@ struct simple8b_block {
             codec.decodeArray(reinterpret_cast<uint32_t const*>(in), 8 * n, out, n));
     }
 };
+
+using simple8b_block = basic_simple8b_block<>;
 }  // namespace pisa
@@ -7,8 +7,9 @@
 
 namespace pisa {
 
-struct streamvbyte_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_streamvbyte_block {
+    static constexpr uint64_t block_size = BlockSize;
     static void
     encode(uint32_t const* in, uint32_t /* sum_of_values */, size_t n, std::vector<uint8_t>& out)
     {
@@ -26,4 +27,6 @@ struct streamvbyte_block {
         return in + read;
     }
 };
+
+using streamvbyte_block = basic_streamvbyte_block<>;
 }  // namespace pisa
@@ -241,15 +241,16 @@ class VarIntGB {
 template <bool delta>
 uint32_t VarIntGB<delta>::mask[4] = {0xFF, 0xFFFF, 0xFFFFFF, 0xFFFFFFFF};
 
-struct varintgb_block {
-    static const uint64_t block_size = 128;
+template <uint64_t BlockSize = 128>
+struct basic_varintgb_block {
+    static constexpr uint64_t block_size = BlockSize;
 
     static void encode(uint32_t const* in, uint32_t sum_of_values, size_t n, std::vector<uint8_t>& out)
     {
         thread_local VarIntGB<false> varintgb_codec;
         assert(n <= block_size);
         if (n < block_size) {
-            interpolative_block::encode(in, sum_of_values, n, out);
+            basic_interpolative_block<BlockSize>::encode(in, sum_of_values, n, out);
             return;
         }
         thread_local std::vector<uint8_t> buf(2 * block_size * sizeof(uint32_t));
@@ -262,10 +263,12 @@ struct varintgb_block {
         thread_local VarIntGB<false> varintgb_codec;
         assert(n <= block_size);
         if (PISA_UNLIKELY(n < block_size)) {
-            return interpolative_block::decode(in, out, sum_of_values, n);
+            return basic_interpolative_block<BlockSize>::decode(in, out, sum_of_values, n);
         }
         auto read = varintgb_codec.decodeArray(in, n, out);
         return read + in;
     }
 };
+
+using varintgb_block = basic_varintgb_block<>;
 }  // namespace pisa
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "boost/lexical_cast.hpp"
@@ -19,12 +20,16 @@ class configuration {
 
     size_t quantization_bits{8};
     bool heuristic_greedy{false};
+    float hybrid_lambda{0};
+    std::string hybrid_predictors{};
 
   private:
     configuration()
     {
         fillvar("PISA_HEURISTIC_GREEDY", heuristic_greedy);
         fillvar("PISA_QUANTIZTION_BITS", quantization_bits);
+        fillvar("PISA_HYBRID_LAMBDA", hybrid_lambda);
+        fillvar("PISA_HYBRID_PREDICTORS", hybrid_predictors);
     }
 
     template <typename T>
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace pisa {
+
+/// Instruction set extensions that kernels are specialized for, in increasing order.
+///
+/// `Baseline` kernels use only instructions available on every supported host (SSE4.2 and
+/// POPCNT), while the others are compiled with function target attributes and selected at run
+/// time, so that a binary built for the baseline still uses wider registers when available.
+enum class SimdLevel : std::uint8_t { Baseline, Avx2, Avx512 };
+
+[[nodiscard]] auto to_string(SimdLevel level) -> std::string_view;
+
+/// \returns the level named `name` (`baseline`, `avx2`, or `avx512`), if any
+[[nodiscard]] auto parse_simd_level(std::string_view name) -> std::optional<SimdLevel>;
+
+/// Returns the highest level supported by the host CPU.
+[[nodiscard]] auto detected_simd_level() -> SimdLevel;
+
+/// Returns the level that kernels are selected for, determined once per process.
+///
+/// It is the detected level, unless the `PISA_SIMD_LEVEL` environment variable names a lower
+/// one, which can be used to compare kernels or to reproduce results of other hosts.
+[[nodiscard]] auto simd_level() -> SimdLevel;
+
+/// A function with implementations for several levels, up to `max_level`.
+struct Kernel {
+    std::string_view name;
+    SimdLevel max_level;
+};
+
+constexpr Kernel ACCUMULATOR_SCAN_KERNEL{"accumulator_scan", SimdLevel::Avx512};
+constexpr Kernel TERM_GAINS_KERNEL{"bp_term_gains", SimdLevel::Avx2};
+constexpr Kernel DOCID_PREFIX_SUM_KERNEL{"docid_prefix_sum", SimdLevel::Avx512};
+constexpr Kernel ASCII_CLASSIFY_KERNEL{"ascii_tokenizer_classify", SimdLevel::Avx2};
+
+constexpr std::array<Kernel, 4> DISPATCHED_KERNELS{
+    ACCUMULATOR_SCAN_KERNEL, TERM_GAINS_KERNEL, DOCID_PREFIX_SUM_KERNEL, ASCII_CLASSIFY_KERNEL};
+
+/// Returns the level of the implementation of `kernel` used in this process.
+[[nodiscard]] inline auto kernel_level(Kernel const& kernel) -> SimdLevel
+{
+    return std::min(simd_level(), kernel.max_level);
+}
+
+}  // namespace pisa
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <fmt/format.h>
+#include <gsl/span>
+#include <spdlog/spdlog.h>
+
+#include "binary_freq_collection.hpp"
+#include "global_parameters.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "merge_index.hpp"
+#include "scorer/scorer.hpp"
+#include "util/compiler_attribute.hpp"
+#include "util/likely.hpp"
+#include "wand_data.hpp"
+
+namespace pisa {
+
+/// A mutable in-memory index of documents appended after a static index, which makes them
+/// searchable as soon as they are added, without rebuilding the static index.
+///
+/// Documents get consecutive IDs starting from `first_docid`, which is the number of documents
+/// in the static index. Posting lists are append-only arrays of uncompressed document IDs and
+/// frequencies, logically split into blocks of `block_size` postings: `next_geq` skips whole
+/// blocks by looking at their last document IDs before searching within a block.
+///
+/// The index satisfies the *SharedLockable* requirements. `add_document` and `erase_prefix`
+/// take the exclusive lock themselves, while readers, e.g., queries over a `segmented_index`,
+/// must hold a shared lock, such as `std::shared_lock lock(delta)`, for as long as they use
+/// its enumerators or document lengths.
+class delta_index {
+    struct posting_list {
+        std::vector<std::uint32_t> docs;
+        std::vector<std::uint32_t> freqs;
+        std::uint64_t occurrences = 0;
+        float max_weight = 0.0F;
+    };
+
+  public:
+    /// Returns the score of a posting of `term` in document `docid` with frequency `freq`.
+    using posting_scorer_type =
+        std::function<float(std::uint32_t term, std::uint32_t docid, std::uint32_t freq)>;
+
+    class document_enumerator {
+      public:
+        document_enumerator(
+            posting_list const* list, std::uint64_t size, std::uint32_t universe, std::uint64_t block_size)
+            : m_docs(list != nullptr ? list->docs.data() : nullptr),
+              m_freqs(list != nullptr ? list->freqs.data() : nullptr),
+              m_size(size),
+              m_universe(universe),
+              m_block_size(block_size)
+        {
+            reset();
+        }
+
+        void reset() { move(0); }
+
+        void PISA_ALWAYSINLINE next() { move(m_position + 1); }
+
+        void PISA_ALWAYSINLINE next_geq(std::uint64_t lower_bound)
+        {
+            if (PISA_UNLIKELY(m_cur_docid >= lower_bound || m_position >= m_size)) {
+                return;
+            }
+            auto block = m_position / m_block_size;
+            while ((block + 1) * m_block_size < m_size
+                   && m_docs[(block + 1) * m_block_size - 1] < lower_bound) {
+                block += 1;
+            }
+            auto first = std::max(block * m_block_size, m_position);
+            auto last = std::min((block + 1) * m_block_size, m_size);
+            move(std::lower_bound(m_docs + first, m_docs + last, lower_bound) - m_docs);
+        }
+
+        void PISA_ALWAYSINLINE move(std::uint64_t position)
+        {
+            m_position = position;
+            m_cur_docid = PISA_LIKELY(position < m_size) ? m_docs[position] : m_universe;
+        }
+
+        [[nodiscard]] auto docid() const -> std::uint64_t { return m_cur_docid; }
+        [[nodiscard]] auto freq() const -> std::uint64_t { return m_freqs[m_position]; }
+        [[nodiscard]] auto position() const -> std::uint64_t { return m_position; }
+        [[nodiscard]] auto size() const -> std::uint64_t { return m_size; }
+
+      private:
+        std::uint32_t const* m_docs;
+        std::uint32_t const* m_freqs;
+        std::uint64_t m_size;
+        std::uint32_t m_universe;
+        std::uint64_t m_block_size;
+        std::uint64_t m_position = 0;
+        std::uint64_t m_cur_docid = 0;
+    };
+
+    explicit delta_index(std::uint32_t first_docid, std::uint64_t block_size = 128)
+        : m_first_docid(first_docid), m_block_size(block_size)
+    {
+        if (block_size == 0) {
+            throw std::invalid_argument("Block size must be positive");
+        }
+    }
+
+    /// Copies the documents added to `other` so far, holding a shared lock on it meanwhile,
+    /// e.g., to write them out while documents are added to `other`. Maximum weights are
+    /// copied, but not tracked in the copy.
+    delta_index(delta_index const& other) : m_first_docid(0), m_block_size(other.m_block_size)
+    {
+        std::shared_lock lock(other);
+        m_first_docid = other.m_first_docid;
+        m_postings = other.m_postings;
+        m_lists = other.m_lists;
+        m_doc_lens = other.m_doc_lens;
+    }
+    delta_index(delta_index&&) = delete;
+    delta_index& operator=(delta_index const&) = delete;
+    delta_index& operator=(delta_index&&) = delete;
+    ~delta_index() = default;
+
+    /// Appends a document consisting of the tokens `terms` (term IDs, in any order, possibly
+    /// repeated) and returns its ID. Its length is the number of tokens.
+    auto add_document(gsl::span<std::uint32_t const> terms) -> std::uint32_t
+    {
+        std::vector<std::uint32_t> sorted(terms.begin(), terms.end());
+        std::sort(sorted.begin(), sorted.end());
+        std::unique_lock lock(m_mutex);
+        auto docid = num_docs();
+        if (not sorted.empty() && sorted.back() >= m_lists.size()) {
+            m_lists.resize(sorted.back() + 1);
+        }
+        m_doc_lens.push_back(terms.size());
+        for (auto first = sorted.begin(); first != sorted.end();) {
+            auto last = std::upper_bound(first, sorted.end(), *first);
+            auto& list = m_lists[*first];
+            std::uint32_t freq = last - first;
+            list.docs.push_back(docid);
+            list.freqs.push_back(freq);
+            list.occurrences += freq;
+            if (m_posting_scorer) {
+                list.max_weight = std::max(list.max_weight, m_posting_scorer(*first, docid, freq));
+            }
+            m_postings += 1;
+            first = last;
+        }
+        return docid;
+    }
+
+    /// Removes the first `count` documents, which have been merged into the static index.
+    /// Document IDs of the remaining ones do not change, as the static index now precedes them.
+    void erase_prefix(std::uint32_t count)
+    {
+        std::unique_lock lock(m_mutex);
+        if (count > document_count()) {
+            throw std::invalid_argument(fmt::format(
+                "Cannot erase {} documents out of {}", count, document_count()));
+        }
+        auto new_first_docid = m_first_docid + count;
+        for (auto& list: m_lists) {
+            auto erased = std::lower_bound(list.docs.begin(), list.docs.end(), new_first_docid)
+                - list.docs.begin();
+            list.occurrences -= std::accumulate(
+                list.freqs.begin(), list.freqs.begin() + erased, std::uint64_t(0));
+            list.docs.erase(list.docs.begin(), list.docs.begin() + erased);
+            list.freqs.erase(list.freqs.begin(), list.freqs.begin() + erased);
+            m_postings -= erased;
+        }
+        m_doc_lens.erase(m_doc_lens.begin(), m_doc_lens.begin() + count);
+        m_first_docid = new_first_docid;
+        if (m_posting_scorer) {
+            update_max_weights();
+        }
+    }
+
+    /// Scores each posting with `posting_scorer` as it is added, so that `max_weight` returns
+    /// the maximum score of each list without going over it. Postings added so far are scored
+    /// right away. Document lengths may be read within `posting_scorer`, while the exclusive
+    /// lock is held.
+    void track_max_weights(posting_scorer_type posting_scorer)
+    {
+        std::unique_lock lock(m_mutex);
+        m_posting_scorer = std::move(posting_scorer);
+        update_max_weights();
+    }
+
+    void lock() const { m_mutex.lock(); }
+    void unlock() const { m_mutex.unlock(); }
+    auto try_lock() const -> bool { return m_mutex.try_lock(); }
+    void lock_shared() const { m_mutex.lock_shared(); }
+    void unlock_shared() const { m_mutex.unlock_shared(); }
+    auto try_lock_shared() const -> bool { return m_mutex.try_lock_shared(); }
+
+    /// Returns an enumerator over the postings of `term` added so far; it is empty if the term
+    /// does not occur in any document.
+    [[nodiscard]] auto operator[](std::size_t term) const -> document_enumerator
+    {
+        if (term >= m_lists.size()) {
+            return document_enumerator(nullptr, 0, num_docs(), m_block_size);
+        }
+        auto const& list = m_lists[term];
+        return document_enumerator(&list, list.docs.size(), num_docs(), m_block_size);
+    }
+
+    /// Number of term IDs, i.e., one past the highest term ID added so far.
+    [[nodiscard]] auto size() const -> std::uint64_t { return m_lists.size(); }
+
+    /// One past the highest document ID, as for static indexes.
+    [[nodiscard]] auto num_docs() const -> std::uint32_t
+    {
+        return m_first_docid + m_doc_lens.size();
+    }
+
+    [[nodiscard]] auto first_docid() const -> std::uint32_t { return m_first_docid; }
+    [[nodiscard]] auto document_count() const -> std::uint32_t { return m_doc_lens.size(); }
+    [[nodiscard]] auto posting_count() const -> std::uint64_t { return m_postings; }
+    [[nodiscard]] auto block_size() const -> std::uint64_t { return m_block_size; }
+
+    [[nodiscard]] auto doc_len(std::uint64_t docid) const -> std::uint32_t
+    {
+        return m_doc_lens[docid - m_first_docid];
+    }
+
+    /// Sum of the frequencies of the postings of `term`.
+    [[nodiscard]] auto term_occurrence_count(std::size_t term) const -> std::uint64_t
+    {
+        return term < m_lists.size() ? m_lists[term].occurrences : 0;
+    }
+
+    /// Maximum score of the postings of `term`, or 0 if there are none, if max weights are
+    /// tracked, see `track_max_weights`.
+    [[nodiscard]] auto max_weight(std::size_t term) const -> std::optional<float>
+    {
+        if (not m_posting_scorer) {
+            return std::nullopt;
+        }
+        return term < m_lists.size() ? m_lists[term].max_weight : 0.0F;
+    }
+
+    /// Writes all documents as a compressed index of `IndexType`, with document IDs starting
+    /// from 0, and their WAND data, leaving out terms without postings. Returns the term ID
+    /// of each term of this index in the written one, or `ABSENT_TERM`.
+    template <typename IndexType, typename WandType>
+    auto write_segment(
+        std::string const& index_filename,
+        std::string const& wand_filename,
+        ScorerParams const& scorer_params,
+        BlockSize block_size) const -> std::vector<std::uint32_t>
+    {
+        std::vector<std::uint32_t> mapping;
+        std::vector<std::uint32_t> term_occurrence_counts;
+        std::vector<std::uint32_t> term_posting_counts;
+        for (auto const& list: m_lists) {
+            if (list.docs.empty()) {
+                mapping.push_back(ABSENT_TERM);
+                continue;
+            }
+            mapping.push_back(term_posting_counts.size());
+            term_posting_counts.push_back(list.docs.size());
+            term_occurrence_counts.push_back(list.occurrences);
+        }
+        global_parameters params;
+        typename IndexType::builder builder(document_count(), params);
+        WandType wdata(
+            std::vector<std::uint32_t>(m_doc_lens.begin(), m_doc_lens.end()),
+            term_occurrence_counts,
+            term_posting_counts,
+            scorer_params,
+            block_size,
+            false,
+            [&](auto&& fn) {
+                std::vector<std::uint32_t> docs;
+                for (std::size_t term = 0; term < m_lists.size(); ++term) {
+                    auto const& list = m_lists[term];
+                    if (list.docs.empty()) {
+                        continue;
+                    }
+                    docs.resize(list.docs.size());
+                    std::transform(
+                        list.docs.begin(), list.docs.end(), docs.begin(), [&](auto doc) {
+                            return doc - m_first_docid;
+                        });
+                    builder.add_posting_list(
+                        docs.size(),
+                        docs.begin(),
+                        list.freqs.begin(),
+                        term_occurrence_counts[mapping[term]]);
+                    fn(binary_freq_collection::sequence{
+                        {docs.data(), docs.data() + docs.size()},
+                        {list.freqs.data(), list.freqs.data() + list.freqs.size()}});
+                }
+            });
+        IndexType index;
+        builder.build(index);
+        mapper::freeze(index, index_filename.c_str());
+        mapper::freeze(wdata, wand_filename.c_str());
+        return mapping;
+    }
+
+  private:
+    void update_max_weights()
+    {
+        for (std::uint32_t term = 0; term < m_lists.size(); ++term) {
+            auto& list = m_lists[term];
+            list.max_weight = 0.0F;
+            for (std::size_t pos = 0; pos < list.docs.size(); ++pos) {
+                list.max_weight = std::max(
+                    list.max_weight, m_posting_scorer(term, list.docs[pos], list.freqs[pos]));
+            }
+        }
+    }
+
+    std::uint32_t m_first_docid;
+    std::uint64_t m_block_size;
+    std::uint64_t m_postings = 0;
+    std::vector<posting_list> m_lists{};
+    std::vector<std::uint32_t> m_doc_lens{};
+    posting_scorer_type m_posting_scorer{};
+    mutable std::shared_mutex m_mutex{};
+};
+
+/// A static index followed by the documents of a delta index, which can be queried as one
+/// index: enumerators go over the static list and then over the delta list of the same term,
+/// so the existing query algorithms work unchanged, with a single top-k queue.
+///
+/// The delta must be locked for reading, see `delta_index`, for the lifetime of this view.
+template <typename StaticIndex>
+class segmented_index {
+  public:
+    class document_enumerator {
+      public:
+        using static_enumerator = typename StaticIndex::document_enumerator;
+
+        document_enumerator(
+            std::optional<static_enumerator> static_list,
+            delta_index::document_enumerator delta_list,
+            std::uint64_t static_num_docs)
+            : m_static(std::move(static_list)),
+              m_delta(std::move(delta_list)),
+              m_static_num_docs(static_num_docs)
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            m_delta.reset();
+            m_in_static = m_static.has_value();
+            if (m_in_static) {
+                m_static->reset();
+                m_in_static = m_static->docid() < m_static_num_docs;
+            }
+        }
+
+        void PISA_ALWAYSINLINE next()
+        {
+            if (PISA_LIKELY(m_in_static)) {
+                m_static->next();
+                m_in_static = m_static->docid() < m_static_num_docs;
+            } else {
+                m_delta.next();
+            }
+        }
+
+        void PISA_ALWAYSINLINE next_geq(std::uint64_t lower_bound)
+        {
+            if (PISA_LIKELY(m_in_static)) {
+                if (lower_bound <= m_static->docid()) {
+                    return;
+                }
+                if (lower_bound < m_static_num_docs) {
+                    m_static->next_geq(lower_bound);
+                    if (m_static->docid() < m_static_num_docs) {
+                        return;
+                    }
+                }
+                m_in_static = false;
+            }
+            m_delta.next_geq(lower_bound);
+        }
+
+        [[nodiscard]] auto docid() const -> std::uint64_t
+        {
+            return m_in_static ? m_static->docid() : m_delta.docid();
+        }
+
+        [[nodiscard]] auto freq() -> std::uint64_t
+        {
+            return m_in_static ? m_static->freq() : m_delta.freq();
+        }
+
+        [[nodiscard]] auto size() const -> std::uint64_t
+        {
+            return (m_static ? m_static->size() : 0) + m_delta.size();
+        }
+
+      private:
+        std::optional<static_enumerator> m_static;
+        delta_index::document_enumerator m_delta;
+        std::uint64_t m_static_num_docs;
+        bool m_in_static = false;
+    };
+
+    segmented_index(StaticIndex const& static_index, delta_index const& delta)
+        : m_static(static_index), m_delta(delta)
+    {
+        if (delta.first_docid() != static_index.num_docs()) {
+            throw std::invalid_argument(fmt::format(
+                "Delta starts at document {} but the static index has {} documents",
+                delta.first_docid(),
+                static_index.num_docs()));
+        }
+    }
+
+    [[nodiscard]] auto operator[](std::size_t term) const -> document_enumerator
+    {
+        std::optional<typename StaticIndex::document_enumerator> static_list;
+        if (term < m_static.size()) {
+            static_list = m_static[term];
+        }
+        return document_enumerator(std::move(static_list), m_delta[term], m_static.num_docs());
+    }
+
+    [[nodiscard]] auto size() const -> std::uint64_t
+    {
+        return std::max<std::uint64_t>(m_static.size(), m_delta.size());
+    }
+
+    [[nodiscard]] auto num_docs() const -> std::uint64_t { return m_delta.num_docs(); }
+
+  private:
+    StaticIndex const& m_static;
+    delta_index const& m_delta;
+};
+
+/// Scoring statistics of a static index followed by a delta index, to be passed to scorers
+/// and `make_max_scored_cursors` along with a `segmented_index`.
+///
+/// Collection and term statistics are those of the static WAND data, and stay fixed until the
+/// delta is merged, so that scores of static postings, and their upper bounds, do not change
+/// as documents are added. Only document lengths are extended, and terms missing from the
+/// static index use their delta posting and occurrence counts. List upper bounds are the
+/// maximum of the static ones and of the delta scores. For terms of the static index, the
+/// latter are maintained by the delta as documents are added, once `track_max_term_weights`
+/// is called; otherwise, and for new terms, whose statistics change with every document, they
+/// are computed on request. Quantized WAND data are not supported.
+template <typename Wand>
+class segmented_wand_data {
+  public:
+    segmented_wand_data(Wand const& wdata, delta_index const& delta, ScorerParams const& scorer_params)
+        : m_wdata(wdata), m_delta(delta), m_scorer(scorer::from_params(scorer_params, *this))
+    {}
+    segmented_wand_data(segmented_wand_data const&) = delete;
+    segmented_wand_data(segmented_wand_data&&) = delete;
+    segmented_wand_data& operator=(segmented_wand_data const&) = delete;
+    segmented_wand_data& operator=(segmented_wand_data&&) = delete;
+    ~segmented_wand_data() = default;
+
+    [[nodiscard]] auto norm_len(std::uint64_t doc_id) const -> float
+    {
+        return doc_len(doc_id) / avg_len();
+    }
+
+    [[nodiscard]] auto doc_len(std::uint64_t doc_id) const -> std::size_t
+    {
+        return doc_id < m_wdata.num_docs() ? m_wdata.doc_len(doc_id) : m_delta.doc_len(doc_id);
+    }
+
+    [[nodiscard]] auto term_occurrence_count(std::uint64_t term_id) const -> std::size_t
+    {
+        return is_static(term_id) ? m_wdata.term_occurrence_count(term_id)
+                                  : m_delta.term_occurrence_count(term_id);
+    }
+
+    [[nodiscard]] auto term_posting_count(std::uint64_t term_id) const -> std::size_t
+    {
+        return is_static(term_id) ? m_wdata.term_posting_count(term_id) : m_delta[term_id].size();
+    }
+
+    [[nodiscard]] auto num_docs() const -> std::size_t { return m_wdata.num_docs(); }
+    [[nodiscard]] auto avg_len() const -> float { return m_wdata.avg_len(); }
+    [[nodiscard]] auto collection_len() const -> std::uint64_t { return m_wdata.collection_len(); }
+
+    [[nodiscard]] auto max_term_weight(std::uint64_t term_id) const -> float
+    {
+        float max_weight = is_static(term_id) ? m_wdata.max_term_weight(term_id) : 0.0F;
+        if (auto delta_weight = m_delta.max_weight(term_id); is_static(term_id) && delta_weight) {
+            return std::max(max_weight, *delta_weight);
+        }
+        auto term_scorer = m_scorer->term_scorer(term_id);
+        for (auto list = m_delta[term_id]; list.position() < list.size(); list.next()) {
+            max_weight = std::max(max_weight, term_scorer(list.docid(), list.freq()));
+        }
+        return max_weight;
+    }
+
+    [[nodiscard]] auto scorer() const -> index_scorer<segmented_wand_data> const&
+    {
+        return *m_scorer;
+    }
+
+  private:
+    [[nodiscard]] auto is_static(std::uint64_t term_id) const -> bool
+    {
+        return term_id < m_wdata.num_terms();
+    }
+
+    Wand const& m_wdata;
+    delta_index const& m_delta;
+    std::unique_ptr<index_scorer<segmented_wand_data>> m_scorer;
+};
+
+/// Makes `delta` maintain the maximum scores of its postings of the terms of `wdata`, computed
+/// as in `segmented_wand_data`, so that list upper bounds do not require scoring delta lists.
+///
+/// `wdata` must stay valid while documents are added. Call it again with the WAND data of the
+/// merged index after `delta.erase_prefix`.
+template <typename Wand>
+void track_max_term_weights(delta_index& delta, Wand const& wdata, ScorerParams const& scorer_params)
+{
+    auto view = std::make_shared<segmented_wand_data<Wand>>(wdata, delta, scorer_params);
+    delta.track_max_weights(
+        [view, term_count = wdata.num_terms()](
+            std::uint32_t term, std::uint32_t docid, std::uint32_t freq) {
+            return term < term_count ? view->scorer().term_scorer(term)(docid, freq) : 0.0F;
+        });
+}
+
+/// Where to find the static index and its WAND data, where to write the merged ones, and how
+/// to compute WAND data of the merged index.
+struct DeltaMergeOptions {
+    std::string index;
+    std::string wand;
+    std::string output;
+    std::string output_wand;
+    ScorerParams scorer_params;
+    BlockSize block_size;
+};
+
+/// Flushes the documents of `delta` into a new compressed segment and merges it with the
+/// static index, returning the number of merged documents.
+///
+/// The delta is locked for reading only while its documents are copied, and the copy is
+/// written out and merged without holding the lock, so documents can be added and queries
+/// served during the merge. Once it is done, the caller switches queries to the merged index
+/// and calls `delta.erase_prefix` with the returned count, which keeps document IDs of
+/// documents added in the meantime valid.
+template <typename IndexType, typename WandType>
+auto merge_delta(DeltaMergeOptions const& options, delta_index const& delta) -> std::uint32_t
+{
+    auto segment = boost::filesystem::path(options.output + ".delta");
+    auto segment_wand = boost::filesystem::path(options.output + ".delta.wand");
+    TermMapping term_mapping(2);
+    std::uint32_t document_count = 0;
+    {
+        delta_index snapshot(delta);
+        document_count = snapshot.document_count();
+        IndexType static_index(MemorySource::mapped_file(options.index));
+        if (snapshot.first_docid() != static_index.num_docs()) {
+            throw std::invalid_argument(fmt::format(
+                "Delta starts at document {} but the static index has {} documents",
+                snapshot.first_docid(),
+                static_index.num_docs()));
+        }
+        if (document_count == 0) {
+            throw std::invalid_argument("No documents to merge");
+        }
+        spdlog::info(
+            "Flushing {} documents with {} postings", document_count, snapshot.posting_count());
+        term_mapping[1] = snapshot.write_segment<IndexType, WandType>(
+            segment.string(), segment_wand.string(), options.scorer_params, options.block_size);
+        auto term_count = std::max<std::size_t>(static_index.size(), snapshot.size());
+        term_mapping[0].resize(term_count, ABSENT_TERM);
+        std::iota(term_mapping[0].begin(), term_mapping[0].begin() + static_index.size(), 0);
+        term_mapping[1].resize(term_count, ABSENT_TERM);
+    }
+    merge_indexes<IndexType, WandType>(
+        {options.index, segment.string()},
+        options.output,
+        term_mapping,
+        MergeWandOptions{
+            {options.wand, segment_wand.string()},
+            options.output_wand,
+            options.scorer_params,
+            options.block_size,
+            false,
+        });
+    boost::filesystem::remove(segment);
+    boost::filesystem::remove(segment_wand);
+    return document_count;
+}
+
+/// Runs `merge_delta` on a background thread.
+template <typename IndexType, typename WandType>
+auto merge_delta_async(DeltaMergeOptions options, delta_index const& delta)
+    -> std::future<std::uint32_t>
+{
+    return std::async(std::launch::async, [options = std::move(options), &delta] {
+        return merge_delta<IndexType, WandType>(options, delta);
+    });
+}
+
+}  // namespace pisa
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <gsl/span>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "forward_index.hpp"
+#include "util/huge_page_allocator.hpp"
+
+namespace pisa {
+
+//! A forward index with all term IDs decoded into one contiguous array.
+//!
+//! Terms of document `d` occupy positions `[offsets[d], offsets[d + 1])` of the term array
+//! (compressed sparse row layout), so accessing them requires no decoding and no allocation.
+//! Both arrays are backed by huge pages. `Term` can be `std::uint16_t` when the vocabulary
+//! has at most 2^16 terms, e.g., after pruning short lists and renumbering the remaining terms
+//! with `dense_term_ids`, which halves the memory footprint.
+template <typename Term = std::uint32_t>
+class flat_forward_index {
+  public:
+    using id_type = std::uint32_t;
+    using term_type = Term;
+
+    //! Decodes all documents of `fwd` in parallel.
+    static auto from_forward_index(forward_index const& fwd) -> flat_forward_index
+    {
+        return decode(fwd, fwd.term_count(), [](auto term) { return term; });
+    }
+
+    //! Decodes all documents of `fwd` in parallel, replacing each term `t` with `term_map[t]`.
+    //! All mapped IDs must be less than `term_count`.
+    static auto from_forward_index(
+        forward_index const& fwd, gsl::span<std::uint32_t const> term_map, std::size_t term_count)
+        -> flat_forward_index
+    {
+        return decode(fwd, term_count, [term_map](auto term) { return term_map[term]; });
+    }
+
+    //! Builds an index of `document_count` documents from a stream of postings.
+    //!
+    //! `for_each_posting(fn)` must call `fn(document, term)` for each posting, with terms in
+    //! non-decreasing order. It is called twice, first to count the terms of each document and
+    //! then to fill them in, and must produce the same postings both times.
+    template <typename ForEachPosting>
+    static auto from_postings(
+        std::size_t document_count, std::size_t term_count, ForEachPosting&& for_each_posting)
+        -> flat_forward_index
+    {
+        if (term_count > std::size_t(std::numeric_limits<Term>::max()) + 1) {
+            throw std::invalid_argument(fmt::format(
+                "Cannot store {} distinct terms in {}-byte term IDs", term_count, sizeof(Term)));
+        }
+        flat_forward_index flat;
+        flat.m_term_count = term_count;
+        flat.m_offsets.resize(document_count + 1, 0);
+        for_each_posting([&](id_type document, auto) { flat.m_offsets[document + 1] += 1; });
+        std::partial_sum(flat.m_offsets.begin(), flat.m_offsets.end(), flat.m_offsets.begin());
+        flat.m_terms.resize(flat.m_offsets.back());
+        std::vector<std::uint64_t> positions(flat.m_offsets.begin(), std::prev(flat.m_offsets.end()));
+        for_each_posting([&](id_type document, auto term) {
+            flat.m_terms[positions[document]++] = static_cast<Term>(term);
+        });
+        return flat;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return m_offsets.size() - 1; }
+    [[nodiscard]] auto term_count() const -> std::size_t { return m_term_count; }
+    [[nodiscard]] auto term_count(id_type document) const -> std::size_t
+    {
+        return m_offsets[document + 1] - m_offsets[document];
+    }
+    [[nodiscard]] auto posting_count() const -> std::size_t { return m_terms.size(); }
+
+    [[nodiscard]] auto terms(id_type document) const -> gsl::span<Term const>
+    {
+        return gsl::make_span(m_terms.data() + m_offsets[document], term_count(document));
+    }
+
+  private:
+    flat_forward_index() = default;
+
+    template <typename MapTerm>
+    static auto decode(forward_index const& fwd, std::size_t term_count, MapTerm map_term)
+        -> flat_forward_index
+    {
+        if (term_count > std::size_t(std::numeric_limits<Term>::max()) + 1) {
+            throw std::invalid_argument(fmt::format(
+                "Cannot store {} distinct terms in {}-byte term IDs", term_count, sizeof(Term)));
+        }
+        flat_forward_index flat;
+        flat.m_term_count = term_count;
+        flat.m_offsets.resize(fwd.size() + 1);
+        flat.m_offsets[0] = 0;
+        for (id_type doc = 0; doc < fwd.size(); ++doc) {
+            flat.m_offsets[doc + 1] = flat.m_offsets[doc] + fwd.term_count(doc);
+        }
+        flat.m_terms.resize(flat.m_offsets.back());
+        tbb::parallel_for(
+            tbb::blocked_range<id_type>(0, fwd.size()),
+            [&](tbb::blocked_range<id_type> const& range) {
+                for (auto doc = range.begin(); doc != range.end(); ++doc) {
+                    auto terms = fwd.terms(doc);
+                    std::transform(
+                        terms.begin(),
+                        terms.end(),
+                        flat.m_terms.data() + flat.m_offsets[doc],
+                        [&](auto term) { return static_cast<Term>(map_term(term)); });
+                }
+            });
+        return flat;
+    }
+
+    std::size_t m_term_count = 0;
+    std::vector<std::uint64_t, huge_page_allocator<std::uint64_t>> m_offsets{};
+    std::vector<Term, huge_page_allocator<Term>> m_terms{};
+};
+
+//! Numbers the terms occurring in at least one document of `fwd` consecutively, in increasing
+//! order of their original IDs.
+//!
+//! Returns the map from original to dense IDs (undefined for terms that do not occur) and the
+//! number of occurring terms. `fwd.term_count()` is the size of the whole vocabulary even when
+//! short lists were left out, so the dense count decides the narrowest term type instead.
+inline auto dense_term_ids(forward_index const& fwd) -> std::pair<std::vector<std::uint32_t>, std::size_t>
+{
+    std::vector<std::atomic<bool>> occurs(fwd.term_count());
+    tbb::parallel_for(
+        tbb::blocked_range<std::uint32_t>(0, fwd.size()),
+        [&](tbb::blocked_range<std::uint32_t> const& range) {
+            for (auto doc = range.begin(); doc != range.end(); ++doc) {
+                for (auto term: fwd.terms(doc)) {
+                    // Frequent terms are only read after the first write, avoiding contention.
+                    if (not occurs[term].load(std::memory_order_relaxed)) {
+                        occurs[term].store(true, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    std::vector<std::uint32_t> term_map(fwd.term_count(), 0);
+    std::uint32_t term_count = 0;
+    for (std::size_t term = 0; term < occurs.size(); ++term) {
+        if (occurs[term].load(std::memory_order_relaxed)) {
+            term_map[term] = term_count++;
+        }
+    }
+    return {std::move(term_map), term_count};
+}
+
+}  // namespace pisa
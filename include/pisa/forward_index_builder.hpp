@@ -4,6 +4,7 @@
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include <boost/filesystem.hpp>
@@ -15,7 +16,7 @@
 namespace pisa {
 
 using process_content_function_type =
-    std::function<void(std::string&&, std::function<void(std::string&&)>)>;
+    std::function<void(std::string&&, std::function<void(std::string_view)>)>;
 
 class Forward_Index_Builder {
   public:
@@ -72,6 +73,21 @@ class Forward_Index_Builder {
         std::ptrdiff_t batch_size,
         std::size_t threads) const;
 
+    /// Builds a forward index, splitting and parsing records in parallel.
+    ///
+    /// The input is split at record boundaries into chunks of roughly `chunk_size` bytes.
+    /// Each chunk is parsed by `record_parser(format, ...)` in a worker thread and processed
+    /// as a single batch. Batches are numbered in input order, so document IDs follow the order
+    /// of the records in the input stream.
+    void build_chunked(
+        std::istream& is,
+        std::string const& output_file,
+        std::string const& format,
+        std::size_t chunk_size,
+        TermTransformerBuilder term_transformer_builder,
+        process_content_function_type process_content,
+        std::size_t threads) const;
+
     /// Removes all intermediate batches.
     void remove_batches(std::string const& basename, std::ptrdiff_t batch_count) const;
 };
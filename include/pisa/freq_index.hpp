@@ -17,6 +17,8 @@ template <typename DocsSequence, typename FreqsSequence>
 class freq_index {
   public:
     using index_layout_tag = BitVectorIndexTag;
+    using docs_sequence_type = DocsSequence;
+    using freqs_sequence_type = FreqsSequence;
 
     freq_index() = default;
 
@@ -34,9 +36,21 @@ class freq_index {
               m_freqs_sequences(params)
         {}
 
+        /// Bits of the document and frequency sequences of a single posting list.
+        struct encoded_posting_list {
+            bit_vector_builder docs_bits;
+            bit_vector_builder freqs_bits;
+        };
+
+        /// Encodes a posting list into `encoded` without adding it to the index, so that lists
+        /// can be encoded concurrently and then added in order with `add_encoded_posting_list`.
         template <typename DocsIterator, typename FreqsIterator>
-        void add_posting_list(
-            uint64_t n, DocsIterator docs_begin, FreqsIterator freqs_begin, uint64_t occurrences)
+        void encode_posting_list(
+            uint64_t n,
+            DocsIterator docs_begin,
+            FreqsIterator freqs_begin,
+            uint64_t occurrences,
+            encoded_posting_list& encoded) const
         {
             if (!n) {
                 throw std::invalid_argument("List must be nonempty");
@@ -44,21 +58,34 @@ class freq_index {
 
             tbb::parallel_invoke(
                 [&] {
-                    bit_vector_builder docs_bits;
+                    auto& docs_bits = encoded.docs_bits;
                     write_gamma_nonzero(docs_bits, occurrences);
                     if (occurrences > 1) {
                         docs_bits.append_bits(n, ceil_log2(occurrences + 1));
                     }
                     DocsSequence::write(docs_bits, docs_begin, m_num_docs, n, m_params);
-                    m_docs_sequences.append(docs_bits);
                 },
                 [&] {
-                    bit_vector_builder freqs_bits;
-                    FreqsSequence::write(freqs_bits, freqs_begin, occurrences + 1, n, m_params);
-                    m_freqs_sequences.append(freqs_bits);
+                    FreqsSequence::write(
+                        encoded.freqs_bits, freqs_begin, occurrences + 1, n, m_params);
                 });
         }
 
+        void add_encoded_posting_list(encoded_posting_list& encoded)
+        {
+            m_docs_sequences.append(encoded.docs_bits);
+            m_freqs_sequences.append(encoded.freqs_bits);
+        }
+
+        template <typename DocsIterator, typename FreqsIterator>
+        void add_posting_list(
+            uint64_t n, DocsIterator docs_begin, FreqsIterator freqs_begin, uint64_t occurrences)
+        {
+            encoded_posting_list encoded;
+            encode_posting_list(n, docs_begin, freqs_begin, occurrences, encoded);
+            add_encoded_posting_list(encoded);
+        }
+
         void build(freq_index& sq)
         {
             sq.m_num_docs = m_num_docs;
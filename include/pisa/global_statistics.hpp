@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gsl/span>
+
+#include "type_safe.hpp"
+#include "vec_map.hpp"
+
+namespace pisa {
+
+/// Collection-wide statistics used in place of those of a single shard, so that the scores of
+/// documents in different shards are comparable. Term statistics are listed in the order of
+/// the term IDs of the shard they are used for.
+struct global_statistics {
+    std::uint64_t num_docs = 0;
+    std::uint64_t collection_len = 0;
+    std::vector<std::uint32_t> term_occurrence_counts;
+    std::vector<std::uint32_t> term_posting_counts;
+};
+
+/// Sums document and term statistics over all shards, and returns the global statistics of
+/// the terms of each shard.
+///
+/// Each shard is given by the basename of its binary collection and by its term list, whose
+/// lines are the terms of the consecutive posting lists. Terms are matched across shards by
+/// their strings.
+///
+/// \throws std::invalid_argument   if the numbers of collections and term lists differ, or if
+///                                 a term list does not match its collection
+[[nodiscard]] auto shard_global_statistics(
+    gsl::span<std::string const> collections, gsl::span<std::string const> term_lists)
+    -> VecMap<Shard_Id, global_statistics>;
+
+}  // namespace pisa
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <gsl/span>
+
+#include "payload_vector.hpp"
+#include "util/hash.hpp"
+
+namespace pisa {
+
+/// A term lexicon with constant-time term-to-ID lookup.
+///
+/// Terms are mapped to IDs with a minimal perfect hash function built by hash-and-displace:
+/// terms are distributed into small buckets, and each bucket stores a pilot value that sends
+/// all its terms to distinct slots of a table holding term IDs. The terms themselves are stored
+/// in a payload vector, so that terms outside of the lexicon can be rejected, and IDs can be
+/// resolved back to terms. Looking up a term costs one hash, two random accesses, and a single
+/// string comparison, regardless of the lexicon size. Unlike a `.termlex` file, the terms do not
+/// need to be sorted. The table has slightly more slots than terms (see `LOAD_FACTOR`), so that
+/// the last buckets to be placed still find free slots quickly.
+///
+/// Layout: magic, seed, bucket count, term count, slot count (8 bytes each), pilots (4 bytes per
+/// bucket), term IDs (4 bytes per slot), padding to 8 bytes, payload vector of terms.
+class Hashed_Lexicon {
+  public:
+    static constexpr std::uint64_t MAGIC = 0x48584c5f41534950;  // "PISA_LXH"
+    static constexpr std::size_t BUCKET_SIZE = 4;
+    static constexpr double LOAD_FACTOR = 0.99;
+
+    /// Returns the number of slots of the table for `term_count` terms.
+    [[nodiscard]] static auto slot_count(std::size_t term_count) -> std::size_t
+    {
+        return static_cast<std::size_t>(std::ceil(term_count / LOAD_FACTOR));
+    }
+
+    Hashed_Lexicon(
+        std::uint64_t seed,
+        gsl::span<std::uint32_t const> pilots,
+        gsl::span<std::uint32_t const> ids,
+        Payload_Vector<> terms)
+        : m_seed(seed), m_pilots(pilots), m_ids(ids), m_terms(terms)
+    {}
+
+    /// Checks if the memory starts with the hashed lexicon's magic number.
+    [[nodiscard]] static auto is_hashed_lexicon(gsl::span<std::byte const> mem) -> bool;
+
+    template <typename ContiguousContainer>
+    [[nodiscard]] static auto is_hashed_lexicon(ContiguousContainer&& mem) -> bool
+    {
+        return is_hashed_lexicon(
+            gsl::make_span(reinterpret_cast<std::byte const*>(mem.data()), mem.size()));
+    }
+
+    /// \throws std::runtime_error  if the memory does not contain a valid hashed lexicon
+    [[nodiscard]] static auto from(gsl::span<std::byte const> mem) -> Hashed_Lexicon;
+
+    template <typename ContiguousContainer>
+    [[nodiscard]] static auto from(ContiguousContainer&& mem) -> Hashed_Lexicon
+    {
+        return from(gsl::make_span(reinterpret_cast<std::byte const*>(mem.data()), mem.size()));
+    }
+
+    /// Returns the ID of `term`, or `std::nullopt` if it is not in the lexicon.
+    [[nodiscard]] auto find(std::string_view term) const -> std::optional<std::uint32_t>
+    {
+        if (m_terms.size() == 0) {
+            return std::nullopt;
+        }
+        auto hash = hash::murmur64(term, m_seed);
+        auto id = m_ids[slot(hash, m_pilots[bucket(hash, m_pilots.size())], m_ids.size())];
+        if (id < m_terms.size() && *(m_terms.begin() + id) == term) {
+            return id;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] auto operator[](std::uint32_t id) const -> std::string_view
+    {
+        return *(m_terms.begin() + id);
+    }
+    [[nodiscard]] auto terms() const -> Payload_Vector<> const& { return m_terms; }
+    [[nodiscard]] auto size() const -> std::size_t { return m_terms.size(); }
+
+    [[nodiscard]] static auto bucket(std::uint64_t hash, std::size_t bucket_count) -> std::size_t
+    {
+        return (hash >> 32U) % bucket_count;
+    }
+
+    [[nodiscard]] static auto slot(std::uint64_t hash, std::uint32_t pilot, std::size_t slot_count)
+        -> std::size_t
+    {
+        return hash::mix64(hash ^ hash::mix64(pilot)) % slot_count;
+    }
+
+  private:
+    std::uint64_t m_seed;
+    gsl::span<std::uint32_t const> m_pilots;
+    gsl::span<std::uint32_t const> m_ids;
+    Payload_Vector<> m_terms;
+};
+
+/// Builds a hashed lexicon and writes it to `os`. The ID of a term is its position in `terms`.
+///
+/// \throws std::invalid_argument   if `terms` contains duplicates
+void write_hashed_lexicon(gsl::span<std::string const> terms, std::ostream& os);
+
+}  // namespace pisa
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "binary_freq_collection.hpp"
+#include "bit_vector.hpp"
+#include "codec/block_codecs.hpp"
+#include "codec/compact_elias_fano.hpp"
+#include "configuration.hpp"
+#include "global_parameters.hpp"
+#include "linear_quantizer.hpp"
+#include "mappable/mappable_vector.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "query/queries.hpp"
+#include "scorer/scorer.hpp"
+#include "util/progress.hpp"
+#include "util/util.hpp"
+
+namespace pisa {
+
+/// A segment of an impact-ordered posting list: the IDs of all documents in which the term has
+/// the same quantized impact, compressed in blocks of `BlockCodec::block_size` gaps.
+template <typename BlockCodec>
+struct impact_segment {
+    std::uint32_t impact = 0;
+    std::uint32_t size = 0;
+    std::uint8_t const* data = nullptr;
+    float weight = 1.0F;
+
+    /// Score contributed to each document of the segment.
+    [[nodiscard]] auto score() const noexcept -> float { return weight * impact; }
+
+    /// Calls `fn(docid)` for each document of the segment in increasing docid order.
+    template <typename Fn>
+    void for_each(Fn&& fn) const
+    {
+        thread_local std::vector<std::uint32_t> buf(BlockCodec::block_size);
+        std::uint8_t const* ptr = data;
+        std::uint32_t docid = 0;
+        for (std::uint32_t pos = 0; pos < size; pos += BlockCodec::block_size) {
+            auto block_size = std::min<std::uint32_t>(BlockCodec::block_size, size - pos);
+            ptr = BlockCodec::decode(ptr, buf.data(), uint32_t(-1), block_size);
+            for (std::uint32_t i = 0; i < block_size; ++i) {
+                docid += buf[i];
+                fn(docid);
+                docid += 1;
+            }
+        }
+    }
+};
+
+/// An index whose posting lists are ordered by decreasing impact rather than by document ID.
+///
+/// Each list is a sequence of segments of postings with equal impact (a quantized score, see
+/// `LinearQuantizer`), in decreasing impact order. A segment is encoded as its impact, its
+/// length, and its size in bytes (all as variable bytes), followed by the gaps between its
+/// document IDs encoded with `BlockCodec`. Lists are meant to be processed score-at-a-time, see
+/// `ranked_or_saat_query`.
+template <typename BlockCodec>
+class impact_ordered_index {
+  public:
+    using block_codec_type = BlockCodec;
+    using segment_type = impact_segment<BlockCodec>;
+
+    impact_ordered_index() = default;
+    explicit impact_ordered_index(MemorySource source) : m_source(std::move(source))
+    {
+        mapper::map(*this, m_source.data(), mapper::map_flags::warmup);
+    }
+
+    class builder {
+      public:
+        builder(uint64_t num_docs, global_parameters const& params)
+            : m_params(params), m_num_docs(num_docs)
+        {
+            m_endpoints.push_back(0);
+        }
+
+        /// Adds a list of `n` postings, given in increasing docid order, with their impacts.
+        template <typename DocsIterator, typename ImpactsIterator>
+        void add_posting_list(uint64_t n, DocsIterator docs_begin, ImpactsIterator impacts_begin)
+        {
+            if (!n) {
+                throw std::invalid_argument("List must be nonempty");
+            }
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> postings(n);
+            for (auto& [impact, docid]: postings) {
+                docid = *docs_begin++;
+                impact = *impacts_begin++;
+            }
+            std::sort(postings.begin(), postings.end(), [](auto const& lhs, auto const& rhs) {
+                return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+            });
+            std::vector<std::uint8_t> segment_bytes;
+            std::vector<std::uint32_t> gaps(BlockCodec::block_size);
+            for (auto first = postings.begin(); first != postings.end();) {
+                auto last = std::find_if(first, postings.end(), [&](auto const& posting) {
+                    return posting.first != first->first;
+                });
+                segment_bytes.clear();
+                std::uint32_t next_docid = 0;
+                for (auto block = first; block != last;) {
+                    auto block_size =
+                        std::min<std::ptrdiff_t>(BlockCodec::block_size, std::distance(block, last));
+                    for (std::ptrdiff_t i = 0; i < block_size; ++i, ++block) {
+                        gaps[i] = block->second - next_docid;
+                        next_docid = block->second + 1;
+                    }
+                    BlockCodec::encode(gaps.data(), uint32_t(-1), block_size, segment_bytes);
+                }
+                TightVariableByte::encode_single(first->first, m_lists);
+                TightVariableByte::encode_single(std::distance(first, last), m_lists);
+                TightVariableByte::encode_single(segment_bytes.size(), m_lists);
+                m_lists.insert(m_lists.end(), segment_bytes.begin(), segment_bytes.end());
+                first = last;
+            }
+            m_endpoints.push_back(m_lists.size());
+        }
+
+        void build(impact_ordered_index& index)
+        {
+            index.m_params = m_params;
+            index.m_size = m_endpoints.size() - 1;
+            index.m_num_docs = m_num_docs;
+            index.m_lists.steal(m_lists);
+
+            bit_vector_builder bvb;
+            compact_elias_fano::write(
+                bvb, m_endpoints.begin(), index.m_lists.size(), index.m_size, m_params);
+            bit_vector(&bvb).swap(index.m_endpoints);
+        }
+
+      private:
+        global_parameters m_params;
+        size_t m_num_docs;
+        std::vector<uint64_t> m_endpoints;
+        std::vector<uint8_t> m_lists;
+    };
+
+    size_t size() const { return m_size; }
+
+    uint64_t num_docs() const { return m_num_docs; }
+
+    /// Returns the segments of list `i` in decreasing impact order.
+    auto segments(size_t i, float weight = 1.0F) const -> std::vector<segment_type>
+    {
+        assert(i < size());
+        auto [begin, end] = list_bounds(i);
+        std::vector<segment_type> segments;
+        std::uint8_t const* ptr = m_lists.data() + begin;
+        while (ptr != m_lists.data() + end) {
+            segment_type segment;
+            std::uint32_t bytes;
+            ptr = TightVariableByte::decode(ptr, &segment.impact, 1);
+            ptr = TightVariableByte::decode(ptr, &segment.size, 1);
+            ptr = TightVariableByte::decode(ptr, &bytes, 1);
+            segment.data = ptr;
+            segment.weight = weight;
+            segments.push_back(segment);
+            ptr += bytes;
+        }
+        return segments;
+    }
+
+    void warmup(size_t i) const
+    {
+        assert(i < size());
+        auto [begin, end] = list_bounds(i);
+        volatile uint32_t tmp;
+        for (size_t i = begin; i != end; ++i) {
+            tmp = m_lists[i];
+        }
+        (void)tmp;
+    }
+
+    template <typename Visitor>
+    void map(Visitor& visit)
+    {
+        visit(m_params, "m_params")(m_size, "m_size")(m_num_docs, "m_num_docs")(
+            m_endpoints, "m_endpoints")(m_lists, "m_lists");
+    }
+
+  private:
+    auto list_bounds(size_t i) const -> std::pair<std::uint64_t, std::uint64_t>
+    {
+        compact_elias_fano::enumerator endpoints(m_endpoints, 0, m_lists.size(), m_size, m_params);
+        auto begin = endpoints.move(i).second;
+        auto end = i + 1 != size() ? endpoints.move(i + 1).second : m_lists.size();
+        return {begin, end};
+    }
+
+    global_parameters m_params;
+    size_t m_size{0};
+    size_t m_num_docs{0};
+    bit_vector m_endpoints;
+    mapper::mappable_vector<uint8_t> m_lists;
+    MemorySource m_source;
+};
+
+/// Builds an impact-ordered index of `input`, with scores quantized as in quantized indexes
+/// built by `compress`, using the maximum score in `wdata`.
+template <typename BlockCodec, typename Wand>
+void build_impact_ordered_index(
+    binary_freq_collection const& input,
+    Wand const& wdata,
+    ScorerParams const& scorer_params,
+    impact_ordered_index<BlockCodec>& index)
+{
+    auto scorer = scorer::from_params(scorer_params, wdata);
+    LinearQuantizer quantizer(wdata.index_max_term_weight(), configuration::get().quantization_bits);
+    typename impact_ordered_index<BlockCodec>::builder builder(input.num_docs(), global_parameters{});
+    pisa::progress progress("Create impact-ordered index", input.size());
+    std::vector<std::uint32_t> impacts;
+    std::size_t term_id = 0;
+    for (auto const& plist: input) {
+        auto term_scorer = scorer->term_scorer(term_id);
+        impacts.clear();
+        for (std::size_t pos = 0; pos < plist.docs.size(); ++pos) {
+            impacts.push_back(quantizer(term_scorer(plist.docs.begin()[pos], plist.freqs.begin()[pos])));
+        }
+        builder.add_posting_list(plist.docs.size(), plist.docs.begin(), impacts.begin());
+        term_id += 1;
+        progress.update(1);
+    }
+    builder.build(index);
+}
+
+/// Returns the segments of all lists of the query terms; with `weighted`, the scores of the
+/// segments of a term are multiplied by its number of occurrences in the query.
+template <typename Index>
+[[nodiscard]] auto make_impact_segments(Index const& index, Query query, bool weighted = false)
+{
+    std::vector<typename Index::segment_type> segments;
+    for (auto [term, freq]: query_freqs(query.terms)) {
+        auto term_segments = index.segments(term, weighted ? freq : 1.0F);
+        segments.insert(segments.end(), term_segments.begin(), term_segments.end());
+    }
+    return segments;
+}
+
+}  // namespace pisa
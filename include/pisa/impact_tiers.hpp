@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <fmt/format.h>
+#include <gsl/span>
+#include <spdlog/spdlog.h>
+
+#include "binary_collection.hpp"
+#include "binary_freq_collection.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "query/queries.hpp"
+#include "scorer/scorer.hpp"
+#include "util/inverted_index_utils.hpp"
+#include "util/progress.hpp"
+#include "wand_data.hpp"
+
+namespace pisa {
+
+/// Term ID of a list that has no low-impact tier.
+constexpr std::uint32_t NO_LOW_TIER = std::numeric_limits<std::uint32_t>::max();
+
+/// How to split posting lists into tiers: lists longer than `min_length` keep the
+/// `ceil(ratio * n)` highest scoring postings in the high tier (along with ties), and the rest
+/// go to the low tier.
+struct ImpactTierOptions {
+    float ratio = 0.1F;
+    std::size_t min_length = 1024;
+};
+
+struct ImpactTierStats {
+    std::uint64_t split_terms = 0;
+    std::uint64_t high_tier_postings = 0;
+    std::uint64_t low_tier_postings = 0;
+};
+
+/// Maps terms of a tiered collection to their low-impact tiers.
+///
+/// In a tiered collection, list `t < term_count()` is the high tier of term `t`, which holds
+/// all postings of lists that were not split. Low tiers of split terms follow in term order.
+class impact_tiers {
+  public:
+    explicit impact_tiers(std::vector<std::uint32_t> low_tiers) : m_low_tiers(std::move(low_tiers))
+    {}
+
+    /// Reads low tiers written by `split_impact_tiers`.
+    static auto from_file(std::string const& filename) -> impact_tiers
+    {
+        binary_collection tiers(filename.c_str());
+        auto sequence = *tiers.begin();
+        return impact_tiers(std::vector<std::uint32_t>(sequence.begin(), sequence.end()));
+    }
+
+    [[nodiscard]] auto term_count() const -> std::size_t { return m_low_tiers.size(); }
+
+    [[nodiscard]] auto low_tier(term_id_type term) const -> std::optional<term_id_type>
+    {
+        if (auto tier = m_low_tiers.at(term); tier != NO_LOW_TIER) {
+            return tier;
+        }
+        return std::nullopt;
+    }
+
+    /// Returns the low tiers of the terms of `query`, with the weights of their terms.
+    [[nodiscard]] auto low_tiers(Query const& query) const -> Query
+    {
+        Query tiers{query.id, {}, {}};
+        for (std::size_t pos = 0; pos < query.terms.size(); ++pos) {
+            if (auto tier = low_tier(query.terms[pos]); tier) {
+                tiers.terms.push_back(*tier);
+                if (not query.term_weights.empty()) {
+                    tiers.term_weights.push_back(query.term_weights[pos]);
+                }
+            }
+        }
+        return tiers;
+    }
+
+    /// Returns `query` with the low tiers of its terms added.
+    [[nodiscard]] auto all_tiers(Query query) const -> Query
+    {
+        auto tiers = low_tiers(query);
+        query.terms.insert(query.terms.end(), tiers.terms.begin(), tiers.terms.end());
+        query.term_weights.insert(
+            query.term_weights.end(), tiers.term_weights.begin(), tiers.term_weights.end());
+        return query;
+    }
+
+  private:
+    std::vector<std::uint32_t> m_low_tiers;
+};
+
+namespace detail {
+
+    /// Returns the score of the posting at rank `ceil(ratio * n)`, or negative infinity if
+    /// all postings belong to the high tier.
+    template <typename TermScorer>
+    auto high_tier_threshold(
+        binary_freq_collection::sequence const& seq,
+        TermScorer const& term_scorer,
+        ImpactTierOptions const& options,
+        std::vector<float>& scores) -> float
+    {
+        auto length = seq.docs.size();
+        auto kept = std::max<std::size_t>(1, std::ceil(options.ratio * length));
+        if (length <= options.min_length || kept >= length) {
+            return -std::numeric_limits<float>::infinity();
+        }
+        scores.resize(length);
+        for (std::size_t pos = 0; pos < length; ++pos) {
+            scores[pos] = term_scorer(seq.docs.begin()[pos], seq.freqs.begin()[pos]);
+        }
+        auto nth = std::next(scores.begin(), kept - 1);
+        std::nth_element(scores.begin(), nth, scores.end(), std::greater<>{});
+        return *nth;
+    }
+
+}  // namespace detail
+
+/// Splits each long posting list of `input_basename` into a high-impact and a low-impact tier
+/// and writes the tiered collection (see `impact_tiers`) to `output_basename`, its low tiers to
+/// `<output_basename>.tiers`, and its WAND data to `output_wand_filename`.
+///
+/// Postings are scored, as when computing block upper bounds, with the collection statistics
+/// stored in `wand_filename`. Both tiers of a term keep the statistics of the term in the output
+/// WAND data, so that their postings score as in the original list, and a document scores the
+/// same when its postings are summed over all tiers of the query terms.
+template <typename WandType>
+auto split_impact_tiers(
+    std::string const& input_basename,
+    std::string const& output_basename,
+    std::string const& wand_filename,
+    std::string const& output_wand_filename,
+    ScorerParams const& scorer_params,
+    BlockSize block_size,
+    bool quantize,
+    ImpactTierOptions const& options) -> ImpactTierStats
+{
+    if (options.ratio <= 0.0F || options.ratio > 1.0F) {
+        throw std::invalid_argument(
+            fmt::format("High tier ratio must be in (0, 1] but is {}", options.ratio));
+    }
+    binary_freq_collection input(input_basename.c_str());
+    WandType const wdata(MemorySource::mapped_file(wand_filename));
+    if (wdata.num_docs() != input.num_docs() || wdata.num_terms() != input.size()) {
+        throw std::invalid_argument(fmt::format(
+            "WAND data of {} documents and {} terms do not match the collection of {} and {}",
+            wdata.num_docs(),
+            wdata.num_terms(),
+            input.num_docs(),
+            input.size()));
+    }
+    auto scorer = scorer::from_params(scorer_params, wdata);
+
+    ImpactTierStats stats;
+    std::vector<float> thresholds;
+    std::vector<std::uint32_t> low_tiers;
+    std::vector<std::uint32_t> term_occurrence_counts;
+    std::vector<std::uint32_t> term_posting_counts;
+    std::vector<float> scores;
+    {
+        pisa::progress progress("Selecting high tiers", input.size());
+        for (auto const& seq: input) {
+            auto term = thresholds.size();
+            auto threshold = detail::high_tier_threshold(
+                seq, scorer->term_scorer(term), options, scores);
+            thresholds.push_back(threshold);
+            term_occurrence_counts.push_back(wdata.term_occurrence_count(term));
+            term_posting_counts.push_back(wdata.term_posting_count(term));
+            low_tiers.push_back(NO_LOW_TIER);
+            progress.update(1);
+        }
+    }
+
+    boost::filesystem::copy_file(
+        fmt::format("{}.sizes", input_basename),
+        fmt::format("{}.sizes", output_basename),
+        boost::filesystem::copy_option::overwrite_if_exists);
+    std::ofstream dos(output_basename + ".docs");
+    std::ofstream fos(output_basename + ".freqs");
+    auto document_count = static_cast<std::uint32_t>(input.num_docs());
+    write_sequence(dos, gsl::make_span<std::uint32_t const>(&document_count, 1));
+
+    // A posting goes to the high tier if its score is at least the threshold of its term, and
+    // a low tier exists only if some posting does not.
+    auto write_tier = [&](auto const& seq, std::size_t term, bool high, auto&& fn) {
+        auto term_scorer = scorer->term_scorer(term);
+        std::vector<std::uint32_t> docs;
+        std::vector<std::uint32_t> freqs;
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            auto doc = seq.docs.begin()[pos];
+            auto freq = seq.freqs.begin()[pos];
+            if ((term_scorer(doc, freq) >= thresholds[term]) == high) {
+                docs.push_back(doc);
+                freqs.push_back(freq);
+            }
+        }
+        if (not docs.empty()) {
+            write_sequence(dos, gsl::span<std::uint32_t const>(docs));
+            write_sequence(fos, gsl::span<std::uint32_t const>(freqs));
+            fn(binary_freq_collection::sequence{
+                {docs.data(), docs.data() + docs.size()},
+                {freqs.data(), freqs.data() + freqs.size()}});
+        }
+        return docs.size();
+    };
+
+    // Low tiers must be known before building WAND data, whose statistics are passed upfront.
+    {
+        pisa::progress progress("Counting low tiers", input.size());
+        std::size_t term = 0;
+        std::uint32_t next_tier = input.size();
+        for (auto const& seq: input) {
+            if (thresholds[term] > -std::numeric_limits<float>::infinity()) {
+                auto term_scorer = scorer->term_scorer(term);
+                for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                    if (term_scorer(seq.docs.begin()[pos], seq.freqs.begin()[pos]) < thresholds[term]) {
+                        low_tiers[term] = next_tier++;
+                        term_occurrence_counts.push_back(term_occurrence_counts[term]);
+                        term_posting_counts.push_back(term_posting_counts[term]);
+                        break;
+                    }
+                }
+            }
+            term += 1;
+            progress.update(1);
+        }
+    }
+
+    std::vector<std::uint32_t> doc_lens(input.num_docs());
+    for (std::size_t doc = 0; doc < doc_lens.size(); ++doc) {
+        doc_lens[doc] = wdata.doc_len(doc);
+    }
+    WandType tiered_wdata(
+        std::move(doc_lens),
+        std::move(term_occurrence_counts),
+        std::move(term_posting_counts),
+        scorer_params,
+        block_size,
+        quantize,
+        [&](auto&& fn) {
+            pisa::progress progress("Writing tiers", 2 * input.size());
+            std::size_t term = 0;
+            for (auto const& seq: input) {
+                stats.high_tier_postings += write_tier(seq, term, true, fn);
+                term += 1;
+                progress.update(1);
+            }
+            term = 0;
+            for (auto const& seq: input) {
+                if (low_tiers[term] != NO_LOW_TIER) {
+                    stats.low_tier_postings += write_tier(seq, term, false, fn);
+                    stats.split_terms += 1;
+                }
+                term += 1;
+                progress.update(1);
+            }
+        });
+    mapper::freeze(tiered_wdata, output_wand_filename.c_str());
+
+    std::ofstream tos(output_basename + ".tiers");
+    write_sequence(tos, gsl::span<std::uint32_t const>(low_tiers));
+    spdlog::info(
+        "Split {} lists: {} postings in high tiers, {} in low tiers",
+        stats.split_terms,
+        stats.high_tier_postings,
+        stats.low_tier_postings);
+    return stats;
+}
+
+}  // namespace pisa
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
 #include "boost/preprocessor/cat.hpp"
 #include "boost/preprocessor/seq/for_each.hpp"
 #include "boost/preprocessor/stringize.hpp"
 
 #include "codec/block_codecs.hpp"
+#include "codec/hybrid_block.hpp"
 #include "codec/maskedvbyte.hpp"
 #include "codec/qmx.hpp"
 #include "codec/simdbp.hpp"
@@ -43,12 +48,41 @@ using block_simple8b_index = block_freq_index<pisa::simple8b_block>;
 using block_simple16_index = block_freq_index<pisa::simple16_block>;
 using block_simdbp_index = block_freq_index<pisa::simdbp_block>;
 
+// Shorter blocks tighten block-max score bounds for skipping, while longer ones speed up
+// decoding long sequential runs of postings.
+using block_optpfor_64_index = block_freq_index<pisa::basic_optpfor_block<64>>;
+using block_optpfor_256_index = block_freq_index<pisa::basic_optpfor_block<256>>;
+using block_simdbp_256_index = block_freq_index<pisa::basic_simdbp_block<256>>;
+
+using block_hybrid_index = block_freq_index<pisa::hybrid_block>;
+
 }  // namespace pisa
 
-#define PISA_INDEX_TYPES                                                                    \
-    (ef)(single)(pefuniform)(pefopt)(block_optpfor)(block_varintg8iu)(block_streamvbyte)(   \
-        block_maskedvbyte)(block_interpolative)(block_qmx)(block_varintgb)(block_simple8b)( \
-        block_simple16)(block_simdbp)
+#define PISA_INDEX_TYPES                                                                     \
+    (ef)(single)(pefuniform)(pefopt)(block_optpfor)(block_varintg8iu)(block_streamvbyte)(    \
+        block_maskedvbyte)(block_interpolative)(block_qmx)(block_varintgb)(block_simple8b)(  \
+        block_simple16)(block_simdbp)(block_optpfor_64)(block_optpfor_256)(block_simdbp_256)( \
+        block_hybrid)
 #define PISA_BLOCK_INDEX_TYPES                                                                    \
     (block_optpfor)(block_varintg8iu)(block_streamvbyte)(block_maskedvbyte)(block_interpolative)( \
-        block_qmx)(block_varintgb)(block_simple8b)(block_simple16)(block_simdbp)
+        block_qmx)(block_varintgb)(block_simple8b)(block_simple16)(block_simdbp)(                 \
+        block_optpfor_64)(block_optpfor_256)(block_simdbp_256)(block_hybrid)
+
+namespace pisa {
+
+/// Returns the number of postings per block of the block index type `encoding`, or nothing if
+/// it is not a block index type.
+[[nodiscard]] inline auto block_index_block_size(std::string_view encoding)
+    -> std::optional<std::uint64_t>
+{
+#define LOOP_BODY(R, DATA, T)                                         \
+    if (encoding == BOOST_PP_STRINGIZE(T)) {                          \
+        return BOOST_PP_CAT(T, _index)::block_codec_type::block_size; \
+    }                                                                 \
+    /**/
+    BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_BLOCK_INDEX_TYPES);
+#undef LOOP_BODY
+    return std::nullopt;
+}
+
+}  // namespace pisa
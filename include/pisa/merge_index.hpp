@@ -0,0 +1,467 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "binary_freq_collection.hpp"
+#include "block_freq_index.hpp"
+#include "global_parameters.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "payload_vector.hpp"
+#include "util/progress.hpp"
+#include "wand_data.hpp"
+
+namespace pisa {
+
+/// Marks a term that does not occur in one of the merged indexes.
+constexpr std::uint32_t ABSENT_TERM = std::numeric_limits<std::uint32_t>::max();
+
+/// For each merged index, the ID of each term of the merged index in that index,
+/// or `ABSENT_TERM` if it does not occur in it.
+using TermMapping = std::vector<std::vector<std::uint32_t>>;
+
+/// WAND data files of the merged indexes, in the same order, and how to build the merged one.
+struct MergeWandOptions {
+    std::vector<std::string> inputs;
+    std::string output;
+    ScorerParams scorer_params;
+    BlockSize block_size;
+    bool quantize = false;
+};
+
+/// Merges sorted term lexicons into `output_lexicon` and returns the mapping of merged term IDs
+/// to the term IDs of each lexicon.
+inline auto merge_term_lexicons(
+    std::vector<std::string> const& lexicons, std::string const& output_lexicon) -> TermMapping
+{
+    std::vector<Payload_Vector_Buffer> buffers;
+    buffers.reserve(lexicons.size());
+    for (auto const& lexicon: lexicons) {
+        buffers.push_back(Payload_Vector_Buffer::from_file(lexicon));
+    }
+    std::vector<Payload_Vector<std::string_view>> terms;
+    for (auto const& buffer: buffers) {
+        terms.emplace_back(buffer);
+    }
+
+    using entry_type = std::pair<std::string_view, std::size_t>;
+    std::priority_queue<entry_type, std::vector<entry_type>, std::greater<>> heap;
+    std::vector<std::uint32_t> positions(terms.size(), 0);
+    for (std::size_t part = 0; part < terms.size(); ++part) {
+        if (terms[part].size() > 0) {
+            heap.emplace(terms[part][0], part);
+        }
+    }
+    TermMapping mapping(terms.size());
+    std::vector<std::string_view> merged;
+    while (not heap.empty()) {
+        auto term = heap.top().first;
+        for (auto& part_mapping: mapping) {
+            part_mapping.push_back(ABSENT_TERM);
+        }
+        while (not heap.empty() && heap.top().first == term) {
+            auto part = heap.top().second;
+            heap.pop();
+            mapping[part].back() = positions[part]++;
+            if (positions[part] < terms[part].size()) {
+                heap.emplace(terms[part][positions[part]], part);
+            }
+        }
+        merged.push_back(term);
+    }
+    encode_payload_vector(merged.begin(), merged.end()).to_file(output_lexicon);
+    return mapping;
+}
+
+/// Returns the mapping for indexes that share term IDs, where each index contains
+/// the given number of terms.
+inline auto identity_term_mapping(std::vector<std::size_t> const& term_counts) -> TermMapping
+{
+    auto term_count = *std::max_element(term_counts.begin(), term_counts.end());
+    TermMapping mapping;
+    for (auto count: term_counts) {
+        auto& part_mapping = mapping.emplace_back(term_count, ABSENT_TERM);
+        std::iota(part_mapping.begin(), std::next(part_mapping.begin(), count), 0);
+    }
+    return mapping;
+}
+
+/// Concatenates document lexicons in the order of the merged indexes.
+inline void concatenate_document_lexicons(
+    std::vector<std::string> const& lexicons, std::string const& output_lexicon)
+{
+    std::vector<Payload_Vector_Buffer> buffers;
+    buffers.reserve(lexicons.size());
+    std::vector<std::string_view> documents;
+    for (auto const& lexicon: lexicons) {
+        auto const& buffer = buffers.emplace_back(Payload_Vector_Buffer::from_file(lexicon));
+        auto part = Payload_Vector<std::string_view>(buffer);
+        documents.insert(documents.end(), part.begin(), part.end());
+    }
+    encode_payload_vector(documents.begin(), documents.end()).to_file(output_lexicon);
+}
+
+namespace detail {
+
+    /// A block of a merged list, either copied verbatim from one of the input lists,
+    /// or encoded from postings that could not be copied.
+    template <typename BlockData>
+    struct MergedBlock {
+        std::uint32_t index = 0;
+        std::uint32_t max = 0;
+        std::optional<BlockData> copied{};
+        std::vector<std::uint8_t> docs{};
+        std::vector<std::uint8_t> freqs{};
+
+        /// Appends the documents of either the copied block or the encoded postings.
+        void append_docs_block(std::vector<std::uint8_t>& out) const
+        {
+            if (copied) {
+                copied->append_docs_block(out);
+            } else {
+                out.insert(out.end(), docs.begin(), docs.end());
+            }
+        }
+
+        /// Appends the frequencies of either the copied block or the encoded postings.
+        void append_freqs_block(std::vector<std::uint8_t>& out) const
+        {
+            if (copied) {
+                copied->append_freqs_block(out);
+            } else {
+                out.insert(out.end(), freqs.begin(), freqs.end());
+            }
+        }
+    };
+
+    /// A merged posting list, with its postings decoded only if requested.
+    struct MergedList {
+        std::uint64_t size = 0;
+        std::uint64_t occurrences = 0;
+        std::vector<std::uint8_t> bytes;
+        std::vector<std::uint32_t> docs;
+        std::vector<std::uint32_t> freqs;
+    };
+
+    /// Appends lists of the block index `Index` with shifted document IDs, copying encoded blocks
+    /// whenever they start at a block boundary of the output list and have the same base, that
+    /// is, the previous document is shifted by the same offset. Other blocks, typically the first
+    /// block of each appended list and the ones following a partial block, are re-encoded.
+    template <typename Index>
+    class block_list_merger {
+        using codec_type = typename Index::block_codec_type;
+        using block_data = typename Index::document_enumerator::block_data;
+        static constexpr std::uint64_t block_size = codec_type::block_size;
+
+      public:
+        void append(typename Index::document_enumerator list, std::uint32_t offset, bool last)
+        {
+            std::uint64_t n = list.size();
+            auto blocks = list.get_blocks();
+            for (std::uint32_t block = 0; block < blocks.size(); ++block) {
+                std::uint64_t begin = block * block_size;
+                std::uint64_t end = begin + blocks[block].size;
+                std::int64_t base =
+                    (block == 0 ? 0 : std::int64_t(blocks[block - 1].max) + 1) + offset;
+                bool is_full = blocks[block].size == block_size;
+                bool is_final = last && end == n;
+                if (m_docs.empty() && base == m_last_max + 1 && (is_full || is_final)) {
+                    auto& copied = m_blocks.emplace_back();
+                    copied.index = m_blocks.size() - 1;
+                    copied.max = blocks[block].max + offset;
+                    copied.copied = blocks[block];
+                    m_last_max = copied.max;
+                    m_size += end - begin;
+                    continue;
+                }
+                list.move(begin);
+                for (auto pos = begin; pos < end; ++pos, list.next()) {
+                    m_docs.push_back(list.docid() + offset);
+                    m_freqs.push_back(list.freq() - 1);
+                    if (m_docs.size() == block_size) {
+                        flush();
+                    }
+                }
+            }
+        }
+
+        /// Writes the merged list to `out`.
+        void finish(std::vector<std::uint8_t>& out)
+        {
+            if (not m_docs.empty()) {
+                flush();
+            }
+            block_posting_list<codec_type>::write_blocks(out, m_size, m_blocks);
+        }
+
+        [[nodiscard]] auto copied_blocks() const -> std::size_t
+        {
+            return std::count_if(m_blocks.begin(), m_blocks.end(), [](auto const& block) {
+                return block.copied.has_value();
+            });
+        }
+
+      private:
+        void flush()
+        {
+            auto& encoded = m_blocks.emplace_back();
+            encoded.index = m_blocks.size() - 1;
+            encoded.max = m_docs.back();
+            auto base = m_last_max + 1;
+            auto last_doc = m_last_max;
+            for (auto& doc: m_docs) {
+                auto gap = doc - last_doc - 1;
+                last_doc = doc;
+                doc = gap;
+            }
+            codec_type::encode(
+                m_docs.data(), encoded.max - base - (m_docs.size() - 1), m_docs.size(), encoded.docs);
+            codec_type::encode(m_freqs.data(), std::uint32_t(-1), m_freqs.size(), encoded.freqs);
+            m_last_max = encoded.max;
+            m_size += m_docs.size();
+            m_docs.clear();
+            m_freqs.clear();
+        }
+
+        std::vector<MergedBlock<block_data>> m_blocks{};
+        std::vector<std::uint32_t> m_docs{};
+        std::vector<std::uint32_t> m_freqs{};
+        std::int64_t m_last_max = -1;
+        std::uint64_t m_size = 0;
+    };
+
+}  // namespace detail
+
+/// Merges compressed indexes of consecutive document ranges: documents of the `i`-th index
+/// are shifted by the total number of documents in the preceding ones. Without a term mapping,
+/// the indexes are assumed to share term IDs.
+///
+/// For block indexes, encoded blocks are copied verbatim whenever possible, and only blocks
+/// at the boundaries between the merged lists are re-encoded. Other indexes are re-encoded.
+/// If `wand_options` are given, WAND data are merged as well: document lengths are concatenated
+/// and term statistics summed, but scores are recomputed from the merged lists, since they
+/// depend on collection statistics. For the same reason, quantized indexes should not be merged.
+template <typename IndexType, typename WandType>
+void merge_indexes(
+    std::vector<std::string> const& index_filenames,
+    std::string const& output_filename,
+    std::optional<TermMapping> const& input_term_mapping,
+    std::optional<MergeWandOptions> const& wand_options,
+    std::size_t batch_postings = 1U << 24U)
+{
+    constexpr bool is_block_index =
+        std::is_same_v<typename IndexType::index_layout_tag, BlockIndexTag>;
+    if (index_filenames.empty()) {
+        throw std::invalid_argument("No indexes to merge");
+    }
+    std::deque<IndexType> indexes;
+    std::vector<std::uint32_t> offsets;
+    std::uint64_t num_docs = 0;
+    for (auto const& filename: index_filenames) {
+        indexes.emplace_back(MemorySource::mapped_file(filename));
+        offsets.push_back(num_docs);
+        num_docs += indexes.back().num_docs();
+    }
+    if (num_docs > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument(fmt::format("Too many documents: {}", num_docs));
+    }
+    auto term_mapping = [&] {
+        if (input_term_mapping) {
+            return *input_term_mapping;
+        }
+        std::vector<std::size_t> term_counts;
+        for (auto const& index: indexes) {
+            term_counts.push_back(index.size());
+        }
+        return identity_term_mapping(term_counts);
+    }();
+    if (term_mapping.size() != index_filenames.size()) {
+        throw std::invalid_argument(fmt::format(
+            "Term mapping for {} indexes but {} indexes given",
+            term_mapping.size(),
+            index_filenames.size()));
+    }
+    std::size_t term_count = term_mapping.front().size();
+    for (std::size_t part = 0; part < indexes.size(); ++part) {
+        auto const& part_mapping = term_mapping[part];
+        if (part_mapping.size() != term_count) {
+            throw std::invalid_argument("Term mappings must have the same length");
+        }
+        if (std::any_of(part_mapping.begin(), part_mapping.end(), [&](auto term) {
+                return term != ABSENT_TERM && term >= indexes[part].size();
+            })) {
+            throw std::invalid_argument(fmt::format("Invalid term mapping for index {}", part));
+        }
+    }
+    spdlog::info(
+        "Merging {} indexes into {} lists of {} documents", indexes.size(), term_count, num_docs);
+
+    bool decode = wand_options.has_value() || not is_block_index;
+    std::size_t copied_blocks = 0;
+    auto merge_list = [&](std::size_t term, detail::MergedList& out) {
+        out.size = 0;
+        out.occurrences = 0;
+        out.bytes.clear();
+        out.docs.clear();
+        out.freqs.clear();
+        std::size_t last_part = 0;
+        for (std::size_t part = 0; part < indexes.size(); ++part) {
+            if (auto part_term = term_mapping[part][term]; part_term != ABSENT_TERM) {
+                out.size += indexes[part][part_term].size();
+                last_part = part;
+            }
+        }
+        if (out.size == 0) {
+            throw std::invalid_argument(fmt::format("Term {} does not occur in any index", term));
+        }
+        if (decode) {
+            out.docs.reserve(out.size);
+            out.freqs.reserve(out.size);
+            for (std::size_t part = 0; part < indexes.size(); ++part) {
+                if (auto part_term = term_mapping[part][term]; part_term != ABSENT_TERM) {
+                    auto list = indexes[part][part_term];
+                    for (std::size_t pos = 0; pos < list.size(); ++pos, list.next()) {
+                        out.docs.push_back(list.docid() + offsets[part]);
+                        out.freqs.push_back(list.freq());
+                        out.occurrences += out.freqs.back();
+                    }
+                }
+            }
+        }
+        if constexpr (is_block_index) {
+            detail::block_list_merger<IndexType> merger;
+            for (std::size_t part = 0; part <= last_part; ++part) {
+                if (auto part_term = term_mapping[part][term]; part_term != ABSENT_TERM) {
+                    merger.append(indexes[part][part_term], offsets[part], part == last_part);
+                }
+            }
+            merger.finish(out.bytes);
+            return merger.copied_blocks();
+        }
+        return std::size_t(0);
+    };
+
+    auto merge = [&](auto&& builder, auto&& on_list) {
+        pisa::progress progress("Merging posting lists", term_count);
+        std::vector<detail::MergedList> batch;
+        std::vector<std::size_t> batch_copied_blocks;
+        std::size_t first = 0;
+        while (first < term_count) {
+            std::size_t last = first;
+            std::size_t postings = 0;
+            while (last < term_count && (last == first || postings < batch_postings)) {
+                for (std::size_t part = 0; part < indexes.size(); ++part) {
+                    if (auto part_term = term_mapping[part][last]; part_term != ABSENT_TERM) {
+                        postings += indexes[part][part_term].size();
+                    }
+                }
+                last += 1;
+            }
+            batch.resize(last - first);
+            batch_copied_blocks.assign(last - first, 0);
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(first, last),
+                [&](tbb::blocked_range<std::size_t> const& range) {
+                    for (auto term = range.begin(); term != range.end(); ++term) {
+                        batch_copied_blocks[term - first] = merge_list(term, batch[term - first]);
+                    }
+                });
+            for (auto const& list: batch) {
+                if constexpr (is_block_index) {
+                    builder.add_posting_list(list.bytes);
+                } else {
+                    builder.add_posting_list(
+                        list.size, list.docs.begin(), list.freqs.begin(), list.occurrences);
+                }
+                on_list(list);
+            }
+            copied_blocks += std::accumulate(
+                batch_copied_blocks.begin(), batch_copied_blocks.end(), std::size_t(0));
+            progress.update(last - first);
+            first = last;
+        }
+    };
+    auto merge_and_build = [&](auto&& on_list) {
+        if constexpr (is_block_index) {
+            typename IndexType::stream_builder builder(num_docs, global_parameters{});
+            merge(builder, on_list);
+            builder.build(output_filename);
+        } else {
+            typename IndexType::builder builder(num_docs, global_parameters{});
+            merge(builder, on_list);
+            IndexType merged;
+            builder.build(merged);
+            mapper::freeze(merged, output_filename.c_str());
+        }
+    };
+
+    if (wand_options) {
+        if (wand_options->inputs.size() != indexes.size()) {
+            throw std::invalid_argument(fmt::format(
+                "{} WAND data files given for {} indexes",
+                wand_options->inputs.size(),
+                indexes.size()));
+        }
+        std::vector<std::uint32_t> doc_lens;
+        doc_lens.reserve(num_docs);
+        std::vector<std::uint32_t> term_occurrence_counts(term_count, 0);
+        std::vector<std::uint32_t> term_posting_counts(term_count, 0);
+        for (std::size_t part = 0; part < indexes.size(); ++part) {
+            WandType const wdata(MemorySource::mapped_file(wand_options->inputs[part]));
+            if (wdata.num_docs() != indexes[part].num_docs()) {
+                throw std::invalid_argument(fmt::format(
+                    "WAND data {} has {} documents but the index has {}",
+                    wand_options->inputs[part],
+                    wdata.num_docs(),
+                    indexes[part].num_docs()));
+            }
+            for (std::size_t doc = 0; doc < wdata.num_docs(); ++doc) {
+                doc_lens.push_back(wdata.doc_len(doc));
+            }
+            for (std::size_t term = 0; term < term_count; ++term) {
+                if (auto part_term = term_mapping[part][term]; part_term != ABSENT_TERM) {
+                    term_occurrence_counts[term] += wdata.term_occurrence_count(part_term);
+                    term_posting_counts[term] += wdata.term_posting_count(part_term);
+                }
+            }
+        }
+        WandType merged_wdata(
+            std::move(doc_lens),
+            std::move(term_occurrence_counts),
+            std::move(term_posting_counts),
+            wand_options->scorer_params,
+            wand_options->block_size,
+            wand_options->quantize,
+            [&](auto&& fn) {
+                merge_and_build([&](detail::MergedList const& list) {
+                    fn(binary_freq_collection::sequence{
+                        {list.docs.data(), list.docs.data() + list.docs.size()},
+                        {list.freqs.data(), list.freqs.data() + list.freqs.size()}});
+                });
+            });
+        mapper::freeze(merged_wdata, wand_options->output.c_str());
+    } else {
+        merge_and_build([](auto const&) {});
+    }
+    if constexpr (is_block_index) {
+        spdlog::info("Copied {} encoded blocks verbatim", copied_blocks);
+    }
+}
+
+}  // namespace pisa
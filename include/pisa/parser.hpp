@@ -3,18 +3,55 @@
 #include <functional>
 #include <istream>
 #include <optional>
+#include <string>
+#include <string_view>
 
 #include "document_record.hpp"
 
 namespace pisa {
 
-void parse_plaintext_content(std::string&& content, std::function<void(std::string&&)> process);
-void parse_html_content(std::string&& content, std::function<void(std::string&&)> process);
+/// Content parsers pass each token to `process` as a view that is only valid during the call.
+void parse_plaintext_content(std::string&& content, std::function<void(std::string_view)> process);
+void parse_html_content(std::string&& content, std::function<void(std::string_view)> process);
 
 std::function<std::optional<Document_Record>(std::istream&)>
 record_parser(std::string const& type, std::istream& is);
 
-std::function<void(std::string&& constent, std::function<void(std::string&&)>)>
+/// Finds where records end in a buffer that starts at a record boundary.
+///
+/// Returns the end of the first record that ends at or after `min_size`, or `std::nullopt` if no
+/// such record is complete within the buffer.
+using Record_Boundary =
+    std::function<std::optional<std::size_t>(std::string_view buffer, std::size_t min_size)>;
+
+/// Returns the function that finds record boundaries of the given format, or `std::nullopt` if
+/// records of this format cannot be located without parsing them.
+///
+/// Plaintext records end at a new line, and TREC records at the end of the line of their closing
+/// `</DOC>` tag. WARC records are framed by their `Content-Length` header field, so that a record
+/// whose content contains a WARC header is never split.
+[[nodiscard]] auto record_boundary(std::string const& type) -> std::optional<Record_Boundary>;
+
+/// Reads an input stream in large chunks, each ending at a record boundary.
+///
+/// Every chunk holds a sequence of complete records and can be parsed with `record_parser`
+/// independently of the other chunks. The stream is only read sequentially, so it can be
+/// any input stream, including a decompressed pipe or a filtering stream.
+class Record_Chunk_Reader {
+  public:
+    Record_Chunk_Reader(std::istream& is, Record_Boundary boundary, std::size_t chunk_size);
+
+    /// Returns the next chunk, or `std::nullopt` when the stream is exhausted.
+    [[nodiscard]] auto next() -> std::optional<std::string>;
+
+  private:
+    std::istream& m_is;
+    Record_Boundary m_boundary;
+    std::size_t m_chunk_size;
+    std::string m_carry{};
+};
+
+std::function<void(std::string&& constent, std::function<void(std::string_view)>)>
 content_parser(std::optional<std::string> const& type);
 
 }  // namespace pisa
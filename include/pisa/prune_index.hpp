@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <fmt/format.h>
+#include <gsl/span>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "binary_freq_collection.hpp"
+#include "hashed_lexicon.hpp"
+#include "memory_source.hpp"
+#include "payload_vector.hpp"
+#include "query/queries.hpp"
+#include "scorer/index_scorer.hpp"
+#include "topk_queue.hpp"
+#include "util/inverted_index_utils.hpp"
+#include "util/progress.hpp"
+
+namespace pisa {
+
+enum class PruningStrategy {
+    /// Drops postings scoring below a threshold common to all terms.
+    Global,
+    /// Drops postings of each term scoring below `epsilon` times its `k`-th highest score.
+    ///
+    /// > D. Carmel, D. Cohen, R. Fagin, E. Farchi, M. Herscovici, Y. S. Maarek, and A. Soffer.
+    /// > 2001. Static index pruning for information retrieval systems. In Proceedings of SIGIR
+    /// > '01. 43-50.
+    TermCentric,
+    /// Keeps the `ratio` highest scoring postings of each document.
+    ///
+    /// > S. Büttcher and C. L. A. Clarke. 2006. A document-centric approach to static index
+    /// > pruning in text retrieval systems. In Proceedings of CIKM '06. 182-189.
+    DocumentCentric,
+};
+
+struct PruningOptions {
+    PruningStrategy strategy = PruningStrategy::TermCentric;
+    float threshold = 0.0F;
+    std::size_t k = 10;
+    float epsilon = 0.5F;
+    float ratio = 0.5F;
+};
+
+struct PruningStats {
+    std::uint64_t input_postings = 0;
+    std::uint64_t output_postings = 0;
+    std::uint64_t dropped_terms = 0;
+};
+
+namespace detail {
+
+    /// Returns the score under which postings of each document are dropped, keeping
+    /// `ceil(ratio * n)` postings of a document with `n` postings (ties are kept).
+    template <typename Scorer>
+    auto document_thresholds(binary_freq_collection const& input, Scorer const& scorer, float ratio)
+        -> std::vector<float>
+    {
+        std::vector<std::uint64_t> offsets(input.num_docs() + 1, 0);
+        for (auto const& seq: input) {
+            for (auto doc: seq.docs) {
+                offsets[doc + 1] += 1;
+            }
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<float> scores(offsets.back());
+        std::vector<std::uint64_t> positions(offsets.begin(), std::prev(offsets.end()));
+        {
+            pisa::progress progress("Scoring postings", input.size());
+            std::size_t term = 0;
+            for (auto const& seq: input) {
+                auto term_scorer = scorer.term_scorer(term);
+                for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                    auto doc = seq.docs.begin()[pos];
+                    scores[positions[doc]++] = term_scorer(doc, seq.freqs.begin()[pos]);
+                }
+                term += 1;
+                progress.update(1);
+            }
+        }
+        std::vector<float> thresholds(input.num_docs(), 0.0F);
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, input.num_docs()),
+            [&](tbb::blocked_range<std::size_t> const& range) {
+                for (auto doc = range.begin(); doc != range.end(); ++doc) {
+                    auto first = std::next(scores.begin(), offsets[doc]);
+                    auto last = std::next(scores.begin(), offsets[doc + 1]);
+                    auto kept = static_cast<std::size_t>(std::ceil(ratio * (last - first)));
+                    if (kept == 0) {
+                        thresholds[doc] = std::numeric_limits<float>::infinity();
+                    } else if (kept < static_cast<std::size_t>(last - first)) {
+                        auto nth = std::next(first, kept - 1);
+                        std::nth_element(first, nth, last, std::greater<>{});
+                        thresholds[doc] = *nth;
+                    }
+                }
+            });
+        return thresholds;
+    }
+
+}  // namespace detail
+
+/// Writes to `output_basename` the collection `input_basename` without postings whose scores,
+/// as computed by `scorer`, are deemed too low by `options.strategy`.
+///
+/// Document sizes are copied, so the pruned collection can be scored with the statistics of
+/// the original one. As in `sample_inverted_index`, terms left without postings are not
+/// written and are inserted into `terms_to_drop`; this shifts the IDs of the following terms,
+/// and `write_pruned_lexicon` writes a term lexicon matching them.
+template <typename Scorer>
+auto prune_inverted_index(
+    std::string const& input_basename,
+    std::string const& output_basename,
+    Scorer const& scorer,
+    PruningOptions const& options,
+    std::unordered_set<std::size_t>& terms_to_drop) -> PruningStats
+{
+    if (options.strategy == PruningStrategy::DocumentCentric
+        && (options.ratio < 0.0F || options.ratio > 1.0F)) {
+        throw std::invalid_argument(
+            fmt::format("Document ratio must be between 0 and 1 but is {}", options.ratio));
+    }
+    if (options.strategy == PruningStrategy::TermCentric && options.k == 0) {
+        throw std::invalid_argument("Term-centric pruning requires positive k");
+    }
+    binary_freq_collection input(input_basename.c_str());
+    std::vector<float> document_thresholds;
+    if (options.strategy == PruningStrategy::DocumentCentric) {
+        document_thresholds = detail::document_thresholds(input, scorer, options.ratio);
+    }
+
+    boost::filesystem::copy_file(
+        fmt::format("{}.sizes", input_basename),
+        fmt::format("{}.sizes", output_basename),
+        boost::filesystem::copy_option::overwrite_if_exists);
+    std::ofstream dos(output_basename + ".docs");
+    std::ofstream fos(output_basename + ".freqs");
+    auto document_count = static_cast<std::uint32_t>(input.num_docs());
+    write_sequence(dos, gsl::make_span<std::uint32_t const>(&document_count, 1));
+
+    PruningStats stats;
+    std::vector<float> scores;
+    std::vector<std::uint32_t> pruned_docs;
+    std::vector<std::uint32_t> pruned_freqs;
+    pisa::progress progress("Pruning inverted index", input.size());
+    std::size_t term = 0;
+    for (auto const& seq: input) {
+        auto term_scorer = scorer.term_scorer(term);
+        scores.resize(seq.docs.size());
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            scores[pos] = term_scorer(seq.docs.begin()[pos], seq.freqs.begin()[pos]);
+        }
+        float term_threshold = options.threshold;
+        if (options.strategy == PruningStrategy::TermCentric) {
+            term_threshold = 0.0F;
+            if (scores.size() > options.k) {
+                std::vector<float> top(scores);
+                auto kth = std::next(top.begin(), options.k - 1);
+                std::nth_element(top.begin(), kth, top.end(), std::greater<>{});
+                term_threshold = options.epsilon * *kth;
+            }
+        }
+        pruned_docs.clear();
+        pruned_freqs.clear();
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            auto doc = seq.docs.begin()[pos];
+            auto threshold = options.strategy == PruningStrategy::DocumentCentric
+                ? document_thresholds[doc]
+                : term_threshold;
+            if (scores[pos] >= threshold) {
+                pruned_docs.push_back(doc);
+                pruned_freqs.push_back(seq.freqs.begin()[pos]);
+            }
+        }
+        stats.input_postings += seq.docs.size();
+        stats.output_postings += pruned_docs.size();
+        if (pruned_docs.empty()) {
+            terms_to_drop.insert(term);
+            stats.dropped_terms += 1;
+        } else {
+            write_sequence(dos, gsl::span<std::uint32_t const>(pruned_docs));
+            write_sequence(fos, gsl::span<std::uint32_t const>(pruned_freqs));
+        }
+        term += 1;
+        progress.update(1);
+    }
+    return stats;
+}
+
+/// Writes to `output_lexicon` the terms of `input_lexicon` except `terms_to_drop`, so that term
+/// IDs match the collection written by `prune_inverted_index`. The output lexicon is hashed if
+/// the input one is, and sorted otherwise.
+///
+/// \throws std::invalid_argument   if the lexicon does not have `term_count` terms
+inline void write_pruned_lexicon(
+    std::string const& input_lexicon,
+    std::string const& output_lexicon,
+    std::size_t term_count,
+    std::unordered_set<std::size_t> const& terms_to_drop)
+{
+    auto source = MemorySource::mapped_file(input_lexicon);
+    bool hashed = Hashed_Lexicon::is_hashed_lexicon(source);
+    auto terms = hashed ? Hashed_Lexicon::from(source).terms() : Payload_Vector<>::from(source);
+    if (terms.size() != term_count) {
+        throw std::invalid_argument(fmt::format(
+            "Lexicon {} has {} terms but the collection has {}",
+            input_lexicon,
+            terms.size(),
+            term_count));
+    }
+    std::vector<std::string> kept;
+    std::size_t term = 0;
+    for (auto const& value: terms) {
+        if (terms_to_drop.find(term) == terms_to_drop.end()) {
+            kept.emplace_back(value);
+        }
+        term += 1;
+    }
+    if (hashed) {
+        std::ofstream os(output_lexicon, std::ios::binary);
+        write_hashed_lexicon(gsl::make_span(kept), os);
+    } else {
+        encode_payload_vector(gsl::span<std::string const>(kept)).to_file(output_lexicon);
+    }
+}
+
+/// Returns the mean fraction of the top-`k` documents retrieved from `original` that are also
+/// retrieved from `pruned`, where both are collections scored exhaustively by `scorer`, and
+/// `pruned` lacks the terms in `terms_to_drop`.
+template <typename Scorer>
+auto topk_overlap(
+    binary_freq_collection const& original,
+    binary_freq_collection const& pruned,
+    std::unordered_set<std::size_t> const& terms_to_drop,
+    Scorer const& scorer,
+    std::vector<Query> const& queries,
+    std::size_t k) -> double
+{
+    std::vector<binary_freq_collection::sequence> original_lists(original.begin(), original.end());
+    std::vector<std::optional<binary_freq_collection::sequence>> pruned_lists;
+    auto pruned_it = pruned.begin();
+    for (std::size_t term = 0; term < original_lists.size(); ++term) {
+        if (terms_to_drop.find(term) != terms_to_drop.end()) {
+            pruned_lists.emplace_back();
+        } else {
+            pruned_lists.emplace_back(*pruned_it);
+            ++pruned_it;
+        }
+    }
+    std::vector<float> accumulators(original.num_docs());
+    auto retrieve = [&](Query const& query, auto&& list) {
+        std::fill(accumulators.begin(), accumulators.end(), 0.0F);
+        for (auto [term, freq]: query_freqs(query.terms)) {
+            if (auto seq = list(term); seq) {
+                auto term_scorer = scorer.term_scorer(term);
+                for (std::size_t pos = 0; pos < seq->docs.size(); ++pos) {
+                    auto doc = seq->docs.begin()[pos];
+                    accumulators[doc] += term_scorer(doc, seq->freqs.begin()[pos]);
+                }
+            }
+        }
+        topk_queue topk(k);
+        for (std::uint32_t doc = 0; doc < accumulators.size(); ++doc) {
+            if (accumulators[doc] > 0.0F) {
+                topk.insert(accumulators[doc], doc);
+            }
+        }
+        topk.finalize();
+        std::unordered_set<std::uint32_t> documents;
+        for (auto [score, doc]: topk.topk()) {
+            documents.insert(doc);
+        }
+        return documents;
+    };
+
+    double overlap_sum = 0.0;
+    std::size_t evaluated = 0;
+    for (auto const& query: queries) {
+        auto expected = retrieve(query, [&](auto term) {
+            return std::optional<binary_freq_collection::sequence>(original_lists.at(term));
+        });
+        if (expected.empty()) {
+            continue;
+        }
+        auto actual = retrieve(query, [&](auto term) { return pruned_lists.at(term); });
+        auto common = std::count_if(
+            expected.begin(), expected.end(), [&](auto doc) { return actual.count(doc) > 0; });
+        overlap_sum += static_cast<double>(common) / expected.size();
+        evaluated += 1;
+    }
+    return evaluated > 0 ? overlap_sum / evaluated : 1.0;
+}
+
+}  // namespace pisa
@@ -10,5 +10,7 @@
 #include "query/algorithm/range_taat_query.hpp"
 #include "query/algorithm/ranked_and_query.hpp"
 #include "query/algorithm/ranked_or_query.hpp"
+#include "query/algorithm/ranked_or_saat_query.hpp"
 #include "query/algorithm/ranked_or_taat_query.hpp"
+#include "query/algorithm/two_tier_block_max_wand_query.hpp"
 #include "query/algorithm/wand_query.hpp"
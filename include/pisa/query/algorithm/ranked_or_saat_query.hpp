@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "topk_queue.hpp"
+
+namespace pisa {
+
+/// Score-at-a-time disjunctive query processing over impact-ordered segments (see
+/// `impact_ordered_index`), processing segments of all terms in decreasing score order.
+///
+/// With a postings budget, processing stops before the first segment that would start after
+/// that many postings have been processed, which bounds the latency of a query at the cost of
+/// approximate results ("anytime" processing).
+///
+/// > Jimmy Lin and Andrew Trotman. 2015. Anytime Ranking for Impact-Ordered Indexes. In
+/// > Proceedings of the 2015 International Conference on The Theory of Information Retrieval
+/// > (ICTIR '15). ACM, New York, NY, USA, 301-304.
+class ranked_or_saat_query {
+  public:
+    explicit ranked_or_saat_query(
+        topk_queue& topk, std::uint64_t postings_budget = std::numeric_limits<std::uint64_t>::max())
+        : m_topk(topk), m_postings_budget(postings_budget)
+    {}
+
+    template <typename SegmentRange, typename Acc>
+    void operator()(SegmentRange&& segments, Acc&& accumulator)
+    {
+        m_processed_postings = 0;
+        if (segments.empty()) {
+            return;
+        }
+        accumulator.init();
+
+        std::stable_sort(segments.begin(), segments.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.score() > rhs.score();
+        });
+        for (auto const& segment: segments) {
+            if (m_processed_postings >= m_postings_budget) {
+                break;
+            }
+            auto score = segment.score();
+            segment.for_each([&](auto docid) { accumulator.accumulate(docid, score); });
+            m_processed_postings += segment.size;
+        }
+        accumulator.aggregate(m_topk);
+    }
+
+    /// Returns the number of postings processed by the last query.
+    [[nodiscard]] auto processed_postings() const noexcept -> std::uint64_t
+    {
+        return m_processed_postings;
+    }
+
+    std::vector<typename topk_queue::entry_type> const& topk() const { return m_topk.topk(); }
+
+  private:
+    topk_queue& m_topk;
+    std::uint64_t m_postings_budget;
+    std::uint64_t m_processed_postings = 0;
+};
+
+}  // namespace pisa
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "query/algorithm/block_max_wand_query.hpp"
+#include "topk_queue.hpp"
+
+namespace pisa {
+
+/// Block-Max WAND over posting lists split into high- and low-impact tiers (see
+/// `split_impact_tiers`).
+///
+/// The query is first processed over the high tiers only. Then, the low tiers are probed for the
+/// documents retrieved so far to compute their full scores. If the `k`-th of these exceeds the
+/// `k`-th partial score by more than the low tiers can contribute to any document, no other
+/// document can enter the top-k and the results are final. Otherwise, the query is processed
+/// again over all tiers, with the `k`-th full score as the initial threshold.
+struct two_tier_block_max_wand_query {
+    explicit two_tier_block_max_wand_query(topk_queue& topk) : m_topk(topk) {}
+
+    /// `high_tiers` and `low_tiers` are cursors over the high and low tiers of the query terms,
+    /// and `all_tiers()` returns new cursors over both, which are only created if needed.
+    template <typename CursorRange, typename LowCursorRange, typename MakeCursors>
+    void operator()(
+        CursorRange&& high_tiers, LowCursorRange&& low_tiers, MakeCursors&& all_tiers, uint64_t max_docid)
+    {
+        topk_queue partial(m_topk.capacity(), m_topk.initial_threshold());
+        block_max_wand_query high_query(partial);
+        high_query(high_tiers, max_docid);
+        if (low_tiers.empty()) {
+            m_certified = true;
+            m_topk = std::move(partial);
+            return;
+        }
+
+        float low_tier_bound = 0.0F;
+        for (auto& cursor: low_tiers) {
+            low_tier_bound += cursor.max_score();
+        }
+        auto partial_threshold = partial.true_threshold();
+        partial.finalize();
+        auto candidates = partial.topk();
+        std::sort(candidates.begin(), candidates.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.second < rhs.second;
+        });
+        topk_queue full(m_topk.capacity(), m_topk.initial_threshold());
+        for (auto [score, docid]: candidates) {
+            for (auto& cursor: low_tiers) {
+                if (cursor.docid() < docid) {
+                    cursor.next_geq(docid);
+                }
+                if (cursor.docid() == docid) {
+                    score += cursor.score();
+                }
+            }
+            full.insert(score, docid);
+        }
+        m_certified = full.size() == full.capacity()
+            && full.true_threshold() >= partial_threshold + low_tier_bound;
+        if (m_certified) {
+            m_topk = std::move(full);
+            return;
+        }
+
+        m_topk = topk_queue(
+            m_topk.capacity(), std::max(full.true_threshold(), m_topk.initial_threshold()));
+        block_max_wand_query all_query(m_topk);
+        all_query(all_tiers(), max_docid);
+    }
+
+    /// Returns `true` if the last query was answered from the high tiers and low-tier probes.
+    [[nodiscard]] auto certified() const noexcept -> bool { return m_certified; }
+
+    std::vector<typename topk_queue::entry_type> const& topk() const { return m_topk.topk(); }
+
+    void clear_topk() { m_topk.clear(); }
+
+    topk_queue const& get_topk() const { return m_topk; }
+
+  private:
+    topk_queue& m_topk;
+    bool m_certified = false;
+};
+
+}  // namespace pisa
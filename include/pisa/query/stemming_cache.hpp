@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pisa {
+
+/// Bounded memoization of stemming (or any other term transformation).
+///
+/// Token occurrences follow a Zipfian distribution, so the vast majority of stemmer calls
+/// repeat earlier ones. The cache is direct-mapped: each term hashes to a single slot,
+/// and a miss overwrites whatever that slot held. It is not synchronized; it is meant to be
+/// used as a `thread_local` in front of a stemmer. Hit and miss counts of all caches,
+/// including destroyed ones, are available through `StemmingCache::global_stats()`.
+class StemmingCache {
+  public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1U << 16U;
+
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+
+        [[nodiscard]] auto lookups() const noexcept -> std::size_t { return hits + misses; }
+        [[nodiscard]] auto hit_rate() const noexcept -> double
+        {
+            return lookups() > 0 ? static_cast<double>(hits) / lookups() : 0.0;
+        }
+    };
+
+    /// Capacity is rounded up to the nearest power of two.
+    explicit StemmingCache(std::size_t capacity = DEFAULT_CAPACITY);
+    StemmingCache(StemmingCache const&) = delete;
+    StemmingCache(StemmingCache&&) = delete;
+    StemmingCache& operator=(StemmingCache const&) = delete;
+    StemmingCache& operator=(StemmingCache&&) = delete;
+    ~StemmingCache();
+
+    /// Returns the cached result for `term`, calling `transform(term)` on a miss.
+    template <typename Transform>
+    [[nodiscard]] auto get(std::string const& term, Transform&& transform) -> std::string const&
+    {
+        auto& entry = m_entries[std::hash<std::string_view>{}(term) & m_mask];
+        if (entry.occupied && entry.term == term) {
+            increment(m_hits);
+            return entry.stem;
+        }
+        increment(m_misses);
+        entry.stem = transform(term);
+        entry.term = term;
+        entry.occupied = true;
+        return entry.stem;
+    }
+
+    [[nodiscard]] auto stats() const noexcept -> Stats;
+
+    /// Sums statistics of all caches, in all threads.
+    [[nodiscard]] static auto global_stats() -> Stats;
+
+  private:
+    struct Entry {
+        std::string term{};
+        std::string stem{};
+        bool occupied = false;
+    };
+
+    /// Counters are only modified by the owning thread, but can be read by any thread.
+    static void increment(std::atomic_size_t& counter) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::vector<Entry> m_entries;
+    std::size_t m_mask;
+    std::atomic_size_t m_hits{0};
+    std::atomic_size_t m_misses{0};
+};
+
+}  // namespace pisa
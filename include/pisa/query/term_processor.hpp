@@ -4,6 +4,7 @@
 #include <optional>
 #include <unordered_set>
 
+#include "hashed_lexicon.hpp"
 #include "io.hpp"
 #include "memory_source.hpp"
 #include "payload_vector.hpp"
@@ -30,14 +31,23 @@ class TermProcessor {
         std::optional<std::string> const& stemmer_type)
     {
         auto source = std::make_shared<MemorySource>(MemorySource::mapped_file(*terms_file));
-        auto terms = Payload_Vector<>::from(*source);
-        auto to_id = [source = std::move(source), terms](auto str) -> std::optional<term_id_type> {
-            // Note: the lexicographical order of the terms matters.
-            return pisa::binary_search(terms.begin(), terms.end(), std::string_view(str));
-        };
+        std::function<std::optional<term_id_type>(std::string const&)> to_id;
+        if (Hashed_Lexicon::is_hashed_lexicon(*source)) {
+            to_id = [source, lexicon = Hashed_Lexicon::from(*source)](auto const& str) {
+                return lexicon.find(str);
+            };
+        } else {
+            auto terms = Payload_Vector<>::from(*source);
+            to_id = [source, terms](auto const& str) -> std::optional<term_id_type> {
+                // Note: the lexicographical order of the terms matters.
+                return pisa::binary_search(terms.begin(), terms.end(), std::string_view(str));
+            };
+        }
 
         // Implements '_to_id' method.
-        _to_id = [=](auto str) { return to_id(term_transformer_builder(stemmer_type)()(str)); };
+        _to_id = [to_id, transform = term_transformer_builder(stemmer_type)()](auto str) {
+            return to_id(transform(std::move(str)));
+        };
         // Loads stopwords.
         if (stopwords_filename) {
             std::ifstream is(*stopwords_filename);
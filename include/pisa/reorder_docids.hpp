@@ -1,20 +1,30 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <fstream>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <string>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <gsl/span>
 #include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
+#include "binary_collection.hpp"
 #include "binary_freq_collection.hpp"
+#include "flat_forward_index.hpp"
 #include "recursive_graph_bisection.hpp"
+#include "util/hash.hpp"
 #include "util/index_build_utils.hpp"
 #include "util/inverted_index_utils.hpp"
 #include "util/progress.hpp"
+#include "util/util.hpp"
 
 namespace pisa {
 
@@ -30,27 +40,28 @@ struct RecursiveGraphBisectionOptions {
     std::size_t min_length;
     bool compress_fwd;
     bool print_args;
+    std::optional<std::size_t> max_postings = std::nullopt;
 };
 
 namespace detail {
     using iterator_type = std::vector<uint32_t>::iterator;
-    using range_type = document_range<iterator_type>;
-    using node_type = computation_node<iterator_type>;
 
-    inline std::vector<node_type>
-    read_node_config(const std::string& config_file, const range_type& initial_range)
+    template <typename Range>
+    std::vector<computation_node<iterator_type, typename Range::forward_index_type>>
+    read_node_config(const std::string& config_file, const Range& initial_range)
     {
-        std::vector<node_type> nodes;
+        std::vector<computation_node<iterator_type, typename Range::forward_index_type>> nodes;
         std::ifstream is(config_file);
         std::string line;
         while (std::getline(is, line)) {
             std::istringstream iss(line);
-            nodes.push_back(node_type::from_stream(iss, initial_range));
+            nodes.push_back(decltype(nodes)::value_type::from_stream(iss, initial_range));
         }
         return nodes;
     }
 
-    inline void run_with_config(const std::string& config_file, const range_type& initial_range)
+    template <typename Range>
+    void run_with_config(const std::string& config_file, const Range& initial_range)
     {
         auto nodes = read_node_config(config_file, initial_range);
         auto total_count = std::accumulate(
@@ -62,7 +73,8 @@ namespace detail {
         recursive_graph_bisection(std::move(nodes), bp_progress);
     }
 
-    inline void run_default_tree(size_t depth, const range_type& initial_range)
+    template <typename Range>
+    void run_default_tree(size_t depth, const Range& initial_range)
     {
         spdlog::info("Default tree with depth {}", depth);
         pisa::progress bp_progress("Graph bisection", initial_range.size() * depth);
@@ -70,6 +82,392 @@ namespace detail {
         recursive_graph_bisection(initial_range, depth, depth - 6, bp_progress);
     }
 
+    /// Calls `fn` with a value of the narrowest term ID type that can represent `term_count` terms.
+    template <typename Fn>
+    void with_term_type(std::size_t term_count, Fn&& fn)
+    {
+        if (term_count <= std::size_t(std::numeric_limits<std::uint16_t>::max()) + 1) {
+            fn(std::uint16_t{});
+        } else {
+            fn(std::uint32_t{});
+        }
+    }
+
+    /// Runs BP on a flat copy of `fwd` with the narrowest term type that fits the terms that
+    /// occur in it, renumbered densely. The compressed forward index is released once it is
+    /// decoded.
+    inline void run_flat(
+        forward_index& fwd,
+        std::vector<uint32_t>& documents,
+        RecursiveGraphBisectionOptions const& options)
+    {
+        auto dense = dense_term_ids(fwd);
+        auto& term_map = dense.first;
+        auto term_count = dense.second;
+        with_term_type(term_count, [&](auto term) {
+            auto flat = flat_forward_index<decltype(term)>::from_forward_index(
+                fwd, term_map, term_count);
+            term_map.clear();
+            term_map.shrink_to_fit();
+            fwd.clear();
+            fwd.shrink_to_fit();
+            spdlog::info(
+                "Decoded forward index: {} postings, {} terms, {} bytes per term ID",
+                flat.posting_count(),
+                term_count,
+                sizeof(term));
+            std::vector<double> gains(flat.size(), 0.0);
+            document_range<iterator_type, decltype(flat)> initial_range(
+                documents.begin(), documents.end(), flat, gains);
+            if (options.node_config) {
+                run_with_config(*options.node_config, initial_range);
+            } else {
+                run_default_tree(
+                    options.depth.value_or(static_cast<size_t>(std::log2(flat.size()) - 5)),
+                    initial_range);
+            }
+        });
+    }
+
+    /// Bisects `documents`, which index into `flat`, to the given depth.
+    template <typename Flat>
+    void bisect(
+        Flat const& flat,
+        gsl::span<std::uint32_t> documents,
+        std::size_t depth,
+        std::size_t cache_depth,
+        progress& bp_progress)
+    {
+        std::vector<std::uint32_t> local(flat.size());
+        std::iota(local.begin(), local.end(), 0U);
+        std::vector<double> gains(flat.size(), 0.0);
+        document_range<iterator_type, Flat> range(local.begin(), local.end(), flat, gains);
+        recursive_graph_bisection(range, depth, cache_depth, bp_progress);
+        std::vector<std::uint32_t> ids(documents.begin(), documents.end());
+        std::transform(local.begin(), local.end(), documents.begin(), [&](auto doc) {
+            return ids[doc];
+        });
+    }
+
+    /// Returns the boundaries of the ranges produced by splitting `[0, size)` in halves
+    /// `depth` times, the same way as `document_range::split` does.
+    inline auto leaf_boundaries(std::size_t size, std::size_t depth) -> std::vector<std::size_t>
+    {
+        std::vector<std::size_t> boundaries{0, size};
+        for (std::size_t level = 0; level < depth; ++level) {
+            std::vector<std::size_t> next{0};
+            for (std::size_t idx = 1; idx < boundaries.size(); ++idx) {
+                auto first = boundaries[idx - 1];
+                auto last = boundaries[idx];
+                if (last - first > 1) {
+                    next.push_back(first + (last - first) / 2);
+                }
+                next.push_back(last);
+            }
+            boundaries = std::move(next);
+        }
+        return boundaries;
+    }
+
+    /// Maximum number of spill files of out-of-core bisection open at a time.
+    constexpr std::size_t MAX_SPILL_FILES = 256;
+
+    /// The document order found by `bisect_out_of_core`.
+    struct out_of_core_result {
+        std::vector<std::uint32_t> documents;
+        /// Number of partitions spilled to disk and bisected independently.
+        std::size_t spilled_partitions = 0;
+    };
+
+    /// Runs BP on an inverted index whose forward index does not fit in memory.
+    ///
+    /// At most `options.max_postings` postings are held in memory at a time. The top levels of
+    /// the tree are computed on a graph with a uniform sample of terms that fits that budget.
+    /// Since partitions are split by document count, any partition whose postings still exceed
+    /// the budget is split further on the sample, so that each fits it on its own. The postings
+    /// of every partition are then spilled to a separate file, in as many passes over the
+    /// inverted index as needed to keep at most `max_spill_files` files open, and the partitions
+    /// are bisected independently, as many at a time as fit in memory together.
+    ///
+    /// \throws std::runtime_error   if a spill file cannot be written or read back in full
+    inline auto bisect_out_of_core(
+        RecursiveGraphBisectionOptions const& options,
+        std::size_t max_spill_files = MAX_SPILL_FILES) -> out_of_core_result
+    {
+        binary_collection coll((options.input_basename + ".docs").c_str());
+        auto firstseq = *coll.begin();
+        if (firstseq.size() != 1) {
+            throw std::invalid_argument("First sequence should only contain number of documents");
+        }
+        auto num_docs = *firstseq.begin();
+        auto for_each_list = [&](auto&& fn) {
+            std::uint32_t term = 0;
+            for (auto it = ++coll.begin(); it != coll.end(); ++it, ++term) {
+                if (it->size() >= options.min_length) {
+                    fn(term, *it);
+                }
+            }
+        };
+        std::size_t posting_count = 0;
+        for_each_list([&](auto, auto const& list) { posting_count += list.size(); });
+
+        auto budget = std::max<std::size_t>(*options.max_postings, 1);
+        std::vector<std::uint32_t> documents(num_docs);
+        std::iota(documents.begin(), documents.end(), 0U);
+        auto depth = options.depth.value_or(static_cast<size_t>(std::log2(num_docs) - 5));
+        auto cache_depth = depth > 6 ? depth - 6 : 0;
+        if (posting_count <= budget) {
+            spdlog::info("Index with {} postings fits in memory", posting_count);
+            auto fwd = forward_index::from_inverted_index(
+                options.input_basename, options.min_length, options.compress_fwd);
+            run_flat(fwd, documents, options);
+            return {std::move(documents), 0};
+        }
+
+        auto top_depth = std::min<std::size_t>(
+            depth, ceil_log2((posting_count + budget - 1) / budget));
+        auto sample_rate = static_cast<double>(budget) / posting_count;
+        auto sampled = [&](std::uint32_t term) {
+            return static_cast<double>(hash::mix64(term) >> 11U)
+                < sample_rate * static_cast<double>(std::uint64_t(1) << 53U);
+        };
+        spdlog::info(
+            "Bisecting {} postings out of core: top {} levels on {:.2f}% of terms",
+            posting_count,
+            top_depth,
+            100 * sample_rate);
+        pisa::progress bp_progress("Graph bisection", num_docs * depth);
+        bp_progress.update(0);
+
+        std::size_t sampled_terms = 0;
+        for_each_list([&](auto term, auto const&) { sampled_terms += sampled(term) ? 1 : 0; });
+        auto sampled_flat = [&](auto term_type) {
+            return flat_forward_index<decltype(term_type)>::from_postings(
+                num_docs, sampled_terms, [&](auto&& fn) {
+                    std::uint32_t local_term = 0;
+                    for_each_list([&](auto term, auto const& list) {
+                        if (sampled(term)) {
+                            for (auto doc: list) {
+                                fn(doc, local_term);
+                            }
+                            local_term += 1;
+                        }
+                    });
+                });
+        };
+
+        // Partitions are split by document count, but postings are not spread evenly across
+        // documents, so a partition can still exceed the budget after `top_depth` levels.
+        // Such partitions are split further on the sample until they fit or reach `depth`.
+        auto boundaries = leaf_boundaries(num_docs, top_depth);
+        std::vector<std::size_t> levels(boundaries.size() - 1, top_depth);
+        std::vector<std::uint32_t> partition(num_docs);
+        std::vector<std::size_t> partition_postings;
+        auto count_postings = [&] {
+            for (std::size_t part = 0; part + 1 < boundaries.size(); ++part) {
+                for (auto pos = boundaries[part]; pos < boundaries[part + 1]; ++pos) {
+                    partition[documents[pos]] = part;
+                }
+            }
+            partition_postings.assign(boundaries.size() - 1, 0);
+            for_each_list([&](auto, auto const& list) {
+                for (auto doc: list) {
+                    partition_postings[partition[doc]] += 1;
+                }
+            });
+        };
+        auto splittable = [&](std::size_t part) {
+            return partition_postings[part] > budget && levels[part] < depth
+                && boundaries[part + 1] - boundaries[part] > 1;
+        };
+        with_term_type(sampled_terms, [&](auto term_type) {
+            auto flat = sampled_flat(term_type);
+            bisect(flat, gsl::make_span(documents), top_depth, cache_depth, bp_progress);
+            if (top_depth == depth) {
+                return;
+            }
+            std::vector<double> gains(num_docs, 0.0);
+            while (true) {
+                count_postings();
+                std::vector<std::size_t> next_boundaries{0};
+                std::vector<std::size_t> next_levels;
+                for (std::size_t part = 0; part < levels.size(); ++part) {
+                    auto first = boundaries[part];
+                    auto last = boundaries[part + 1];
+                    if (splittable(part)) {
+                        document_range<iterator_type, decltype(flat)> range(
+                            documents.begin() + first, documents.begin() + last, flat, gains);
+                        recursive_graph_bisection(
+                            range,
+                            1,
+                            cache_depth > levels[part] ? cache_depth - levels[part] : 0,
+                            bp_progress);
+                        next_boundaries.push_back(first + (last - first) / 2);
+                        next_boundaries.push_back(last);
+                        next_levels.insert(next_levels.end(), 2, levels[part] + 1);
+                    } else {
+                        next_boundaries.push_back(last);
+                        next_levels.push_back(levels[part]);
+                    }
+                }
+                if (next_levels.size() == levels.size()) {
+                    break;
+                }
+                boundaries = std::move(next_boundaries);
+                levels = std::move(next_levels);
+            }
+        });
+        if (top_depth == depth) {
+            return {std::move(documents), 0};
+        }
+
+        // Partitions at full depth or with a single document need no further bisection.
+        auto bisected = [&](std::size_t part) {
+            return levels[part] < depth && boundaries[part + 1] - boundaries[part] > 1;
+        };
+        auto partition_count = levels.size();
+        std::vector<std::size_t> spilled;
+        for (std::size_t part = 0; part < partition_count; ++part) {
+            if (bisected(part)) {
+                spilled.push_back(part);
+            }
+        }
+        spdlog::info("Bisecting {} partitions independently", spilled.size());
+        std::vector<std::uint32_t> local_id(num_docs);
+        for (std::size_t part = 0; part < partition_count; ++part) {
+            for (auto pos = boundaries[part]; pos < boundaries[part + 1]; ++pos) {
+                local_id[documents[pos]] = pos - boundaries[part];
+            }
+        }
+
+        auto spill_file = [&](std::size_t part) {
+            return fmt::format("{}.bp.{}", *options.output_basename, part);
+        };
+        std::vector<std::size_t> partition_terms(partition_count, 0);
+        max_spill_files = std::max<std::size_t>(max_spill_files, 1);
+        std::vector<std::ptrdiff_t> spill_slot(partition_count, -1);
+        for (std::size_t group = 0; group < spilled.size(); group += max_spill_files) {
+            auto group_parts = gsl::make_span(spilled).subspan(
+                group, std::min(max_spill_files, spilled.size() - group));
+            std::vector<std::ofstream> spills(group_parts.size());
+            for (std::size_t slot = 0; slot < group_parts.size(); ++slot) {
+                spill_slot[group_parts[slot]] = slot;
+                spills[slot].open(spill_file(group_parts[slot]), std::ios::binary);
+                if (not spills[slot].is_open()) {
+                    throw std::runtime_error(
+                        fmt::format("Failed to open spill file {}", spill_file(group_parts[slot])));
+                }
+            }
+            std::vector<std::int64_t> last_term(group_parts.size(), -1);
+            for_each_list([&](auto term, auto const& list) {
+                for (auto doc: list) {
+                    auto part = partition[doc];
+                    auto slot = spill_slot[part];
+                    if (slot < 0) {
+                        continue;
+                    }
+                    std::array<std::uint32_t, 2> posting{local_id[doc], term};
+                    spills[slot].write(
+                        reinterpret_cast<char const*>(posting.data()), sizeof(posting));
+                    if (last_term[slot] != term) {
+                        last_term[slot] = term;
+                        partition_terms[part] += 1;
+                    }
+                }
+            });
+            for (std::size_t slot = 0; slot < group_parts.size(); ++slot) {
+                spills[slot].close();
+                if (spills[slot].fail()) {
+                    throw std::runtime_error(fmt::format(
+                        "Failed to write spill file {}", spill_file(group_parts[slot])));
+                }
+                spill_slot[group_parts[slot]] = -1;
+            }
+        }
+        partition.clear();
+        partition.shrink_to_fit();
+        local_id.clear();
+        local_id.shrink_to_fit();
+
+        auto bisect_partition = [&](std::size_t part) {
+            auto for_each_posting = [&](auto&& fn) {
+                std::ifstream is(spill_file(part), std::ios::binary);
+                if (not is.is_open()) {
+                    throw std::runtime_error(
+                        fmt::format("Failed to open spill file {}", spill_file(part)));
+                }
+                std::vector<std::array<std::uint32_t, 2>> buffer(1U << 16U);
+                std::uint32_t local_term = 0;
+                std::int64_t last_term = -1;
+                std::size_t postings = 0;
+                while (is) {
+                    is.read(
+                        reinterpret_cast<char*>(buffer.data()),
+                        buffer.size() * sizeof(buffer[0]));
+                    auto count = static_cast<std::size_t>(is.gcount()) / sizeof(buffer[0]);
+                    for (std::size_t idx = 0; idx < count; ++idx) {
+                        auto [doc, term] = buffer[idx];
+                        if (last_term >= 0 && last_term != term) {
+                            local_term += 1;
+                        }
+                        last_term = term;
+                        fn(doc, local_term);
+                    }
+                    postings += count;
+                }
+                if (is.bad() || postings != partition_postings[part]) {
+                    throw std::runtime_error(fmt::format(
+                        "Read {} postings from spill file {} but {} were written",
+                        postings,
+                        spill_file(part),
+                        partition_postings[part]));
+                }
+            };
+            if (not bisected(part)) {
+                return;
+            }
+            auto first = boundaries[part];
+            auto last = boundaries[part + 1];
+            auto level = levels[part];
+            with_term_type(partition_terms[part], [&](auto term_type) {
+                auto flat = flat_forward_index<decltype(term_type)>::from_postings(
+                    last - first, partition_terms[part], for_each_posting);
+                bisect(
+                    flat,
+                    gsl::make_span(documents).subspan(first, last - first),
+                    depth - level,
+                    cache_depth > level ? cache_depth - level : 0,
+                    bp_progress);
+            });
+            boost::filesystem::remove(spill_file(part));
+        };
+
+        // Partitions are processed in waves, each of which fits in the memory budget.
+        for (std::size_t part = 0; part < partition_count; ++part) {
+            if (not bisected(part)) {
+                partition_postings[part] = 0;
+            }
+        }
+        std::size_t wave_first = 0;
+        while (wave_first < partition_count) {
+            auto wave_last = wave_first + 1;
+            auto wave_postings = partition_postings[wave_first];
+            while (wave_last < partition_count
+                   && wave_postings + partition_postings[wave_last] <= budget) {
+                wave_postings += partition_postings[wave_last];
+                wave_last += 1;
+            }
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(wave_first, wave_last, 1), [&](auto const& parts) {
+                    for (auto part = parts.begin(); part != parts.end(); ++part) {
+                        bisect_partition(part);
+                    }
+                });
+            wave_first = wave_last;
+        }
+        return {std::move(documents), spilled.size()};
+    }
+
 }  // namespace detail
 
 [[nodiscard]] auto recursive_graph_bisection(RecursiveGraphBisectionOptions const& options) -> int
@@ -79,51 +477,51 @@ namespace detail {
         return 1;
     }
 
-    forward_index fwd = options.input_fwd
-        ? forward_index::read(*options.input_fwd)
-        : forward_index::from_inverted_index(
-            options.input_basename, options.min_length, options.compress_fwd);
-
-    if (options.output_fwd) {
-        forward_index::write(fwd, *options.output_fwd);
+    if (options.max_postings && (options.input_fwd || options.output_fwd || options.node_config)) {
+        spdlog::error("Out-of-core bisection does not support forward index files or node config.");
+        return 1;
     }
 
-    if (options.output_basename) {
-        std::vector<uint32_t> documents(fwd.size());
+    std::vector<uint32_t> documents;
+    if (options.max_postings) {
+        documents = detail::bisect_out_of_core(options).documents;
+    } else {
+        forward_index fwd = options.input_fwd
+            ? forward_index::read(*options.input_fwd)
+            : forward_index::from_inverted_index(
+                options.input_basename, options.min_length, options.compress_fwd);
+
+        if (options.output_fwd) {
+            forward_index::write(fwd, *options.output_fwd);
+        }
+        if (not options.output_basename) {
+            return 0;
+        }
+        documents.resize(fwd.size());
         std::iota(documents.begin(), documents.end(), 0U);
-        std::vector<double> gains(fwd.size(), 0.0);
-        detail::range_type initial_range(documents.begin(), documents.end(), fwd, gains);
+        detail::run_flat(fwd, documents, options);
+    }
 
-        if (options.node_config) {
-            detail::run_with_config(*options.node_config, initial_range);
-        } else {
-            detail::run_default_tree(
-                options.depth.value_or(static_cast<size_t>(std::log2(fwd.size()) - 5)),
-                initial_range);
+    if (options.print_args) {
+        for (const auto& document: documents) {
+            std::cout << document << '\n';
         }
+    }
+    auto mapping = get_mapping(documents);
+    documents.clear();
+    reorder_inverted_index(options.input_basename, *options.output_basename, mapping);
 
-        if (options.print_args) {
-            for (const auto& document: documents) {
-                std::cout << document << '\n';
-            }
-        }
-        auto mapping = get_mapping(documents);
-        fwd.clear();
-        documents.clear();
-        reorder_inverted_index(options.input_basename, *options.output_basename, mapping);
-
-        if (options.document_lexicon) {
-            auto doc_buffer = Payload_Vector_Buffer::from_file(*options.document_lexicon);
-            auto documents = Payload_Vector<std::string>(doc_buffer);
-            std::vector<std::string> reordered_documents(documents.size());
-            pisa::progress doc_reorder("Reordering documents vector", documents.size());
-            for (size_t i = 0; i < documents.size(); ++i) {
-                reordered_documents[mapping[i]] = documents[i];
-                doc_reorder.update(1);
-            }
-            encode_payload_vector(reordered_documents.begin(), reordered_documents.end())
-                .to_file(*options.reordered_document_lexicon);
+    if (options.document_lexicon) {
+        auto doc_buffer = Payload_Vector_Buffer::from_file(*options.document_lexicon);
+        auto documents = Payload_Vector<std::string>(doc_buffer);
+        std::vector<std::string> reordered_documents(documents.size());
+        pisa::progress doc_reorder("Reordering documents vector", documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            reordered_documents[mapping[i]] = documents[i];
+            doc_reorder.update(1);
         }
+        encode_payload_vector(reordered_documents.begin(), reordered_documents.end())
+            .to_file(*options.reordered_document_lexicon);
     }
     return 0;
 }
@@ -265,25 +663,33 @@ inline auto reorder_by_feature(ReorderOptions options, std::string const& featur
     return 0;
 }
 
+/// Reads a mapping file, in which each line contains an original and a new document ID.
+inline auto read_mapping(std::string const& mapping_file) -> std::vector<std::uint32_t>
+{
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+    std::ifstream is(mapping_file);
+    uint32_t prev_id, new_id;
+    while (is >> prev_id >> new_id) {
+        pairs.emplace_back(prev_id, new_id);
+    }
+    std::vector<std::uint32_t> mapping(pairs.size());
+    for (auto [prev_id, new_id]: pairs) {
+        if (prev_id >= mapping.size()) {
+            throw std::invalid_argument(fmt::format("Invalid document order file: {}", mapping_file));
+        }
+        mapping[prev_id] = new_id;
+    }
+    return mapping;
+}
+
 inline auto reorder_from_mapping(ReorderOptions options, std::string mapping_file) -> int
 {
     spdlog::info("Reading mapping");
     binary_freq_collection input_collection(options.input_basename.c_str());
-    auto const mapping = [&] {
-        std::vector<std::uint32_t> mapping(input_collection.num_docs());
-
-        std::ifstream is(mapping_file);
-        uint32_t prev_id, new_id;
-        size_t count = 0;
-        while (is >> prev_id >> new_id) {
-            mapping[prev_id] = new_id;
-            ++count;
-        }
-        if (mapping.size() != count) {
-            throw std::invalid_argument(fmt::format("Invalid document order file: {}", mapping_file));
-        }
-        return mapping;
-    }();
+    auto const mapping = read_mapping(mapping_file);
+    if (mapping.size() != input_collection.num_docs()) {
+        throw std::invalid_argument(fmt::format("Invalid document order file: {}", mapping_file));
+    }
     binary_collection input_sizes(fmt::format("{}.sizes", options.input_basename).c_str());
     reorder_from_mapping(input_collection, input_sizes, options, mapping);
     return 0;
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <gsl/span>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "binary_freq_collection.hpp"
+#include "block_freq_index.hpp"
+#include "global_parameters.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "util/progress.hpp"
+#include "wand_data.hpp"
+
+namespace pisa {
+
+/// Where to read WAND data from, where to write the reordered one, and how to recompute
+/// its block upper bounds.
+struct ReorderWandOptions {
+    std::string input;
+    std::string output;
+    ScorerParams scorer_params;
+    BlockSize block_size;
+    bool quantize = false;
+};
+
+namespace detail {
+
+    /// A posting list with reassigned document IDs, and its encoding if it was done off the
+    /// builder thread.
+    struct ReorderedList {
+        std::vector<std::uint32_t> docs;
+        std::vector<std::uint32_t> freqs;
+        std::uint64_t occurrences = 0;
+        std::vector<std::uint8_t> bytes;
+    };
+
+    inline void verify_permutation(gsl::span<std::uint32_t const> mapping, std::uint64_t num_docs)
+    {
+        if (mapping.size() != num_docs) {
+            throw std::invalid_argument(fmt::format(
+                "Mapping has {} documents but the index has {}", mapping.size(), num_docs));
+        }
+        std::vector<bool> seen(num_docs, false);
+        for (auto doc: mapping) {
+            if (doc >= num_docs || seen[doc]) {
+                throw std::invalid_argument(
+                    fmt::format("Mapping is not a permutation: document {} is invalid", doc));
+            }
+            seen[doc] = true;
+        }
+    }
+
+    template <typename Index>
+    void reorder_list(
+        Index const& index,
+        std::size_t term,
+        gsl::span<std::uint32_t const> mapping,
+        ReorderedList& out)
+    {
+        auto list = index[term];
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> postings(list.size());
+        for (auto& posting: postings) {
+            posting = {mapping[list.docid()], list.freq()};
+            list.next();
+        }
+        std::sort(postings.begin(), postings.end());
+        out.docs.resize(postings.size());
+        out.freqs.resize(postings.size());
+        out.occurrences = 0;
+        for (std::size_t pos = 0; pos < postings.size(); ++pos) {
+            out.docs[pos] = postings[pos].first;
+            out.freqs[pos] = postings[pos].second;
+            out.occurrences += postings[pos].second;
+        }
+        if constexpr (std::is_same_v<typename Index::index_layout_tag, BlockIndexTag>) {
+            out.bytes.clear();
+            block_posting_list<typename Index::block_codec_type>::write(
+                out.bytes, out.docs.size(), out.docs.begin(), out.freqs.begin());
+        }
+    }
+
+    /// Calls `fn(term, list)` for each list of `index` in term order, where `list` holds the
+    /// postings of `term` with document IDs reassigned by `mapping`.
+    ///
+    /// Lists are processed in batches of roughly `batch_postings` postings: each batch is
+    /// decoded, remapped, sorted, and (for block indexes) re-encoded in parallel, and then
+    /// passed to `fn` sequentially.
+    template <typename Index, typename Fn>
+    void for_each_reordered_list(
+        Index const& index,
+        gsl::span<std::uint32_t const> mapping,
+        std::size_t batch_postings,
+        Fn&& fn)
+    {
+        pisa::progress progress("Reordering posting lists", index.size());
+        std::vector<ReorderedList> batch;
+        std::size_t first = 0;
+        while (first < index.size()) {
+            std::size_t last = first;
+            std::size_t postings = 0;
+            while (last < index.size() && (last == first || postings < batch_postings)) {
+                postings += index[last].size();
+                last += 1;
+            }
+            batch.resize(last - first);
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(first, last),
+                [&](tbb::blocked_range<std::size_t> const& range) {
+                    for (auto term = range.begin(); term != range.end(); ++term) {
+                        reorder_list(index, term, mapping, batch[term - first]);
+                    }
+                });
+            for (auto term = first; term < last; ++term) {
+                fn(term, batch[term - first]);
+            }
+            progress.update(last - first);
+            first = last;
+        }
+    }
+
+}  // namespace detail
+
+/// Reassigns document IDs of a compressed index without going back to the uncompressed
+/// collection: document `d` becomes `mapping[d]`.
+///
+/// Each posting list is decoded, remapped, sorted, and re-encoded with the codec of the input
+/// index, which is written to `output_filename`. If `wand_options` are given, WAND data are
+/// remapped as well, recomputing block upper bounds from the new lists as they are produced,
+/// so that each list is decoded only once. Block upper bounds use the stored frequencies,
+/// therefore WAND data cannot be recomputed from a quantized index.
+template <typename IndexType, typename WandType>
+void reorder_index(
+    std::string const& index_filename,
+    std::string const& output_filename,
+    gsl::span<std::uint32_t const> mapping,
+    std::optional<ReorderWandOptions> const& wand_options,
+    std::size_t batch_postings = 1U << 24U)
+{
+    IndexType index(MemorySource::mapped_file(index_filename));
+    detail::verify_permutation(mapping, index.num_docs());
+    spdlog::info("Reordering {} lists of {} documents", index.size(), index.num_docs());
+
+    global_parameters params;
+    auto reorder = [&](auto&& builder, auto&& on_list) {
+        detail::for_each_reordered_list(
+            index, mapping, batch_postings, [&](auto, detail::ReorderedList const& list) {
+                if constexpr (std::is_same_v<typename IndexType::index_layout_tag, BlockIndexTag>) {
+                    builder.add_posting_list(list.bytes);
+                } else {
+                    builder.add_posting_list(
+                        list.docs.size(), list.docs.begin(), list.freqs.begin(), list.occurrences);
+                }
+                on_list(binary_freq_collection::sequence{
+                    {list.docs.data(), list.docs.data() + list.docs.size()},
+                    {list.freqs.data(), list.freqs.data() + list.freqs.size()}});
+            });
+    };
+    auto reorder_and_build = [&](auto&& on_list) {
+        if constexpr (std::is_same_v<typename IndexType::index_layout_tag, BlockIndexTag>) {
+            typename IndexType::stream_builder builder(index.num_docs(), params);
+            reorder(builder, on_list);
+            builder.build(output_filename);
+        } else {
+            typename IndexType::builder builder(index.num_docs(), params);
+            reorder(builder, on_list);
+            IndexType reordered;
+            builder.build(reordered);
+            mapper::freeze(reordered, output_filename.c_str());
+        }
+    };
+
+    if (wand_options) {
+        WandType const wdata(MemorySource::mapped_file(wand_options->input));
+        WandType reordered_wdata(
+            wdata,
+            mapping,
+            wand_options->scorer_params,
+            wand_options->block_size,
+            wand_options->quantize,
+            reorder_and_build);
+        mapper::freeze(reordered_wdata, wand_options->output.c_str());
+    } else {
+        reorder_and_build([](auto const&) {});
+    }
+}
+
+}  // namespace pisa
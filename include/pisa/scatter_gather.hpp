@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gsl/span>
+
+#include "query/queries.hpp"
+#include "topk_queue.hpp"
+#include "type_alias.hpp"
+#include "type_safe.hpp"
+#include "vec_map.hpp"
+
+namespace pisa {
+
+/// A request to retrieve the top `k` documents of a query on a single shard.
+struct shard_request {
+    std::uint32_t id = 0;
+    std::uint32_t k = 0;
+    std::vector<term_id_type> terms;
+};
+
+/// The top-k documents of a shard, in response to the request with the same `id`.
+struct shard_response {
+    std::uint32_t id = 0;
+    std::vector<topk_queue::entry_type> topk;
+};
+
+/// Encodes a request as a sequence of 32-bit words: ID, `k`, the number of terms, and the terms.
+[[nodiscard]] auto encode_request(shard_request const& request) -> std::vector<char>;
+
+/// \throws std::invalid_argument   if `bytes` is not an encoded request
+[[nodiscard]] auto decode_request(gsl::span<char const> bytes) -> shard_request;
+
+/// Encodes a response as a sequence of 32-bit words: ID, the number of results, and the pairs of
+/// scores and document IDs.
+[[nodiscard]] auto encode_response(shard_response const& response) -> std::vector<char>;
+
+/// \throws std::invalid_argument   if `bytes` is not an encoded response
+[[nodiscard]] auto decode_response(gsl::span<char const> bytes) -> shard_response;
+
+/// An owning socket file descriptor, closed on destruction.
+class Socket {
+  public:
+    Socket() = default;
+    explicit Socket(int fd) : m_fd(fd) {}
+    Socket(Socket const&) = delete;
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket const&) = delete;
+    Socket& operator=(Socket&& other) noexcept;
+    ~Socket();
+
+    [[nodiscard]] auto fd() const noexcept -> int { return m_fd; }
+    [[nodiscard]] auto is_open() const noexcept -> bool { return m_fd >= 0; }
+    void close() noexcept;
+
+  private:
+    int m_fd = -1;
+};
+
+/// Creates a Unix domain socket listening at `path`, replacing any existing file.
+///
+/// \throws std::system_error   on failure
+[[nodiscard]] auto listen_unix_socket(std::string const& path) -> Socket;
+
+/// Waits for a connection on `listener`.
+///
+/// \throws std::system_error   on failure
+[[nodiscard]] auto accept_connection(Socket const& listener) -> Socket;
+
+/// Connects to the Unix domain socket at `path`, retrying until `timeout` passes, so that
+/// workers that are still starting up can be connected to.
+///
+/// \throws std::system_error   if no connection is established in time
+[[nodiscard]] auto connect_unix_socket(std::string const& path, std::chrono::milliseconds timeout)
+    -> Socket;
+
+/// Writes a message prefixed with its length.
+///
+/// \throws std::system_error   on failure
+void write_message(Socket const& socket, gsl::span<char const> message);
+
+/// Reads a message written with `write_message`, or returns `std::nullopt` if the connection
+/// is closed by the peer.
+///
+/// \throws std::system_error   on failure
+[[nodiscard]] auto read_message(Socket const& socket) -> std::optional<std::vector<char>>;
+
+/// Responds to the requests received on `connection` with `handler` until the peer closes
+/// the connection.
+///
+/// A request that is already followed by another one when it is read is skipped without a
+/// response: the coordinator has given up on it by the time it sends the next request.
+void serve_shard_requests(
+    Socket const& connection, std::function<shard_response(shard_request const&)> const& handler);
+
+/// Sends queries to shard workers and merges their top-k lists into a global top-k list.
+///
+/// Shards that do not respond within the timeout are left out of the result, which is then
+/// marked as partial. Responses are read without blocking, so a shard that has sent only part
+/// of its response does not delay the query past the timeout. Late responses are discarded by
+/// subsequent queries, and workers skip the requests that have been given up on.
+class scatter_gather_coordinator {
+  public:
+    struct result_type {
+        std::vector<topk_queue::entry_type> topk;
+        std::vector<Shard_Id> shards;
+        std::vector<Shard_Id> missing_shards;
+        std::chrono::microseconds time;
+
+        [[nodiscard]] auto partial() const -> bool { return not missing_shards.empty(); }
+    };
+
+    /// Constructs a coordinator of the workers connected with `connections`, where
+    /// `global_docids` maps the document IDs of each shard to global ones.
+    scatter_gather_coordinator(
+        VecMap<Shard_Id, Socket> connections,
+        VecMap<Shard_Id, std::vector<Document_Id>> global_docids,
+        std::chrono::milliseconds timeout);
+
+    [[nodiscard]] auto num_shards() const -> std::size_t { return m_connections.size(); }
+
+    /// Retrieves the top `k` documents, where `shard_queries` contains the query with term IDs
+    /// of each shard.
+    [[nodiscard]] auto operator()(VecMap<Shard_Id, Query> const& shard_queries, std::uint32_t k)
+        -> result_type;
+
+  private:
+    VecMap<Shard_Id, Socket> m_connections;
+    VecMap<Shard_Id, std::vector<Document_Id>> m_global_docids;
+    VecMap<Shard_Id, std::vector<char>> m_received;
+    std::chrono::milliseconds m_timeout;
+    std::uint32_t m_next_request = 0;
+};
+
+}  // namespace pisa
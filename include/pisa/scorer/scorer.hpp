@@ -22,6 +22,9 @@ struct ScorerParams {
 };
 
 namespace pisa { namespace scorer {
+    /// Creates the scorer `params.name` over the statistics of `wdata`, which may be WAND data
+    /// or any other source of the same document and term statistics, e.g., WAND data of a
+    /// shard built with global statistics, or `segmented_wand_data`.
     inline auto from_params =
         [](const ScorerParams& params,
            auto const& wdata) -> std::unique_ptr<index_scorer<std::decay_t<decltype(wdata)>>> {
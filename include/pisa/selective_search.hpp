@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <gsl/span>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "cursor/block_max_scored_cursor.hpp"
+#include "cursor/max_scored_cursor.hpp"
+#include "memory_source.hpp"
+#include "query/algorithm/block_max_maxscore_query.hpp"
+#include "query/algorithm/block_max_wand_query.hpp"
+#include "query/algorithm/maxscore_query.hpp"
+#include "query/algorithm/wand_query.hpp"
+#include "query/queries.hpp"
+#include "scorer/scorer.hpp"
+#include "timer.hpp"
+#include "topk_queue.hpp"
+#include "type_safe.hpp"
+#include "vec_map.hpp"
+
+namespace pisa {
+
+/// Returns the shards whose scores are greater than `min_score`, in decreasing order of their
+/// scores, keeping at most `max_shards` of them if given.
+[[nodiscard]] inline auto select_shards(
+    gsl::span<double const> scores, double min_score, std::optional<std::size_t> max_shards)
+    -> std::vector<Shard_Id>
+{
+    std::vector<Shard_Id> shards;
+    for (std::size_t shard = 0; shard < static_cast<std::size_t>(scores.size()); ++shard) {
+        if (scores[shard] > min_score) {
+            shards.push_back(Shard_Id(shard));
+        }
+    }
+    std::stable_sort(shards.begin(), shards.end(), [&](auto lhs, auto rhs) {
+        return scores[lhs.as_int()] > scores[rhs.as_int()];
+    });
+    if (max_shards && shards.size() > *max_shards) {
+        shards.resize(*max_shards);
+    }
+    return shards;
+}
+
+/// Merges the top-k lists of `shards` into a single top-k list, translating shard-local
+/// document IDs to global ones with `global_docids`.
+[[nodiscard]] inline auto merge_shard_results(
+    gsl::span<Shard_Id const> shards,
+    gsl::span<std::vector<topk_queue::entry_type> const> results,
+    VecMap<Shard_Id, std::vector<Document_Id>> const& global_docids,
+    std::size_t k) -> std::vector<topk_queue::entry_type>
+{
+    if (shards.size() != results.size()) {
+        throw std::invalid_argument(fmt::format(
+            "Number of shards ({}) does not match number of results ({})",
+            shards.size(),
+            results.size()));
+    }
+    topk_queue topk(k);
+    for (std::size_t idx = 0; idx < static_cast<std::size_t>(shards.size()); ++idx) {
+        auto const& docids = global_docids[shards[idx]];
+        for (auto [score, docid]: results[idx]) {
+            topk.insert(score, static_cast<DocId>(docids.at(docid).as_int()));
+        }
+    }
+    topk.finalize();
+    return topk.topk();
+}
+
+/// Returns `true` if `algorithm` can be used to query a `search_shard`.
+[[nodiscard]] inline auto is_shard_algorithm(std::string const& algorithm) -> bool
+{
+    return algorithm == "wand" || algorithm == "maxscore" || algorithm == "block_max_wand"
+        || algorithm == "block_max_maxscore";
+}
+
+/// A shard served by `selective_search_broker`: an index with its WAND data and scorer.
+template <typename Index, typename Wand>
+struct search_shard {
+    search_shard(
+        std::string const& index_path,
+        std::string const& wand_data_path,
+        ScorerParams const& scorer_params)
+        : index(MemorySource::mapped_file(index_path)),
+          wdata(MemorySource::mapped_file(wand_data_path)),
+          scorer(scorer::from_params(scorer_params, wdata))
+    {}
+
+    /// Returns the top `k` documents of `query` retrieved with `algorithm`, which must be one of
+    /// those accepted by `is_shard_algorithm`.
+    [[nodiscard]] auto search(Query const& query, std::string const& algorithm, std::size_t k) const
+        -> std::vector<topk_queue::entry_type>
+    {
+        topk_queue topk(k);
+        if (algorithm == "wand") {
+            wand_query wand_q(topk);
+            wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        } else if (algorithm == "maxscore") {
+            maxscore_query maxscore_q(topk);
+            maxscore_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        } else if (algorithm == "block_max_wand") {
+            block_max_wand_query block_max_wand_q(topk);
+            block_max_wand_q(
+                make_block_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        } else if (algorithm == "block_max_maxscore") {
+            block_max_maxscore_query block_max_maxscore_q(topk);
+            block_max_maxscore_q(
+                make_block_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        } else {
+            throw std::invalid_argument(fmt::format("Unsupported algorithm: {}", algorithm));
+        }
+        topk.finalize();
+        return topk.topk();
+    }
+
+    Index index;
+    Wand wdata;
+    std::unique_ptr<index_scorer<Wand>> scorer;
+};
+
+/// Executes queries on the selected shards of a collection in parallel, and merges their
+/// results into a global top-k list.
+template <typename Index, typename Wand>
+class selective_search_broker {
+  public:
+    using shard_type = search_shard<Index, Wand>;
+
+    struct result_type {
+        std::vector<topk_queue::entry_type> topk;
+        std::vector<Shard_Id> shards;
+        std::chrono::microseconds time;
+    };
+
+    /// Constructs a broker over `shards`, where `global_docids` maps the document IDs of each
+    /// shard to global ones, retrieving the top `k` documents with `algorithm`.
+    selective_search_broker(
+        std::vector<std::unique_ptr<shard_type>> shards,
+        VecMap<Shard_Id, std::vector<Document_Id>> global_docids,
+        std::string algorithm,
+        std::size_t k)
+        : m_shards(std::move(shards)),
+          m_global_docids(std::move(global_docids)),
+          m_algorithm(std::move(algorithm)),
+          m_k(k)
+    {
+        if (m_shards.size() != m_global_docids.size()) {
+            throw std::invalid_argument(fmt::format(
+                "Number of shards ({}) does not match number of document mappings ({})",
+                m_shards.size(),
+                m_global_docids.size()));
+        }
+        if (not is_shard_algorithm(m_algorithm)) {
+            throw std::invalid_argument(fmt::format("Unsupported algorithm: {}", m_algorithm));
+        }
+    }
+
+    [[nodiscard]] auto num_shards() const -> std::size_t { return m_shards.size(); }
+
+    /// Runs the query on `shards`, where `shard_queries` contains the query with term IDs of
+    /// each shard.
+    [[nodiscard]] auto
+    operator()(VecMap<Shard_Id, Query> const& shard_queries, std::vector<Shard_Id> shards) const
+        -> result_type
+    {
+        if (shard_queries.size() != m_shards.size()) {
+            throw std::invalid_argument(fmt::format(
+                "Expected queries for {} shards but {} given",
+                m_shards.size(),
+                shard_queries.size()));
+        }
+        result_type result;
+        result.shards = std::move(shards);
+        result.time = run_with_timer<std::chrono::microseconds>([&] {
+            std::vector<std::vector<topk_queue::entry_type>> shard_results(result.shards.size());
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(0, result.shards.size(), 1),
+                [&](tbb::blocked_range<std::size_t> const& range) {
+                    for (auto idx = range.begin(); idx != range.end(); ++idx) {
+                        auto shard = result.shards[idx];
+                        shard_results[idx] = m_shards[shard.as_int()]->search(
+                            shard_queries[shard], m_algorithm, m_k);
+                    }
+                });
+            result.topk = merge_shard_results(
+                gsl::make_span(result.shards), gsl::make_span(shard_results), m_global_docids, m_k);
+        });
+        return result;
+    }
+
+  private:
+    std::vector<std::unique_ptr<shard_type>> m_shards;
+    VecMap<Shard_Id, std::vector<Document_Id>> m_global_docids;
+    std::string m_algorithm;
+    std::size_t m_k;
+};
+
+}  // namespace pisa
@@ -24,6 +24,14 @@ auto mapping_from_files(std::istream* full_titles, gsl::span<std::istream*> shar
 auto mapping_from_files(std::string const& full_titles, gsl::span<std::string const> shard_titles)
     -> VecMap<Document_Id, Shard_Id>;
 
+/// Returns, for each shard, the global IDs of its documents in the order of their shard IDs.
+/// Documents are matched by their titles.
+auto global_document_ids(std::istream* full_titles, gsl::span<std::istream*> shard_titles)
+    -> VecMap<Shard_Id, std::vector<Document_Id>>;
+
+auto global_document_ids(std::string const& full_titles, gsl::span<std::string const> shard_titles)
+    -> VecMap<Shard_Id, std::vector<Document_Id>>;
+
 auto create_random_mapping(
     int document_count, int shard_count, std::optional<std::uint64_t> seed = std::nullopt)
     -> VecMap<Document_Id, Shard_Id>;
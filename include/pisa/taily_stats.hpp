@@ -6,6 +6,8 @@
 #include <gsl/span>
 #include <mio/mmap.hpp>
 #include <taily.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #include "binary_freq_collection.hpp"
 #include "memory_source.hpp"
@@ -79,30 +81,34 @@ class TailyStats {
 };
 
 /// Constructs a vector of `taily::Feature_Statistics` for each term in the `collection` using
-/// `scorer`.
+/// `scorer`. Posting lists are processed in parallel.
 template <typename Scorer>
 [[nodiscard]] auto extract_feature_stats(pisa::binary_freq_collection const& collection, Scorer scorer)
     -> std::vector<taily::Feature_Statistics>
 {
-    std::vector<taily::Feature_Statistics> term_stats;
+    std::vector<binary_freq_collection::sequence> lists(collection.begin(), collection.end());
+    std::vector<taily::Feature_Statistics> term_stats(lists.size());
     {
-        pisa::progress progress("Processing posting lists", collection.size());
-        std::size_t term_id = 0;
-        for (auto const& seq: collection) {
-            std::vector<float> scores;
-            std::uint64_t size = seq.docs.size();
-            scores.reserve(size);
-            auto term_scorer = scorer->term_scorer(term_id);
-            for (std::size_t i = 0; i < seq.docs.size(); ++i) {
-                std::uint64_t docid = *(seq.docs.begin() + i);
-                std::uint64_t freq = *(seq.freqs.begin() + i);
-                float score = term_scorer(docid, freq);
-                scores.push_back(score);
-            }
-            term_stats.push_back(taily::Feature_Statistics::from_features(scores));
-            term_id += 1;
-            progress.update(1);
-        }
+        pisa::progress progress("Processing posting lists", lists.size());
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, lists.size()),
+            [&](tbb::blocked_range<std::size_t> const& range) {
+                std::vector<float> scores;
+                for (auto term_id = range.begin(); term_id != range.end(); ++term_id) {
+                    auto const& seq = lists[term_id];
+                    scores.clear();
+                    scores.reserve(seq.docs.size());
+                    auto term_scorer = scorer->term_scorer(term_id);
+                    for (std::size_t i = 0; i < seq.docs.size(); ++i) {
+                        std::uint64_t docid = *(seq.docs.begin() + i);
+                        std::uint64_t freq = *(seq.freqs.begin() + i);
+                        float score = term_scorer(docid, freq);
+                        scores.push_back(score);
+                    }
+                    term_stats[term_id] = taily::Feature_Statistics::from_features(scores);
+                }
+                progress.update(range.size());
+            });
     }
     return term_stats;
 }
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+#include <gsl/span>
+
+#include "mappable/mappable_vector.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "query/queries.hpp"
+#include "type_alias.hpp"
+
+namespace pisa {
+
+/// A store of k-th highest scores of single terms, term pairs, and term triples, for a set of
+/// values of k, used to seed `topk_queue` with a safe initial threshold at query time.
+///
+/// The k-th highest score of a disjunctive query over a subset of the query terms is a lower
+/// bound on the k-th highest score of the query itself, and so is the k'-th highest score of
+/// the subset for any k' >= k. Thus, `threshold()` returns the maximum over all stored subsets
+/// of a query, using the smallest stored k' >= k. Note that the bound does not hold for
+/// conjunctive queries.
+///
+/// Terms and pairs are keyed by their IDs packed into 64 bits. Triples are keyed by their first
+/// two IDs, with the third stored alongside, so that lookups are always exact.
+class threshold_store {
+  private:
+    /// The key of a set of sorted distinct terms: the term itself, the two terms of a pair, or the
+    /// first two terms of a triple packed into `key`, and the third term of a triple in `third`.
+    struct key_type {
+        std::size_t arity;
+        std::uint64_t key;
+        term_id_type third;
+
+        [[nodiscard]] auto operator<(key_type const& other) const -> bool
+        {
+            return std::tie(key, third) < std::tie(other.key, other.third);
+        }
+        [[nodiscard]] auto operator!=(key_type const& other) const -> bool
+        {
+            return std::tie(key, third) != std::tie(other.key, other.third);
+        }
+    };
+
+  public:
+    static constexpr std::size_t max_arity = 3;
+
+    threshold_store() = default;
+    explicit threshold_store(MemorySource source) : m_source(std::move(source))
+    {
+        mapper::map(*this, m_source.data(), mapper::map_flags::warmup);
+    }
+
+    class builder {
+      public:
+        /// Constructs a builder storing scores for each of `ks`.
+        explicit builder(std::vector<std::uint32_t> ks) : m_ks(std::move(ks))
+        {
+            if (m_ks.empty()) {
+                throw std::invalid_argument("At least one value of k is required");
+            }
+            std::sort(m_ks.begin(), m_ks.end());
+            m_ks.erase(std::unique(m_ks.begin(), m_ks.end()), m_ks.end());
+        }
+
+        [[nodiscard]] auto ks() const -> std::vector<std::uint32_t> const& { return m_ks; }
+
+        /// Adds the k-th highest scores of a query consisting of `terms`, in the order of `ks()`.
+        void add(gsl::span<term_id_type const> terms, gsl::span<Score const> scores)
+        {
+            if (static_cast<std::size_t>(scores.size()) != m_ks.size()) {
+                throw std::invalid_argument(fmt::format(
+                    "Expected {} scores but {} given", m_ks.size(), scores.size()));
+            }
+            auto key = threshold_store::key(terms);
+            if (not key) {
+                throw std::invalid_argument(
+                    fmt::format("Only 1 to {} distinct terms can be stored", max_arity));
+            }
+            auto& entries = m_entries[key->arity - 1];
+            entries.emplace_back(*key, std::vector<Score>(scores.begin(), scores.end()));
+        }
+
+        void build(threshold_store& store)
+        {
+            store.m_ks.steal(m_ks);
+            build_arity(m_entries[0], store.m_term_keys, nullptr, store.m_term_scores);
+            build_arity(m_entries[1], store.m_pair_keys, nullptr, store.m_pair_scores);
+            build_arity(
+                m_entries[2], store.m_triple_keys, &store.m_triple_thirds, store.m_triple_scores);
+        }
+
+      private:
+        using entry_type = std::pair<key_type, std::vector<Score>>;
+
+        /// Sorts entries by key and writes one row of scores per distinct key. Entries with the
+        /// same key come from the same terms, so taking their maximum is still a lower bound.
+        static void build_arity(
+            std::vector<entry_type>& entries,
+            mapper::mappable_vector<std::uint64_t>& keys,
+            mapper::mappable_vector<term_id_type>* thirds,
+            mapper::mappable_vector<Score>& scores)
+        {
+            std::sort(entries.begin(), entries.end(), [](auto const& lhs, auto const& rhs) {
+                return lhs.first < rhs.first;
+            });
+            std::vector<std::uint64_t> sorted_keys;
+            std::vector<term_id_type> sorted_thirds;
+            std::vector<Score> sorted_scores;
+            for (auto first = entries.begin(); first != entries.end();) {
+                auto last = std::find_if(first, entries.end(), [&](auto const& entry) {
+                    return entry.first != first->first;
+                });
+                sorted_keys.push_back(first->first.key);
+                sorted_thirds.push_back(first->first.third);
+                for (std::size_t idx = 0; idx < first->second.size(); ++idx) {
+                    sorted_scores.push_back(
+                        std::max_element(first, last, [idx](auto const& lhs, auto const& rhs) {
+                            return lhs.second[idx] < rhs.second[idx];
+                        })->second[idx]);
+                }
+                first = last;
+            }
+            keys.steal(sorted_keys);
+            if (thirds != nullptr) {
+                thirds->steal(sorted_thirds);
+            }
+            scores.steal(sorted_scores);
+            entries.clear();
+        }
+
+        std::vector<std::uint32_t> m_ks;
+        std::array<std::vector<entry_type>, max_arity> m_entries;
+    };
+
+    /// Returns the values of k for which scores are stored, in increasing order.
+    [[nodiscard]] auto ks() const -> gsl::span<std::uint32_t const>
+    {
+        return gsl::make_span(m_ks.data(), m_ks.size());
+    }
+
+    /// Returns the number of stored terms, pairs, and triples.
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_term_keys.size() + m_pair_keys.size() + m_triple_keys.size();
+    }
+
+    /// Returns the k-th highest score stored for exactly the (distinct) `terms`, if any.
+    [[nodiscard]] auto find(gsl::span<term_id_type const> terms, std::size_t k) const
+        -> std::optional<Score>
+    {
+        auto column = k_column(k);
+        auto key = threshold_store::key(terms);
+        if (not column || not key) {
+            return std::nullopt;
+        }
+        return find(*key, *column);
+    }
+
+    /// Returns the highest safe initial threshold for a top-`k` disjunctive query over `terms`,
+    /// or 0 if none of its terms, pairs, or triples is stored.
+    [[nodiscard]] auto threshold(gsl::span<term_id_type const> terms, std::size_t k) const -> Score
+    {
+        auto column = k_column(k);
+        if (not column) {
+            return 0.0F;
+        }
+        thread_local std::vector<term_id_type> distinct;
+        distinct.assign(terms.begin(), terms.end());
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+        Score threshold = 0.0F;
+        auto update = [&](key_type const& key) {
+            if (auto score = find(key, *column); score) {
+                threshold = std::max(threshold, *score);
+            }
+        };
+        auto n = distinct.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            update(key_type{1, distinct[i], 0});
+            if (m_pair_keys.size() > 0) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    update(key_type{2, pair_key(distinct[i], distinct[j]), 0});
+                }
+            }
+            if (m_triple_keys.size() > 0) {
+                for (std::size_t j = i + 1; j < n; ++j) {
+                    for (std::size_t s = j + 1; s < n; ++s) {
+                        update(key_type{3, pair_key(distinct[i], distinct[j]), distinct[s]});
+                    }
+                }
+            }
+        }
+        return threshold;
+    }
+
+    [[nodiscard]] auto threshold(Query const& query, std::size_t k) const -> Score
+    {
+        return threshold(gsl::make_span(query.terms), k);
+    }
+
+    template <typename Visitor>
+    void map(Visitor& visit)
+    {
+        visit(m_ks, "m_ks")(m_term_keys, "m_term_keys")(m_term_scores, "m_term_scores")(
+            m_pair_keys, "m_pair_keys")(m_pair_scores, "m_pair_scores")(
+            m_triple_keys, "m_triple_keys")(m_triple_thirds, "m_triple_thirds")(
+            m_triple_scores, "m_triple_scores");
+    }
+
+  private:
+    [[nodiscard]] static auto pair_key(term_id_type first, term_id_type second) -> std::uint64_t
+    {
+        return (static_cast<std::uint64_t>(first) << 32U) | second;
+    }
+
+    /// Returns the key of the sorted distinct `terms`.
+    [[nodiscard]] static auto key(gsl::span<term_id_type const> terms) -> std::optional<key_type>
+    {
+        std::vector<term_id_type> distinct(terms.begin(), terms.end());
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        switch (distinct.size()) {
+        case 1: return key_type{1, distinct[0], 0};
+        case 2: return key_type{2, pair_key(distinct[0], distinct[1]), 0};
+        case 3: return key_type{3, pair_key(distinct[0], distinct[1]), distinct[2]};
+        default: return std::nullopt;
+        }
+    }
+
+    /// Returns the position of the smallest stored k' >= k.
+    [[nodiscard]] auto k_column(std::size_t k) const -> std::optional<std::size_t>
+    {
+        auto pos = std::lower_bound(m_ks.begin(), m_ks.end(), k);
+        if (pos == m_ks.end()) {
+            return std::nullopt;
+        }
+        return std::distance(m_ks.begin(), pos);
+    }
+
+    [[nodiscard]] auto find(key_type const& key, std::size_t column) const -> std::optional<Score>
+    {
+        auto const& [keys, scores] = [&]() {
+            switch (key.arity) {
+            case 1: return std::tie(m_term_keys, m_term_scores);
+            case 2: return std::tie(m_pair_keys, m_pair_scores);
+            default: return std::tie(m_triple_keys, m_triple_scores);
+            }
+        }();
+        auto [first, last] = std::equal_range(keys.begin(), keys.end(), key.key);
+        if (first == last) {
+            return std::nullopt;
+        }
+        auto offset = std::distance(keys.begin(), first);
+        if (key.arity == max_arity) {
+            // Triples sharing their first two terms are sorted by the third one.
+            auto thirds_first = m_triple_thirds.begin() + offset;
+            auto thirds_last = thirds_first + std::distance(first, last);
+            auto pos = std::lower_bound(thirds_first, thirds_last, key.third);
+            if (pos == thirds_last || *pos != key.third) {
+                return std::nullopt;
+            }
+            offset = std::distance(m_triple_thirds.begin(), pos);
+        }
+        return scores[offset * m_ks.size() + column];
+    }
+
+    mapper::mappable_vector<std::uint32_t> m_ks;
+    mapper::mappable_vector<std::uint64_t> m_term_keys;
+    mapper::mappable_vector<Score> m_term_scores;
+    mapper::mappable_vector<std::uint64_t> m_pair_keys;
+    mapper::mappable_vector<Score> m_pair_scores;
+    mapper::mappable_vector<std::uint64_t> m_triple_keys;
+    mapper::mappable_vector<term_id_type> m_triple_thirds;
+    mapper::mappable_vector<Score> m_triple_scores;
+    MemorySource m_source;
+};
+
+}  // namespace pisa
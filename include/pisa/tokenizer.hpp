@@ -2,8 +2,10 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <boost/config/warning_disable.hpp>
 #include <boost/iterator/filter_iterator.hpp>
@@ -13,6 +15,8 @@
 #include <boost/spirit/include/qi.hpp>
 #include <boost/tokenizer.hpp>
 
+#include "cpu_dispatch.hpp"
+
 namespace pisa {
 
 namespace lex = boost::spirit::lex;
@@ -81,4 +85,116 @@ class TermTokenizer {
     std::string_view::const_iterator last_;
 };
 
+/// Tokenizes ASCII text with the same rules as `TermTokenizer`.
+///
+/// The text is copied into an internal buffer, reused between calls, while alphanumeric bytes
+/// are marked in a bit mask, 16 or 32 bytes at a time, depending on the SIMD level. Tokens are then found by scanning the mask
+/// and passed to the callback as views into the buffer, valid only until the next call.
+/// If the text contains any non-ASCII byte, nothing is tokenized and `false` is returned,
+/// so that the caller can fall back to `TermTokenizer`.
+class AsciiTermTokenizer {
+  public:
+    explicit AsciiTermTokenizer(SimdLevel level = kernel_level(ASCII_CLASSIFY_KERNEL))
+        : m_level(level)
+    {}
+
+    template <typename Fn>
+    [[nodiscard]] auto tokenize(std::string_view text, Fn&& fn) -> bool
+    {
+        if (not classify(text)) {
+            return false;
+        }
+        auto size = m_buffer.size();
+        auto is_letter = [&](std::size_t pos) { return is_ascii_letter(m_buffer[pos]); };
+        auto all_letters = [&](std::size_t first, std::size_t last) {
+            return std::all_of(&m_buffer[first], &m_buffer[last], is_ascii_letter);
+        };
+        std::size_t pos = 0;
+        while ((pos = next_alnum(pos)) < size) {
+            auto start = pos;
+            auto end = next_non_alnum(start);
+            pos = end;
+            if (end < size && m_buffer[end] == '.' && all_letters(start, end)) {
+                // Abbreviation: at least two groups of letters, each followed by a period.
+                std::size_t group_count = 1;
+                auto abbreviation_end = end + 1;
+                std::size_t length = end - start;
+                while (abbreviation_end < size && is_alnum(abbreviation_end)) {
+                    auto group_end = next_non_alnum(abbreviation_end);
+                    if (group_end == size || m_buffer[group_end] != '.'
+                        || not all_letters(abbreviation_end, group_end)) {
+                        break;
+                    }
+                    std::copy(
+                        &m_buffer[abbreviation_end],
+                        &m_buffer[group_end],
+                        &m_buffer[start + length]);
+                    length += group_end - abbreviation_end;
+                    abbreviation_end = group_end + 1;
+                    ++group_count;
+                }
+                if (group_count > 1) {
+                    fn(std::string_view(&m_buffer[start], length));
+                    pos = abbreviation_end;
+                    continue;
+                }
+            } else if (end + 1 < size && m_buffer[end] == '\'' && is_letter(end + 1)) {
+                // Possessive: the apostrophe and the letters that follow it are skipped.
+                pos = end + 1;
+                while (pos < size && is_letter(pos)) {
+                    ++pos;
+                }
+            }
+            fn(std::string_view(&m_buffer[start], end - start));
+        }
+        return true;
+    }
+
+  private:
+    [[nodiscard]] static auto is_ascii_letter(char ch) -> bool
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+    }
+
+    /// Copies the text into the buffer and marks its alphanumeric bytes.
+    /// Returns `false` if the text contains non-ASCII bytes.
+    [[nodiscard]] auto classify(std::string_view text) -> bool;
+
+    [[nodiscard]] auto is_alnum(std::size_t pos) const -> bool
+    {
+        return ((m_alnum[pos >> 6U] >> (pos & 63U)) & 1U) == 1U;
+    }
+
+    [[nodiscard]] auto next_alnum(std::size_t pos) const -> std::size_t
+    {
+        return next_bit(pos, 0U);
+    }
+
+    [[nodiscard]] auto next_non_alnum(std::size_t pos) const -> std::size_t
+    {
+        return next_bit(pos, ~std::uint64_t(0));
+    }
+
+    /// Returns the position of the first set bit of the mask XOR `flip`, starting at `pos`.
+    [[nodiscard]] auto next_bit(std::size_t pos, std::uint64_t flip) const -> std::size_t
+    {
+        auto word = pos >> 6U;
+        if (word >= m_alnum.size()) {
+            return m_buffer.size();
+        }
+        auto bits = (m_alnum[word] ^ flip) & (~std::uint64_t(0) << (pos & 63U));
+        while (bits == 0U) {
+            if (++word == m_alnum.size()) {
+                return m_buffer.size();
+            }
+            bits = m_alnum[word] ^ flip;
+        }
+        return std::min<std::size_t>((word << 6U) + __builtin_ctzll(bits), m_buffer.size());
+    }
+
+    SimdLevel m_level;
+    std::string m_buffer{};
+    std::vector<std::uint64_t> m_alnum{};
+};
+
 }  // namespace pisa
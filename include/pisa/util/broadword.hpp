@@ -78,6 +78,10 @@ namespace pisa { namespace broadword {
     {
         assert(k < popcount(x));
 
+#if USE_PDEP
+        // deposit a single bit at the position of the k-th one of x
+        return intrinsics::tzcnt(intrinsics::pdep(uint64_t(1) << k, x));
+#else
         uint64_t byte_sums = byte_counts(x) * ones_step_8;
 
         const uint64_t k_step_8 = k * ones_step_8;
@@ -89,6 +93,7 @@ namespace pisa { namespace broadword {
 #endif
         const uint64_t byte_rank = k - (((byte_sums << 8) >> place) & uint64_t(0xFF));
         return place + tables::select_in_byte[((x >> place) & 0xFF) | (byte_rank << 8)];
+#endif
     }
 
     inline uint64_t same_msb(uint64_t x, uint64_t y)
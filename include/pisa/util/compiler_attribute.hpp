@@ -23,4 +23,11 @@
     #define PISA_FLATTEN_FUNC __attribute__((always_inline, flatten))
 #else
     #define PISA_FLATTEN_FUNC PISA_ALWAYSINLINE
-#endif
\ No newline at end of file
+#endif
+
+// target instruction set of a kernel selected at run time
+#if defined(__clang__) || defined(__GNUC__)
+    #define PISA_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define PISA_TARGET(isa)
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace pisa::hash {
+
+/// Finalization mix of MurmurHash3: a fast, bijective scrambling of a 64-bit integer.
+[[nodiscard]] constexpr auto mix64(std::uint64_t key) noexcept -> std::uint64_t
+{
+    key ^= key >> 33U;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33U;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33U;
+    return key;
+}
+
+/// MurmurHash64A of a byte string.
+///
+/// Unlike `std::hash`, the result is stable across platforms and standard library
+/// implementations, so it can be stored on disk.
+[[nodiscard]] inline auto murmur64(std::string_view data, std::uint64_t seed = 0) noexcept
+    -> std::uint64_t
+{
+    constexpr std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+    constexpr unsigned r = 47;
+    auto len = data.size();
+    std::uint64_t h = seed ^ (len * m);
+    auto const* pos = reinterpret_cast<unsigned char const*>(data.data());
+    auto const* end = pos + (len & ~std::size_t(7));
+    for (; pos != end; pos += 8) {
+        std::uint64_t k;
+        std::memcpy(&k, pos, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    switch (len & 7U) {
+    case 7: h ^= std::uint64_t(pos[6]) << 48U; [[fallthrough]];
+    case 6: h ^= std::uint64_t(pos[5]) << 40U; [[fallthrough]];
+    case 5: h ^= std::uint64_t(pos[4]) << 32U; [[fallthrough]];
+    case 4: h ^= std::uint64_t(pos[3]) << 24U; [[fallthrough]];
+    case 3: h ^= std::uint64_t(pos[2]) << 16U; [[fallthrough]];
+    case 2: h ^= std::uint64_t(pos[1]) << 8U; [[fallthrough]];
+    case 1: h ^= std::uint64_t(pos[0]); h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+}  // namespace pisa::hash
@@ -7,6 +7,12 @@
 #else
     #define USE_POPCNT 0
 #endif
+// See the PISA_ENABLE_PDEP option in docs/source/getting_started.md.
+#if defined(PISA_ENABLE_PDEP) && defined(__BMI__) && defined(__BMI2__)
+    #define USE_PDEP 1
+#else
+    #define USE_PDEP 0
+#endif
 
 #if defined(__GNUC__) || defined(__clang__)
     #define __INTRIN_INLINE inline __attribute__((__always_inline__))
@@ -74,4 +80,12 @@ namespace pisa { namespace intrinsics {
 
 #endif /* USE_POPCNT */
 
+#if USE_PDEP
+
+    __INTRIN_INLINE uint64_t pdep(uint64_t x, uint64_t mask) { return _pdep_u64(x, mask); }
+
+    __INTRIN_INLINE uint64_t tzcnt(uint64_t x) { return _tzcnt_u64(x); }
+
+#endif /* USE_PDEP */
+
 }}  // namespace pisa::intrinsics
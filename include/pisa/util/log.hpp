@@ -24,6 +24,9 @@ class Log2 {
         return m_values[n];
     }
 
+    /// Precomputed values of `log2(n)` for `n < N`.
+    [[nodiscard]] constexpr auto values() const -> std::array<double, N> const& { return m_values; }
+
   private:
     std::array<double, N> m_values{};
 };
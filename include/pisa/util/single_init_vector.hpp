@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 template <class T>
@@ -15,11 +16,26 @@ class single_init_entry {
         m_generation = generation;
     }
 
+    /// Byte offsets of the value and the generation within an entry, for code that reads
+    /// entries directly, such as vector gathers.
+    static constexpr auto value_offset() -> std::size_t
+    {
+        return offsetof(single_init_entry, m_value);
+    }
+    static constexpr auto generation_offset() -> std::size_t
+    {
+        return offsetof(single_init_entry, m_generation);
+    }
+
   private:
     T m_value;
     std::size_t m_generation;
 };
 
+// The gathers of BP degrees read the value and the generation as consecutive 64-bit words.
+static_assert(single_init_entry<std::size_t>::value_offset() == 0);
+static_assert(single_init_entry<std::size_t>::generation_offset() == sizeof(std::size_t));
+
 template <typename T>
 struct Default {
     constexpr static T value = T();
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <locale>
 #include <map>
+#include <string_view>
 #include <vector>
 
 #include "util/broadword.hpp"
@@ -113,6 +114,29 @@ make_function_iterator(State initial_state, AdvanceFunctor, ValueFunctor)
     return function_iterator<State, AdvanceFunctor, ValueFunctor>(initial_state);
 }
 
+/// Writes `str` to `os` as a quoted JSON string.
+inline void write_json_string(std::ostream& os, std::string_view str)
+{
+    os << '"';
+    for (char c: str) {
+        switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\r': os << "\\r"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec
+                   << std::setfill(' ');
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
 struct stats_line {
     stats_line() { std::cout << "{"; }
     stats_line(stats_line const&) = default;
@@ -149,8 +173,7 @@ struct stats_line {
         std::cout << v;
     }
 
-    // XXX properly escape strings
-    void emit(const char* s) const { std::cout << '"' << s << '"'; }
+    void emit(const char* s) const { write_json_string(std::cout, s); }
 
     void emit(std::string const& s) const { emit(s.c_str()); }
 
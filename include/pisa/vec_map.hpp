@@ -194,8 +194,10 @@ class VecMap: protected std::vector<V> {
     {}
     VecMap(VecMap const& other) : std::vector<V, Allocator>(other) {}
     VecMap(VecMap const& other, const Allocator& alloc) : std::vector<V, Allocator>(other, alloc) {}
-    VecMap(VecMap&& other) noexcept : std::vector<V, Allocator>(other) {}
-    VecMap(VecMap&& other, Allocator const& alloc) : std::vector<V, Allocator>(other, alloc) {}
+    VecMap(VecMap&& other) noexcept : std::vector<V, Allocator>(std::move(other)) {}
+    VecMap(VecMap&& other, Allocator const& alloc)
+        : std::vector<V, Allocator>(std::move(other), alloc)
+    {}
     VecMap(std::initializer_list<V> init, Allocator const& alloc = Allocator())
         : std::vector<V, Allocator>(init, alloc)
     {}
@@ -210,7 +212,7 @@ class VecMap: protected std::vector<V> {
     };
     auto operator=(VecMap&& other) noexcept -> VecMap&
     {
-        std::vector<V, Allocator>::operator=(other);
+        std::vector<V, Allocator>::operator=(std::move(other));
         return *this;
     };
     auto operator=(std::initializer_list<V> init) -> VecMap&
@@ -5,10 +5,15 @@
 #include <unordered_set>
 
 #include "boost/variant.hpp"
+#include "fmt/format.h"
+#include "gsl/span"
 #include "spdlog/spdlog.h"
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
 
 #include "binary_collection.hpp"
 #include "binary_freq_collection.hpp"
+#include "global_statistics.hpp"
 #include "mappable/mappable_vector.hpp"
 #include "mappable/mapper.hpp"
 #include "memory_source.hpp"
@@ -24,6 +29,10 @@
 class enumerator;
 namespace pisa {
 
+/// Number of posting lists whose blocks are computed in parallel at a time when building WAND
+/// data from a collection.
+constexpr std::size_t wand_build_batch_size = 4096;
+
 template <typename block_wand_type = wand_data_raw>
 class wand_data {
   public:
@@ -61,7 +70,7 @@ class wand_data {
 
         m_avg_len = float(m_collection_len / double(num_docs));
 
-        typename block_wand_type::builder builder(coll, params);
+        typename block_wand_type::builder builder(num_docs, coll.size(), params);
 
         {
             pisa::progress progress("Storing terms statistics", coll.size());
@@ -87,21 +96,37 @@ class wand_data {
         auto scorer = scorer::from_params(scorer_params, *this);
         {
             pisa::progress progress("Storing score upper bounds", coll.size());
+            std::vector<binary_freq_collection::sequence> lists;
             size_t term_id = 0;
-            size_t new_term_id = 0;
             for (auto const& seq: coll) {
                 if (terms_to_drop.find(term_id) != terms_to_drop.end()) {
                     progress.update(1);
-                    term_id += 1;
-                    continue;
+                } else {
+                    lists.push_back(seq);
                 }
-                auto v = builder.add_sequence(
-                    seq, coll, doc_lens, m_avg_len, scorer->term_scorer(new_term_id), block_size);
-                max_term_weight.push_back(v);
-                m_index_max_term_weight = std::max(m_index_max_term_weight, v);
                 term_id += 1;
-                new_term_id += 1;
-                progress.update(1);
+            }
+            // Blocks of a batch of lists are computed in parallel, and then appended in term order.
+            std::vector<typename block_wand_type::builder::blocks_type> blocks;
+            for (size_t first = 0; first < lists.size(); first += wand_build_batch_size) {
+                size_t last = std::min(first + wand_build_batch_size, lists.size());
+                blocks.resize(last - first);
+                tbb::parallel_for(
+                    tbb::blocked_range<size_t>(first, last, 1),
+                    [&](tbb::blocked_range<size_t> const& range) {
+                        for (auto new_term_id = range.begin(); new_term_id != range.end();
+                             ++new_term_id) {
+                            blocks[new_term_id - first] = builder.compute_blocks(
+                                lists[new_term_id], scorer->term_scorer(new_term_id), block_size);
+                        }
+                    });
+                for (size_t new_term_id = first; new_term_id < last; ++new_term_id) {
+                    auto v = builder.add_blocks(
+                        lists[new_term_id].docs.size(), std::move(blocks[new_term_id - first]));
+                    max_term_weight.push_back(v);
+                    m_index_max_term_weight = std::max(m_index_max_term_weight, v);
+                }
+                progress.update(last - first);
             }
             if (is_quantized) {
                 LinearQuantizer quantizer(
@@ -116,6 +141,155 @@ class wand_data {
         m_max_term_weight.steal(max_term_weight);
     }
 
+    /// Builds WAND data for the collection of `other` with document IDs reassigned by `mapping`.
+    ///
+    /// Document lengths are permuted, while term statistics and list upper bounds are copied,
+    /// as they do not depend on document IDs. Block upper bounds are recomputed from the remapped
+    /// posting lists: `for_each_list(fn)` must call `fn(seq)` for every list in term order,
+    /// where `seq` is a `binary_freq_collection::sequence` with the new document IDs.
+    /// `is_quantized` must match the way `other` was built, since its list upper bounds are
+    /// copied verbatim.
+    template <typename ForEachList>
+    wand_data(
+        wand_data const& other,
+        gsl::span<uint32_t const> mapping,
+        const ScorerParams& scorer_params,
+        BlockSize block_size,
+        bool is_quantized,
+        ForEachList&& for_each_list)
+        : m_num_docs(other.m_num_docs),
+          m_avg_len(other.m_avg_len),
+          m_collection_len(other.m_collection_len),
+          m_index_max_term_weight(other.m_index_max_term_weight)
+    {
+        if (mapping.size() != other.m_doc_lens.size()) {
+            throw std::invalid_argument(fmt::format(
+                "Mapping has {} documents but WAND data has {}",
+                mapping.size(),
+                other.m_doc_lens.size()));
+        }
+        std::vector<uint32_t> doc_lens(mapping.size());
+        for (size_t doc = 0; doc < mapping.size(); ++doc) {
+            doc_lens[mapping[doc]] = other.m_doc_lens[doc];
+        }
+        std::vector<uint32_t> term_occurrence_counts(
+            other.m_term_occurrence_counts.begin(), other.m_term_occurrence_counts.end());
+        std::vector<uint32_t> term_posting_counts(
+            other.m_term_posting_counts.begin(), other.m_term_posting_counts.end());
+        std::vector<float> max_term_weight(
+            other.m_max_term_weight.begin(), other.m_max_term_weight.end());
+        auto term_count = term_posting_counts.size();
+        m_doc_lens.steal(doc_lens);
+        m_term_occurrence_counts.steal(term_occurrence_counts);
+        m_term_posting_counts.steal(term_posting_counts);
+        m_max_term_weight.steal(max_term_weight);
+
+        global_parameters params;
+        typename block_wand_type::builder builder(mapping.size(), term_count, params);
+        auto scorer = scorer::from_params(scorer_params, *this);
+        size_t term_id = 0;
+        for_each_list([&](binary_freq_collection::sequence const& seq) {
+            builder.add_sequence(
+                seq, doc_lens, m_avg_len, scorer->term_scorer(term_id), block_size);
+            term_id += 1;
+        });
+        if (term_id != term_count) {
+            throw std::invalid_argument(fmt::format(
+                "Remapped {} posting lists but WAND data has {}", term_id, term_count));
+        }
+        if (is_quantized) {
+            builder.quantize_block_max_term_weights(m_index_max_term_weight);
+        }
+        builder.build(m_block_wand);
+    }
+
+    /// Builds WAND data from document lengths and term statistics gathered elsewhere, e.g.,
+    /// summed over several indexes being merged.
+    ///
+    /// Unlike the constructor above, list upper bounds are recomputed along with block upper
+    /// bounds, since scores depend on collection statistics. Lists are passed by
+    /// `for_each_list` in the same way.
+    template <typename ForEachList>
+    wand_data(
+        std::vector<uint32_t> doc_lens,
+        std::vector<uint32_t> term_occurrence_counts,
+        std::vector<uint32_t> term_posting_counts,
+        const ScorerParams& scorer_params,
+        BlockSize block_size,
+        bool is_quantized,
+        ForEachList&& for_each_list)
+        : wand_data(
+            doc_lens,
+            global_statistics{
+                doc_lens.size(),
+                std::accumulate(doc_lens.begin(), doc_lens.end(), uint64_t(0)),
+                std::move(term_occurrence_counts),
+                std::move(term_posting_counts)},
+            scorer_params,
+            block_size,
+            is_quantized,
+            std::forward<ForEachList>(for_each_list))
+    {}
+
+    /// Builds WAND data of a shard whose documents have lengths `doc_lens`, scored with the
+    /// collection-wide statistics `stats` instead of its own.
+    ///
+    /// The statistics are stored in place of those of the shard, so that block and list upper
+    /// bounds, as well as the scores of any scorer created from this WAND data, are comparable
+    /// across shards. In particular, `num_docs()` is the number of documents in the collection.
+    /// Lists are passed by `for_each_list` as above.
+    template <typename ForEachList>
+    wand_data(
+        std::vector<uint32_t> doc_lens,
+        global_statistics stats,
+        const ScorerParams& scorer_params,
+        BlockSize block_size,
+        bool is_quantized,
+        ForEachList&& for_each_list)
+        : m_num_docs(stats.num_docs), m_collection_len(stats.collection_len)
+    {
+        if (stats.term_occurrence_counts.size() != stats.term_posting_counts.size()) {
+            throw std::invalid_argument(fmt::format(
+                "Occurrence counts of {} terms but posting counts of {}",
+                stats.term_occurrence_counts.size(),
+                stats.term_posting_counts.size()));
+        }
+        m_avg_len = float(m_collection_len / double(m_num_docs));
+        auto num_docs = doc_lens.size();
+        auto term_count = stats.term_posting_counts.size();
+        m_doc_lens.steal(doc_lens);
+        m_term_occurrence_counts.steal(stats.term_occurrence_counts);
+        m_term_posting_counts.steal(stats.term_posting_counts);
+
+        global_parameters params;
+        typename block_wand_type::builder builder(num_docs, term_count, params);
+        auto scorer = scorer::from_params(scorer_params, *this);
+        std::vector<float> max_term_weight;
+        max_term_weight.reserve(term_count);
+        for_each_list([&](binary_freq_collection::sequence const& seq) {
+            auto v = builder.add_sequence(
+                seq, doc_lens, m_avg_len, scorer->term_scorer(max_term_weight.size()), block_size);
+            max_term_weight.push_back(v);
+            m_index_max_term_weight = std::max(m_index_max_term_weight, v);
+        });
+        if (max_term_weight.size() != term_count) {
+            throw std::invalid_argument(fmt::format(
+                "Received {} posting lists but statistics of {} terms",
+                max_term_weight.size(),
+                term_count));
+        }
+        if (is_quantized) {
+            LinearQuantizer quantizer(
+                m_index_max_term_weight, configuration::get().quantization_bits);
+            for (auto&& w: max_term_weight) {
+                w = quantizer(w);
+            }
+            builder.quantize_block_max_term_weights(m_index_max_term_weight);
+        }
+        builder.build(m_block_wand);
+        m_max_term_weight.steal(max_term_weight);
+    }
+
     float norm_len(uint64_t doc_id) const { return m_doc_lens[doc_id] / m_avg_len; }
 
     size_t doc_len(uint64_t doc_id) const { return m_doc_lens[doc_id]; }
@@ -131,6 +305,8 @@ class wand_data {
 
     size_t num_docs() const { return m_num_docs; }
 
+    size_t num_terms() const { return m_term_posting_counts.size(); }
+
     float avg_len() const { return m_avg_len; }
 
     uint64_t collection_len() const { return m_collection_len; }
@@ -216,4 +392,57 @@ inline void create_wand_data(
     }
 }
 
+template <typename Wand>
+void create_wand_data_from_statistics(
+    std::string const& output,
+    binary_freq_collection const& coll,
+    binary_collection const& sizes_coll,
+    global_statistics stats,
+    BlockSize block_size,
+    const ScorerParams& scorer_params,
+    bool quantize)
+{
+    auto lengths = *sizes_coll.begin();
+    Wand wdata(
+        std::vector<uint32_t>(lengths.begin(), lengths.end()),
+        std::move(stats),
+        scorer_params,
+        block_size,
+        quantize,
+        [&](auto&& fn) {
+            pisa::progress progress("Storing score upper bounds", coll.size());
+            for (auto const& seq: coll) {
+                fn(seq);
+                progress.update(1);
+            }
+        });
+    mapper::freeze(wdata, output.c_str());
+}
+
+/// Creates WAND data of a shard scored with the collection-wide statistics `stats`.
+inline void create_wand_data(
+    std::string const& output,
+    std::string const& input_basename,
+    BlockSize block_size,
+    const ScorerParams& scorer_params,
+    bool range,
+    bool compress,
+    bool quantize,
+    global_statistics stats)
+{
+    binary_collection sizes_coll((input_basename + ".sizes").c_str());
+    binary_freq_collection coll(input_basename.c_str());
+
+    if (compress) {
+        create_wand_data_from_statistics<wand_data<wand_data_compressed<>>>(
+            output, coll, sizes_coll, std::move(stats), block_size, scorer_params, quantize);
+    } else if (range) {
+        create_wand_data_from_statistics<wand_data<wand_data_range<128, 1024>>>(
+            output, coll, sizes_coll, std::move(stats), block_size, scorer_params, quantize);
+    } else {
+        create_wand_data_from_statistics<wand_data<wand_data_raw>>(
+            output, coll, sizes_coll, std::move(stats), block_size, scorer_params, quantize);
+    }
+}
+
 }  // namespace pisa
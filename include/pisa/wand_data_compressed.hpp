@@ -96,40 +96,54 @@ class wand_data_compressed {
   public:
     class builder {
       public:
-        builder(binary_freq_collection const& coll, global_parameters const& params)
+        builder(uint64_t num_docs, [[maybe_unused]] size_t num_lists, global_parameters const& params)
             : total_elements(0),
               total_blocks(0),
               params(params),
-              compressor_builder(coll.num_docs(), params)
+              compressor_builder(num_docs, params)
         {
             spdlog::info("Storing max weight for each list and for each block...");
         }
 
+        using blocks_type = std::pair<std::vector<uint32_t>, std::vector<float>>;
+
+        /// Computes the blocks of a single list; safe to call concurrently for different lists.
         template <typename Scorer>
-        float add_sequence(
-            binary_freq_collection::sequence const& seq,
-            binary_freq_collection const& coll,
-            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
-            float avg_len,
-            Scorer scorer,
-            BlockSize block_size)
+        auto compute_blocks(
+            binary_freq_collection::sequence const& seq, Scorer scorer, BlockSize block_size) const
+            -> blocks_type
         {
-            auto t = block_size.type() == typeid(FixedBlock)
+            return block_size.type() == typeid(FixedBlock)
                 ? static_block_partition(seq, scorer, boost::get<FixedBlock>(block_size).size)
                 : variable_block_partition(
-                    coll, seq, scorer, boost::get<VariableBlock>(block_size).lambda);
+                    seq, scorer, boost::get<VariableBlock>(block_size).lambda);
+        }
 
-            float max_score = *(std::max_element(t.second.begin(), t.second.end()));
+        /// Appends the blocks of the next list, of length `length`, and returns its max score.
+        float add_blocks(std::size_t length, blocks_type blocks)
+        {
+            float max_score = *(std::max_element(blocks.second.begin(), blocks.second.end()));
             max_term_weight.push_back(max_score);
-            total_elements += seq.docs.size();
-            total_blocks += t.first.size();
+            total_elements += length;
+            total_blocks += blocks.first.size();
 
-            block_max_documents.push_back(std::move(t.first));
-            unquantized_block_max_scores.push_back(std::move(t.second));
+            block_max_documents.push_back(std::move(blocks.first));
+            unquantized_block_max_scores.push_back(std::move(blocks.second));
 
             return max_term_weight.back();
         }
 
+        template <typename Scorer>
+        float add_sequence(
+            binary_freq_collection::sequence const& seq,
+            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
+            [[maybe_unused]] float avg_len,
+            Scorer scorer,
+            BlockSize block_size)
+        {
+            return add_blocks(seq.docs.size(), compute_blocks(seq, scorer, block_size));
+        }
+
         void quantize_block_max_term_weights([[maybe_unused]] float index_max_term_weight) {}
 
         void build(wand_data_compressed& wdata)
@@ -37,54 +37,78 @@ class wand_data_range {
 
     class builder {
       public:
-        builder(binary_freq_collection const& coll, [[maybe_unused]] global_parameters const& params)
-            : blocks_num(ceil_div(coll.num_docs(), range_size)),
+        builder(uint64_t num_docs, size_t num_lists, [[maybe_unused]] global_parameters const& params)
+            : blocks_num(ceil_div(num_docs, range_size)),
               total_elements(0),
               blocks_start{0},
               block_max_term_weight{}
         {
-            auto posting_lists = std::distance(coll.begin(), coll.end());
             spdlog::info("Storing max weight for each list and for each block...");
             spdlog::info(
                 "Range size: {}. Number of docs: {}."
                 "Blocks per posting list: {}. Posting lists: {}.",
                 range_size,
-                coll.num_docs(),
+                num_docs,
                 blocks_num,
-                posting_lists);
+                num_lists);
         }
 
+        /// Block upper bounds of a list; for lists too short to be stored, only the list's max score.
+        using blocks_type = std::vector<float>;
+
+        /// Computes the blocks of a single list; safe to call concurrently for different lists.
         template <typename Scorer>
-        float add_sequence(
+        auto compute_blocks(
             binary_freq_collection::sequence const& term_seq,
-            [[maybe_unused]] binary_freq_collection const& coll,
-            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
-            float avg_len,
             Scorer scorer,
-            [[maybe_unused]] BlockSize block_size)
+            [[maybe_unused]] BlockSize block_size) const -> blocks_type
         {
-            float max_score = 0.0F;
-
+            if (term_seq.docs.size() < min_list_lenght) {
+                float max_score = 0.0F;
+                for (auto i = 0; i < term_seq.docs.size(); ++i) {
+                    uint64_t docid = *(term_seq.docs.begin() + i);
+                    uint64_t freq = *(term_seq.freqs.begin() + i);
+                    max_score = std::max(max_score, scorer(docid, freq));
+                }
+                return {max_score};
+            }
             std::vector<float> b_max(blocks_num, 0.0F);
             for (auto i = 0; i < term_seq.docs.size(); ++i) {
                 uint64_t docid = *(term_seq.docs.begin() + i);
                 uint64_t freq = *(term_seq.freqs.begin() + i);
                 float score = scorer(docid, freq);
-                max_score = std::max(max_score, score);
                 size_t pos = docid / range_size;
                 float& bm = b_max[pos];
                 bm = std::max(bm, score);
             }
-            if (term_seq.docs.size() >= min_list_lenght) {
-                block_max_term_weight.insert(block_max_term_weight.end(), b_max.begin(), b_max.end());
-                blocks_start.push_back(b_max.size() + blocks_start.back());
-                total_elements += term_seq.docs.size();
+            return b_max;
+        }
+
+        /// Appends the blocks of the next list, of length `length`, and returns its max score.
+        float add_blocks(std::size_t length, blocks_type blocks)
+        {
+            float max_score = *std::max_element(blocks.begin(), blocks.end());
+            if (length >= min_list_lenght) {
+                block_max_term_weight.insert(block_max_term_weight.end(), blocks.begin(), blocks.end());
+                blocks_start.push_back(blocks.size() + blocks_start.back());
+                total_elements += length;
             } else {
                 blocks_start.push_back(blocks_start.back());
             }
             return max_score;
         }
 
+        template <typename Scorer>
+        float add_sequence(
+            binary_freq_collection::sequence const& term_seq,
+            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
+            [[maybe_unused]] float avg_len,
+            Scorer scorer,
+            BlockSize block_size)
+        {
+            return add_blocks(term_seq.docs.size(), compute_blocks(term_seq, scorer, block_size));
+        }
+
         void quantize_block_max_term_weights(float index_max_term_weight)
         {
             LinearQuantizer quantizer(index_max_term_weight, configuration::get().quantization_bits);
@@ -19,10 +19,11 @@ class wand_data_raw {
 
     class builder {
       public:
-        builder(binary_freq_collection const& coll, global_parameters const& params)
+        builder(
+            [[maybe_unused]] uint64_t num_docs,
+            [[maybe_unused]] size_t num_lists,
+            [[maybe_unused]] global_parameters const& params)
         {
-            (void)coll;
-            (void)params;
             spdlog::info("Storing max weight for each list and for each block...");
             total_elements = 0;
             total_blocks = 0;
@@ -30,32 +31,46 @@ class wand_data_raw {
             blocks_start.push_back(0);
         }
 
+        using blocks_type = std::pair<std::vector<uint32_t>, std::vector<float>>;
+
+        /// Computes the blocks of a single list; safe to call concurrently for different lists.
         template <typename Scorer>
-        float add_sequence(
-            binary_freq_collection::sequence const& seq,
-            binary_freq_collection const& coll,
-            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
-            float avg_len,
-            Scorer scorer,
-            BlockSize block_size)
+        auto compute_blocks(
+            binary_freq_collection::sequence const& seq, Scorer scorer, BlockSize block_size) const
+            -> blocks_type
         {
-            auto t = block_size.type() == typeid(FixedBlock)
+            return block_size.type() == typeid(FixedBlock)
                 ? static_block_partition(seq, scorer, boost::get<FixedBlock>(block_size).size)
                 : variable_block_partition(
-                    coll, seq, scorer, boost::get<VariableBlock>(block_size).lambda);
-
-            block_max_term_weight.insert(
-                block_max_term_weight.end(), t.second.begin(), t.second.end());
-            block_docid.insert(block_docid.end(), t.first.begin(), t.first.end());
-            max_term_weight.push_back(*(std::max_element(t.second.begin(), t.second.end())));
-            blocks_start.push_back(t.first.size() + blocks_start.back());
+                    seq, scorer, boost::get<VariableBlock>(block_size).lambda);
+        }
 
-            total_elements += seq.docs.size();
-            total_blocks += t.first.size();
+        /// Appends the blocks of the next list, of length `length`, and returns its max score.
+        float add_blocks(std::size_t length, blocks_type blocks)
+        {
+            auto const& [docids, scores] = blocks;
+            block_max_term_weight.insert(block_max_term_weight.end(), scores.begin(), scores.end());
+            block_docid.insert(block_docid.end(), docids.begin(), docids.end());
+            max_term_weight.push_back(*(std::max_element(scores.begin(), scores.end())));
+            blocks_start.push_back(docids.size() + blocks_start.back());
+
+            total_elements += length;
+            total_blocks += docids.size();
             effective_list++;
             return max_term_weight.back();
         }
 
+        template <typename Scorer>
+        float add_sequence(
+            binary_freq_collection::sequence const& seq,
+            [[maybe_unused]] std::vector<uint32_t> const& doc_lens,
+            [[maybe_unused]] float avg_len,
+            Scorer scorer,
+            BlockSize block_size)
+        {
+            return add_blocks(seq.docs.size(), compute_blocks(seq, scorer, block_size));
+        }
+
         void quantize_block_max_term_weights(float index_max_term_weight)
         {
             LinearQuantizer quantizer(index_max_term_weight, configuration::get().quantization_bits);
@@ -3,6 +3,8 @@
 
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #include "compress.hpp"
 #include "configuration.hpp"
@@ -16,6 +18,9 @@
 
 namespace pisa {
 
+/// Number of posting lists encoded concurrently before being added to the index.
+constexpr std::size_t compress_batch_size = 4096;
+
 template <typename Collection>
 void dump_index_specific_stats(Collection const&, std::string const&)
 {}
@@ -110,10 +115,9 @@ void compress_index_streaming(
     }
 }
 
-// TODO(michal): Group parameters under a common `optional` so that, say, it is impossible to get
-// `quantized == true` and at the same time `wand_data_filename == std::nullopt`.
+/// Builds an index in memory, as required by indexes that are not block-based.
 template <typename CollectionType, typename WandType>
-void compress_index(
+void compress_index_in_memory(
     binary_freq_collection const& input,
     pisa::global_parameters const& params,
     const std::optional<std::string>& output_filename,
@@ -123,30 +127,6 @@ void compress_index(
     ScorerParams const& scorer_params,
     bool quantized)
 {
-    if constexpr (std::is_same_v<typename CollectionType::index_layout_tag, BlockIndexTag>) {
-        std::optional<QuantizedScorer<WandType>> quantized_scorer{};
-        WandType wdata;
-        mio::mmap_source wdata_source;
-        if (quantized) {
-            ensure(wand_data_filename.has_value())
-                .or_panic("Bug: Asked for quantized but no wand data");
-            std::error_code error;
-            wdata_source.map(*wand_data_filename, error);
-            if (error) {
-                spdlog::error("error mapping file: {}, exiting...", error.message());
-                std::abort();
-            }
-            mapper::map(wdata, wdata_source, mapper::map_flags::warmup);
-            auto scorer = scorer::from_params(scorer_params, wdata);
-            LinearQuantizer quantizer(
-                wdata.index_max_term_weight(), configuration::get().quantization_bits);
-            quantized_scorer = QuantizedScorer(std::move(scorer), quantizer);
-        }
-        compress_index_streaming<CollectionType, WandType>(
-            input, params, *output_filename, std::move(quantized_scorer), check);
-        return;
-    }
-
     spdlog::info("Processing {} documents", input.num_docs());
     double tick = get_time_usecs();
 
@@ -167,34 +147,55 @@ void compress_index(
             scorer = scorer::from_params(scorer_params, wdata);
         }
 
-        size_t term_id = 0;
-        for (auto const& plist: input) {
-            size_t size = plist.docs.size();
-            if (quantized) {
-                LinearQuantizer quantizer(
-                    wdata.index_max_term_weight(), configuration::get().quantization_bits);
-                auto term_scorer = scorer->term_scorer(term_id);
-                std::vector<uint64_t> quants;
-                for (size_t pos = 0; pos < size; ++pos) {
-                    uint64_t doc = *(plist.docs.begin() + pos);
-                    uint64_t freq = *(plist.freqs.begin() + pos);
-                    float score = term_scorer(doc, freq);
-                    uint64_t quant_score = quantizer(score);
-                    quants.push_back(quant_score);
-                }
-                assert(quants.size() == size);
-                uint64_t quants_sum =
-                    std::accumulate(quants.begin(), quants.begin() + quants.size(), uint64_t(0));
-                builder.add_posting_list(size, plist.docs.begin(), quants.begin(), quants_sum);
-            } else {
-                uint64_t freqs_sum =
-                    std::accumulate(plist.freqs.begin(), plist.freqs.begin() + size, uint64_t(0));
-                builder.add_posting_list(size, plist.docs.begin(), plist.freqs.begin(), freqs_sum);
+        // Lists are encoded in parallel in batches and added in term order. Partitions of long
+        // lists are also optimized in parallel, see `partitioned_sequence`.
+        std::vector<binary_freq_collection::sequence> lists(input.begin(), input.end());
+        for (size_t first = 0; first < lists.size(); first += compress_batch_size) {
+            size_t last = std::min(first + compress_batch_size, lists.size());
+            std::vector<typename CollectionType::builder::encoded_posting_list> encoded(
+                last - first);
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(first, last, 1),
+                [&](tbb::blocked_range<size_t> const& range) {
+                    for (auto term_id = range.begin(); term_id != range.end(); ++term_id) {
+                        auto const& plist = lists[term_id];
+                        size_t size = plist.docs.size();
+                        auto& encoded_list = encoded[term_id - first];
+                        if (quantized) {
+                            LinearQuantizer quantizer(
+                                wdata.index_max_term_weight(),
+                                configuration::get().quantization_bits);
+                            auto term_scorer = scorer->term_scorer(term_id);
+                            std::vector<uint64_t> quants;
+                            for (size_t pos = 0; pos < size; ++pos) {
+                                uint64_t doc = *(plist.docs.begin() + pos);
+                                uint64_t freq = *(plist.freqs.begin() + pos);
+                                float score = term_scorer(doc, freq);
+                                uint64_t quant_score = quantizer(score);
+                                quants.push_back(quant_score);
+                            }
+                            assert(quants.size() == size);
+                            uint64_t quants_sum = std::accumulate(
+                                quants.begin(), quants.begin() + quants.size(), uint64_t(0));
+                            builder.encode_posting_list(
+                                size, plist.docs.begin(), quants.begin(), quants_sum, encoded_list);
+                        } else {
+                            uint64_t freqs_sum = std::accumulate(
+                                plist.freqs.begin(), plist.freqs.begin() + size, uint64_t(0));
+                            builder.encode_posting_list(
+                                size,
+                                plist.docs.begin(),
+                                plist.freqs.begin(),
+                                freqs_sum,
+                                encoded_list);
+                        }
+                    }
+                });
+            for (size_t term_id = first; term_id < last; ++term_id) {
+                builder.add_encoded_posting_list(encoded[term_id - first]);
+                postings += lists[term_id].docs.size();
             }
-
-            progress.update(1);
-            postings += size;
-            term_id += 1;
+            progress.update(last - first);
         }
     }
 
@@ -221,6 +222,53 @@ void compress_index(
     }
 }
 
+// TODO(michal): Group parameters under a common `optional` so that, say, it is impossible to get
+// `quantized == true` and at the same time `wand_data_filename == std::nullopt`.
+template <typename CollectionType, typename WandType>
+void compress_index(
+    binary_freq_collection const& input,
+    pisa::global_parameters const& params,
+    const std::optional<std::string>& output_filename,
+    bool check,
+    std::string const& seq_type,
+    std::optional<std::string> const& wand_data_filename,
+    ScorerParams const& scorer_params,
+    bool quantized)
+{
+    if constexpr (std::is_same_v<typename CollectionType::index_layout_tag, BlockIndexTag>) {
+        std::optional<QuantizedScorer<WandType>> quantized_scorer{};
+        WandType wdata;
+        mio::mmap_source wdata_source;
+        if (quantized) {
+            ensure(wand_data_filename.has_value())
+                .or_panic("Bug: Asked for quantized but no wand data");
+            std::error_code error;
+            wdata_source.map(*wand_data_filename, error);
+            if (error) {
+                spdlog::error("error mapping file: {}, exiting...", error.message());
+                std::abort();
+            }
+            mapper::map(wdata, wdata_source, mapper::map_flags::warmup);
+            auto scorer = scorer::from_params(scorer_params, wdata);
+            LinearQuantizer quantizer(
+                wdata.index_max_term_weight(), configuration::get().quantization_bits);
+            quantized_scorer = QuantizedScorer(std::move(scorer), quantizer);
+        }
+        compress_index_streaming<CollectionType, WandType>(
+            input, params, *output_filename, std::move(quantized_scorer), check);
+    } else {
+        compress_index_in_memory<CollectionType, WandType>(
+            input,
+            params,
+            output_filename,
+            check,
+            seq_type,
+            wand_data_filename,
+            scorer_params,
+            quantized);
+    }
+}
+
 void compress(
     std::string const& input_basename,
     std::optional<std::string> const& wand_data_filename,
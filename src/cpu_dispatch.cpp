@@ -0,0 +1,74 @@
+#include "cpu_dispatch.hpp"
+
+#include <cstdlib>
+
+#include <spdlog/spdlog.h>
+
+namespace pisa {
+
+namespace {
+
+    [[nodiscard]] auto select_simd_level() -> SimdLevel
+    {
+        auto detected = detected_simd_level();
+        if (char const* requested = std::getenv("PISA_SIMD_LEVEL"); requested != nullptr) {
+            if (auto level = parse_simd_level(requested); level) {
+                if (*level > detected) {
+                    spdlog::warn(
+                        "SIMD level {} not supported by this CPU; using {}",
+                        requested,
+                        to_string(detected));
+                    return detected;
+                }
+                return *level;
+            }
+            spdlog::warn("Unknown SIMD level {}; using {}", requested, to_string(detected));
+        }
+        return detected;
+    }
+
+    /// Selects the level when the library is loaded rather than on the first kernel call.
+    [[maybe_unused]] SimdLevel const startup_simd_level = simd_level();
+
+}  // namespace
+
+auto to_string(SimdLevel level) -> std::string_view
+{
+    switch (level) {
+    case SimdLevel::Baseline: return "baseline";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+auto parse_simd_level(std::string_view name) -> std::optional<SimdLevel>
+{
+    for (auto level: {SimdLevel::Baseline, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (name == to_string(level)) {
+            return level;
+        }
+    }
+    return std::nullopt;
+}
+
+auto detected_simd_level() -> SimdLevel
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl")) {
+        return SimdLevel::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::Avx2;
+    }
+    return SimdLevel::Baseline;
+}
+
+auto simd_level() -> SimdLevel
+{
+    static SimdLevel const level = select_simd_level();
+    return level;
+}
+
+}  // namespace pisa
@@ -3,13 +3,16 @@
 #include <map>
 #include <sstream>
 
+#include <fmt/format.h>
 #include <range/v3/view/iota.hpp>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 #include <tbb/concurrent_queue.h>
+#include <tbb/pipeline.h>
 #include <tbb/task_group.h>
 
 #include "binary_collection.hpp"
+#include "parser.hpp"
 
 namespace pisa {
 
@@ -42,7 +45,10 @@ void Forward_Index_Builder::run(
     std::ofstream term_os(basename + ".terms");
     write_header(os, bp.records.size());
 
-    std::map<std::string, uint32_t> map;
+    std::map<std::string, uint32_t, std::less<>> map;
+    // Tokens are copied into this buffer, which transformers usually hand back after modifying
+    // it in place, so that most tokens are processed without allocating.
+    std::string term;
 
     for (auto&& record: bp.records) {
         title_os << record.title() << '\n';
@@ -50,7 +56,8 @@ void Forward_Index_Builder::run(
 
         std::vector<uint32_t> term_ids;
 
-        auto process = [&](auto&& term) {
+        auto process = [&](std::string_view token) {
+            term.assign(token.begin(), token.end());
             term = process_term(std::move(term));
             uint32_t id = 0;
             if (auto pos = map.find(term); pos != map.end()) {
@@ -277,6 +284,66 @@ void Forward_Index_Builder::build(
     remove_batches(output_file, batch_number);
 }
 
+void Forward_Index_Builder::build_chunked(
+    std::istream& is,
+    std::string const& output_file,
+    std::string const& format,
+    std::size_t chunk_size,
+    TermTransformerBuilder term_transformer_builder,
+    process_content_function_type process_content,
+    std::size_t threads) const
+{
+    auto boundary = record_boundary(format);
+    if (not boundary) {
+        throw std::invalid_argument(
+            fmt::format("Format {} does not support parallel record parsing", format));
+    }
+    Record_Chunk_Reader reader(is, *boundary, chunk_size);
+    Document_Id first_document{0};
+    std::ptrdiff_t batch_number = 0;
+
+    auto read_chunk = [&](tbb::flow_control& fc) -> std::string {
+        auto chunk = reader.next();
+        if (not chunk) {
+            fc.stop();
+            return {};
+        }
+        spdlog::debug("Read chunk of {} bytes", chunk->size());
+        return std::move(*chunk);
+    };
+    auto parse_chunk = [&](std::string chunk) -> std::vector<Document_Record> {
+        std::istringstream chunk_stream(std::move(chunk));
+        auto next_record = record_parser(format, chunk_stream);
+        std::vector<Document_Record> records;
+        std::optional<Document_Record> record = std::nullopt;
+        while ((record = next_record(chunk_stream))) {
+            records.push_back(std::move(*record));
+        }
+        return records;
+    };
+    auto assign_ids = [&](std::vector<Document_Record> records) -> Batch_Process {
+        Batch_Process bp{batch_number, std::move(records), first_document, output_file};
+        ++batch_number;
+        first_document += bp.records.size();
+        return bp;
+    };
+    auto process_batch = [&](Batch_Process bp) {
+        run(std::move(bp), term_transformer_builder(), process_content);
+    };
+
+    tbb::parallel_pipeline(
+        std::max<std::size_t>(threads, 1) * 2,
+        tbb::make_filter<void, std::string>(tbb::filter::serial_in_order, read_chunk)
+            & tbb::make_filter<std::string, std::vector<Document_Record>>(
+                tbb::filter::parallel, parse_chunk)
+            & tbb::make_filter<std::vector<Document_Record>, Batch_Process>(
+                tbb::filter::serial_in_order, assign_ids)
+            & tbb::make_filter<Batch_Process, void>(tbb::filter::parallel, process_batch));
+
+    merge(output_file, first_document.as_int(), batch_number);
+    remove_batches(output_file, batch_number);
+}
+
 void try_remove(boost::filesystem::path const& file)
 {
     using boost::filesystem::remove;
@@ -0,0 +1,88 @@
+#include "global_statistics.hpp"
+
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "binary_collection.hpp"
+#include "binary_freq_collection.hpp"
+#include "io.hpp"
+
+namespace pisa {
+
+auto shard_global_statistics(
+    gsl::span<std::string const> collections, gsl::span<std::string const> term_lists)
+    -> VecMap<Shard_Id, global_statistics>
+{
+    if (collections.size() != term_lists.size()) {
+        throw std::invalid_argument(fmt::format(
+            "Number of collections ({}) does not match number of term lists ({})",
+            collections.size(),
+            term_lists.size()));
+    }
+
+    std::uint64_t num_docs = 0;
+    std::uint64_t collection_len = 0;
+    std::unordered_map<std::string, std::uint32_t> global_term_ids;
+    std::vector<std::uint32_t> term_occurrence_counts;
+    std::vector<std::uint32_t> term_posting_counts;
+    VecMap<Shard_Id, std::vector<std::uint32_t>> shard_terms;
+
+    for (std::size_t shard = 0; shard < collections.size(); ++shard) {
+        spdlog::info("Gathering statistics of {}", collections[shard]);
+        binary_freq_collection collection(collections[shard].c_str());
+        binary_collection sizes(fmt::format("{}.sizes", collections[shard]).c_str());
+        auto lengths = *sizes.begin();
+        num_docs += collection.num_docs();
+        collection_len += std::accumulate(lengths.begin(), lengths.end(), std::uint64_t(0));
+
+        auto terms = io::read_string_vector(term_lists[shard]);
+        auto& global_terms = shard_terms.emplace_back();
+        global_terms.reserve(terms.size());
+        for (auto const& seq: collection) {
+            if (global_terms.size() == terms.size()) {
+                throw std::invalid_argument(fmt::format(
+                    "Collection {} has more posting lists than terms in {}",
+                    collections[shard],
+                    term_lists[shard]));
+            }
+            auto [pos, inserted] = global_term_ids.emplace(
+                terms[global_terms.size()], term_posting_counts.size());
+            if (inserted) {
+                term_occurrence_counts.push_back(0);
+                term_posting_counts.push_back(0);
+            }
+            term_occurrence_counts[pos->second] +=
+                std::accumulate(seq.freqs.begin(), seq.freqs.end(), std::uint32_t(0));
+            term_posting_counts[pos->second] += seq.docs.size();
+            global_terms.push_back(pos->second);
+        }
+        if (global_terms.size() != terms.size()) {
+            throw std::invalid_argument(fmt::format(
+                "Collection {} has {} posting lists but {} has {} terms",
+                collections[shard],
+                global_terms.size(),
+                term_lists[shard],
+                terms.size()));
+        }
+    }
+
+    VecMap<Shard_Id, global_statistics> stats;
+    for (auto const& global_terms: shard_terms) {
+        auto& shard_stats = stats.emplace_back();
+        shard_stats.num_docs = num_docs;
+        shard_stats.collection_len = collection_len;
+        shard_stats.term_occurrence_counts.reserve(global_terms.size());
+        shard_stats.term_posting_counts.reserve(global_terms.size());
+        for (auto term: global_terms) {
+            shard_stats.term_occurrence_counts.push_back(term_occurrence_counts[term]);
+            shard_stats.term_posting_counts.push_back(term_posting_counts[term]);
+        }
+    }
+    return stats;
+}
+
+}  // namespace pisa
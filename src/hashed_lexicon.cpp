@@ -0,0 +1,161 @@
+#include "hashed_lexicon.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace pisa {
+
+namespace {
+
+    constexpr std::uint64_t MAX_SEED_ATTEMPTS = 16;
+    constexpr std::uint32_t MAX_PILOT = 1U << 20U;
+
+    /// Finds pilots for all buckets, filling `ids`, or returns `std::nullopt` if two terms
+    /// have the same hash, or if no pilot below `MAX_PILOT` places a bucket, in which case
+    /// another seed must be used.
+    [[nodiscard]] auto find_pilots(
+        gsl::span<std::string const> terms, std::uint64_t seed, std::vector<std::uint32_t>& ids)
+        -> std::optional<std::vector<std::uint32_t>>
+    {
+        auto term_count = terms.size();
+        auto slot_count = Hashed_Lexicon::slot_count(term_count);
+        auto bucket_count = std::max<std::size_t>(
+            1, (term_count + Hashed_Lexicon::BUCKET_SIZE - 1) / Hashed_Lexicon::BUCKET_SIZE);
+
+        std::vector<std::uint64_t> hashes(term_count);
+        std::transform(terms.begin(), terms.end(), hashes.begin(), [seed](auto const& term) {
+            return hash::murmur64(term, seed);
+        });
+
+        // Terms sorted by bucket, with buckets in decreasing order of size.
+        std::vector<std::size_t> bucket_sizes(bucket_count, 0);
+        for (auto hash: hashes) {
+            bucket_sizes[Hashed_Lexicon::bucket(hash, bucket_count)] += 1;
+        }
+        std::vector<std::uint32_t> order(term_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+            auto lhs_bucket = Hashed_Lexicon::bucket(hashes[lhs], bucket_count);
+            auto rhs_bucket = Hashed_Lexicon::bucket(hashes[rhs], bucket_count);
+            if (bucket_sizes[lhs_bucket] != bucket_sizes[rhs_bucket]) {
+                return bucket_sizes[lhs_bucket] > bucket_sizes[rhs_bucket];
+            }
+            return lhs_bucket < rhs_bucket || (lhs_bucket == rhs_bucket && hashes[lhs] < hashes[rhs]);
+        });
+
+        std::vector<std::uint32_t> pilots(bucket_count, 0);
+        std::vector<bool> taken(slot_count, false);
+        ids.assign(slot_count, 0);
+        std::vector<std::size_t> slots;
+        auto first = order.begin();
+        while (first != order.end()) {
+            auto bucket = Hashed_Lexicon::bucket(hashes[*first], bucket_count);
+            auto last = std::next(first, bucket_sizes[bucket]);
+            for (auto it = std::next(first); it != last; ++it) {
+                if (hashes[*it] == hashes[*std::prev(it)]) {
+                    if (terms[*it] == terms[*std::prev(it)]) {
+                        throw std::invalid_argument(
+                            fmt::format("Duplicate term in lexicon: {}", terms[*it]));
+                    }
+                    return std::nullopt;
+                }
+            }
+            bool placed = false;
+            for (std::uint32_t pilot = 0; pilot < MAX_PILOT && not placed; ++pilot) {
+                slots.clear();
+                bool fits = std::all_of(first, last, [&](auto term) {
+                    auto slot = Hashed_Lexicon::slot(hashes[term], pilot, slot_count);
+                    if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        return false;
+                    }
+                    slots.push_back(slot);
+                    return true;
+                });
+                if (fits) {
+                    pilots[bucket] = pilot;
+                    for (auto it = first; it != last; ++it) {
+                        auto slot = slots[std::distance(first, it)];
+                        taken[slot] = true;
+                        ids[slot] = *it;
+                    }
+                    placed = true;
+                }
+            }
+            if (not placed) {
+                return std::nullopt;
+            }
+            first = last;
+        }
+        return pilots;
+    }
+
+    template <typename T>
+    void write_span(std::ostream& os, gsl::span<T const> values)
+    {
+        os.write(reinterpret_cast<char const*>(values.data()), values.size() * sizeof(T));
+    }
+
+}  // namespace
+
+auto Hashed_Lexicon::is_hashed_lexicon(gsl::span<std::byte const> mem) -> bool
+{
+    if (sizeof(MAGIC) > mem.size()) {
+        return false;
+    }
+    return std::get<0>(unpack_head<std::uint64_t>(mem)) == MAGIC;
+}
+
+auto Hashed_Lexicon::from(gsl::span<std::byte const> mem) -> Hashed_Lexicon
+{
+    auto [magic, seed, bucket_count, term_count, slot_count, tail] =
+        unpack_head<std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t>(
+            mem);
+    if (magic != MAGIC) {
+        throw std::runtime_error("Not a hashed lexicon: invalid magic number");
+    }
+    auto [pilots, after_pilots] = split(tail, bucket_count * sizeof(std::uint32_t));
+    auto [ids, after_ids] = split(after_pilots, slot_count * sizeof(std::uint32_t));
+    auto padding = (8 - (bucket_count + slot_count) * sizeof(std::uint32_t) % 8) % 8;
+    auto terms = Payload_Vector<>::from(std::get<1>(split(after_ids, padding)));
+    if (terms.size() != term_count) {
+        throw std::runtime_error(fmt::format(
+            "Hashed lexicon of {} terms contains a payload vector of {} terms",
+            term_count,
+            terms.size()));
+    }
+    return Hashed_Lexicon(
+        seed, cast_span<std::uint32_t>(pilots), cast_span<std::uint32_t>(ids), terms);
+}
+
+void write_hashed_lexicon(gsl::span<std::string const> terms, std::ostream& os)
+{
+    std::vector<std::uint32_t> ids;
+    for (std::uint64_t seed = 0; seed < MAX_SEED_ATTEMPTS; ++seed) {
+        if (auto pilots = find_pilots(terms, seed, ids); pilots) {
+            std::uint64_t bucket_count = pilots->size();
+            std::uint64_t term_count = terms.size();
+            std::uint64_t slot_count = ids.size();
+            os.write(reinterpret_cast<char const*>(&Hashed_Lexicon::MAGIC), sizeof(std::uint64_t));
+            os.write(reinterpret_cast<char const*>(&seed), sizeof(seed));
+            os.write(reinterpret_cast<char const*>(&bucket_count), sizeof(bucket_count));
+            os.write(reinterpret_cast<char const*>(&term_count), sizeof(term_count));
+            os.write(reinterpret_cast<char const*>(&slot_count), sizeof(slot_count));
+            write_span(os, gsl::span<std::uint32_t const>(*pilots));
+            write_span(os, gsl::span<std::uint32_t const>(ids));
+            auto padding = (8 - (bucket_count + slot_count) * sizeof(std::uint32_t) % 8) % 8;
+            std::fill_n(std::ostreambuf_iterator<char>(os), padding, '\0');
+            encode_payload_vector(terms).to_stream(os);
+            return;
+        }
+        spdlog::debug("Cannot place all terms with seed {}; trying another seed", seed);
+    }
+    throw std::runtime_error("Unable to build a hashed lexicon: no seed places all terms");
+}
+
+}  // namespace pisa
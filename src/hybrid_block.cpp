@@ -0,0 +1,84 @@
+#include "codec/hybrid_block.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "configuration.hpp"
+
+namespace pisa {
+
+auto to_string(hybrid_codec codec) -> std::string_view
+{
+    switch (codec) {
+    case hybrid_codec::simdbp: return "simdbp";
+    case hybrid_codec::optpfor: return "optpfor";
+    case hybrid_codec::streamvbyte: return "streamvbyte";
+    case hybrid_codec::varintgb: return "varintgb";
+    }
+    return "unknown";
+}
+
+auto parse_hybrid_codec(std::string_view name) -> std::optional<hybrid_codec>
+{
+    for (auto codec: hybrid_codecs) {
+        if (name == to_string(codec)) {
+            return codec;
+        }
+    }
+    return std::nullopt;
+}
+
+auto hybrid_selector::get() -> hybrid_selector const&
+{
+    static hybrid_selector const selector = [] {
+        auto const& config = configuration::get();
+        predictors_type predictors{};
+        if (not config.hybrid_predictors.empty()) {
+            std::ifstream is(config.hybrid_predictors);
+            if (not is) {
+                throw std::invalid_argument(
+                    fmt::format("Cannot read predictors from {}", config.hybrid_predictors));
+            }
+            predictors = read_hybrid_predictors(is);
+        } else if (config.hybrid_lambda > 0) {
+            spdlog::warn("PISA_HYBRID_LAMBDA has no effect without PISA_HYBRID_PREDICTORS");
+        }
+        return hybrid_selector(config.hybrid_lambda, predictors);
+    }();
+    return selector;
+}
+
+auto read_hybrid_predictors(std::istream& is) -> hybrid_selector::predictors_type
+{
+    hybrid_selector::predictors_type predictors{};
+    std::string line;
+    while (std::getline(is, line)) {
+        std::istringstream iss(line);
+        std::string name;
+        if (not(iss >> name)) {
+            continue;
+        }
+        auto codec = parse_hybrid_codec(name);
+        if (not codec) {
+            throw std::invalid_argument(fmt::format("Unknown hybrid codec: {}", name));
+        }
+        std::vector<std::string> tokens{
+            std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>()};
+        if (tokens.size() % 2 != 0) {
+            throw std::invalid_argument(fmt::format("Invalid predictor of {}: {}", name, line));
+        }
+        std::vector<std::pair<std::string, float>> weights;
+        for (std::size_t pos = 0; pos < tokens.size(); pos += 2) {
+            weights.emplace_back(tokens[pos], std::stof(tokens[pos + 1]));
+        }
+        predictors[static_cast<std::size_t>(*codec)] = time_prediction::predictor(weights);
+    }
+    return predictors;
+}
+
+}  // namespace pisa
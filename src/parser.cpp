@@ -9,6 +9,8 @@
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <memory>
 
@@ -151,10 +153,160 @@ record_parser(std::string const& type, std::istream& is)
     std::abort();
 }
 
-void parse_plaintext_content(std::string&& content, std::function<void(std::string&&)> process)
+/// Finds the end of the line containing the first occurrence of `terminator` that ends the line
+/// at or after `min_size`.
+[[nodiscard]] auto line_boundary(std::string terminator) -> Record_Boundary
 {
-    TermTokenizer tokenizer(content);
-    std::for_each(tokenizer.begin(), tokenizer.end(), process);
+    return [terminator = std::move(terminator)](
+               std::string_view buffer, std::size_t min_size) -> std::optional<std::size_t> {
+        auto from = min_size - std::min(min_size, terminator.size());
+        auto pos = buffer.find(terminator, from);
+        if (pos == std::string_view::npos) {
+            return std::nullopt;
+        }
+        auto line_end = buffer.find('\n', pos + terminator.size() - 1);
+        if (line_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        return line_end + 1;
+    };
+}
+
+/// Walks WARC records from the beginning of `buffer`, skipping from each header to the end of
+/// its content as given by `Content-Length`.
+[[nodiscard]] auto warc_boundary(std::string_view buffer, std::size_t min_size)
+    -> std::optional<std::size_t>
+{
+    constexpr auto content_length_field = "content-length:"sv;
+    auto starts_with_field = [&](std::string_view line) {
+        auto lower = [](char c) { return std::tolower(static_cast<unsigned char>(c)); };
+        return line.size() >= content_length_field.size()
+            && std::equal(
+                   content_length_field.begin(),
+                   content_length_field.end(),
+                   line.begin(),
+                   [&](char expected, char actual) { return expected == lower(actual); });
+    };
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    auto parse_length = [&](std::string_view value) -> std::optional<std::size_t> {
+        while (not value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        if (value.empty() || not is_digit(value.front())) {
+            return std::nullopt;
+        }
+        std::size_t length = 0;
+        for (; not value.empty() && is_digit(value.front()); value.remove_prefix(1)) {
+            length = length * 10 + (value.front() - '0');
+        }
+        return length;
+    };
+
+    std::size_t pos = 0;
+    while (pos < min_size) {
+        bool in_header = false;
+        std::optional<std::size_t> content_length{};
+        while (true) {
+            auto line_end = buffer.find('\n', pos);
+            if (line_end == std::string_view::npos) {
+                return std::nullopt;
+            }
+            auto line = buffer.substr(pos, line_end - pos);
+            if (not line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            pos = line_end + 1;
+            if (not in_header) {
+                // Blank lines between records are skipped, and so is any text before the first
+                // version line, as the record parser does.
+                in_header = line.substr(0, 5) == "WARC/";
+                continue;
+            }
+            if (line.empty()) {
+                break;
+            }
+            if (starts_with_field(line)) {
+                content_length = parse_length(line.substr(content_length_field.size()));
+            }
+        }
+        // A header without a valid length is malformed; resume at the next version line.
+        if (content_length) {
+            pos += *content_length;
+        }
+    }
+    if (pos > buffer.size()) {
+        return std::nullopt;
+    }
+    return pos;
+}
+
+auto record_boundary(std::string const& type) -> std::optional<Record_Boundary>
+{
+    if (type == "plaintext") {
+        return line_boundary("\n");
+    }
+    if (type == "trectext" or type == "trecweb") {
+        return line_boundary("\n</DOC>");
+    }
+    if (type == "warc") {
+        return Record_Boundary(warc_boundary);
+    }
+    return std::nullopt;
+}
+
+Record_Chunk_Reader::Record_Chunk_Reader(
+    std::istream& is, Record_Boundary boundary, std::size_t chunk_size)
+    : m_is(is), m_boundary(std::move(boundary)), m_chunk_size(std::max<std::size_t>(chunk_size, 1))
+{}
+
+auto Record_Chunk_Reader::next() -> std::optional<std::string>
+{
+    constexpr std::size_t read_block_size = 1U << 20U;
+    std::string chunk = std::move(m_carry);
+    m_carry.clear();
+    auto read = [&](std::size_t count) {
+        auto size = chunk.size();
+        chunk.resize(size + count);
+        m_is.read(&chunk[size], count);
+        chunk.resize(size + m_is.gcount());
+    };
+    if (chunk.size() < m_chunk_size) {
+        read(m_chunk_size - chunk.size());
+    }
+    while (true) {
+        if (auto end = m_boundary(chunk, m_chunk_size); end) {
+            m_carry = chunk.substr(*end);
+            chunk.resize(*end);
+            return chunk;
+        }
+        if (not m_is) {
+            break;
+        }
+        read(read_block_size);
+    }
+    if (chunk.empty()) {
+        return std::nullopt;
+    }
+    return chunk;
+}
+
+/// Tokenizes text with the vectorized ASCII tokenizer, falling back to `TermTokenizer`
+/// if the text contains non-ASCII bytes.
+void tokenize(std::string_view text, std::function<void(std::string_view)> const& process)
+{
+    thread_local AsciiTermTokenizer ascii_tokenizer;
+    if (ascii_tokenizer.tokenize(text, process)) {
+        return;
+    }
+    TermTokenizer tokenizer(text);
+    std::for_each(tokenizer.begin(), tokenizer.end(), [&](std::string const& term) {
+        process(term);
+    });
+}
+
+void parse_plaintext_content(std::string&& content, std::function<void(std::string_view)> process)
+{
+    tokenize(content, process);
 }
 
 [[nodiscard]] auto is_http(std::string_view content) -> bool
@@ -167,7 +319,7 @@ void parse_plaintext_content(std::string&& content, std::function<void(std::stri
     return std::string_view(&*start, 4) == "HTTP"sv;
 }
 
-void parse_html_content(std::string&& content, std::function<void(std::string&&)> process)
+void parse_html_content(std::string&& content, std::function<void(std::string_view)> process)
 {
     content = parsing::html::cleantext([&]() {
         auto pos = content.begin();
@@ -188,11 +340,10 @@ void parse_html_content(std::string&& content, std::function<void(std::string&&)
     if (content.empty()) {
         return;
     }
-    TermTokenizer tokenizer(content);
-    std::for_each(tokenizer.begin(), tokenizer.end(), process);
+    tokenize(content, process);
 }
 
-std::function<void(std::string&& constent, std::function<void(std::string&&)>)>
+std::function<void(std::string&& constent, std::function<void(std::string_view)>)>
 content_parser(std::optional<std::string> const& type)
 {
     if (not type) {
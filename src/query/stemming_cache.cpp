@@ -0,0 +1,66 @@
+#include "query/stemming_cache.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace pisa {
+
+namespace {
+
+    /// Keeps track of live caches, and of the statistics of the destroyed ones.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<StemmingCache const*> caches;
+        StemmingCache::Stats retired;
+    };
+
+    auto registry() -> Registry&
+    {
+        static Registry instance;
+        return instance;
+    }
+
+}  // namespace
+
+StemmingCache::StemmingCache(std::size_t capacity)
+{
+    std::size_t size = 1;
+    while (size < capacity) {
+        size <<= 1U;
+    }
+    m_entries.resize(size);
+    m_mask = size - 1;
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.caches.push_back(this);
+}
+
+StemmingCache::~StemmingCache()
+{
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto local = stats();
+    reg.retired.hits += local.hits;
+    reg.retired.misses += local.misses;
+    reg.caches.erase(std::find(reg.caches.begin(), reg.caches.end(), this));
+}
+
+auto StemmingCache::stats() const noexcept -> Stats
+{
+    return Stats{m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed)};
+}
+
+auto StemmingCache::global_stats() -> Stats
+{
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto total = reg.retired;
+    for (auto const* cache: reg.caches) {
+        auto local = cache->stats();
+        total.hits += local.hits;
+        total.misses += local.misses;
+    }
+    return total;
+}
+
+}  // namespace pisa
@@ -4,6 +4,8 @@
 #include <Porter2.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include "query/stemming_cache.hpp"
+
 namespace pisa {
 
 auto term_transformer_builder(std::optional<std::string> const& type) -> TermTransformerBuilder
@@ -19,8 +21,11 @@ auto term_transformer_builder(std::optional<std::string> const& type) -> TermTra
     if (*type == "porter2") {
         return [] {
             return [](std::string&& term) -> std::string {
-                boost::algorithm::to_lower(term);
-                return porter2::Stemmer{}.stem(term);
+                thread_local StemmingCache cache;
+                return cache.get(term, [](std::string term) {
+                    boost::algorithm::to_lower(term);
+                    return porter2::Stemmer{}.stem(term);
+                });
             };
         };
     }
@@ -28,8 +33,11 @@ auto term_transformer_builder(std::optional<std::string> const& type) -> TermTra
         return []() {
             return [kstemmer = std::make_shared<stem::KrovetzStemmer>()](
                        std::string&& term) mutable -> std::string {
-                boost::algorithm::to_lower(term);
-                return kstemmer->kstem_stemmer(term);
+                thread_local StemmingCache cache;
+                return cache.get(term, [&](std::string term) {
+                    boost::algorithm::to_lower(term);
+                    return kstemmer->kstem_stemmer(term);
+                });
             };
         };
     }
@@ -0,0 +1,474 @@
+#include "scatter_gather.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fmt/format.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "selective_search.hpp"
+#include "timer.hpp"
+
+namespace pisa {
+
+namespace {
+
+    void append_word(std::vector<char>& bytes, std::uint32_t word)
+    {
+        auto const* first = reinterpret_cast<char const*>(&word);
+        bytes.insert(bytes.end(), first, first + sizeof(word));
+    }
+
+    /// Reads consecutive 32-bit words from an encoded message.
+    class word_reader {
+      public:
+        explicit word_reader(gsl::span<char const> bytes) : m_bytes(bytes) {}
+
+        [[nodiscard]] auto remaining() const -> std::size_t
+        {
+            return (m_bytes.size() - m_pos) / sizeof(std::uint32_t);
+        }
+
+        [[nodiscard]] auto next() -> std::uint32_t
+        {
+            if (remaining() == 0) {
+                throw std::invalid_argument("Unexpected end of message");
+            }
+            std::uint32_t word;
+            std::memcpy(&word, m_bytes.data() + m_pos, sizeof(word));
+            m_pos += sizeof(word);
+            return word;
+        }
+
+        void expect_end() const
+        {
+            if (m_pos != static_cast<std::size_t>(m_bytes.size())) {
+                throw std::invalid_argument(fmt::format(
+                    "Expected end of message at byte {} but message has {} bytes",
+                    m_pos,
+                    m_bytes.size()));
+            }
+        }
+
+      private:
+        gsl::span<char const> m_bytes;
+        std::size_t m_pos = 0;
+    };
+
+    [[nodiscard]] auto system_error(std::string const& what) -> std::system_error
+    {
+        return std::system_error(errno, std::generic_category(), what);
+    }
+
+    [[nodiscard]] auto unix_address(std::string const& path) -> sockaddr_un
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument(fmt::format("Socket path too long: {}", path));
+        }
+        address.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), address.sun_path);
+        return address;
+    }
+
+    /// Reads exactly `size` bytes, returning `false` if the connection is closed before any
+    /// byte is read.
+    [[nodiscard]] auto read_exactly(int fd, char* data, std::size_t size) -> bool
+    {
+        std::size_t pos = 0;
+        while (pos < size) {
+            auto count = ::recv(fd, data + pos, size - pos, 0);
+            if (count == 0) {
+                if (pos == 0) {
+                    return false;
+                }
+                throw std::runtime_error("Connection closed in the middle of a message");
+            }
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw system_error("Failed reading from socket");
+            }
+            pos += count;
+        }
+        return true;
+    }
+
+    /// Appends the bytes that can be read from `fd` without blocking to `buffer`, returning
+    /// `false` if the peer has closed the connection.
+    [[nodiscard]] auto receive_available(int fd, std::vector<char>& buffer) -> bool
+    {
+        std::array<char, 4096> chunk{};
+        while (true) {
+            auto count = ::recv(fd, chunk.data(), chunk.size(), MSG_DONTWAIT);
+            if (count == 0) {
+                return false;
+            }
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return true;
+                }
+                throw system_error("Failed reading from socket");
+            }
+            buffer.insert(buffer.end(), chunk.data(), chunk.data() + count);
+        }
+    }
+
+    /// Removes the first message from `buffer` if it has been received in full.
+    [[nodiscard]] auto take_message(std::vector<char>& buffer) -> std::optional<std::vector<char>>
+    {
+        std::uint32_t size;
+        if (buffer.size() < sizeof(size)) {
+            return std::nullopt;
+        }
+        std::memcpy(&size, buffer.data(), sizeof(size));
+        if (buffer.size() - sizeof(size) < size) {
+            return std::nullopt;
+        }
+        auto first = std::next(buffer.begin(), sizeof(size));
+        auto last = std::next(first, size);
+        std::vector<char> message(first, last);
+        buffer.erase(buffer.begin(), last);
+        return message;
+    }
+
+    /// Checks if any input, or the end of the connection, can be read from `fd` without waiting.
+    [[nodiscard]] auto input_available(int fd) -> bool
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        while (::poll(&pfd, 1, 0) < 0) {
+            if (errno != EINTR) {
+                throw system_error("Failed polling socket");
+            }
+        }
+        return pfd.revents != 0;
+    }
+
+}  // namespace
+
+auto encode_request(shard_request const& request) -> std::vector<char>
+{
+    std::vector<char> bytes;
+    bytes.reserve((3 + request.terms.size()) * sizeof(std::uint32_t));
+    append_word(bytes, request.id);
+    append_word(bytes, request.k);
+    append_word(bytes, request.terms.size());
+    for (auto term: request.terms) {
+        append_word(bytes, term);
+    }
+    return bytes;
+}
+
+auto decode_request(gsl::span<char const> bytes) -> shard_request
+{
+    word_reader reader(bytes);
+    shard_request request;
+    request.id = reader.next();
+    request.k = reader.next();
+    auto num_terms = reader.next();
+    if (num_terms > reader.remaining()) {
+        throw std::invalid_argument(fmt::format("Invalid number of terms: {}", num_terms));
+    }
+    request.terms.reserve(num_terms);
+    for (std::uint32_t idx = 0; idx < num_terms; ++idx) {
+        request.terms.push_back(reader.next());
+    }
+    reader.expect_end();
+    return request;
+}
+
+auto encode_response(shard_response const& response) -> std::vector<char>
+{
+    std::vector<char> bytes;
+    bytes.reserve((2 + 2 * response.topk.size()) * sizeof(std::uint32_t));
+    append_word(bytes, response.id);
+    append_word(bytes, response.topk.size());
+    for (auto [score, docid]: response.topk) {
+        std::uint32_t score_bits;
+        std::memcpy(&score_bits, &score, sizeof(score_bits));
+        append_word(bytes, score_bits);
+        append_word(bytes, docid);
+    }
+    return bytes;
+}
+
+auto decode_response(gsl::span<char const> bytes) -> shard_response
+{
+    word_reader reader(bytes);
+    shard_response response;
+    response.id = reader.next();
+    auto size = reader.next();
+    if (size > reader.remaining() / 2) {
+        throw std::invalid_argument(fmt::format("Invalid number of results: {}", size));
+    }
+    response.topk.reserve(size);
+    for (std::uint32_t idx = 0; idx < size; ++idx) {
+        auto score_bits = reader.next();
+        Score score;
+        std::memcpy(&score, &score_bits, sizeof(score));
+        response.topk.emplace_back(score, reader.next());
+    }
+    reader.expect_end();
+    return response;
+}
+
+Socket::Socket(Socket&& other) noexcept : m_fd(other.m_fd)
+{
+    other.m_fd = -1;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_fd = other.m_fd;
+        other.m_fd = -1;
+    }
+    return *this;
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+void Socket::close() noexcept
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+auto listen_unix_socket(std::string const& path) -> Socket
+{
+    auto address = unix_address(path);
+    Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (not socket.is_open()) {
+        throw system_error("Failed creating socket");
+    }
+    ::unlink(path.c_str());
+    if (::bind(socket.fd(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        throw system_error(fmt::format("Failed binding socket to {}", path));
+    }
+    if (::listen(socket.fd(), SOMAXCONN) != 0) {
+        throw system_error(fmt::format("Failed listening at {}", path));
+    }
+    return socket;
+}
+
+auto accept_connection(Socket const& listener) -> Socket
+{
+    while (true) {
+        Socket connection(::accept(listener.fd(), nullptr, nullptr));
+        if (connection.is_open()) {
+            return connection;
+        }
+        if (errno != EINTR) {
+            throw system_error("Failed accepting connection");
+        }
+    }
+}
+
+auto connect_unix_socket(std::string const& path, std::chrono::milliseconds timeout) -> Socket
+{
+    auto address = unix_address(path);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (not socket.is_open()) {
+            throw system_error("Failed creating socket");
+        }
+        if (::connect(socket.fd(), reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return socket;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw system_error(fmt::format("Failed connecting to {}", path));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void write_message(Socket const& socket, gsl::span<char const> message)
+{
+    auto size = static_cast<std::uint32_t>(message.size());
+    std::vector<char> bytes(sizeof(size) + message.size());
+    std::memcpy(bytes.data(), &size, sizeof(size));
+    std::copy(message.begin(), message.end(), bytes.begin() + sizeof(size));
+    std::size_t pos = 0;
+    while (pos < bytes.size()) {
+        auto count = ::send(socket.fd(), bytes.data() + pos, bytes.size() - pos, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("Failed writing to socket");
+        }
+        pos += count;
+    }
+}
+
+auto read_message(Socket const& socket) -> std::optional<std::vector<char>>
+{
+    std::uint32_t size;
+    if (not read_exactly(socket.fd(), reinterpret_cast<char*>(&size), sizeof(size))) {
+        return std::nullopt;
+    }
+    std::vector<char> message(size);
+    if (size > 0 && not read_exactly(socket.fd(), message.data(), size)) {
+        throw std::runtime_error("Connection closed in the middle of a message");
+    }
+    return message;
+}
+
+void serve_shard_requests(
+    Socket const& connection, std::function<shard_response(shard_request const&)> const& handler)
+{
+    try {
+        while (auto message = read_message(connection)) {
+            // The coordinator sends a new request only once it has given up on the previous
+            // one, so only the last of the requests that have queued up is worth answering.
+            while (input_available(connection.fd())) {
+                auto next = read_message(connection);
+                if (not next) {
+                    return;
+                }
+                message = std::move(next);
+            }
+            auto response = handler(decode_request(gsl::make_span(*message)));
+            write_message(connection, gsl::make_span(encode_response(response)));
+        }
+    } catch (std::system_error const& err) {
+        // The coordinator may close the connection without waiting for pending responses.
+        if (err.code() != std::errc::broken_pipe && err.code() != std::errc::connection_reset) {
+            throw;
+        }
+    }
+}
+
+scatter_gather_coordinator::scatter_gather_coordinator(
+    VecMap<Shard_Id, Socket> connections,
+    VecMap<Shard_Id, std::vector<Document_Id>> global_docids,
+    std::chrono::milliseconds timeout)
+    : m_connections(std::move(connections)),
+      m_global_docids(std::move(global_docids)),
+      m_received(m_connections.size()),
+      m_timeout(timeout)
+{
+    if (m_connections.size() != m_global_docids.size()) {
+        throw std::invalid_argument(fmt::format(
+            "Number of shards ({}) does not match number of document mappings ({})",
+            m_connections.size(),
+            m_global_docids.size()));
+    }
+}
+
+auto scatter_gather_coordinator::operator()(
+    VecMap<Shard_Id, Query> const& shard_queries, std::uint32_t k) -> result_type
+{
+    if (shard_queries.size() != m_connections.size()) {
+        throw std::invalid_argument(fmt::format(
+            "Expected queries for {} shards but {} given",
+            m_connections.size(),
+            shard_queries.size()));
+    }
+    result_type result;
+    result.time = run_with_timer<std::chrono::microseconds>([&] {
+        auto request_id = m_next_request++;
+        auto deadline = std::chrono::steady_clock::now() + m_timeout;
+
+        std::vector<Shard_Id> pending;
+        for (std::size_t idx = 0; idx < m_connections.size(); ++idx) {
+            auto shard = Shard_Id(idx);
+            auto& connection = m_connections[shard];
+            if (not connection.is_open()) {
+                result.missing_shards.push_back(shard);
+                continue;
+            }
+            shard_request request{request_id, k, shard_queries[shard].terms};
+            try {
+                write_message(connection, gsl::make_span(encode_request(request)));
+                pending.push_back(shard);
+            } catch (std::exception const&) {
+                connection.close();
+                m_received[shard].clear();
+                result.missing_shards.push_back(shard);
+            }
+        }
+
+        std::vector<std::vector<topk_queue::entry_type>> shard_results;
+        std::vector<pollfd> fds;
+        while (not pending.empty()) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                break;
+            }
+            fds.clear();
+            for (auto shard: pending) {
+                fds.push_back(pollfd{m_connections[shard].fd(), POLLIN, 0});
+            }
+            if (::poll(fds.data(), fds.size(), remaining.count()) < 0 && errno != EINTR) {
+                throw system_error("Failed polling shard connections");
+            }
+            std::vector<Shard_Id> still_pending;
+            for (std::size_t idx = 0; idx < pending.size(); ++idx) {
+                auto shard = pending[idx];
+                if (fds[idx].revents == 0) {
+                    still_pending.push_back(shard);
+                    continue;
+                }
+                auto& connection = m_connections[shard];
+                auto& received = m_received[shard];
+                try {
+                    // Reads only what has arrived, so that a partially sent response does not
+                    // block past the deadline; the rest is read by this or a later query.
+                    bool open = receive_available(connection.fd(), received);
+                    std::optional<shard_response> response;
+                    while (auto message = take_message(received)) {
+                        response = decode_response(gsl::make_span(*message));
+                        if (response->id == request_id) {
+                            break;
+                        }
+                        // A late response to a request that has timed out.
+                        response.reset();
+                    }
+                    if (response) {
+                        result.shards.push_back(shard);
+                        shard_results.push_back(std::move(response->topk));
+                    } else if (open) {
+                        still_pending.push_back(shard);
+                    } else {
+                        connection.close();
+                        received.clear();
+                        result.missing_shards.push_back(shard);
+                    }
+                } catch (std::exception const&) {
+                    connection.close();
+                    received.clear();
+                    result.missing_shards.push_back(shard);
+                }
+            }
+            pending = std::move(still_pending);
+        }
+        result.missing_shards.insert(result.missing_shards.end(), pending.begin(), pending.end());
+        std::sort(result.missing_shards.begin(), result.missing_shards.end());
+        result.topk = merge_shard_results(
+            gsl::make_span(result.shards), gsl::make_span(shard_results), m_global_docids, k);
+    });
+    return result;
+}
+
+}  // namespace pisa
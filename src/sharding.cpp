@@ -102,6 +102,48 @@ auto mapping_from_files(std::string const& full_titles, gsl::span<std::string co
     return mapping_from_files(&fis, gsl::make_span(title_files));
 }
 
+auto global_document_ids(std::istream* full_titles, gsl::span<std::istream*> shard_titles)
+    -> VecMap<Shard_Id, std::vector<Document_Id>>
+{
+    std::unordered_map<std::string, Document_Id> map;
+    auto document_id = Document_Id(0);
+    io::for_each_line(*full_titles, [&](auto const& title) {
+        map.emplace(title, document_id);
+        document_id += 1;
+    });
+
+    VecMap<Shard_Id, std::vector<Document_Id>> result;
+    result.reserve(shard_titles.size());
+    for (auto* is: shard_titles) {
+        auto& documents = result.emplace_back();
+        io::for_each_line(*is, [&](auto const& title) {
+            if (auto pos = map.find(title); pos != map.end()) {
+                documents.push_back(pos->second);
+            } else {
+                throw std::invalid_argument(
+                    fmt::format("Document {} of shard {} not found", title, result.size() - 1));
+            }
+        });
+    }
+    return result;
+}
+
+auto global_document_ids(std::string const& full_titles, gsl::span<std::string const> shard_titles)
+    -> VecMap<Shard_Id, std::vector<Document_Id>>
+{
+    std::ifstream fis(full_titles);
+    std::vector<std::unique_ptr<std::istream>> shard_is;
+    for (auto const& shard_file: shard_titles) {
+        if (!boost::filesystem::exists(shard_file)) {
+            throw std::invalid_argument(fmt::format("Shard file does not exist: {}", shard_file));
+        }
+        shard_is.push_back(std::make_unique<std::ifstream>(shard_file));
+    }
+    auto title_files =
+        shard_is | ranges::views::transform([](auto& is) { return is.get(); }) | ranges::to_vector;
+    return global_document_ids(&fis, gsl::make_span(title_files));
+}
+
 auto create_random_mapping(int document_count, int shard_count, std::optional<std::uint64_t> seed)
     -> VecMap<Document_Id, Shard_Id>
 {
@@ -1,7 +1,100 @@
 #include "tokenizer.hpp"
 
+#include <immintrin.h>
+
+#include "util/compiler_attribute.hpp"
+
 namespace pisa {
 
 tokens<lexer_type> const TermTokenizer::LEXER = tokens<lexer_type>{};
 
+namespace {
+
+    /// Copies the bytes of `in` from `pos` to `size` into `out`, and sets the bits of
+    /// `alnum` of the alphanumeric ones; `pos` must be a multiple of 16.
+    /// Returns `false` if any of the bytes is not ASCII.
+    auto classify_ascii_baseline(
+        std::uint8_t const* in,
+        std::uint8_t* out,
+        std::uint64_t* alnum,
+        std::size_t pos,
+        std::size_t size) -> bool
+    {
+        __m128i non_ascii = _mm_setzero_si128();
+        for (; pos + 16 <= size; pos += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + pos));
+            non_ascii = _mm_or_si128(non_ascii, bytes);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos), bytes);
+            // Non-ASCII bytes are negative, so signed comparisons are enough for the ranges
+            // below. Setting the 0x20 bit maps upper case letters to lower case, and no other
+            // byte to one.
+            __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+            __m128i letter = _mm_and_si128(
+                _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+            __m128i digit = _mm_and_si128(
+                _mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+                _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), bytes));
+            auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_or_si128(letter, digit)));
+            alnum[pos >> 6U] |= std::uint64_t(mask) << (pos & 63U);
+        }
+        if (_mm_movemask_epi8(non_ascii) != 0) {
+            return false;
+        }
+        for (; pos < size; ++pos) {
+            auto byte = in[pos];
+            if (byte >= 0x80U) {
+                return false;
+            }
+            out[pos] = byte;
+            auto lower = byte | 0x20U;
+            if ((lower >= 'a' && lower <= 'z') || (byte >= '0' && byte <= '9')) {
+                alnum[pos >> 6U] |= std::uint64_t(1) << (pos & 63U);
+            }
+        }
+        return true;
+    }
+
+    PISA_TARGET("avx2")
+    auto classify_ascii_avx2(
+        std::uint8_t const* in, std::uint8_t* out, std::uint64_t* alnum, std::size_t size) -> bool
+    {
+        __m256i non_ascii = _mm256_setzero_si256();
+        std::size_t pos = 0;
+        for (; pos + 32 <= size; pos += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + pos));
+            non_ascii = _mm256_or_si256(non_ascii, bytes);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos), bytes);
+            __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+            __m256i letter = _mm256_and_si256(
+                _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+            __m256i digit = _mm256_and_si256(
+                _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes));
+            auto mask =
+                static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(letter, digit)));
+            alnum[pos >> 6U] |= std::uint64_t(mask) << (pos & 63U);
+        }
+        if (_mm256_movemask_epi8(non_ascii) != 0) {
+            return false;
+        }
+        return classify_ascii_baseline(in, out, alnum, pos, size);
+    }
+
+}  // namespace
+
+auto AsciiTermTokenizer::classify(std::string_view text) -> bool
+{
+    auto size = text.size();
+    m_buffer.resize(size);
+    m_alnum.assign((size + 63) / 64, 0U);
+    auto const* in = reinterpret_cast<std::uint8_t const*>(text.data());
+    auto* out = reinterpret_cast<std::uint8_t*>(m_buffer.data());
+    if (m_level >= SimdLevel::Avx2) {
+        return classify_ascii_avx2(in, out, m_alnum.data(), size);
+    }
+    return classify_ascii_baseline(in, out, m_alnum.data(), 0, size);
+}
+
 }  // namespace pisa
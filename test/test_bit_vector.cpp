@@ -212,6 +212,21 @@ TEST_CASE("bit_vector_unary_enumerator")
     }
 }
 
+TEST_CASE("select_in_word")
+{
+    std::mt19937_64 gen(1234);
+    for (int i = 0; i < 10'000; ++i) {
+        uint64_t word = gen() & gen();
+        uint64_t k = 0;
+        for (uint64_t pos = 0; pos < 64; ++pos) {
+            if ((word >> pos) & 1U) {
+                MY_REQUIRE_EQUAL(pisa::broadword::select_in_word(word, k), pos, "k = " << k);
+                k += 1;
+            }
+        }
+    }
+}
+
 TEST_CASE("bvb_reverse")
 {
     rc::check([](std::vector<bool> v) {
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "codec/block_codecs.hpp"
+#include "codec/hybrid_block.hpp"
 #include "codec/maskedvbyte.hpp"
 #include "codec/qmx.hpp"
 #include "codec/simdbp.hpp"
@@ -53,5 +54,21 @@ TEST_CASE("block_codecs")
     test_block_codec<pisa::varintgb_block>();
     test_block_codec<pisa::simple8b_block>();
     test_block_codec<pisa::simdbp_block>();
+    test_block_codec<pisa::hybrid_block>();
     test_block_codec<pisa::simple16_block>();
 }
+
+TEST_CASE("block_codecs with other block sizes")
+{
+    test_block_codec<pisa::basic_optpfor_block<64>>();
+    test_block_codec<pisa::basic_optpfor_block<256>>();
+    test_block_codec<pisa::basic_varint_G8IU_block<64>>();
+    test_block_codec<pisa::basic_streamvbyte_block<256>>();
+    test_block_codec<pisa::basic_maskedvbyte_block<256>>();
+    test_block_codec<pisa::basic_interpolative_block<64>>();
+    test_block_codec<pisa::basic_qmx_block<256>>();
+    test_block_codec<pisa::basic_varintgb_block<64>>();
+    test_block_codec<pisa::basic_simple8b_block<256>>();
+    test_block_codec<pisa::basic_simdbp_block<256>>();
+    test_block_codec<pisa::basic_simple16_block<64>>();
+}
@@ -4,6 +4,7 @@
 #include "test_generic_sequence.hpp"
 
 #include "codec/block_codecs.hpp"
+#include "codec/hybrid_block.hpp"
 #include "codec/maskedvbyte.hpp"
 #include "codec/qmx.hpp"
 #include "codec/simdbp.hpp"
@@ -14,6 +15,7 @@
 #include "temporary_directory.hpp"
 
 #include "block_freq_index.hpp"
+#include "index_types.hpp"
 #include "mappable/mapper.hpp"
 #include "mio/mmap.hpp"
 
@@ -76,4 +78,19 @@ TEST_CASE("block_freq_index")
     test_block_freq_index<pisa::simple8b_block>();
     test_block_freq_index<pisa::simple16_block>();
     test_block_freq_index<pisa::simdbp_block>();
+    test_block_freq_index<pisa::hybrid_block>();
+}
+
+TEST_CASE("block_freq_index with other block sizes")
+{
+    test_block_freq_index<pisa::basic_optpfor_block<64>>();
+    test_block_freq_index<pisa::basic_optpfor_block<256>>();
+    test_block_freq_index<pisa::basic_simdbp_block<256>>();
+    test_block_freq_index<pisa::basic_streamvbyte_block<64>>();
+    test_block_freq_index<pisa::basic_interpolative_block<32>>();
+
+    REQUIRE(pisa::block_index_block_size("block_simdbp") == 128);
+    REQUIRE(pisa::block_index_block_size("block_optpfor_64") == 64);
+    REQUIRE(pisa::block_index_block_size("block_simdbp_256") == 256);
+    REQUIRE_FALSE(pisa::block_index_block_size("pefopt").has_value());
 }
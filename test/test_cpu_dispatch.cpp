@@ -0,0 +1,93 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <random>
+#include <vector>
+
+#include "accumulator/score_scan.hpp"
+#include "accumulator/simple_accumulator.hpp"
+#include "codec/docid_prefix_sum.hpp"
+#include "cpu_dispatch.hpp"
+#include "topk_queue.hpp"
+
+using namespace pisa;
+
+TEST_CASE("Parse SIMD levels", "[simd][unit]")
+{
+    for (auto level: {SimdLevel::Baseline, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        REQUIRE(parse_simd_level(to_string(level)) == level);
+    }
+    REQUIRE_FALSE(parse_simd_level("sse2").has_value());
+    REQUIRE(simd_level() <= detected_simd_level());
+    for (auto const& kernel: DISPATCHED_KERNELS) {
+        REQUIRE(kernel_level(kernel) <= kernel.max_level);
+        REQUIRE(kernel_level(kernel) <= simd_level());
+    }
+}
+
+TEST_CASE("Score scan kernels agree", "[simd][unit]")
+{
+    auto level = GENERATE(SimdLevel::Baseline, SimdLevel::Avx2, SimdLevel::Avx512);
+    if (level > detected_simd_level()) {
+        return;
+    }
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(0.0, 1.0);
+    std::vector<float> scores(1'000);
+    std::generate(
+        scores.begin(), scores.end(), [&] { return dist(gen) < 0.95 ? 0.0F : dist(gen); });
+    auto last = scores.data() + scores.size();
+    for (auto threshold: {0.0F, 0.5F, 0.99F, 1.0F}) {
+        for (std::size_t start = 0; start < 40; ++start) {
+            auto first = scores.data() + start;
+            auto expected = std::find_if(first, last, [&](float s) { return s > threshold; });
+            REQUIRE(find_greater(first, last, threshold, level) == expected);
+        }
+    }
+}
+
+TEST_CASE("Document prefix sum kernels agree", "[simd][unit]")
+{
+    auto level = GENERATE(SimdLevel::Baseline, SimdLevel::Avx2, SimdLevel::Avx512);
+    if (level > detected_simd_level()) {
+        return;
+    }
+    std::mt19937 gen(13);
+    std::vector<std::uint32_t> gaps(128);
+    std::generate(gaps.begin(), gaps.end(), [&] { return gen() % 3 == 0 ? gen() % 1000 : 0; });
+    for (std::uint32_t base: {0U, 1U, 1'000'000U}) {
+        for (std::size_t n = 0; n <= gaps.size(); ++n) {
+            std::vector<std::uint32_t> expected(gaps.begin(), gaps.begin() + n);
+            std::uint32_t docid = base - 1;
+            for (auto& value: expected) {
+                docid += value + 1;
+                value = docid;
+            }
+            auto values = gaps;
+            docid_prefix_sum(values.data(), n, base, level);
+            REQUIRE(std::vector<std::uint32_t>(values.begin(), values.begin() + n) == expected);
+            REQUIRE(std::equal(values.begin() + n, values.end(), gaps.begin() + n));
+        }
+    }
+}
+
+TEST_CASE("Simple accumulator aggregates scores above the threshold", "[simd][unit]")
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dist(0.0, 10.0);
+    Simple_Accumulator accumulator(1'003);
+    accumulator.init();
+    for (std::uint32_t doc = 0; doc < accumulator.size(); doc += 1 + gen() % 7) {
+        accumulator.accumulate(doc, dist(gen));
+    }
+    topk_queue topk(10);
+    accumulator.aggregate(topk);
+    topk.finalize();
+
+    topk_queue expected(10);
+    for (std::uint32_t doc = 0; doc < accumulator.size(); ++doc) {
+        expected.insert(accumulator[doc], doc);
+    }
+    expected.finalize();
+    REQUIRE(topk.topk() == expected.topk());
+}
@@ -0,0 +1,282 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+#include <shared_mutex>
+
+#include <tbb/task_scheduler_init.h>
+
+#include "cursor/max_scored_cursor.hpp"
+#include "cursor/scored_cursor.hpp"
+#include "delta_index.hpp"
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "query/algorithm/maxscore_query.hpp"
+#include "query/algorithm/ranked_or_query.hpp"
+#include "query/algorithm/wand_query.hpp"
+#include "query/queries.hpp"
+#include "temporary_directory.hpp"
+#include "test_index_common.hpp"
+#include "util/inverted_index_utils.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+/// Writes documents `[0, last)` as a collection, skipping terms that do not occur in them.
+/// Returns the term ID of each input term in the new collection, where terms missing from it
+/// get consecutive IDs following the ones of the collection, as they would in the delta.
+auto write_prefix(
+    binary_freq_collection const& collection,
+    binary_collection const& sizes,
+    std::uint32_t last,
+    std::string const& basename) -> std::vector<std::uint32_t>
+{
+    std::ofstream docs(fmt::format("{}.docs", basename));
+    std::ofstream freqs(fmt::format("{}.freqs", basename));
+    std::ofstream lengths(fmt::format("{}.sizes", basename));
+    emit(docs, 1);
+    emit(docs, last);
+    std::vector<std::uint32_t> mapping;
+    std::vector<std::size_t> missing;
+    for (auto const& seq: collection) {
+        auto size = std::lower_bound(seq.docs.begin(), seq.docs.end(), last) - seq.docs.begin();
+        if (size == 0) {
+            missing.push_back(mapping.size());
+            mapping.push_back(0);
+            continue;
+        }
+        mapping.push_back(mapping.size() - missing.size());
+        emit(docs, size);
+        emit(docs, seq.docs.begin(), size);
+        emit(freqs, size);
+        emit(freqs, seq.freqs.begin(), size);
+    }
+    auto term_count = mapping.size() - missing.size();
+    for (auto term: missing) {
+        mapping[term] = term_count++;
+    }
+    emit(lengths, last);
+    emit(lengths, sizes.begin()->begin(), last);
+    return mapping;
+}
+
+/// Adds documents `[first, collection.num_docs())` to `delta` with term IDs given by `mapping`.
+void add_documents(
+    binary_freq_collection const& collection,
+    std::uint32_t first,
+    std::vector<std::uint32_t> const& mapping,
+    delta_index& delta)
+{
+    std::vector<std::vector<std::uint32_t>> documents(collection.num_docs() - first);
+    std::uint32_t term = 0;
+    for (auto const& seq: collection) {
+        auto pos = std::lower_bound(seq.docs.begin(), seq.docs.end(), first) - seq.docs.begin();
+        for (; pos < seq.docs.size(); ++pos) {
+            auto& document = documents[seq.docs.begin()[pos] - first];
+            document.insert(document.end(), seq.freqs.begin()[pos], mapping[term]);
+        }
+        term += 1;
+    }
+    for (auto const& document: documents) {
+        delta.add_document(document);
+    }
+}
+
+TEST_CASE("Delta index enumerator", "[index][delta]")
+{
+    delta_index delta(10, 4);
+    std::vector<std::uint32_t> docs;
+    for (std::uint32_t doc = 10; doc < 100; ++doc) {
+        std::vector<std::uint32_t> terms{0};
+        if (doc % 3 == 0) {
+            terms.insert(terms.end(), doc % 5 + 1, 1);
+            docs.push_back(doc);
+        }
+        REQUIRE(delta.add_document(terms) == doc);
+    }
+    REQUIRE(delta.num_docs() == 100);
+    REQUIRE(delta.size() == 2);
+    REQUIRE(delta[2].size() == 0);
+    REQUIRE(delta[2].docid() == 100);
+
+    auto list = delta[1];
+    REQUIRE(list.size() == docs.size());
+    for (auto doc: docs) {
+        REQUIRE(list.docid() == doc);
+        REQUIRE(list.freq() == doc % 5 + 1);
+        list.next();
+    }
+    REQUIRE(list.docid() == 100);
+
+    auto lower_bound = GENERATE(range(0, 102));
+    list.reset();
+    list.next_geq(lower_bound);
+    auto expected = std::lower_bound(docs.begin(), docs.end(), lower_bound);
+    REQUIRE(list.docid() == (expected == docs.end() ? 100 : *expected));
+}
+
+TEST_CASE("Copy delta index", "[index][delta]")
+{
+    delta_index delta(10, 4);
+    for (std::uint32_t doc = 10; doc < 100; ++doc) {
+        delta.add_document(std::vector<std::uint32_t>(doc % 3, doc % 7));
+    }
+    delta_index copy(delta);
+    delta.add_document(std::vector<std::uint32_t>{1, 1, 2});
+    REQUIRE(copy.num_docs() == 100);
+    REQUIRE(copy.posting_count() + 2 == delta.posting_count());
+    for (std::uint32_t term = 0; term < delta.size(); ++term) {
+        auto expected = delta[term];
+        auto actual = copy[term];
+        REQUIRE(actual.size() == expected.size() - (term == 1 || term == 2 ? 1 : 0));
+        REQUIRE(
+            copy.term_occurrence_count(term) + (term == 1 ? 2 : (term == 2 ? 1 : 0))
+            == delta.term_occurrence_count(term));
+        for (; actual.position() < actual.size(); actual.next(), expected.next()) {
+            REQUIRE(actual.docid() == expected.docid());
+            REQUIRE(actual.freq() == expected.freq());
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("Query static and delta indexes", "[index][delta]", block_simdbp_index, ef_index)
+{
+    tbb::task_scheduler_init init;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    Temporary_Directory tmp;
+    auto path = [&](auto name) { return (tmp.path() / name).string(); };
+
+    std::uint32_t split = collection.num_docs() - 1000;
+    auto mapping = write_prefix(collection, sizes, split, path("static"));
+    build_index<TestType>(binary_freq_collection(path("static").c_str()), path("static"));
+    build_wand_data<wand_type>(path("static"), path("static.wand"));
+    TestType static_index(MemorySource::mapped_file(path("static")));
+    wand_type static_wdata(MemorySource::mapped_file(path("static.wand")));
+
+    delta_index delta(split, 4);
+    add_documents(collection, split, mapping, delta);
+    REQUIRE(delta.num_docs() == collection.num_docs());
+
+    SECTION("Results are the same as scoring all postings of the collection")
+    {
+        std::vector<binary_freq_collection::sequence> lists(collection.begin(), collection.end());
+        std::vector<Query> queries;
+        std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+        auto push_query = [&](std::string const& query_line) {
+            queries.push_back(parse_query_ids(query_line));
+        };
+        io::for_each_line(qfile, push_query);
+
+        std::shared_lock lock(delta);
+        segmented_index<TestType> index(static_index, delta);
+        segmented_wand_data<wand_type> wdata(static_wdata, delta, ScorerParams("bm25"));
+        for (auto query: queries) {
+            topk_queue expected(10);
+            std::unordered_map<std::uint32_t, float> scores;
+            for (auto [term, weight]: query_freqs(query.terms)) {
+                auto term_scorer = wdata.scorer().term_scorer(mapping[term]);
+                auto const& seq = lists[term];
+                for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                    auto doc = seq.docs.begin()[pos];
+                    scores[doc] += term_scorer(doc, seq.freqs.begin()[pos]);
+                }
+            }
+            for (auto [doc, score]: scores) {
+                expected.insert(score, doc);
+            }
+            expected.finalize();
+
+            std::transform(query.terms.begin(), query.terms.end(), query.terms.begin(), [&](auto term) {
+                return mapping[term];
+            });
+            topk_queue or_topk(10);
+            ranked_or_query or_q(or_topk);
+            or_q(make_scored_cursors(index, wdata.scorer(), query), index.num_docs());
+            or_topk.finalize();
+            topk_queue wand_topk(10);
+            wand_query wand_q(wand_topk);
+            wand_q(make_max_scored_cursors(index, wdata, wdata.scorer(), query), index.num_docs());
+            wand_topk.finalize();
+            topk_queue maxscore_topk(10);
+            maxscore_query maxscore_q(maxscore_topk);
+            maxscore_q(make_max_scored_cursors(index, wdata, wdata.scorer(), query), index.num_docs());
+            maxscore_topk.finalize();
+
+            for (auto const* actual: {&or_topk, &wand_topk, &maxscore_topk}) {
+                REQUIRE(actual->topk().size() == expected.topk().size());
+                for (size_t i = 0; i < expected.topk().size(); ++i) {
+                    REQUIRE(
+                        actual->topk()[i].first
+                        == Approx(expected.topk()[i].first).epsilon(0.01));  // tolerance is %
+                }
+            }
+        }
+    }
+
+    SECTION("Tracked max weights are the maximum scores of delta postings")
+    {
+        delta_index tracked(split, 4);
+        track_max_term_weights(tracked, static_wdata, ScorerParams("bm25"));
+        add_documents(collection, split, mapping, tracked);
+        auto check_max_weights = [&] {
+            std::shared_lock lock(tracked);
+            segmented_wand_data<wand_type> wdata(static_wdata, tracked, ScorerParams("bm25"));
+            for (std::uint32_t term = 0; term < tracked.size(); ++term) {
+                float expected =
+                    term < static_wdata.num_terms() ? static_wdata.max_term_weight(term) : 0.0F;
+                std::uint64_t occurrences = 0;
+                auto term_scorer = wdata.scorer().term_scorer(term);
+                for (auto list = tracked[term]; list.position() < list.size(); list.next()) {
+                    expected = std::max(expected, term_scorer(list.docid(), list.freq()));
+                    occurrences += list.freq();
+                }
+                REQUIRE(tracked.term_occurrence_count(term) == occurrences);
+                REQUIRE(wdata.max_term_weight(term) == Approx(expected));
+            }
+        };
+        check_max_weights();
+        tracked.erase_prefix(500);
+        check_max_weights();
+    }
+
+    SECTION("Merged index contains all documents")
+    {
+        auto count = merge_delta<TestType, wand_type>(
+            DeltaMergeOptions{
+                path("static"),
+                path("static.wand"),
+                path("merged"),
+                path("merged.wand"),
+                ScorerParams("bm25"),
+                FixedBlock(5)},
+            delta);
+        REQUIRE(count == collection.num_docs() - split);
+
+        TestType merged(MemorySource::mapped_file(path("merged")));
+        REQUIRE(merged.num_docs() == collection.num_docs());
+        REQUIRE(merged.size() == mapping.size());
+        std::uint32_t term = 0;
+        for (auto const& seq: collection) {
+            auto list = merged[mapping[term]];
+            REQUIRE(list.size() == seq.docs.size());
+            for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                REQUIRE(list.docid() == seq.docs.begin()[pos]);
+                REQUIRE(list.freq() == seq.freqs.begin()[pos]);
+                list.next();
+            }
+            term += 1;
+        }
+        wand_type merged_wdata(MemorySource::mapped_file(path("merged.wand")));
+        REQUIRE(merged_wdata.num_docs() == collection.num_docs());
+
+        delta.erase_prefix(count);
+        REQUIRE(delta.document_count() == 0);
+        REQUIRE(delta.posting_count() == 0);
+        REQUIRE(delta.first_docid() == collection.num_docs());
+        REQUIRE_NOTHROW(segmented_index<TestType>(merged, delta));
+    }
+}
@@ -3,8 +3,10 @@
 
 #include "test_generic_sequence.hpp"
 
+#include "flat_forward_index.hpp"
 #include "forward_index.hpp"
 
+#include <algorithm>
 #include <vector>
 
 TEST_CASE("write_and_read")
@@ -27,3 +29,53 @@ TEST_CASE("write_and_read")
         REQUIRE(std::equal(fwd[doc].begin(), fwd[doc].end(), fwd_read[doc].begin()));
     }
 }
+
+TEST_CASE("flat_forward_index")
+{
+    using namespace pisa;
+    auto fwd = forward_index::from_inverted_index("test_data/test_collection", 0, true);
+    auto flat = flat_forward_index<>::from_forward_index(fwd);
+
+    REQUIRE(flat.size() == fwd.size());
+    REQUIRE(flat.term_count() == fwd.term_count());
+    std::size_t posting_count = 0;
+    for (uint32_t doc = 0; doc < fwd.size(); ++doc) {
+        auto expected = fwd.terms(doc);
+        auto actual = flat.terms(doc);
+        REQUIRE(flat.term_count(doc) == fwd.term_count(doc));
+        REQUIRE(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+        posting_count += expected.size();
+    }
+    REQUIRE(flat.posting_count() == posting_count);
+}
+
+TEST_CASE("flat_forward_index with dense term IDs")
+{
+    using namespace pisa;
+    auto fwd = forward_index::from_inverted_index("test_data/test_collection", 100, true);
+    auto dense = dense_term_ids(fwd);
+    auto const& term_map = dense.first;
+    auto term_count = dense.second;
+
+    std::vector<bool> occurs(fwd.term_count(), false);
+    for (uint32_t doc = 0; doc < fwd.size(); ++doc) {
+        for (auto term: fwd.terms(doc)) {
+            occurs[term] = true;
+        }
+    }
+    REQUIRE(term_count == std::size_t(std::count(occurs.begin(), occurs.end(), true)));
+    REQUIRE(term_count < fwd.term_count());
+
+    auto flat = flat_forward_index<>::from_forward_index(fwd, term_map, term_count);
+    REQUIRE(flat.term_count() == term_count);
+    for (uint32_t doc = 0; doc < fwd.size(); ++doc) {
+        auto expected = fwd.terms(doc);
+        std::transform(expected.begin(), expected.end(), expected.begin(), [&](auto term) {
+            return term_map[term];
+        });
+        auto actual = flat.terms(doc);
+        REQUIRE(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+        REQUIRE(std::is_sorted(actual.begin(), actual.end()));
+        REQUIRE(std::all_of(actual.begin(), actual.end(), [&](auto term) { return term < term_count; }));
+    }
+}
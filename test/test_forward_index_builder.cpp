@@ -2,9 +2,13 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <set>
 #include <string>
 
 #include <boost/filesystem.hpp>
+#include <fmt/format.h>
 #include <catch2/catch.hpp>
 #include <gsl/span>
 
@@ -274,7 +278,7 @@ TEST_CASE("Merge forward index batches", "[parsing][forward_index]")
 TEST_CASE("Parse HTML content", "[parsing][forward_index][unit]")
 {
     std::vector<std::string> vec;
-    auto map_word = [&](std::string&& word) { vec.push_back(word); };
+    auto map_word = [&](std::string_view word) { vec.emplace_back(word); };
     SECTION("empty")
     {
         parse_html_content(
@@ -397,3 +401,164 @@ TEST_CASE("Build forward index", "[parsing][forward_index][integration]")
         }
     }
 }
+
+[[nodiscard]] auto warc_record(std::string const& trecid, std::string const& body) -> std::string
+{
+    auto http = fmt::format(
+        "HTTP/1.1 200 OK\nContent-Type: text/html\nContent-Length: {}\n\n{}", body.size(), body);
+    return fmt::format(
+        "WARC/0.18\nWARC-Type: response\nWARC-Target-URI: http://{0}\nWARC-TREC-ID: {0}\n"
+        "Content-Type: application/http;msgtype=response\nContent-Length: {1}\n\n{2}\n\n",
+        trecid,
+        http.size(),
+        http);
+}
+
+/// Writes the records of the plaintext test collection in `format`. Every tenth body contains
+/// strings that start records, which must not be taken for record boundaries.
+void write_collection(std::string const& format, std::string const& output)
+{
+    std::ifstream is(PISA_SOURCE_DIR "/test/test_data/clueweb1k.plaintext");
+    std::ofstream os(output);
+    Plaintext_Record record;
+    for (int idx = 0; is >> record; ++idx) {
+        auto body = record.content();
+        if (idx % 10 == 0) {
+            body += "\nWARC/0.18\nWARC-Type: response\nContent-Length: 100\n\n<DOC>\ntail";
+        }
+        if (format == "warc") {
+            os << warc_record(record.trecid(), body);
+        } else if (format == "trectext") {
+            os << "<DOC>\n<DOCNO> " << record.trecid() << " </DOCNO>\n<TEXT>\n"
+               << body << "\n</TEXT>\n</DOC>\n";
+        } else if (format == "trecweb") {
+            os << "<DOC>\n<DOCNO>" << record.trecid() << "</DOCNO>\n<DOCHDR>\nhttp://"
+               << record.trecid() << "\n</DOCHDR>\n"
+               << body << "\n</DOC>\n";
+        } else {
+            os << record.trecid() << ' ' << body << '\n';
+        }
+    }
+}
+
+TEST_CASE("Read record chunks", "[parsing][forward_index][unit]")
+{
+    std::vector<std::string> records{
+        warc_record("A", "a"),
+        warc_record("B", "b\r\n\r\nWARC/1.0\r\nContent-Length: 1000\r\n\r\nb"),
+        warc_record("C", "c\nWARC/1.0\n"),
+        warc_record("D", "d")};
+    std::string input =
+        "WARC/1.0\r\nWARC-Type: warcinfo\r\nContent-Length: 3\r\n\r\nabc\r\n\r\n";
+    std::set<std::size_t> record_ends{input.size() - 4};
+    for (auto const& record: records) {
+        input += record;
+        record_ends.insert(input.size() - 2);
+    }
+    auto chunk_size =
+        GENERATE(std::size_t{1}, std::size_t{50}, std::size_t{300}, std::size_t{10'000});
+    GIVEN("Chunk size " << chunk_size)
+    {
+        std::istringstream is(input);
+        Record_Chunk_Reader reader(is, *record_boundary("warc"), chunk_size);
+        std::vector<std::string> chunks;
+        std::optional<std::string> chunk = std::nullopt;
+        while ((chunk = reader.next())) {
+            chunks.push_back(*chunk);
+        }
+        THEN("Chunks concatenate to the input")
+        {
+            REQUIRE(std::accumulate(chunks.begin(), chunks.end(), std::string{}) == input);
+        }
+        AND_THEN("Every chunk ends with the content of a record")
+        {
+            std::size_t end = 0;
+            for (std::size_t pos = 0; pos + 1 < chunks.size(); ++pos) {
+                end += chunks[pos].size();
+                REQUIRE(record_ends.count(end) == 1);
+            }
+        }
+        AND_THEN("Chunks are at least as large as requested, except for the last one")
+        {
+            for (std::size_t pos = 0; pos + 1 < chunks.size(); ++pos) {
+                REQUIRE(chunks[pos].size() >= chunk_size);
+            }
+        }
+    }
+}
+
+TEST_CASE("Find record boundaries", "[parsing][forward_index][unit]")
+{
+    auto plaintext = *record_boundary("plaintext");
+    REQUIRE(plaintext("a b\nc d\ne", 1) == std::optional<std::size_t>(4));
+    REQUIRE(plaintext("a b\nc d\ne", 4) == std::optional<std::size_t>(4));
+    REQUIRE(plaintext("a b\nc d\ne", 5) == std::optional<std::size_t>(8));
+    REQUIRE(plaintext("a b\nc d\ne", 9) == std::nullopt);
+
+    auto trec = *record_boundary("trecweb");
+    std::string input = "<DOC>\na\n<DOC>\n</DOC>\n<DOC>\nb\n</DOC>\n";
+    REQUIRE(trec(input, 1) == std::optional<std::size_t>(21));
+    REQUIRE(trec(input, 23) == std::optional<std::size_t>(input.size()));
+    REQUIRE(trec(input.substr(0, 20), 1) == std::nullopt);
+
+    auto warc = *record_boundary("warc");
+    std::string record = "WARC/1.0\r\nContent-Length: 10\r\n\r\nWARC/1.0\r\n";
+    REQUIRE(warc(record, 1) == std::optional<std::size_t>(record.size()));
+    REQUIRE(warc(record.substr(0, record.size() - 1), 1) == std::nullopt);
+
+    REQUIRE_FALSE(record_boundary("wapo").has_value());
+}
+
+TEST_CASE("Build forward index in chunks", "[parsing][forward_index][integration]")
+{
+    auto identity = [] {
+        return [](std::string&& term) -> std::string { return std::forward<std::string>(term); };
+    };
+    Temporary_Directory tmpdir;
+    auto dir = tmpdir.path();
+
+    auto format = GENERATE(
+        std::string("plaintext"),
+        std::string("trectext"),
+        std::string("trecweb"),
+        std::string("warc"));
+    std::string input = (dir / "input").string();
+    write_collection(format, input);
+
+    std::string expected = (dir / "expected").string();
+    {
+        std::ifstream is(input);
+        Forward_Index_Builder builder;
+        builder.build(
+            is, expected, record_parser(format, is), identity, parse_plaintext_content, 100, 2);
+    }
+    REQUIRE_FALSE(load_lines(expected + ".documents").empty());
+
+    int thread_count = GENERATE(1, 2, 8);
+    std::size_t chunk_size = GENERATE(std::size_t{1}, std::size_t{10'000}, std::size_t{1'000'000});
+    WHEN("Build a forward index from " << format << " with " << thread_count
+                                       << " threads and chunks of " << chunk_size << " bytes")
+    {
+        std::string output = (dir / "fwd").string();
+        std::ifstream is(input);
+        Forward_Index_Builder builder;
+        builder.build_chunked(
+            is, output, format, chunk_size, identity, parse_plaintext_content, thread_count);
+
+        THEN("The result is the same as when reading records one by one")
+        {
+            REQUIRE(load_lines(output + ".documents") == load_lines(expected + ".documents"));
+            REQUIRE(load_lines(output + ".terms") == load_lines(expected + ".terms"));
+            binary_collection coll(output.c_str());
+            binary_collection expected_coll(expected.c_str());
+            auto expected_seq = expected_coll.begin();
+            for (auto seq: coll) {
+                REQUIRE(expected_seq != expected_coll.end());
+                REQUIRE(std::vector<uint32_t>(seq.begin(), seq.end())
+                        == std::vector<uint32_t>(expected_seq->begin(), expected_seq->end()));
+                ++expected_seq;
+            }
+            REQUIRE(expected_seq == expected_coll.end());
+        }
+    }
+}
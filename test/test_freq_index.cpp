@@ -6,9 +6,12 @@
 #include <numeric>
 #include <vector>
 
+#include <tbb/parallel_for.h>
+
 #include "test_generic_sequence.hpp"
 
 #include "freq_index.hpp"
+#include "io.hpp"
 #include "mappable/mapper.hpp"
 #include "memory_source.hpp"
 #include "mio/mmap.hpp"
@@ -78,3 +81,55 @@ TEST_CASE("freq_index")
         uniform_partitioned_sequence<>,
         positive_sequence<uniform_partitioned_sequence<strict_sequence>>>();
 }
+
+TEST_CASE("Posting lists encoded in parallel match sequentially added lists")
+{
+    using collection_type = pisa::freq_index<
+        pisa::partitioned_sequence<>,
+        pisa::positive_sequence<pisa::partitioned_sequence<pisa::strict_sequence>>>;
+    using vec_type = std::vector<uint64_t>;
+
+    Temporary_Directory tmpdir;
+    pisa::global_parameters params;
+    uint64_t universe = 20000;
+    std::vector<std::pair<vec_type, vec_type>> posting_lists(30);
+    for (auto& plist: posting_lists) {
+        double avg_gap = 1.1 + double(rand()) / RAND_MAX * 10;
+        auto n = uint64_t(universe / avg_gap);
+        plist.first = random_sequence(universe, n, true);
+        plist.second.resize(n);
+        std::generate(plist.second.begin(), plist.second.end(), []() { return (rand() % 256) + 1; });
+    }
+    auto sum = [](vec_type const& freqs) {
+        return std::accumulate(freqs.begin(), freqs.end(), uint64_t(0));
+    };
+
+    auto sequential_path = (tmpdir.path() / "sequential.bin").string();
+    {
+        collection_type::builder b(universe, params);
+        for (auto const& [docs, freqs]: posting_lists) {
+            b.add_posting_list(docs.size(), docs.begin(), freqs.begin(), sum(freqs));
+        }
+        collection_type coll;
+        b.build(coll);
+        pisa::mapper::freeze(coll, sequential_path.c_str());
+    }
+
+    auto parallel_path = (tmpdir.path() / "parallel.bin").string();
+    {
+        collection_type::builder b(universe, params);
+        std::vector<collection_type::builder::encoded_posting_list> encoded(posting_lists.size());
+        tbb::parallel_for(size_t(0), posting_lists.size(), [&](size_t i) {
+            auto const& [docs, freqs] = posting_lists[i];
+            b.encode_posting_list(docs.size(), docs.begin(), freqs.begin(), sum(freqs), encoded[i]);
+        });
+        for (auto& list: encoded) {
+            b.add_encoded_posting_list(list);
+        }
+        collection_type coll;
+        b.build(coll);
+        pisa::mapper::freeze(coll, parallel_path.c_str());
+    }
+
+    REQUIRE(pisa::io::load_data(parallel_path) == pisa::io::load_data(sequential_path));
+}
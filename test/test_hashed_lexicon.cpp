@@ -0,0 +1,80 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <rapidcheck.h>
+
+#include "hashed_lexicon.hpp"
+#include "query/term_processor.hpp"
+#include "temporary_directory.hpp"
+
+using namespace pisa;
+
+[[nodiscard]] auto encode(std::vector<std::string> const& terms) -> std::string
+{
+    std::ostringstream os;
+    write_hashed_lexicon(terms, os);
+    return os.str();
+}
+
+TEST_CASE("Hashed lexicon", "[hashed_lexicon][unit]")
+{
+    std::vector<std::string> terms{"obama", "lol", "usa", "tree", "term2", ""};
+    auto bytes = encode(terms);
+    REQUIRE(Hashed_Lexicon::is_hashed_lexicon(bytes));
+    auto lexicon = Hashed_Lexicon::from(bytes);
+    REQUIRE(lexicon.size() == terms.size());
+    for (std::uint32_t id = 0; id < terms.size(); ++id) {
+        CHECK(lexicon.find(terms[id]) == std::make_optional(id));
+        CHECK(lexicon[id] == terms[id]);
+    }
+    CHECK_FALSE(lexicon.find("family").has_value());
+    CHECK_FALSE(lexicon.find("obamas").has_value());
+}
+
+TEST_CASE("Empty hashed lexicon", "[hashed_lexicon][unit]")
+{
+    auto bytes = encode({});
+    auto lexicon = Hashed_Lexicon::from(bytes);
+    REQUIRE(lexicon.size() == 0);
+    REQUIRE_FALSE(lexicon.find("term").has_value());
+}
+
+TEST_CASE("Hashed lexicon rejects duplicates and other formats", "[hashed_lexicon][unit]")
+{
+    REQUIRE_THROWS_AS(encode({"a", "b", "a"}), std::invalid_argument);
+    std::ostringstream os;
+    encode_payload_vector(gsl::make_span(std::vector<std::string>{"a", "b"})).to_stream(os);
+    REQUIRE_FALSE(Hashed_Lexicon::is_hashed_lexicon(os.str()));
+    REQUIRE_THROWS_AS(Hashed_Lexicon::from(os.str()), std::runtime_error);
+}
+
+TEST_CASE("Hashed lexicon finds every term", "[hashed_lexicon][prop]")
+{
+    rc::check([](std::vector<std::string> terms) {
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        auto bytes = encode(terms);
+        auto lexicon = Hashed_Lexicon::from(bytes);
+        for (std::uint32_t id = 0; id < terms.size(); ++id) {
+            RC_ASSERT(lexicon.find(terms[id]) == std::make_optional(id));
+        }
+    });
+}
+
+TEST_CASE("Term processor with hashed lexicon", "[hashed_lexicon][query]")
+{
+    Temporary_Directory tmpdir;
+    auto lexfile = (tmpdir.path() / "lex").string();
+    {
+        std::ofstream os(lexfile);
+        write_hashed_lexicon(std::vector<std::string>{"usa", "tree", "obama", "lol", "term2"}, os);
+    }
+    TermProcessor term_processor(std::make_optional(lexfile), std::nullopt, std::nullopt);
+    CHECK(term_processor("Obama") == std::make_optional(term_id_type{2}));
+    CHECK(term_processor("tree") == std::make_optional(term_id_type{1}));
+    CHECK_FALSE(term_processor("family").has_value());
+}
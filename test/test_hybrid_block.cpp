@@ -0,0 +1,109 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "codec/hybrid_block.hpp"
+
+using namespace pisa;
+
+namespace {
+
+auto random_blocks(std::size_t count) -> std::vector<std::vector<std::uint32_t>>
+{
+    std::mt19937 gen(17);
+    std::vector<std::vector<std::uint32_t>> blocks;
+    for (std::size_t block = 0; block < count; ++block) {
+        auto size = block % 3 == 0 ? 1 + gen() % hybrid_block::block_size : hybrid_block::block_size;
+        auto max_value = 1U << (gen() % 20);
+        std::vector<std::uint32_t> values(size);
+        std::generate(values.begin(), values.end(), [&] { return gen() % max_value; });
+        blocks.push_back(std::move(values));
+    }
+    return blocks;
+}
+
+auto encoded_size(hybrid_codec codec, std::vector<std::uint32_t> const& values) -> std::size_t
+{
+    std::vector<std::uint8_t> encoded;
+    hybrid_block::encode(codec, values.data(), std::uint32_t(-1), values.size(), encoded);
+    return encoded.size();
+}
+
+}  // namespace
+
+TEST_CASE("Parse hybrid codec names", "[hybrid][unit]")
+{
+    for (auto codec: hybrid_codecs) {
+        REQUIRE(parse_hybrid_codec(to_string(codec)) == codec);
+    }
+    REQUIRE_FALSE(parse_hybrid_codec("qmx").has_value());
+}
+
+TEST_CASE("Read hybrid predictors", "[hybrid][unit]")
+{
+    std::istringstream is("simdbp bias 10 n 0.5\n\nvarintgb n 2\n");
+    auto predictors = read_hybrid_predictors(is);
+    time_prediction::feature_vector features;
+    features[time_prediction::feature_type::n] = 128;
+    REQUIRE(predictors[static_cast<std::size_t>(hybrid_codec::simdbp)](features) == 74);
+    REQUIRE(predictors[static_cast<std::size_t>(hybrid_codec::optpfor)](features) == 0);
+    REQUIRE(predictors[static_cast<std::size_t>(hybrid_codec::varintgb)](features) == 256);
+
+    std::istringstream unknown_codec("qmx bias 1\n");
+    REQUIRE_THROWS_AS(read_hybrid_predictors(unknown_codec), std::invalid_argument);
+    std::istringstream missing_weight("simdbp bias\n");
+    REQUIRE_THROWS_AS(read_hybrid_predictors(missing_weight), std::invalid_argument);
+    std::istringstream unknown_feature("simdbp speed 1\n");
+    REQUIRE_THROWS_AS(read_hybrid_predictors(unknown_feature), std::invalid_argument);
+}
+
+TEST_CASE("Hybrid blocks are decoded with the selected codec", "[hybrid][unit]")
+{
+    std::istringstream is("optpfor bias 1000\nsimdbp bias 1000\nvarintgb bias 1000\n");
+    auto predictors = read_hybrid_predictors(is);
+    auto blocks = random_blocks(300);
+
+    SECTION("Smallest encoding without time trade-off")
+    {
+        hybrid_selector selector(0, predictors);
+        for (auto const& values: blocks) {
+            std::uint32_t sum_of_values = std::accumulate(values.begin(), values.end(), 0U);
+            std::vector<std::uint8_t> encoded;
+            hybrid_block::encode(selector, values.data(), std::uint32_t(-1), values.size(), encoded);
+            std::size_t smallest = encoded.size();
+            for (auto codec: hybrid_codecs) {
+                smallest = std::min(smallest, encoded_size(codec, values));
+            }
+            REQUIRE(encoded.size() == smallest);
+
+            std::vector<std::uint32_t> decoded(hybrid_block::block_size);
+            auto end = hybrid_block::decode(
+                encoded.data(), decoded.data(), std::uint32_t(-1), values.size());
+            REQUIRE(end == encoded.data() + encoded.size());
+            REQUIRE(std::equal(values.begin(), values.end(), decoded.begin()));
+
+            encoded.clear();
+            hybrid_block::encode(selector, values.data(), sum_of_values, values.size(), encoded);
+            end = hybrid_block::decode(encoded.data(), decoded.data(), sum_of_values, values.size());
+            REQUIRE(end == encoded.data() + encoded.size());
+            REQUIRE(std::equal(values.begin(), values.end(), decoded.begin()));
+        }
+    }
+    SECTION("Fastest codec with a large trade-off")
+    {
+        hybrid_selector selector(1000, predictors);
+        for (auto const& values: blocks) {
+            std::vector<std::uint8_t> encoded;
+            hybrid_block::encode(selector, values.data(), std::uint32_t(-1), values.size(), encoded);
+            REQUIRE(hybrid_block::codec(encoded.data()) == hybrid_codec::streamvbyte);
+
+            std::vector<std::uint32_t> decoded(hybrid_block::block_size);
+            hybrid_block::decode(encoded.data(), decoded.data(), std::uint32_t(-1), values.size());
+            REQUIRE(std::equal(values.begin(), values.end(), decoded.begin()));
+        }
+    }
+}
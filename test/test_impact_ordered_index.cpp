@@ -0,0 +1,151 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "accumulator/lazy_accumulator.hpp"
+#include "accumulator/simple_accumulator.hpp"
+#include "configuration.hpp"
+#include "impact_ordered_index.hpp"
+#include "index_types.hpp"
+#include "io.hpp"
+#include "linear_quantizer.hpp"
+#include "pisa_config.hpp"
+#include "query/algorithm/ranked_or_saat_query.hpp"
+#include "query/queries.hpp"
+#include "temporary_directory.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+TEMPLATE_TEST_CASE(
+    "Impact-ordered index", "[index][saat]", pisa::simdbp_block, pisa::interpolative_block)
+{
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    wand_type wdata(
+        sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        ScorerParams("bm25"),
+        BlockSize(FixedBlock(64)),
+        false,
+        std::unordered_set<size_t>{});
+    auto scorer = scorer::from_params(ScorerParams("bm25"), wdata);
+    LinearQuantizer quantizer(wdata.index_max_term_weight(), configuration::get().quantization_bits);
+
+    Temporary_Directory tmp;
+    auto index_path = (tmp.path() / "index").string();
+    {
+        impact_ordered_index<TestType> index;
+        build_impact_ordered_index(collection, wdata, ScorerParams("bm25"), index);
+        mapper::freeze(index, index_path.c_str());
+    }
+    impact_ordered_index<TestType> index(MemorySource::mapped_file(index_path));
+    REQUIRE(index.size() == collection.size());
+    REQUIRE(index.num_docs() == collection.num_docs());
+
+    std::vector<std::unordered_map<std::uint32_t, std::uint32_t>> impacts;
+    for (auto const& seq: collection) {
+        auto term_scorer = scorer->term_scorer(impacts.size());
+        auto& list_impacts = impacts.emplace_back();
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            auto doc = seq.docs.begin()[pos];
+            list_impacts[doc] = quantizer(term_scorer(doc, seq.freqs.begin()[pos]));
+        }
+    }
+
+    SECTION("Lists are segments of documents with equal impact")
+    {
+        for (std::size_t term = 0; term < index.size(); ++term) {
+            auto segments = index.segments(term);
+            std::size_t postings = 0;
+            for (std::size_t pos = 0; pos < segments.size(); ++pos) {
+                if (pos > 0) {
+                    REQUIRE(segments[pos].impact < segments[pos - 1].impact);
+                }
+                std::int64_t last = -1;
+                segments[pos].for_each([&](auto doc) {
+                    REQUIRE(static_cast<std::int64_t>(doc) > last);
+                    REQUIRE(impacts[term].at(doc) == segments[pos].impact);
+                    last = doc;
+                    postings += 1;
+                });
+                REQUIRE(postings > 0);
+            }
+            REQUIRE(postings == impacts[term].size());
+        }
+    }
+
+    std::vector<Query> queries;
+    std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+    auto push_query = [&](std::string const& query_line) {
+        queries.push_back(parse_query_ids(query_line));
+    };
+    io::for_each_line(qfile, push_query);
+
+    SECTION("Without budget, results are exhaustive")
+    {
+        Simple_Accumulator simple(index.num_docs());
+        Lazy_Accumulator<4> lazy(index.num_docs());
+        for (auto const& query: queries) {
+            std::unordered_map<std::uint32_t, float> scores;
+            for (auto [term, freq]: query_freqs(query.terms)) {
+                for (auto [doc, impact]: impacts[term]) {
+                    scores[doc] += impact;
+                }
+            }
+            topk_queue expected(10);
+            for (auto [doc, score]: scores) {
+                expected.insert(score, doc);
+            }
+            expected.finalize();
+
+            topk_queue simple_topk(10);
+            ranked_or_saat_query simple_q(simple_topk);
+            simple_q(make_impact_segments(index, query), simple);
+            simple_topk.finalize();
+            topk_queue lazy_topk(10);
+            ranked_or_saat_query lazy_q(lazy_topk);
+            lazy_q(make_impact_segments(index, query), lazy);
+            lazy_topk.finalize();
+
+            for (auto const* actual: {&simple_topk, &lazy_topk}) {
+                REQUIRE(actual->topk().size() == expected.topk().size());
+                for (std::size_t i = 0; i < expected.topk().size(); ++i) {
+                    REQUIRE(actual->topk()[i].first == expected.topk()[i].first);
+                }
+            }
+            std::uint64_t postings = 0;
+            for (auto [term, freq]: query_freqs(query.terms)) {
+                postings += impacts[term].size();
+            }
+            REQUIRE(simple_q.processed_postings() == postings);
+        }
+    }
+
+    SECTION("Processing stops after the postings budget")
+    {
+        Simple_Accumulator accumulator(index.num_docs());
+        std::uint64_t budget = GENERATE(1, 100, 1000);
+        for (auto const& query: queries) {
+            auto segments = make_impact_segments(index, query);
+            std::uint64_t total = 0;
+            std::uint64_t largest = 0;
+            for (auto const& segment: segments) {
+                total += segment.size;
+                largest = std::max<std::uint64_t>(largest, segment.size);
+            }
+            topk_queue topk(10);
+            ranked_or_saat_query saat_q(topk, budget);
+            saat_q(std::move(segments), accumulator);
+            topk.finalize();
+            REQUIRE(saat_q.processed_postings() <= std::min(total, budget + largest));
+            REQUIRE(saat_q.processed_postings() >= std::min(total, budget));
+        }
+    }
+}
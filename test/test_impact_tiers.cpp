@@ -0,0 +1,139 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+#include <limits>
+
+#include <tbb/task_scheduler_init.h>
+
+#include "cursor/block_max_scored_cursor.hpp"
+#include "impact_tiers.hpp"
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "query/algorithm/block_max_wand_query.hpp"
+#include "query/algorithm/two_tier_block_max_wand_query.hpp"
+#include "query/queries.hpp"
+#include "temporary_directory.hpp"
+#include "test_index_common.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+TEMPLATE_TEST_CASE("Split posting lists into impact tiers", "[index][tiers]", block_simdbp_index, ef_index)
+{
+    tbb::task_scheduler_init init;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    Temporary_Directory tmp;
+    auto path = [&](auto name) { return (tmp.path() / name).string(); };
+
+    build_wand_data<wand_type>(basename, path("wand"));
+    ImpactTierOptions options;
+    options.ratio = 0.2;
+    options.min_length = 100;
+    auto stats = split_impact_tiers<wand_type>(
+        basename,
+        path("tiered"),
+        path("wand"),
+        path("tiered.wand"),
+        ScorerParams("bm25"),
+        FixedBlock(5),
+        false,
+        options);
+    REQUIRE(stats.split_terms > 0);
+
+    binary_freq_collection tiered(path("tiered").c_str());
+    auto tiers = impact_tiers::from_file(path("tiered.tiers"));
+    wand_type wdata(MemorySource::mapped_file(path("wand")));
+    wand_type tiered_wdata(MemorySource::mapped_file(path("tiered.wand")));
+    auto scorer = scorer::from_params(ScorerParams("bm25"), wdata);
+    auto tiered_scorer = scorer::from_params(ScorerParams("bm25"), tiered_wdata);
+    REQUIRE(tiers.term_count() == collection.size());
+    REQUIRE(tiered.size() == collection.size() + stats.split_terms);
+    REQUIRE(tiered_wdata.num_terms() == tiered.size());
+
+    SECTION("Tiers partition the postings of each list by score")
+    {
+        std::vector<binary_freq_collection::sequence> lists(tiered.begin(), tiered.end());
+        std::uint32_t term = 0;
+        for (auto const& seq: collection) {
+            auto high = lists[term];
+            auto low = tiers.low_tier(term);
+            if (seq.docs.size() <= options.min_length) {
+                REQUIRE_FALSE(low);
+            }
+            auto term_scorer = scorer->term_scorer(term);
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> postings;
+            float min_high_score = std::numeric_limits<float>::max();
+            for (std::size_t pos = 0; pos < high.docs.size(); ++pos) {
+                postings.emplace_back(high.docs.begin()[pos], high.freqs.begin()[pos]);
+                min_high_score = std::min(
+                    min_high_score, term_scorer(high.docs.begin()[pos], high.freqs.begin()[pos]));
+            }
+            if (low) {
+                auto const& low_seq = lists[*low];
+                REQUIRE(high.docs.size() >= std::ceil(options.ratio * seq.docs.size()));
+                for (std::size_t pos = 0; pos < low_seq.docs.size(); ++pos) {
+                    auto doc = low_seq.docs.begin()[pos];
+                    auto freq = low_seq.freqs.begin()[pos];
+                    postings.emplace_back(doc, freq);
+                    REQUIRE(term_scorer(doc, freq) < min_high_score);
+                    REQUIRE(
+                        tiered_scorer->term_scorer(*low)(doc, freq)
+                        == Approx(term_scorer(doc, freq)));
+                }
+            }
+            std::sort(postings.begin(), postings.end());
+            REQUIRE(postings.size() == seq.docs.size());
+            for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                REQUIRE(postings[pos].first == seq.docs.begin()[pos]);
+                REQUIRE(postings[pos].second == seq.freqs.begin()[pos]);
+            }
+            term += 1;
+        }
+    }
+
+    SECTION("Two-tier BMW returns the same scores as BMW")
+    {
+        build_index<TestType>(collection, path("index"));
+        build_index<TestType>(tiered, path("tiered.index"));
+        TestType index(MemorySource::mapped_file(path("index")));
+        TestType tiered_index(MemorySource::mapped_file(path("tiered.index")));
+
+        std::vector<Query> queries;
+        std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+        auto push_query = [&](std::string const& query_line) {
+            queries.push_back(parse_query_ids(query_line));
+        };
+        io::for_each_line(qfile, push_query);
+
+        for (auto const& query: queries) {
+            topk_queue expected(10);
+            block_max_wand_query bmw_q(expected);
+            bmw_q(make_block_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+            expected.finalize();
+
+            topk_queue actual(10);
+            two_tier_block_max_wand_query two_tier_q(actual);
+            two_tier_q(
+                make_block_max_scored_cursors(tiered_index, tiered_wdata, *tiered_scorer, query),
+                make_block_max_scored_cursors(
+                    tiered_index, tiered_wdata, *tiered_scorer, tiers.low_tiers(query)),
+                [&] {
+                    return make_block_max_scored_cursors(
+                        tiered_index, tiered_wdata, *tiered_scorer, tiers.all_tiers(query));
+                },
+                tiered_index.num_docs());
+            actual.finalize();
+
+            REQUIRE(actual.topk().size() == expected.topk().size());
+            for (size_t i = 0; i < expected.topk().size(); ++i) {
+                REQUIRE(
+                    actual.topk()[i].first
+                    == Approx(expected.topk()[i].first).epsilon(0.01));  // tolerance is %
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <unordered_set>
+
+#include <fmt/format.h>
+
+#include "binary_collection.hpp"
+#include "binary_freq_collection.hpp"
+#include "global_parameters.hpp"
+#include "mappable/mapper.hpp"
+#include "scorer/scorer.hpp"
+#include "wand_data.hpp"
+
+/// Compresses `collection` with `Index` and writes it to `output`.
+template <typename Index>
+void build_index(pisa::binary_freq_collection const& collection, std::string const& output)
+{
+    typename Index::builder builder(collection.num_docs(), pisa::global_parameters{});
+    for (auto const& plist: collection) {
+        uint64_t freqs_sum = std::accumulate(plist.freqs.begin(), plist.freqs.end(), uint64_t(0));
+        builder.add_posting_list(
+            plist.docs.size(), plist.docs.begin(), plist.freqs.begin(), freqs_sum);
+    }
+    Index index;
+    builder.build(index);
+    pisa::mapper::freeze(index, output.c_str());
+}
+
+/// Builds unquantized BM25 WAND data with fixed blocks of 5 postings for the collection at
+/// `basename` and writes it to `output`.
+template <typename Wand>
+void build_wand_data(std::string const& basename, std::string const& output)
+{
+    pisa::binary_freq_collection collection(basename.c_str());
+    pisa::binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    Wand wdata(
+        sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        ScorerParams("bm25"),
+        pisa::BlockSize(pisa::FixedBlock(5)),
+        false,
+        std::unordered_set<size_t>{});
+    pisa::mapper::freeze(wdata, output.c_str());
+}
@@ -0,0 +1,135 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+
+#include <tbb/task_scheduler_init.h>
+
+#include "index_types.hpp"
+#include "io.hpp"
+#include "merge_index.hpp"
+#include "payload_vector.hpp"
+#include "pisa_config.hpp"
+#include "temporary_directory.hpp"
+#include "test_index_common.hpp"
+#include "util/inverted_index_utils.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+/// Writes documents in `[first, last)` as a collection with document IDs starting from 0,
+/// skipping terms that do not occur in it. Returns the term ID of each input term in the new
+/// collection.
+auto split_collection(
+    binary_freq_collection const& collection,
+    binary_collection const& sizes,
+    std::uint32_t first,
+    std::uint32_t last,
+    std::string const& basename) -> std::vector<std::uint32_t>
+{
+    std::ofstream docs(fmt::format("{}.docs", basename));
+    std::ofstream freqs(fmt::format("{}.freqs", basename));
+    std::ofstream lengths(fmt::format("{}.sizes", basename));
+    emit(docs, 1);
+    emit(docs, last - first);
+    std::vector<std::uint32_t> mapping;
+    std::uint32_t term_count = 0;
+    for (auto const& seq: collection) {
+        std::vector<std::uint32_t> part_docs;
+        std::vector<std::uint32_t> part_freqs;
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            auto doc = seq.docs.begin()[pos];
+            if (doc >= first && doc < last) {
+                part_docs.push_back(doc - first);
+                part_freqs.push_back(seq.freqs.begin()[pos]);
+            }
+        }
+        if (part_docs.empty()) {
+            mapping.push_back(ABSENT_TERM);
+            continue;
+        }
+        emit(docs, part_docs.size());
+        emit(docs, part_docs.data(), part_docs.size());
+        emit(freqs, part_freqs.size());
+        emit(freqs, part_freqs.data(), part_freqs.size());
+        mapping.push_back(term_count++);
+    }
+    emit(lengths, last - first);
+    emit(lengths, sizes.begin()->begin() + first, last - first);
+    return mapping;
+}
+
+TEMPLATE_TEST_CASE(
+    "Merge compressed indexes",
+    "[index][merge]",
+    block_simdbp_index,
+    block_varintgb_index,
+    pefopt_index,
+    ef_index)
+{
+    tbb::task_scheduler_init init;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    Temporary_Directory tmp;
+    auto path = [&](auto name) { return (tmp.path() / name).string(); };
+
+    build_index<TestType>(collection, path("expected"));
+    build_wand_data<wand_type>(basename, path("expected.wand"));
+
+    auto split = GENERATE(std::vector<std::uint32_t>{0, 1000, 2000}, std::vector<std::uint32_t>{0, 1});
+    split.push_back(collection.num_docs());
+    std::vector<std::string> indexes;
+    std::vector<std::string> wands;
+    TermMapping term_mapping;
+    for (std::size_t part = 0; part + 1 < split.size(); ++part) {
+        auto part_basename = path(fmt::format("part{}", part));
+        term_mapping.push_back(
+            split_collection(collection, sizes, split[part], split[part + 1], part_basename));
+        build_index<TestType>(binary_freq_collection(part_basename.c_str()), part_basename);
+        build_wand_data<wand_type>(part_basename, part_basename + ".wand");
+        indexes.push_back(part_basename);
+        wands.push_back(part_basename + ".wand");
+    }
+
+    merge_indexes<TestType, wand_type>(
+        indexes,
+        path("actual"),
+        term_mapping,
+        MergeWandOptions{
+            .inputs = wands,
+            .output = path("actual.wand"),
+            .scorer_params = ScorerParams("bm25"),
+            .block_size = FixedBlock(5),
+            .quantize = false,
+        },
+        1000);
+
+    REQUIRE(io::load_data(path("actual")) == io::load_data(path("expected")));
+    REQUIRE(io::load_data(path("actual.wand")) == io::load_data(path("expected.wand")));
+}
+
+TEST_CASE("Merge term lexicons", "[index][merge]")
+{
+    Temporary_Directory tmp;
+    auto path = [&](auto name) { return (tmp.path() / name).string(); };
+    std::vector<std::vector<std::string>> lexicons{{"a", "c", "d"}, {"b", "c"}, {"d", "e"}};
+    std::vector<std::string> files;
+    for (std::size_t part = 0; part < lexicons.size(); ++part) {
+        files.push_back(path(fmt::format("lex{}", part)));
+        encode_payload_vector(gsl::span<std::string const>(lexicons[part])).to_file(files.back());
+    }
+
+    auto mapping = merge_term_lexicons(files, path("merged"));
+
+    auto buffer = Payload_Vector_Buffer::from_file(path("merged"));
+    auto merged = Payload_Vector<std::string>(buffer);
+    REQUIRE(
+        std::vector<std::string>(merged.begin(), merged.end())
+        == std::vector<std::string>{"a", "b", "c", "d", "e"});
+    auto absent = ABSENT_TERM;
+    REQUIRE(mapping[0] == std::vector<std::uint32_t>{0, absent, 1, 2, absent});
+    REQUIRE(mapping[1] == std::vector<std::uint32_t>{absent, 0, 1, absent, absent});
+    REQUIRE(mapping[2] == std::vector<std::uint32_t>{absent, absent, absent, 0, 1});
+}
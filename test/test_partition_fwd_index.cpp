@@ -89,6 +89,27 @@ TEST_CASE("mapping_from_files", "[invert][unit]")
         == std::vector<Shard_Id>{0_s, 0_s, 0_s, 1_s, 1_s, 0_s, 2_s, 2_s, 2_s, 2_s, 2_s, 2_s});
 }
 
+TEST_CASE("global_document_ids", "[invert][unit]")
+{
+    std::istringstream full("D00\nD01\nD02\nD03\nD04\nD05");
+    std::vector<std::unique_ptr<std::istream>> shards;
+    shards.push_back(std::make_unique<std::istringstream>("D00\nD03\nD05"));
+    shards.push_back(std::make_unique<std::istringstream>("D04\nD01\nD02"));
+    auto stream_pointers =
+        ranges::views::transform(shards, [](auto const& s) { return s.get(); }) | ranges::to_vector;
+    auto docids = global_document_ids(&full, gsl::span<std::istream*>(stream_pointers));
+    REQUIRE(docids.size() == 2);
+    REQUIRE(docids[0_s] == std::vector<Document_Id>{0_d, 3_d, 5_d});
+    REQUIRE(docids[1_s] == std::vector<Document_Id>{4_d, 1_d, 2_d});
+
+    std::istringstream partial("D00\nD01");
+    std::istringstream missing("D00\nD07");
+    std::vector<std::istream*> missing_pointers{&missing};
+    REQUIRE_THROWS_AS(
+        global_document_ids(&partial, gsl::span<std::istream*>(missing_pointers)),
+        std::invalid_argument);
+}
+
 TEST_CASE("create_random_mapping", "[invert][unit]")
 {
     uint64_t seed = 88887;
@@ -0,0 +1,216 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+#include <unordered_set>
+
+#include <tbb/task_scheduler_init.h>
+
+#include "binary_freq_collection.hpp"
+#include "hashed_lexicon.hpp"
+#include "io.hpp"
+#include "memory_source.hpp"
+#include "payload_vector.hpp"
+#include "pisa_config.hpp"
+#include "prune_index.hpp"
+#include "temporary_directory.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+using posting_type = std::pair<std::uint32_t, std::uint32_t>;
+
+auto read_lists(binary_freq_collection const& collection)
+    -> std::vector<std::vector<posting_type>>
+{
+    std::vector<std::vector<posting_type>> lists;
+    for (auto const& seq: collection) {
+        auto& list = lists.emplace_back();
+        for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+            list.emplace_back(seq.docs.begin()[pos], seq.freqs.begin()[pos]);
+        }
+    }
+    return lists;
+}
+
+TEST_CASE("Prune inverted index", "[prune]")
+{
+    tbb::task_scheduler_init init;
+    std::string input(PISA_SOURCE_DIR "/test/test_data/test_collection");
+    binary_freq_collection collection(input.c_str());
+    binary_collection sizes((input + ".sizes").c_str());
+    wand_data<wand_data_raw> wdata(
+        sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        ScorerParams("bm25"),
+        BlockSize(FixedBlock(64)),
+        false,
+        {});
+    auto scorer = scorer::from_params(ScorerParams("bm25"), wdata);
+    auto score = [&](std::size_t term, posting_type posting) {
+        return scorer->term_scorer(term)(posting.first, posting.second);
+    };
+    Temporary_Directory tmp;
+    auto output = (tmp.path() / "pruned").string();
+    auto original_lists = read_lists(collection);
+
+    auto prune = [&](PruningOptions const& options, std::unordered_set<std::size_t>& terms_to_drop) {
+        auto stats = prune_inverted_index(input, output, *scorer, options, terms_to_drop);
+        binary_freq_collection pruned(output.c_str());
+        REQUIRE(pruned.num_docs() == collection.num_docs());
+        REQUIRE(io::load_data(output + ".sizes") == io::load_data(input + ".sizes"));
+        auto pruned_lists = read_lists(pruned);
+        REQUIRE(pruned_lists.size() + terms_to_drop.size() == original_lists.size());
+        REQUIRE(stats.dropped_terms == terms_to_drop.size());
+        std::vector<std::vector<posting_type>> lists;
+        auto it = pruned_lists.begin();
+        std::uint64_t postings = 0;
+        for (std::size_t term = 0; term < original_lists.size(); ++term) {
+            if (terms_to_drop.count(term) > 0) {
+                lists.emplace_back();
+            } else {
+                REQUIRE(std::includes(
+                    original_lists[term].begin(),
+                    original_lists[term].end(),
+                    it->begin(),
+                    it->end()));
+                postings += it->size();
+                lists.push_back(*it++);
+            }
+        }
+        REQUIRE(stats.output_postings == postings);
+        return lists;
+    };
+
+    SECTION("Global")
+    {
+        float threshold = 3.0F;
+        std::unordered_set<std::size_t> terms_to_drop;
+        auto lists = prune(PruningOptions{PruningStrategy::Global, threshold}, terms_to_drop);
+        REQUIRE(not terms_to_drop.empty());
+        for (std::size_t term = 0; term < lists.size(); ++term) {
+            for (auto posting: original_lists[term]) {
+                bool kept = std::binary_search(lists[term].begin(), lists[term].end(), posting);
+                REQUIRE(kept == (score(term, posting) >= threshold));
+            }
+        }
+    }
+
+    SECTION("Term-centric")
+    {
+        PruningOptions options{PruningStrategy::TermCentric};
+        options.k = 10;
+        options.epsilon = 0.7F;
+        std::unordered_set<std::size_t> terms_to_drop;
+        auto lists = prune(options, terms_to_drop);
+        REQUIRE(terms_to_drop.empty());
+        for (std::size_t term = 0; term < lists.size(); ++term) {
+            if (original_lists[term].size() <= options.k) {
+                REQUIRE(lists[term] == original_lists[term]);
+                continue;
+            }
+            std::vector<float> scores;
+            for (auto posting: original_lists[term]) {
+                scores.push_back(score(term, posting));
+            }
+            std::sort(scores.begin(), scores.end(), std::greater<>{});
+            auto threshold = options.epsilon * scores[options.k - 1];
+            REQUIRE(lists[term].size() >= options.k);
+            for (auto posting: original_lists[term]) {
+                bool kept = std::binary_search(lists[term].begin(), lists[term].end(), posting);
+                REQUIRE(kept == (score(term, posting) >= threshold));
+            }
+        }
+    }
+
+    SECTION("Document-centric")
+    {
+        auto ratio = GENERATE(0.3F, 1.0F);
+        std::unordered_set<std::size_t> terms_to_drop;
+        auto lists = prune(
+            PruningOptions{PruningStrategy::DocumentCentric, 0.0F, 0, 0.0F, ratio}, terms_to_drop);
+        std::vector<std::uint32_t> original_counts(collection.num_docs(), 0);
+        std::vector<std::uint32_t> counts(collection.num_docs(), 0);
+        for (std::size_t term = 0; term < lists.size(); ++term) {
+            for (auto posting: original_lists[term]) {
+                original_counts[posting.first] += 1;
+            }
+            for (auto posting: lists[term]) {
+                counts[posting.first] += 1;
+            }
+        }
+        for (std::size_t doc = 0; doc < counts.size(); ++doc) {
+            REQUIRE(counts[doc] >= std::ceil(ratio * original_counts[doc]));
+        }
+        if (ratio == 1.0F) {
+            REQUIRE(lists == original_lists);
+        } else {
+            REQUIRE(std::accumulate(counts.begin(), counts.end(), 0UL)
+                    < std::accumulate(original_counts.begin(), original_counts.end(), 0UL));
+        }
+    }
+
+    SECTION("Pruned term lexicon")
+    {
+        std::vector<std::string> terms;
+        for (std::size_t term = 0; term < collection.size(); ++term) {
+            terms.push_back(fmt::format("term{:06}", term));
+        }
+        std::unordered_set<std::size_t> terms_to_drop;
+        prune(PruningOptions{PruningStrategy::Global, 3.0F}, terms_to_drop);
+        std::vector<std::string> expected;
+        for (std::size_t term = 0; term < terms.size(); ++term) {
+            if (terms_to_drop.count(term) == 0) {
+                expected.push_back(terms[term]);
+            }
+        }
+        auto input_lexicon = (tmp.path() / "input.termlex").string();
+        auto output_lexicon = (tmp.path() / "pruned.termlex").string();
+        bool hashed = GENERATE(false, true);
+        if (hashed) {
+            std::ofstream os(input_lexicon, std::ios::binary);
+            write_hashed_lexicon(gsl::make_span(terms), os);
+        } else {
+            encode_payload_vector(gsl::make_span(terms)).to_file(input_lexicon);
+        }
+        write_pruned_lexicon(input_lexicon, output_lexicon, collection.size(), terms_to_drop);
+
+        auto source = MemorySource::mapped_file(output_lexicon);
+        REQUIRE(Hashed_Lexicon::is_hashed_lexicon(source) == hashed);
+        if (hashed) {
+            auto lexicon = Hashed_Lexicon::from(source);
+            REQUIRE(lexicon.size() == expected.size());
+            for (std::uint32_t term = 0; term < expected.size(); ++term) {
+                REQUIRE(lexicon.find(expected[term]) == std::optional<std::uint32_t>(term));
+            }
+        } else {
+            auto lexicon = Payload_Vector<>::from(source);
+            REQUIRE(std::vector<std::string>(lexicon.begin(), lexicon.end()) == expected);
+        }
+        REQUIRE_THROWS_AS(
+            write_pruned_lexicon(input_lexicon, output_lexicon, collection.size() + 1, terms_to_drop),
+            std::invalid_argument);
+    }
+
+    SECTION("Top-k overlap")
+    {
+        std::vector<Query> queries;
+        std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+        io::for_each_line(
+            qfile, [&](std::string const& line) { queries.push_back(parse_query_ids(line)); });
+        std::unordered_set<std::size_t> terms_to_drop;
+        PruningOptions options{PruningStrategy::TermCentric};
+        options.epsilon = 0.0F;
+        prune_inverted_index(input, output, *scorer, options, terms_to_drop);
+        binary_freq_collection pruned(output.c_str());
+        REQUIRE(topk_overlap(collection, pruned, terms_to_drop, *scorer, queries, 10) == 1.0);
+
+        options.epsilon = 0.9F;
+        prune_inverted_index(input, output, *scorer, options, terms_to_drop);
+        binary_freq_collection more_pruned(output.c_str());
+        auto overlap = topk_overlap(collection, more_pruned, terms_to_drop, *scorer, queries, 10);
+        REQUIRE(overlap < 1.0);
+        REQUIRE(overlap > 0.0);
+    }
+}
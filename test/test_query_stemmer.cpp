@@ -2,6 +2,7 @@
 #include "catch2/catch.hpp"
 #include "parser.hpp"
 #include "query/query_stemmer.hpp"
+#include "query/stemming_cache.hpp"
 #include <string>
 
 using namespace pisa;
@@ -16,3 +17,37 @@ TEST_CASE("Stem query", "[stemming][unit]")
     QueryStemmer query_stemmer("porter2");
     GIVEN("Input: " << input) { CHECK(query_stemmer(input) == expected); }
 }
+
+TEST_CASE("Stemming cache", "[stemming][unit]")
+{
+    std::size_t transform_calls = 0;
+    auto transform = [&](std::string const& term) {
+        ++transform_calls;
+        return term.substr(0, 3);
+    };
+    auto global_before = StemmingCache::global_stats();
+    {
+        StemmingCache cache(GENERATE(std::size_t{1}, std::size_t{1000}));
+        REQUIRE(cache.get("playing", transform) == "pla");
+        REQUIRE(cache.get("playing", transform) == "pla");
+        REQUIRE(cache.get("cards", transform) == "car");
+        REQUIRE(cache.get("cards", transform) == "car");
+        REQUIRE(transform_calls == 2);
+        REQUIRE(cache.stats().hits == 2);
+        REQUIRE(cache.stats().misses == 2);
+        REQUIRE(cache.stats().hit_rate() == Approx(0.5));
+    }
+    auto global_after = StemmingCache::global_stats();
+    REQUIRE(global_after.hits - global_before.hits == 2);
+    REQUIRE(global_after.misses - global_before.misses == 2);
+}
+
+TEST_CASE("Stemmer results do not depend on caching", "[stemming][unit]")
+{
+    auto stemmer =
+        term_transformer_builder(GENERATE(std::string("porter2"), std::string("krovetz")))();
+    for (int repeat = 0; repeat < 2; ++repeat) {
+        REQUIRE(stemmer("playing") == stemmer("play"));
+        REQUIRE(stemmer("Cards") == stemmer("card"));
+    }
+}
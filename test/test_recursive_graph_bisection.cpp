@@ -1,5 +1,7 @@
 #define CATCH_CONFIG_MAIN
 
+#include <random>
+
 #include <catch2/catch.hpp>
 
 #include "pisa/forward_index_builder.hpp"
@@ -113,6 +115,47 @@ TEST_CASE("Reorder documents with BP")
             }
         }
 
+        WHEN("Reordered documents with BP out of core")
+        {
+            auto max_postings = GENERATE(std::size_t(20'000), std::size_t(100'000));
+            RecursiveGraphBisectionOptions options{
+                .input_basename = inv_path,
+                .output_basename = bp_inv_path,
+                .output_fwd = std::nullopt,
+                .input_fwd = std::nullopt,
+                .document_lexicon = fmt::format("{}.doclex", fwd_path),
+                .reordered_document_lexicon = fmt::format("{}.doclex", bp_fwd_path),
+                .depth = 8,
+                .node_config = std::nullopt,
+                .min_length = 0,
+                .compress_fwd = false,
+                .print_args = false,
+                .max_postings = max_postings,
+            };
+            int code = recursive_graph_bisection(options);
+            REQUIRE(code == 0);
+            THEN("Both collections are equal when mapped to strings")
+            {
+                auto expected = coll_to_strings(inv_path, fmt::format("{}.doclex", fwd_path));
+                auto actual = coll_to_strings(bp_inv_path, fmt::format("{}.doclex", bp_fwd_path));
+                compare_strcolls(expected, actual);
+            }
+            THEN("Several partitions are spilled, one file at a time, and their files removed")
+            {
+                auto result = detail::bisect_out_of_core(options, 1);
+                REQUIRE(result.spilled_partitions > 1);
+                std::vector<std::uint32_t> sorted = result.documents;
+                std::sort(sorted.begin(), sorted.end());
+                for (std::uint32_t doc = 0; doc < sorted.size(); ++doc) {
+                    REQUIRE(sorted[doc] == doc);
+                }
+                for (std::size_t part = 0; part < (1U << 8U); ++part) {
+                    REQUIRE_FALSE(
+                        boost::filesystem::exists(fmt::format("{}.bp.{}", bp_inv_path, part)));
+                }
+            }
+        }
+
         WHEN("Reordered documents with BP node version")
         {
             int code = recursive_graph_bisection(RecursiveGraphBisectionOptions{
@@ -138,3 +181,100 @@ TEST_CASE("Reorder documents with BP")
         }
     }
 }
+
+TEST_CASE("Batched term gains")
+{
+    std::size_t term_count = 10'000;
+    single_init_vector<std::size_t> from_degrees(term_count);
+    single_init_vector<std::size_t> to_degrees(term_count);
+    from_degrees.clear();
+    to_degrees.clear();
+    std::mt19937 gen(1902);
+    for (std::uint32_t term = 0; term < term_count; ++term) {
+        // Include degrees beyond the precomputed logarithm table.
+        from_degrees.set(term, 1 + gen() % (term % 2 == 0 ? 100 : 10'000));
+        if (gen() % 4 != 0) {
+            to_degrees.set(term, gen() % (term % 3 == 0 ? 50 : 10'000));
+        }
+    }
+    std::vector<std::uint32_t> terms(1001);
+    std::generate(terms.begin(), terms.end(), [&] { return gen() % term_count; });
+
+    std::vector<double> gains(terms.size());
+    auto logn1 = pisa::log2(3000);
+    auto logn2 = pisa::log2(2999);
+    auto level = GENERATE(SimdLevel::Baseline, SimdLevel::Avx2);
+    if (level > detected_simd_level()) {
+        return;
+    }
+    bp::term_gains(terms, logn1, logn2, from_degrees, to_degrees, gains.data(), level);
+    for (std::size_t idx = 0; idx < terms.size(); ++idx) {
+        auto term = terms[idx];
+        auto expected = bp::term_gain(logn1, logn2, from_degrees[term], to_degrees[term]);
+        REQUIRE(gains[idx] == Approx(expected).epsilon(1e-3).margin(1e-2));
+    }
+}
+
+TEST_CASE("Count term degrees")
+{
+    std::size_t term_count = 100'000;
+    constexpr std::size_t document_count = bp::PARALLEL_DEGREES_THRESHOLD + 1000;
+    std::mt19937 gen(1902);
+    std::vector<std::vector<std::uint32_t>> documents(document_count);
+    std::vector<std::size_t> expected(term_count, 0);
+    for (auto& terms: documents) {
+        std::size_t length = 1 + gen() % 50;
+        for (std::size_t pos = 0; pos < length; ++pos) {
+            // Skew terms so that some are shared by many documents and most are never seen.
+            terms.push_back((gen() % 1000) * (gen() % 100));
+        }
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        for (auto term: terms) {
+            expected[term] += 1;
+        }
+    }
+    auto flat = flat_forward_index<>::from_postings(document_count, term_count, [&](auto&& fn) {
+        for (std::uint32_t doc = 0; doc < document_count; ++doc) {
+            for (auto term: documents[doc]) {
+                fn(doc, term);
+            }
+        }
+    });
+    std::vector<std::uint32_t> ids(document_count);
+    std::iota(ids.begin(), ids.end(), 0U);
+    std::vector<double> gains(document_count, 0.0);
+    document_range<std::vector<std::uint32_t>::iterator, flat_forward_index<>> range(
+        ids.begin(), ids.end(), flat, gains);
+
+    auto [first, last] = GENERATE(
+        std::make_pair(std::ptrdiff_t(0), std::ptrdiff_t(document_count)),
+        std::make_pair(std::ptrdiff_t(10), std::ptrdiff_t(510)));
+    if (last - first < std::ptrdiff_t(document_count)) {
+        expected.assign(term_count, 0);
+        for (auto doc = first; doc < last; ++doc) {
+            for (auto term: documents[doc]) {
+                expected[term] += 1;
+            }
+        }
+    }
+    auto subrange = range(first, last);
+
+    // Without any counters, degrees are always counted serially.
+    bp::DegreeCounters no_counters(0);
+    single_init_vector<std::size_t> serial_degrees(term_count);
+    serial_degrees.clear();
+    compute_degrees(subrange, serial_degrees, no_counters);
+
+    // The second round reuses the counters reset by the first one.
+    bp::DegreeCounters counters;
+    single_init_vector<std::size_t> degrees(term_count);
+    for (int round = 0; round < 2; ++round) {
+        degrees.clear();
+        compute_degrees(subrange, degrees, counters);
+        for (std::uint32_t term = 0; term < term_count; ++term) {
+            REQUIRE(degrees[term] == expected[term]);
+            REQUIRE(serial_degrees[term] == expected[term]);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <numeric>
+#include <random>
+
+#include <tbb/task_scheduler_init.h>
+
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "reorder_docids.hpp"
+#include "reorder_index.hpp"
+#include "temporary_directory.hpp"
+#include "test_index_common.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+TEMPLATE_TEST_CASE(
+    "Reorder compressed index",
+    "[index][reorder]",
+    block_simdbp_index,
+    block_varintgb_index,
+    pefopt_index,
+    ef_index)
+{
+    tbb::task_scheduler_init init;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    Temporary_Directory tmp;
+    auto path = [&](auto name) { return (tmp.path() / name).string(); };
+
+    std::vector<std::uint32_t> mapping(collection.num_docs());
+    std::iota(mapping.begin(), mapping.end(), 0);
+    std::shuffle(mapping.begin(), mapping.end(), std::mt19937{17});
+
+    GIVEN("Index and WAND data built from the reordered collection")
+    {
+        reorder_sizes(sizes, collection.num_docs(), mapping, path("reordered"));
+        reorder_postings(collection, path("reordered"), mapping);
+        build_index<TestType>(binary_freq_collection(path("reordered").c_str()), path("expected"));
+        build_wand_data<wand_type>(path("reordered"), path("expected.wand"));
+
+        WHEN("Reordering the compressed index and WAND data")
+        {
+            build_index<TestType>(collection, path("index"));
+            build_wand_data<wand_type>(basename, path("index.wand"));
+            reorder_index<TestType, wand_type>(
+                path("index"),
+                path("actual"),
+                mapping,
+                ReorderWandOptions{
+                    .input = path("index.wand"),
+                    .output = path("actual.wand"),
+                    .scorer_params = ScorerParams("bm25"),
+                    .block_size = FixedBlock(5),
+                    .quantize = false,
+                },
+                1000);
+
+            THEN("Both are identical to the ones built from the reordered collection")
+            {
+                REQUIRE(io::load_data(path("actual")) == io::load_data(path("expected")));
+                REQUIRE(
+                    io::load_data(path("actual.wand")) == io::load_data(path("expected.wand")));
+            }
+        }
+    }
+
+    GIVEN("A mapping that is not a permutation")
+    {
+        build_index<TestType>(collection, path("index"));
+        mapping[0] = mapping[1];
+        REQUIRE_THROWS_AS(
+            (reorder_index<TestType, wand_type>(path("index"), path("actual"), mapping, std::nullopt)),
+            std::invalid_argument);
+    }
+}
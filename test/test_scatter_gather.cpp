@@ -0,0 +1,231 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <thread>
+#include <unordered_set>
+
+#include <sys/socket.h>
+
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "query/queries.hpp"
+#include "scatter_gather.hpp"
+#include "selective_search.hpp"
+#include "temporary_directory.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+using namespace pisa::literals;
+
+TEST_CASE("Encode and decode shard messages", "[scatter_gather][unit]")
+{
+    shard_request request{7, 10, {3, 1, 4, 1, 5}};
+    auto decoded_request = decode_request(gsl::make_span(encode_request(request)));
+    REQUIRE(decoded_request.id == request.id);
+    REQUIRE(decoded_request.k == request.k);
+    REQUIRE(decoded_request.terms == request.terms);
+
+    shard_response response{7, {{2.5, 9}, {1.25, 3}}};
+    auto decoded_response = decode_response(gsl::make_span(encode_response(response)));
+    REQUIRE(decoded_response.id == response.id);
+    REQUIRE(decoded_response.topk == response.topk);
+
+    auto bytes = encode_request(request);
+    bytes.pop_back();
+    REQUIRE_THROWS_AS(decode_request(gsl::make_span(bytes)), std::invalid_argument);
+    bytes = encode_response(response);
+    bytes.resize(bytes.size() + 4);
+    REQUIRE_THROWS_AS(decode_response(gsl::make_span(bytes)), std::invalid_argument);
+}
+
+TEST_CASE(
+    "Coordinator does not wait past timeout for partial responses", "[scatter_gather][integration]")
+{
+    Temporary_Directory tmp;
+    auto path = (tmp.path() / "worker").string();
+    auto listener = listen_unix_socket(path);
+    // Sends the first response in two parts, with the second one past the timeout.
+    std::thread worker([&]() {
+        auto connection = accept_connection(listener);
+        bool first = true;
+        while (auto message = read_message(connection)) {
+            auto request = decode_request(gsl::make_span(*message));
+            shard_response response{request.id, {{1.0, request.id}}};
+            if (not first) {
+                write_message(connection, gsl::make_span(encode_response(response)));
+                continue;
+            }
+            first = false;
+            auto bytes = encode_response(response);
+            auto size = static_cast<std::uint32_t>(bytes.size());
+            bytes.insert(bytes.begin(), sizeof(size), 0);
+            std::memcpy(bytes.data(), &size, sizeof(size));
+            auto half = static_cast<ssize_t>(bytes.size() / 2);
+            REQUIRE(::send(connection.fd(), bytes.data(), half, MSG_NOSIGNAL) == half);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            auto rest = static_cast<ssize_t>(bytes.size()) - half;
+            REQUIRE(::send(connection.fd(), bytes.data() + half, rest, MSG_NOSIGNAL) == rest);
+        }
+    });
+    {
+        VecMap<Shard_Id, Socket> connections;
+        connections.push_back(connect_unix_socket(path, std::chrono::milliseconds(1000)));
+        scatter_gather_coordinator coordinator(
+            std::move(connections),
+            VecMap<Shard_Id, std::vector<Document_Id>>{{0_d, 1_d, 2_d}},
+            std::chrono::milliseconds(100));
+        VecMap<Shard_Id, Query> queries{Query{}};
+
+        auto result = coordinator(queries, 10);
+        REQUIRE(result.partial());
+        REQUIRE(result.time < std::chrono::milliseconds(250));
+
+        // Once the worker has sent the rest of the late response, it is read and discarded
+        // before the response to the next query.
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        result = coordinator(queries, 10);
+        REQUIRE_FALSE(result.partial());
+        REQUIRE(result.topk == std::vector<topk_queue::entry_type>{{1.0, 1}});
+    }
+    worker.join();
+}
+
+TEST_CASE("Shard workers skip requests that have timed out", "[scatter_gather][integration]")
+{
+    Temporary_Directory tmp;
+    auto path = (tmp.path() / "worker").string();
+    auto listener = listen_unix_socket(path);
+    // The first request takes long enough for the next two to time out, and the third one to be
+    // sent before the worker is done.
+    std::vector<std::uint32_t> served;
+    std::thread worker([&]() {
+        auto connection = accept_connection(listener);
+        serve_shard_requests(connection, [&](shard_request const& request) {
+            served.push_back(request.id);
+            if (request.id == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            }
+            return shard_response{request.id, {{1.0, request.id}}};
+        });
+    });
+    {
+        VecMap<Shard_Id, Socket> connections;
+        connections.push_back(connect_unix_socket(path, std::chrono::milliseconds(1000)));
+        scatter_gather_coordinator coordinator(
+            std::move(connections),
+            VecMap<Shard_Id, std::vector<Document_Id>>{{0_d, 1_d, 2_d}},
+            std::chrono::milliseconds(200));
+        VecMap<Shard_Id, Query> queries{Query{}};
+        REQUIRE(coordinator(queries, 10).partial());
+        REQUIRE(coordinator(queries, 10).partial());
+        auto result = coordinator(queries, 10);
+        REQUIRE_FALSE(result.partial());
+        REQUIRE(result.topk == std::vector<topk_queue::entry_type>{{1.0, 2}});
+    }
+    worker.join();
+    REQUIRE(served == std::vector<std::uint32_t>{0, 2});
+}
+
+TEST_CASE("Coordinator merges responses of shard workers", "[scatter_gather][integration]")
+{
+    using index_type = block_simdbp_index;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+
+    Temporary_Directory tmp;
+    auto index_path = (tmp.path() / "index").string();
+    auto wand_path = (tmp.path() / "wand").string();
+    {
+        wand_type wdata(
+            sizes.begin()->begin(),
+            collection.num_docs(),
+            collection,
+            ScorerParams("bm25"),
+            BlockSize(FixedBlock(64)),
+            false,
+            std::unordered_set<size_t>{});
+        mapper::freeze(wdata, wand_path.c_str());
+        index_type::builder builder(collection.num_docs(), global_parameters{});
+        for (auto const& plist: collection) {
+            uint64_t freqs_sum =
+                std::accumulate(plist.freqs.begin(), plist.freqs.end(), uint64_t(0));
+            builder.add_posting_list(
+                plist.docs.size(), plist.docs.begin(), plist.freqs.begin(), freqs_sum);
+        }
+        index_type index;
+        builder.build(index);
+        mapper::freeze(index, index_path.c_str());
+    }
+    search_shard<index_type, wand_type> shard(index_path, wand_path, ScorerParams("bm25"));
+
+    std::vector<Query> queries;
+    std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+    auto push_query = [&](std::string const& query_line) {
+        queries.push_back(parse_query_ids(query_line));
+    };
+    io::for_each_line(qfile, push_query);
+
+    // Two workers serving the same shard, whose documents follow each other in the collection.
+    // The second worker delays responses to the queries at odd positions past the timeout.
+    auto handler = [&](bool slow) {
+        return [&, slow](shard_request const& request) {
+            if (slow && request.id % 2 == 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            }
+            Query query;
+            query.terms = request.terms;
+            return shard_response{request.id, shard.search(query, "block_max_wand", request.k)};
+        };
+    };
+    std::vector<std::thread> workers;
+    VecMap<Shard_Id, Socket> connections;
+    VecMap<Shard_Id, std::vector<Document_Id>> global_docids;
+    for (int worker = 0; worker < 2; ++worker) {
+        auto path = (tmp.path() / fmt::format("worker.{}", worker)).string();
+        auto listener = listen_unix_socket(path);
+        workers.emplace_back([&, listener = std::move(listener), slow = worker == 1]() {
+            auto connection = accept_connection(listener);
+            serve_shard_requests(connection, handler(slow));
+        });
+        connections.push_back(connect_unix_socket(path, std::chrono::milliseconds(1000)));
+        auto& docids = global_docids.emplace_back(collection.num_docs());
+        std::iota(docids.begin(), docids.end(), Document_Id(worker * collection.num_docs()));
+    }
+
+    {
+        std::uint32_t k = 10;
+        scatter_gather_coordinator coordinator(
+            std::move(connections), global_docids, std::chrono::milliseconds(200));
+        for (std::size_t idx = 0; idx < std::min<std::size_t>(queries.size(), 6); ++idx) {
+            auto const& query = queries[idx];
+            auto expected = shard.search(query, "block_max_wand", k);
+            auto result = coordinator(VecMap<Shard_Id, Query>{query, query}, k);
+            if (idx % 2 == 1) {
+                REQUIRE(result.partial());
+                REQUIRE(result.shards == std::vector<Shard_Id>{0_s});
+                REQUIRE(result.missing_shards == std::vector<Shard_Id>{1_s});
+                REQUIRE(result.topk.size() == expected.size());
+                for (std::size_t pos = 0; pos < expected.size(); ++pos) {
+                    REQUIRE(result.topk[pos].first == expected[pos].first);
+                }
+            } else {
+                // Waits for the late response to the previous query, which is discarded.
+                REQUIRE_FALSE(result.partial());
+                REQUIRE(result.topk.size() == std::min<std::size_t>(k, 2 * expected.size()));
+                for (std::size_t pos = 0; pos < result.topk.size(); ++pos) {
+                    REQUIRE(result.topk[pos].first == expected[pos / 2].first);
+                }
+            }
+        }
+    }
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
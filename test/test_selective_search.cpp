@@ -0,0 +1,134 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <unordered_set>
+
+#include "cursor/block_max_scored_cursor.hpp"
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "query/algorithm/block_max_wand_query.hpp"
+#include "query/queries.hpp"
+#include "selective_search.hpp"
+#include "temporary_directory.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+using namespace pisa::literals;
+
+TEST_CASE("Select shards", "[selective_search][unit]")
+{
+    std::vector<double> scores{0.5, 0.0, 3.0, 1.0, 3.0};
+    REQUIRE(
+        select_shards(gsl::make_span(scores), 0.0, std::nullopt)
+        == std::vector<Shard_Id>{2_s, 4_s, 3_s, 0_s});
+    REQUIRE(select_shards(gsl::make_span(scores), 0.0, 2) == std::vector<Shard_Id>{2_s, 4_s});
+    REQUIRE(select_shards(gsl::make_span(scores), 0.5, 10) == std::vector<Shard_Id>{2_s, 4_s, 3_s});
+    REQUIRE(select_shards(gsl::make_span(scores), 5.0, std::nullopt).empty());
+}
+
+TEST_CASE("Merge shard results", "[selective_search][unit]")
+{
+    VecMap<Shard_Id, std::vector<Document_Id>> global_docids{
+        {0_d, 2_d, 4_d}, {1_d, 3_d}, {5_d, 6_d}};
+    std::vector<Shard_Id> shards{2_s, 0_s};
+    std::vector<std::vector<topk_queue::entry_type>> results{
+        {{4.0, 1}, {1.0, 0}}, {{3.0, 2}, {2.0, 0}, {0.5, 1}}};
+    auto merged =
+        merge_shard_results(gsl::make_span(shards), gsl::make_span(results), global_docids, 3);
+    REQUIRE(merged == std::vector<topk_queue::entry_type>{{4.0, 6}, {3.0, 4}, {2.0, 0}});
+    REQUIRE_THROWS_AS(
+        merge_shard_results(
+            gsl::make_span(shards).subspan(1), gsl::make_span(results), global_docids, 3),
+        std::invalid_argument);
+}
+
+TEST_CASE("Broker merges results of selected shards", "[selective_search][integration]")
+{
+    using index_type = block_simdbp_index;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+
+    Temporary_Directory tmp;
+    auto index_path = (tmp.path() / "index").string();
+    auto wand_path = (tmp.path() / "wand").string();
+    {
+        wand_type wdata(
+            sizes.begin()->begin(),
+            collection.num_docs(),
+            collection,
+            ScorerParams("bm25"),
+            BlockSize(FixedBlock(64)),
+            false,
+            std::unordered_set<size_t>{});
+        mapper::freeze(wdata, wand_path.c_str());
+        index_type::builder builder(collection.num_docs(), global_parameters{});
+        for (auto const& plist: collection) {
+            uint64_t freqs_sum =
+                std::accumulate(plist.freqs.begin(), plist.freqs.end(), uint64_t(0));
+            builder.add_posting_list(
+                plist.docs.size(), plist.docs.begin(), plist.freqs.begin(), freqs_sum);
+        }
+        index_type index;
+        builder.build(index);
+        mapper::freeze(index, index_path.c_str());
+    }
+
+    // Two shards with the same index, whose documents follow each other in the collection.
+    using broker_type = selective_search_broker<index_type, wand_type>;
+    std::vector<std::unique_ptr<broker_type::shard_type>> shards;
+    VecMap<Shard_Id, std::vector<Document_Id>> global_docids;
+    for (int shard = 0; shard < 2; ++shard) {
+        shards.push_back(
+            std::make_unique<broker_type::shard_type>(index_path, wand_path, ScorerParams("bm25")));
+        auto& docids = global_docids.emplace_back(collection.num_docs());
+        std::iota(docids.begin(), docids.end(), Document_Id(shard * collection.num_docs()));
+    }
+    REQUIRE_THROWS_AS(broker_type({}, global_docids, "block_max_wand", 10), std::invalid_argument);
+    auto const& shard = *shards.front();
+    std::size_t k = 10;
+    broker_type broker(std::move(shards), global_docids, "block_max_wand", k);
+    REQUIRE_THROWS_AS(broker_type({}, {}, "ranked_or", 10), std::invalid_argument);
+
+    std::vector<Query> queries;
+    std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+    auto push_query = [&](std::string const& query_line) {
+        queries.push_back(parse_query_ids(query_line));
+    };
+    io::for_each_line(qfile, push_query);
+
+    for (auto const& query: queries) {
+        topk_queue topk(k);
+        block_max_wand_query block_max_wand_q(topk);
+        block_max_wand_q(
+            make_block_max_scored_cursors(shard.index, shard.wdata, *shard.scorer, query),
+            shard.index.num_docs());
+        topk.finalize();
+        auto const& expected = topk.topk();
+
+        VecMap<Shard_Id, Query> shard_queries{query, query};
+        auto second = broker(shard_queries, {1_s});
+        REQUIRE(second.shards == std::vector<Shard_Id>{1_s});
+        auto shifted = expected;
+        for (auto& [score, docid]: shifted) {
+            docid += collection.num_docs();
+        }
+        auto actual = second.topk;
+        std::sort(shifted.begin(), shifted.end());
+        std::sort(actual.begin(), actual.end());
+        REQUIRE(actual == shifted);
+
+        auto both = broker(shard_queries, {0_s, 1_s});
+        REQUIRE(both.topk.size() == std::min(k, 2 * expected.size()));
+        for (std::size_t idx = 0; idx < both.topk.size(); ++idx) {
+            REQUIRE(both.topk[idx].first == expected[idx / 2].first);
+        }
+
+        REQUIRE(broker(shard_queries, {}).topk.empty());
+    }
+}
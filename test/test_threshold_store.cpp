@@ -0,0 +1,148 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <fstream>
+#include <numeric>
+#include <set>
+#include <unordered_set>
+
+#include "cursor/max_scored_cursor.hpp"
+#include "index_types.hpp"
+#include "io.hpp"
+#include "pisa_config.hpp"
+#include "query/algorithm/wand_query.hpp"
+#include "query/queries.hpp"
+#include "temporary_directory.hpp"
+#include "threshold_store.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+TEST_CASE("Build threshold store")
+{
+    threshold_store::builder builder({100, 10, 100});
+    REQUIRE(builder.ks() == std::vector<std::uint32_t>{10, 100});
+    builder.add(std::vector<term_id_type>{5}, std::vector<Score>{3.0, 2.0});
+    builder.add(std::vector<term_id_type>{7, 5}, std::vector<Score>{4.0, 3.0});
+    builder.add(std::vector<term_id_type>{1, 5, 7}, std::vector<Score>{5.0, 1.0});
+    builder.add(std::vector<term_id_type>{8, 1, 5}, std::vector<Score>{0.5, 0.5});
+    REQUIRE_THROWS_AS(
+        builder.add(std::vector<term_id_type>{5}, std::vector<Score>{1.0}), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        builder.add(std::vector<term_id_type>{1, 2, 3, 4}, std::vector<Score>{1.0, 1.0}),
+        std::invalid_argument);
+
+    Temporary_Directory tmp;
+    auto path = (tmp.path() / "store").string();
+    {
+        threshold_store store;
+        builder.build(store);
+        mapper::freeze(store, path.c_str());
+    }
+    threshold_store store(MemorySource::mapped_file(path));
+    REQUIRE(store.size() == 4);
+    REQUIRE(store.find(std::vector<term_id_type>{5, 7}, 10) == std::optional<Score>(4.0));
+    REQUIRE(store.find(std::vector<term_id_type>{7, 5}, 100) == std::optional<Score>(3.0));
+    REQUIRE(store.find(std::vector<term_id_type>{7}, 10) == std::nullopt);
+    REQUIRE(store.find(std::vector<term_id_type>{5, 7, 1}, 100) == std::optional<Score>(1.0));
+    REQUIRE(store.find(std::vector<term_id_type>{1, 5, 8}, 10) == std::optional<Score>(0.5));
+    REQUIRE(store.find(std::vector<term_id_type>{1, 5, 6}, 10) == std::nullopt);
+    REQUIRE(store.find(std::vector<term_id_type>{1, 5, 9}, 10) == std::nullopt);
+    REQUIRE(store.threshold(std::vector<term_id_type>{5}, 10) == 3.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{5}, 5) == 3.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{5}, 11) == 2.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{5}, 101) == 0.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{9, 5, 7}, 10) == 4.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{7, 1, 9, 5}, 10) == 5.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{7, 1, 9, 5}, 100) == 3.0);
+    REQUIRE(store.threshold(std::vector<term_id_type>{7, 9}, 10) == 0.0);
+}
+
+TEST_CASE("Thresholds from store are safe", "[query][threshold]")
+{
+    using index_type = block_simdbp_index;
+    using wand_type = wand_data<wand_data_raw>;
+    std::string basename = PISA_SOURCE_DIR "/test/test_data/test_collection";
+    binary_freq_collection collection(basename.c_str());
+    binary_collection sizes(fmt::format("{}.sizes", basename).c_str());
+    wand_type wdata(
+        sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        ScorerParams("bm25"),
+        BlockSize(FixedBlock(64)),
+        false,
+        std::unordered_set<size_t>{});
+    auto scorer = scorer::from_params(ScorerParams("bm25"), wdata);
+
+    index_type::builder index_builder(collection.num_docs(), global_parameters{});
+    for (auto const& plist: collection) {
+        uint64_t freqs_sum = std::accumulate(plist.freqs.begin(), plist.freqs.end(), uint64_t(0));
+        index_builder.add_posting_list(
+            plist.docs.size(), plist.docs.begin(), plist.freqs.begin(), freqs_sum);
+    }
+    index_type index;
+    index_builder.build(index);
+
+    std::vector<Query> queries;
+    std::ifstream qfile(PISA_SOURCE_DIR "/test/test_data/queries");
+    auto push_query = [&](std::string const& query_line) {
+        queries.push_back(parse_query_ids(query_line));
+    };
+    io::for_each_line(qfile, push_query);
+
+    auto kth_scores = [&](Query query, std::size_t k) {
+        topk_queue topk(k);
+        wand_query wand_q(topk);
+        wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        topk.finalize();
+        return topk.topk();
+    };
+
+    std::set<std::vector<term_id_type>> tuples;
+    for (auto const& query: queries) {
+        std::set<term_id_type> terms(query.terms.begin(), query.terms.end());
+        for (auto first = terms.begin(); first != terms.end(); ++first) {
+            tuples.insert({*first});
+            for (auto second = std::next(first); second != terms.end(); ++second) {
+                tuples.insert({*first, *second});
+            }
+        }
+    }
+    threshold_store::builder builder({10, 100});
+    for (auto const& tuple: tuples) {
+        Query query;
+        query.terms = tuple;
+        auto topk = kth_scores(query, 100);
+        std::vector<Score> scores;
+        for (std::size_t k: {10, 100}) {
+            scores.push_back(topk.size() >= k ? topk[k - 1].first : 0.0F);
+        }
+        builder.add(tuple, scores);
+    }
+    threshold_store store;
+    builder.build(store);
+
+    std::size_t k = GENERATE(5, 10, 50);
+    std::size_t nonzero = 0;
+    for (auto const& query: queries) {
+        auto threshold = store.threshold(query, k);
+        auto expected = kth_scores(query, k);
+        if (expected.size() < k) {
+            REQUIRE(threshold == 0.0);
+            continue;
+        }
+        REQUIRE(threshold <= expected.back().first);
+        nonzero += threshold > 0.0 ? 1 : 0;
+
+        topk_queue topk(k, threshold);
+        wand_query wand_q(topk);
+        wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        topk.finalize();
+        REQUIRE(topk.topk().size() == expected.size());
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(topk.topk()[i].first == Approx(expected[i].first));
+        }
+    }
+    REQUIRE(nonzero > 0);
+}
@@ -24,6 +24,44 @@ TEST_CASE("TermTokenizer")
             "a", "1", "12", "w0rd", "token", "izer", "pup", "USa", "us", "hel", "lo"});
 }
 
+TEST_CASE("AsciiTermTokenizer")
+{
+    auto level = GENERATE(SimdLevel::Baseline, SimdLevel::Avx2);
+    if (level > detected_simd_level()) {
+        return;
+    }
+    AsciiTermTokenizer tokenizer(level);
+    auto tokenize = [&](std::string_view text) {
+        std::vector<std::string> tokens;
+        bool ascii =
+            tokenizer.tokenize(text, [&](std::string_view term) { tokens.emplace_back(term); });
+        return std::make_pair(ascii, tokens);
+    };
+    SECTION("Same tokens as TermTokenizer")
+    {
+        auto [ascii, tokens] = tokenize("a 1 12 w0rd, token-izer. pup's, U.S.a., us., hel.lo");
+        REQUIRE(ascii);
+        REQUIRE(
+            tokens
+            == std::vector<std::string>{
+                "a", "1", "12", "w0rd", "token", "izer", "pup", "USa", "us", "hel", "lo"});
+    }
+    SECTION("Tokens crossing 32-byte boundaries")
+    {
+        std::string text = std::string(30, ' ') + "Lorem IPSUM dolor " + std::string(40, '-')
+            + "A.B.C. it's" + std::string(63, '!') + "end";
+        auto [ascii, tokens] = tokenize(text);
+        REQUIRE(ascii);
+        REQUIRE(tokens == std::vector<std::string>{"Lorem", "IPSUM", "dolor", "ABC", "it", "end"});
+    }
+    SECTION("Non-ASCII text is rejected")
+    {
+        auto [ascii, tokens] = tokenize("caf\xc3\xa9 au lait");
+        REQUIRE_FALSE(ascii);
+        REQUIRE(tokens.empty());
+    }
+}
+
 TEST_CASE("Parse query terms to ids")
 {
     Temporary_Directory tmpdir;
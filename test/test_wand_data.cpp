@@ -1,7 +1,9 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch.hpp"
 
+#include <fstream>
 #include <functional>
+#include <numeric>
 
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/zip.hpp>
@@ -9,9 +11,13 @@
 
 #include "test_common.hpp"
 
+#include "global_statistics.hpp"
 #include "index_types.hpp"
+#include "io.hpp"
 #include "pisa_config.hpp"
 #include "query/queries.hpp"
+#include "temporary_directory.hpp"
+#include "util/inverted_index_utils.hpp"
 #include "wand_data.hpp"
 #include "wand_data_range.hpp"
 
@@ -128,3 +134,170 @@ TEST_CASE("wand_data_range")
         }
     }
 }
+
+TEMPLATE_TEST_CASE(
+    "Parallel construction matches sequential construction",
+    "[wand]",
+    wand_data_raw,
+    wand_data_compressed<>,
+    (wand_data_range<64, 1024>))
+{
+    tbb::task_scheduler_init init;
+    binary_freq_collection const collection(PISA_SOURCE_DIR "/test/test_data/test_collection");
+    binary_collection document_sizes(PISA_SOURCE_DIR "/test/test_data/test_collection.sizes");
+    auto block_size = GENERATE(BlockSize(FixedBlock(5)), BlockSize(VariableBlock(12.0)));
+
+    wand_data<TestType> parallel(
+        document_sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        ScorerParams("bm25"),
+        block_size,
+        false,
+        std::unordered_set<size_t>{});
+
+    auto doc_lens = document_sizes.begin()->begin();
+    std::vector<uint32_t> term_occurrence_counts;
+    std::vector<uint32_t> term_posting_counts;
+    for (auto const& seq: collection) {
+        term_occurrence_counts.push_back(std::accumulate(seq.freqs.begin(), seq.freqs.end(), 0));
+        term_posting_counts.push_back(seq.docs.size());
+    }
+    wand_data<TestType> sequential(
+        std::vector<uint32_t>(doc_lens, std::next(doc_lens, collection.num_docs())),
+        term_occurrence_counts,
+        term_posting_counts,
+        ScorerParams("bm25"),
+        block_size,
+        false,
+        [&](auto&& fn) {
+            for (auto const& seq: collection) {
+                fn(seq);
+            }
+        });
+
+    Temporary_Directory tmp;
+    auto parallel_path = (tmp.path() / "parallel").string();
+    auto sequential_path = (tmp.path() / "sequential").string();
+    mapper::freeze(parallel, parallel_path.c_str());
+    mapper::freeze(sequential, sequential_path.c_str());
+    auto parallel_bytes = io::load_data(parallel_path);
+    auto sequential_bytes = io::load_data(sequential_path);
+    REQUIRE(parallel_bytes == sequential_bytes);
+}
+
+TEST_CASE("Shard WAND data scored with global statistics", "[wand]")
+{
+    tbb::task_scheduler_init init;
+    binary_freq_collection const collection(PISA_SOURCE_DIR "/test/test_data/test_collection");
+    binary_collection document_sizes(PISA_SOURCE_DIR "/test/test_data/test_collection.sizes");
+    auto scorer_params = ScorerParams("bm25");
+    auto block_size = BlockSize(FixedBlock(5));
+    wand_data<wand_data_raw> global(
+        document_sizes.begin()->begin(),
+        collection.num_docs(),
+        collection,
+        scorer_params,
+        block_size,
+        false,
+        std::unordered_set<size_t>{});
+
+    // Two shards with the first and second half of the documents, whose terms are listed by
+    // their global IDs.
+    Temporary_Directory tmp;
+    std::uint32_t half = collection.num_docs() / 2;
+    std::vector<std::uint32_t> first_docs{0, half};
+    std::vector<std::uint32_t> last_docs{half, static_cast<std::uint32_t>(collection.num_docs())};
+    std::vector<std::string> collections;
+    std::vector<std::string> term_lists;
+    VecMap<Shard_Id, std::vector<std::uint32_t>> shard_terms;
+    for (std::size_t shard = 0; shard < 2; ++shard) {
+        auto first = first_docs[shard];
+        auto last = last_docs[shard];
+        auto basename = (tmp.path() / fmt::format("shard.{}", shard)).string();
+        std::ofstream docs(fmt::format("{}.docs", basename));
+        std::ofstream freqs(fmt::format("{}.freqs", basename));
+        std::ofstream lengths(fmt::format("{}.sizes", basename));
+        std::ofstream terms(fmt::format("{}.terms", basename));
+        emit(docs, 1);
+        emit(docs, last - first);
+        auto& global_terms = shard_terms.emplace_back();
+        std::uint32_t term = 0;
+        for (auto const& seq: collection) {
+            std::vector<std::uint32_t> shard_docs;
+            std::vector<std::uint32_t> shard_freqs;
+            for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                auto doc = seq.docs.begin()[pos];
+                if (doc >= first && doc < last) {
+                    shard_docs.push_back(doc - first);
+                    shard_freqs.push_back(seq.freqs.begin()[pos]);
+                }
+            }
+            if (not shard_docs.empty()) {
+                emit(docs, shard_docs.size());
+                emit(docs, shard_docs.data(), shard_docs.size());
+                emit(freqs, shard_freqs.size());
+                emit(freqs, shard_freqs.data(), shard_freqs.size());
+                terms << term << '\n';
+                global_terms.push_back(term);
+            }
+            term += 1;
+        }
+        emit(lengths, last - first);
+        emit(lengths, document_sizes.begin()->begin() + first, last - first);
+        collections.push_back(basename);
+        term_lists.push_back(fmt::format("{}.terms", basename));
+    }
+
+    auto stats = shard_global_statistics(gsl::make_span(collections), gsl::make_span(term_lists));
+    REQUIRE(stats.size() == 2);
+    auto global_scorer = scorer::from_params(scorer_params, global);
+    for (std::size_t shard = 0; shard < 2; ++shard) {
+        REQUIRE(stats[Shard_Id(shard)].num_docs == global.num_docs());
+        REQUIRE(stats[Shard_Id(shard)].collection_len == global.collection_len());
+
+        binary_freq_collection const shard_collection(collections[shard].c_str());
+        binary_collection shard_sizes(fmt::format("{}.sizes", collections[shard]).c_str());
+        auto lengths = *shard_sizes.begin();
+        wand_data<wand_data_raw> wdata(
+            std::vector<std::uint32_t>(lengths.begin(), lengths.end()),
+            stats[Shard_Id(shard)],
+            scorer_params,
+            block_size,
+            false,
+            [&](auto&& fn) {
+                for (auto const& seq: shard_collection) {
+                    fn(seq);
+                }
+            });
+        auto scorer = scorer::from_params(scorer_params, wdata);
+        std::size_t shard_term = 0;
+        for (auto const& seq: shard_collection) {
+            auto term = shard_terms[Shard_Id(shard)][shard_term];
+            REQUIRE(wdata.term_posting_count(shard_term) == global.term_posting_count(term));
+            REQUIRE(wdata.term_occurrence_count(shard_term) == global.term_occurrence_count(term));
+            auto term_scorer = scorer->term_scorer(shard_term);
+            auto global_term_scorer = global_scorer->term_scorer(term);
+            for (std::size_t pos = 0; pos < seq.docs.size(); ++pos) {
+                auto doc = seq.docs.begin()[pos];
+                auto freq = seq.freqs.begin()[pos];
+                auto global_doc = doc + first_docs[shard];
+                REQUIRE(term_scorer(doc, freq) == Approx(global_term_scorer(global_doc, freq)));
+            }
+            REQUIRE(wdata.max_term_weight(shard_term) <= Approx(global.max_term_weight(term)));
+            shard_term += 1;
+        }
+    }
+
+    // A term list missing the term of the last posting list.
+    auto terms = io::read_string_vector(term_lists[0]);
+    term_lists[0] = (tmp.path() / "missing.terms").string();
+    std::ofstream missing_terms(term_lists[0]);
+    std::for_each(terms.begin(), std::prev(terms.end()), [&](auto const& term) {
+        missing_terms << term << '\n';
+    });
+    missing_terms.close();
+    REQUIRE_THROWS_AS(
+        shard_global_statistics(gsl::make_span(collections), gsl::make_span(term_lists)),
+        std::invalid_argument);
+}
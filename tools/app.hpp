@@ -1,18 +1,23 @@
 #pragma once
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <optional>
 #include <random>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <CLI/CLI.hpp>
 #include <range/v3/view/getlines.hpp>
 #include <range/v3/view/transform.hpp>
 #include <spdlog/spdlog.h>
 
+#include "impact_tiers.hpp"
+#include "index_types.hpp"
 #include "io.hpp"
+#include "prune_index.hpp"
 #include "query/queries.hpp"
 #include "scorer/scorer.hpp"
 #include "sharding.hpp"
@@ -80,6 +85,9 @@ namespace arg {
 
         [[nodiscard]] auto index_filename() const -> std::string const& { return m_index; }
 
+        /// Transform paths for `shard`.
+        void apply_shard(Shard_Id shard) { m_index = expand_shard(m_index, shard); }
+
       private:
         std::string m_index;
     };
@@ -128,6 +136,11 @@ namespace arg {
 
         [[nodiscard]] auto weighted() const -> bool { return m_weighted; }
 
+        [[nodiscard]] auto term_lexicon() const -> std::optional<std::string> const&
+        {
+            return m_term_lexicon;
+        }
+
       protected:
         [[nodiscard]] auto terms_option() const -> CLI::Option* { return m_terms_option; }
         void override_term_lexicon(std::string term_lexicon) { m_term_lexicon = term_lexicon; }
@@ -352,6 +365,14 @@ namespace arg {
                 block_group
                     ->add_option("-l,--lambda", m_lambda, "Lambda parameter for variable blocks")
                     ->excludes(block_size_opt);
+            auto block_encoding_opt =
+                block_group
+                    ->add_option(
+                        "--index-blocks",
+                        m_index_blocks_encoding,
+                        "Fixed-length blocks of the same size as those of a block index encoding")
+                    ->excludes(block_size_opt)
+                    ->excludes(block_lambda_opt);
             block_group->require_option();
 
             app->add_flag("--compress", m_compress, "Compress additional data");
@@ -359,7 +380,8 @@ namespace arg {
             add_scorer_options(app, *this, ScorerMode::Required);
             app->add_flag("--range", m_range, "Create docid-range based data")
                 ->excludes(block_size_opt)
-                ->excludes(block_lambda_opt);
+                ->excludes(block_lambda_opt)
+                ->excludes(block_encoding_opt);
             app->add_option(
                 "--terms-to-drop",
                 m_terms_to_drop_filename,
@@ -375,6 +397,15 @@ namespace arg {
                 spdlog::info("Lambda {}", *m_lambda);
                 return VariableBlock(*m_lambda);
             }
+            if (m_index_blocks_encoding) {
+                auto block_size = block_index_block_size(*m_index_blocks_encoding);
+                if (not block_size) {
+                    throw std::invalid_argument(fmt::format(
+                        "{} is not a block index encoding", *m_index_blocks_encoding));
+                }
+                spdlog::info("Fixed block size of {}: {}", *m_index_blocks_encoding, *block_size);
+                return FixedBlock(*block_size);
+            }
             spdlog::info("Fixed block size: {}", *m_fixed_block_size);
             return FixedBlock(*m_fixed_block_size);
         }
@@ -406,6 +437,7 @@ namespace arg {
       private:
         std::optional<float> m_lambda{};
         std::optional<uint64_t> m_fixed_block_size{};
+        std::optional<std::string> m_index_blocks_encoding{};
         std::string m_input_basename;
         std::string m_output;
         ScorerParams m_params;
@@ -415,6 +447,230 @@ namespace arg {
         std::string m_terms_to_drop_filename;
     };
 
+    /// Options for rebuilding WAND data along with an index, read from `Input`, which is either
+    /// a single optional file or a list of files.
+    template <typename Input>
+    struct RebuildWandData {
+        explicit RebuildWandData(CLI::App* app) : m_params("")
+        {
+            auto* wand = app->add_option("-w,--wand", m_wand_data_path, "WAND data filename");
+            auto* output_wand =
+                app->add_option("--output-wand", m_output_wand, "Output WAND data filename");
+            wand->needs(output_wand);
+            output_wand->needs(wand);
+            auto* block_size_opt = app->add_option(
+                "-b,--block-size", m_fixed_block_size, "Block size for fixed-length blocks");
+            auto* block_lambda_opt =
+                app->add_option("-l,--lambda", m_lambda, "Lambda parameter for variable blocks")
+                    ->excludes(block_size_opt);
+            auto* compress = app->add_flag("--compress", m_compress, "Compress additional data");
+            auto* quantize = app->add_flag("--quantize", m_quantize, "Quantize scores");
+            auto* range = app->add_flag("--range", m_range, "Create docid-range based data")
+                              ->excludes(block_size_opt)
+                              ->excludes(block_lambda_opt);
+            auto* scorer = add_scorer_options(app, *this, ScorerMode::Optional);
+            wand->needs(scorer);
+            for (auto* opt: {block_size_opt, block_lambda_opt, compress, quantize, range, scorer}) {
+                opt->needs(wand);
+            }
+        }
+
+        [[nodiscard]] auto wand_data_path() const -> Input const& { return m_wand_data_path; }
+        [[nodiscard]] auto output_wand() const -> std::optional<std::string> const&
+        {
+            return m_output_wand;
+        }
+        [[nodiscard]] auto scorer_params() const { return m_params; }
+        [[nodiscard]] auto block_size() const -> BlockSize
+        {
+            if (m_lambda) {
+                return VariableBlock(*m_lambda);
+            }
+            return FixedBlock(m_fixed_block_size.value_or(0));
+        }
+        [[nodiscard]] auto has_block_size() const -> bool
+        {
+            return m_range || m_lambda || m_fixed_block_size;
+        }
+        [[nodiscard]] auto compress() const -> bool { return m_compress; }
+        [[nodiscard]] auto range() const -> bool { return m_range; }
+        [[nodiscard]] auto quantize() const -> bool { return m_quantize; }
+
+        template <typename T>
+        friend CLI::Option* add_scorer_options(CLI::App* app, T& args, ScorerMode scorer_mode);
+
+      private:
+        Input m_wand_data_path;
+        std::optional<std::string> m_output_wand;
+        std::optional<float> m_lambda{};
+        std::optional<uint64_t> m_fixed_block_size{};
+        ScorerParams m_params;
+        bool m_compress = false;
+        bool m_range = false;
+        bool m_quantize = false;
+    };
+
+    struct ReorderIndex {
+        explicit ReorderIndex(CLI::App* app)
+        {
+            app->add_option("-o,--output", m_output, "Output index filename")->required();
+            app->add_option("--mapping", m_mapping_file, "Mapping file")->required();
+        }
+
+        [[nodiscard]] auto output() const -> std::string const& { return m_output; }
+        [[nodiscard]] auto mapping_file() const -> std::string const& { return m_mapping_file; }
+
+      private:
+        std::string m_output;
+        std::string m_mapping_file;
+    };
+
+    struct MergeIndex {
+        explicit MergeIndex(CLI::App* app)
+        {
+            app->add_option("-i,--index", m_indexes, "Inverted index filenames, in document order")
+                ->required();
+            app->add_option("-o,--output", m_output, "Output index filename")->required();
+            auto* terms = app->add_option("--terms", m_term_lexicons, "Term lexicons");
+            auto* output_terms =
+                app->add_option("--output-terms", m_output_term_lexicon, "Output term lexicon");
+            terms->needs(output_terms);
+            output_terms->needs(terms);
+            auto* documents = app->add_option("--documents", m_document_lexicons, "Document lexicons");
+            auto* output_documents = app->add_option(
+                "--output-documents", m_output_document_lexicon, "Output document lexicon");
+            documents->needs(output_documents);
+            output_documents->needs(documents);
+        }
+
+        [[nodiscard]] auto indexes() const -> std::vector<std::string> const& { return m_indexes; }
+        [[nodiscard]] auto output() const -> std::string const& { return m_output; }
+        [[nodiscard]] auto term_lexicons() const -> std::vector<std::string> const&
+        {
+            return m_term_lexicons;
+        }
+        [[nodiscard]] auto output_term_lexicon() const -> std::optional<std::string> const&
+        {
+            return m_output_term_lexicon;
+        }
+        [[nodiscard]] auto document_lexicons() const -> std::vector<std::string> const&
+        {
+            return m_document_lexicons;
+        }
+        [[nodiscard]] auto output_document_lexicon() const -> std::optional<std::string> const&
+        {
+            return m_output_document_lexicon;
+        }
+
+      private:
+        std::vector<std::string> m_indexes;
+        std::string m_output;
+        std::vector<std::string> m_term_lexicons;
+        std::optional<std::string> m_output_term_lexicon;
+        std::vector<std::string> m_document_lexicons;
+        std::optional<std::string> m_output_document_lexicon;
+    };
+
+    struct PruneIndex {
+        explicit PruneIndex(CLI::App* app)
+        {
+            app->add_option("-c,--collection", m_input_basename, "Collection basename")->required();
+            app->add_option("-o,--output", m_output_basename, "Output collection basename")
+                ->required();
+            app->add_option(
+                   "--strategy",
+                   m_strategy,
+                   "Pruning strategy: term (term-centric), document (document-centric), or global",
+                   true);
+            app->add_option("--threshold", m_options.threshold, "Minimum score (global)", true);
+            app->add_option(
+                "--term-k", m_options.k, "Rank of the reference score of a term (term-centric)", true);
+            app->add_option(
+                "--epsilon",
+                m_options.epsilon,
+                "Fraction of the reference score of a term to keep (term-centric)",
+                true);
+            app->add_option(
+                "--ratio", m_options.ratio, "Fraction of postings to keep (document-centric)", true);
+            app->add_option(
+                "--terms-to-drop", m_terms_to_drop_file, "Output file with IDs of dropped terms");
+            auto* encoding =
+                app->add_option("-e,--encoding", m_encoding, "Encoding of the pruned index");
+            auto* index = app->add_option("--index", m_index, "Output pruned index filename");
+            encoding->needs(index);
+            index->needs(encoding);
+            app->add_option("-k", m_k, "Depth of the top-k overlap evaluated on queries", true);
+        }
+
+        [[nodiscard]] auto input_basename() const -> std::string const& { return m_input_basename; }
+        [[nodiscard]] auto output_basename() const -> std::string const&
+        {
+            return m_output_basename;
+        }
+        [[nodiscard]] auto pruning_options() const -> PruningOptions
+        {
+            auto options = m_options;
+            if (m_strategy == "document") {
+                options.strategy = PruningStrategy::DocumentCentric;
+            } else if (m_strategy == "global") {
+                options.strategy = PruningStrategy::Global;
+            } else if (m_strategy == "term") {
+                options.strategy = PruningStrategy::TermCentric;
+            } else {
+                throw std::invalid_argument(fmt::format("Unknown pruning strategy: {}", m_strategy));
+            }
+            return options;
+        }
+        [[nodiscard]] auto terms_to_drop_file() const -> std::optional<std::string> const&
+        {
+            return m_terms_to_drop_file;
+        }
+        [[nodiscard]] auto index_encoding() const -> std::optional<std::string> const&
+        {
+            return m_encoding;
+        }
+        [[nodiscard]] auto index_filename() const -> std::optional<std::string> const&
+        {
+            return m_index;
+        }
+        [[nodiscard]] auto k() const -> std::size_t { return m_k; }
+
+      private:
+        std::string m_input_basename;
+        std::string m_output_basename;
+        std::string m_strategy = "term";
+        PruningOptions m_options{};
+        std::optional<std::string> m_terms_to_drop_file;
+        std::optional<std::string> m_encoding;
+        std::optional<std::string> m_index;
+        std::size_t m_k = 10;
+    };
+
+    struct SplitTiers {
+        explicit SplitTiers(CLI::App* app)
+        {
+            app->add_option("-c,--collection", m_input_basename, "Collection basename")->required();
+            app->add_option("-o,--output", m_output_basename, "Output collection basename")
+                ->required();
+            app->add_option(
+                "--ratio", m_options.ratio, "Fraction of postings in the high tier of a list", true);
+            app->add_option(
+                "--min-length", m_options.min_length, "Length of the longest unsplit list", true);
+        }
+
+        [[nodiscard]] auto input_basename() const -> std::string const& { return m_input_basename; }
+        [[nodiscard]] auto output_basename() const -> std::string const&
+        {
+            return m_output_basename;
+        }
+        [[nodiscard]] auto tier_options() const -> ImpactTierOptions { return m_options; }
+
+      private:
+        std::string m_input_basename;
+        std::string m_output_basename;
+        ImpactTierOptions m_options{};
+    };
+
     struct ReorderDocuments {
         explicit ReorderDocuments(CLI::App* app)
         {
@@ -456,6 +712,12 @@ namespace arg {
             app->add_flag("--nogb", m_nogb, "No VarIntGB compression in forward index")->needs(bp);
             app->add_flag("-p,--print", m_print, "Print ordering to standard output")->needs(bp);
             optconf->excludes(optdepth);
+            app->add_option(
+                   "--max-postings",
+                   m_max_postings,
+                   "Bisect out of core, holding at most this many postings in memory")
+                ->needs(bp)
+                ->excludes(optconf);
         }
 
         [[nodiscard]] auto input_basename() const -> std::string { return m_input_basename; }
@@ -494,6 +756,10 @@ namespace arg {
         {
             return m_node_config;
         }
+        [[nodiscard]] auto max_postings() const -> std::optional<std::size_t>
+        {
+            return m_max_postings;
+        }
 
         void apply_shard(Shard_Id shard)
         {
@@ -541,6 +807,7 @@ namespace arg {
         bool m_nogb = false;
         bool m_print = false;
         std::optional<std::string> m_node_config{};
+        std::optional<std::size_t> m_max_postings{};
     };
 
     struct Separator {
@@ -597,13 +864,61 @@ struct Args: public T... {
 
 using InvertArgs = Args<arg::Invert, arg::Threads, arg::BatchSize<100'000>>;
 using ReorderDocuments = Args<arg::ReorderDocuments, arg::Threads>;
-using CompressArgs =
-    pisa::Args<arg::Compress, arg::Encoding, arg::Quantize<arg::ScorerMode::Optional>>;
-using CreateWandDataArgs = pisa::Args<arg::CreateWandData>;
+using CompressArgs = pisa::Args<
+    arg::Compress,
+    arg::Encoding,
+    arg::Quantize<arg::ScorerMode::Optional>,
+    arg::Threads>;
+using CreateWandDataArgs = pisa::Args<arg::CreateWandData, arg::Threads>;
+using ReorderIndexArgs = pisa::Args<
+    arg::Index,
+    arg::ReorderIndex,
+    arg::RebuildWandData<std::optional<std::string>>,
+    arg::Threads>;
+using MergeIndexArgs = pisa::Args<
+    arg::Encoding,
+    arg::MergeIndex,
+    arg::RebuildWandData<std::vector<std::string>>,
+    arg::Threads>;
+
+using PruneIndexArgs = pisa::Args<
+    arg::PruneIndex,
+    arg::WandData<arg::WandMode::Required>,
+    arg::Scorer,
+    arg::Query<arg::QueryMode::Unranked>,
+    arg::Threads>;
+using SplitTiersArgs =
+    pisa::Args<arg::SplitTiers, arg::RebuildWandData<std::optional<std::string>>>;
+
+struct ShardWandDataArgs: CreateWandDataArgs {
+    explicit ShardWandDataArgs(CLI::App* app) : CreateWandDataArgs(app)
+    {
+        auto* terms = app->add_option(
+            "--terms", m_terms, "Shard term lists, with the term of each posting list per line");
+        app->add_flag("--global-stats", m_global_stats, "Score with statistics of all shards")
+            ->needs(terms)
+            ->excludes("--terms-to-drop");
+    }
+
+    [[nodiscard]] auto terms() const -> std::string const& { return m_terms; }
+    [[nodiscard]] auto global_stats() const -> bool { return m_global_stats; }
 
-struct TailyStatsArgs: pisa::Args<arg::WandData<arg::WandMode::Required>, arg::Scorer> {
+    /// Transform paths for `shard`.
+    void apply_shard(Shard_Id shard)
+    {
+        CreateWandDataArgs::apply_shard(shard);
+        m_terms = expand_shard(m_terms, shard);
+    }
+
+  private:
+    std::string m_terms;
+    bool m_global_stats = false;
+};
+
+struct TailyStatsArgs
+    : pisa::Args<arg::WandData<arg::WandMode::Required>, arg::Scorer, arg::Threads> {
     explicit TailyStatsArgs(CLI::App* app)
-        : pisa::Args<arg::WandData<arg::WandMode::Required>, arg::Scorer>(app)
+        : pisa::Args<arg::WandData<arg::WandMode::Required>, arg::Scorer, arg::Threads>(app)
     {
         app->add_option("-c,--collection", m_collection_path, "Binary collection basename")->required();
         app->add_option("-o,--output", m_output_path, "Output file path")->required();
@@ -652,6 +967,113 @@ struct TailyRankArgs: pisa::Args<arg::Query<arg::QueryMode::Ranked>> {
     std::string m_shard_term_lexicon;
 };
 
+using SelectiveSearchBaseArgs = pisa::Args<
+    arg::Index,
+    arg::WandData<arg::WandMode::Required>,
+    arg::Query<arg::QueryMode::Ranked>,
+    arg::Algorithm,
+    arg::Scorer,
+    arg::Threads>;
+
+struct SelectiveSearchArgs: SelectiveSearchBaseArgs {
+    explicit SelectiveSearchArgs(CLI::App* app) : SelectiveSearchBaseArgs(app)
+    {
+        arg::Query<arg::QueryMode::Ranked>::terms_option()->required(true);
+        app->add_option("--global-stats", m_global_stats, "Global Taily statistics")->required();
+        app->add_option("--shard-stats", m_shard_stats, "Shard-level Taily statistics")->required();
+        app->add_option("--shard-terms", m_shard_term_lexicon, "Shard-level term lexicons")
+            ->required();
+        app->add_option("--documents", m_documents, "Global document titles")->required();
+        app->add_option("--shard-documents", m_shard_documents, "Shard-level document titles")
+            ->required();
+        app->add_option(
+            "--min-score", m_min_score, "Minimum Taily score of a shard to be queried", true);
+        app->add_option("--max-shards", m_max_shards, "Maximum number of shards queried");
+        app->set_config("--config", "", "Configuration .ini file", false);
+    }
+
+    [[nodiscard]] auto global_stats() const -> std::string const& { return m_global_stats; }
+    [[nodiscard]] auto shard_stats() const -> std::string const& { return m_shard_stats; }
+    [[nodiscard]] auto documents() const -> std::string const& { return m_documents; }
+    [[nodiscard]] auto shard_documents() const -> std::string const& { return m_shard_documents; }
+    [[nodiscard]] auto min_score() const -> double { return m_min_score; }
+    [[nodiscard]] auto max_shards() const -> std::optional<std::size_t> { return m_max_shards; }
+
+    /// Transform paths for `shard`.
+    void apply_shard(Shard_Id shard)
+    {
+        arg::Index::apply_shard(shard);
+        arg::WandData<arg::WandMode::Required>::apply_shard(shard);
+        m_shard_term_lexicon = expand_shard(m_shard_term_lexicon, shard);
+        override_term_lexicon(m_shard_term_lexicon);
+        m_shard_stats = expand_shard(m_shard_stats, shard);
+        m_shard_documents = expand_shard(m_shard_documents, shard);
+    }
+
+  private:
+    std::string m_global_stats;
+    std::string m_shard_stats;
+    std::string m_shard_term_lexicon;
+    std::string m_documents;
+    std::string m_shard_documents;
+    double m_min_score = 0.0;
+    std::optional<std::size_t> m_max_shards;
+};
+
+using ScatterGatherBaseArgs = pisa::Args<
+    arg::Index,
+    arg::WandData<arg::WandMode::Required>,
+    arg::Query<arg::QueryMode::Ranked>,
+    arg::Algorithm,
+    arg::Scorer>;
+
+struct ScatterGatherArgs: ScatterGatherBaseArgs {
+    explicit ScatterGatherArgs(CLI::App* app) : ScatterGatherBaseArgs(app)
+    {
+        arg::Query<arg::QueryMode::Ranked>::terms_option()->required(true);
+        app->add_option("--shard-terms", m_shard_term_lexicon, "Shard-level term lexicons")->required();
+        app->add_option("--documents", m_documents, "Global document titles")->required();
+        app->add_option("--shard-documents", m_shard_documents, "Shard-level document titles")
+            ->required();
+        app->add_option("--socket", m_socket, "Unix domain sockets of shard workers")->required();
+        app->add_option(
+            "--timeout", m_timeout, "Time in milliseconds to wait for shard responses", true);
+        app->add_option(
+            "--launch-workers",
+            m_worker,
+            "Launch a process of the given shard worker executable for each shard");
+        app->set_config("--config", "", "Configuration .ini file", false);
+    }
+
+    [[nodiscard]] auto documents() const -> std::string const& { return m_documents; }
+    [[nodiscard]] auto shard_documents() const -> std::string const& { return m_shard_documents; }
+    [[nodiscard]] auto socket() const -> std::string const& { return m_socket; }
+    [[nodiscard]] auto timeout() const -> std::chrono::milliseconds
+    {
+        return std::chrono::milliseconds(m_timeout);
+    }
+    [[nodiscard]] auto worker() const -> std::optional<std::string> const& { return m_worker; }
+
+    /// Transform paths for `shard`.
+    void apply_shard(Shard_Id shard)
+    {
+        arg::Index::apply_shard(shard);
+        arg::WandData<arg::WandMode::Required>::apply_shard(shard);
+        m_shard_term_lexicon = expand_shard(m_shard_term_lexicon, shard);
+        override_term_lexicon(m_shard_term_lexicon);
+        m_shard_documents = expand_shard(m_shard_documents, shard);
+        m_socket = expand_shard(m_socket, shard);
+    }
+
+  private:
+    std::string m_shard_term_lexicon;
+    std::string m_documents;
+    std::string m_shard_documents;
+    std::string m_socket;
+    std::size_t m_timeout = 1000;
+    std::optional<std::string> m_worker;
+};
+
 struct TailyThresholds: pisa::Args<arg::Query<arg::QueryMode::Ranked>> {
     explicit TailyThresholds(CLI::App* app) : pisa::Args<arg::Query<arg::QueryMode::Ranked>>(app)
     {
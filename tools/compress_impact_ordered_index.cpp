@@ -0,0 +1,80 @@
+#include <string>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "app.hpp"
+#include "binary_freq_collection.hpp"
+#include "impact_ordered_index.hpp"
+#include "index_types.hpp"
+#include "mappable/mapper.hpp"
+#include "memory_source.hpp"
+#include "wand_data.hpp"
+#include "wand_data_compressed.hpp"
+#include "wand_data_raw.hpp"
+
+using namespace pisa;
+
+template <typename BlockCodec, typename Wand>
+void compress_impact_ordered(
+    std::string const& input_basename,
+    std::string const& wand_data_filename,
+    ScorerParams const& scorer_params,
+    std::string const& output_filename)
+{
+    binary_freq_collection input(input_basename.c_str());
+    Wand const wdata(MemorySource::mapped_file(wand_data_filename));
+    impact_ordered_index<BlockCodec> index;
+    build_impact_ordered_index(input, wdata, scorer_params, index);
+    auto bytes = mapper::freeze(index, output_filename.c_str());
+    spdlog::info("Impact-ordered index written to {} ({} bytes)", output_filename, bytes);
+}
+
+int main(int argc, char** argv)
+{
+    spdlog::drop("");
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    std::string input_basename;
+    std::string output_filename;
+
+    App<arg::Encoding, arg::WandData<arg::WandMode::Required>, arg::Scorer> app{
+        "Compresses an inverted index into lists of segments of equal quantized impact."};
+    app.add_option("-c,--collection", input_basename, "Collection basename")->required();
+    app.add_option("-o,--output", output_filename, "Output filename")->required();
+    CLI11_PARSE(app, argc, argv);
+
+    auto const& encoding = app.index_encoding();
+    auto compress = [&](auto codec) {
+        using codec_type = decltype(codec);
+        if (app.is_wand_compressed()) {
+            compress_impact_ordered<codec_type, wand_data<wand_data_compressed<>>>(
+                input_basename, app.wand_data_path(), app.scorer_params(), output_filename);
+        } else {
+            compress_impact_ordered<codec_type, wand_data<wand_data_raw>>(
+                input_basename, app.wand_data_path(), app.scorer_params(), output_filename);
+        }
+    };
+
+    try {
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                                  \
+    }                                                          \
+    else if (encoding == BOOST_PP_STRINGIZE(T))                \
+    {                                                          \
+        compress(BOOST_PP_CAT(T, _index)::block_codec_type{}); \
+        /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_BLOCK_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown block encoding {}", encoding);
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -8,6 +8,8 @@
 #include <boost/range/adaptor/transformed.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
 
 #include "app.hpp"
 #include "wand_data.hpp"
@@ -24,16 +26,21 @@ void extract(
     bool print_query_id)
 {
     Wand wdata(MemorySource::mapped_file(wand_data_path));
-    for (auto const& query: queries) {
+    std::vector<std::string> lines(queries.size());
+    tbb::parallel_for(size_t(0), queries.size(), [&](size_t query_idx) {
+        auto const& query = queries[query_idx];
+        auto& line = lines[query_idx];
         if (print_query_id and query.id) {
-            std::cout << *(query.id) << ":";
+            line = *(query.id) + ":";
         }
-        std::cout << boost::algorithm::join(
+        line += boost::algorithm::join(
             query.terms | boost::adaptors::transformed([&wdata](auto term_id) {
                 return std::to_string(wdata.max_term_weight(term_id));
             }),
             separator);
-        std::cout << '\n';
+    });
+    for (auto const& line: lines) {
+        std::cout << line << '\n';
     }
 }
 
@@ -48,7 +55,11 @@ int main(int argc, char** argv)
 
     bool quantized = false;
 
-    App<arg::WandData<arg::WandMode::Required>, arg::Query<arg::QueryMode::Unranked>, arg::Separator, arg::PrintQueryId>
+    App<arg::WandData<arg::WandMode::Required>,
+        arg::Query<arg::QueryMode::Unranked>,
+        arg::Separator,
+        arg::PrintQueryId,
+        arg::Threads>
         app{
             R"(
 Extracts max-scores for query terms from an inverted index.
@@ -58,6 +69,8 @@ which is a tab by default.)"};
     app.add_flag("--quantized", quantized, "Quantized scores");
     CLI11_PARSE(app, argc, argv);
 
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, app.threads() + 1);
+
     auto params =
         std::make_tuple(app.wand_data_path(), app.queries(), app.separator(), app.print_query_id());
 
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <optional>
+#include <set>
 #include <unordered_set>
 
 #include "boost/algorithm/string/classification.hpp"
@@ -9,6 +10,8 @@
 #include "mio/mmap.hpp"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
+#include "tbb/global_control.h"
+#include "tbb/parallel_for.h"
 
 #include "mappable/mapper.hpp"
 
@@ -17,12 +20,14 @@
 #include "index_types.hpp"
 #include "io.hpp"
 #include "query/algorithm.hpp"
+#include "util/progress.hpp"
 #include "util/util.hpp"
 #include "wand_data_compressed.hpp"
 #include "wand_data_raw.hpp"
 
 #include "query/algorithm.hpp"
 #include "scorer/scorer.hpp"
+#include "threshold_store.hpp"
 
 #include "CLI/CLI.hpp"
 
@@ -109,28 +114,26 @@ void kt_thresholds(
         spdlog::info("Number of triples loaded: {}", triples_set.size());
     }
 
-    for (auto const& query: queries) {
-        float threshold = 0;
-
-        auto terms = query.terms;
+    auto kth_score = [&](std::vector<uint32_t> terms) {
+        Query query;
+        query.terms = std::move(terms);
         topk_queue topk(k);
         wand_query wand_q(topk);
+        wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+        return topk.size() == k ? topk.true_threshold() : 0.0F;
+    };
 
+    std::vector<float> thresholds(queries.size(), 0.0);
+    tbb::parallel_for(size_t(0), queries.size(), [&](size_t query_idx) {
+        auto const& terms = queries[query_idx].terms;
+        float threshold = 0;
         for (auto&& term: terms) {
-            Query query;
-            query.terms.push_back(term);
-            wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
-            threshold = std::max(threshold, topk.size() == k ? topk.true_threshold() : 0.0F);
-            topk.clear();
+            threshold = std::max(threshold, kth_score({term}));
         }
         for (size_t i = 0; i < terms.size(); ++i) {
             for (size_t j = i + 1; j < terms.size(); ++j) {
                 if (pairs_set.count({terms[i], terms[j]}) > 0 or all_pairs) {
-                    Query query;
-                    query.terms = {terms[i], terms[j]};
-                    wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
-                    threshold = std::max(threshold, topk.size() == k ? topk.true_threshold() : 0.0F);
-                    topk.clear();
+                    threshold = std::max(threshold, kth_score({terms[i], terms[j]}));
                 }
             }
         }
@@ -138,21 +141,113 @@ void kt_thresholds(
             for (size_t j = i + 1; j < terms.size(); ++j) {
                 for (size_t s = j + 1; s < terms.size(); ++s) {
                     if (triples_set.count({terms[i], terms[j], terms[s]}) > 0 or all_triples) {
-                        Query query;
-                        query.terms = {terms[i], terms[j], terms[s]};
-                        wand_q(
-                            make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
                         threshold =
-                            std::max(threshold, topk.size() == k ? topk.true_threshold() : 0.0F);
-                        topk.clear();
+                            std::max(threshold, kth_score({terms[i], terms[j], terms[s]}));
                     }
                 }
             }
         }
+        thresholds[query_idx] = threshold;
+    });
+    for (auto threshold: thresholds) {
         std::cout << threshold << '\n';
     }
 }
 
+template <typename IndexType, typename WandType>
+void build_threshold_store(
+    const std::string& index_filename,
+    const std::string& wand_data_filename,
+    const std::vector<Query>& queries,
+    ScorerParams const& scorer_params,
+    std::vector<std::uint32_t> const& ks,
+    std::optional<std::string> pairs_filename,
+    std::optional<std::string> triples_filename,
+    bool all_pairs,
+    bool all_triples,
+    std::string const& output)
+{
+    IndexType index(MemorySource::mapped_file(index_filename));
+    WandType wdata(MemorySource::mapped_file(wand_data_filename));
+    auto scorer = scorer::from_params(scorer_params, wdata);
+
+    using Tuple = std::set<uint32_t>;
+    std::set<Tuple> tuples;
+    std::string line;
+    if (pairs_filename) {
+        std::ifstream pin(*pairs_filename);
+        while (std::getline(pin, line)) {
+            tuples.insert(parse_tuple(line, 2));
+        }
+    }
+    if (triples_filename) {
+        std::ifstream trin(*triples_filename);
+        while (std::getline(trin, line)) {
+            tuples.insert(parse_tuple(line, 3));
+        }
+    }
+    for (auto const& query: queries) {
+        std::vector<uint32_t> terms(query.terms.begin(), query.terms.end());
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        for (size_t i = 0; i < terms.size(); ++i) {
+            tuples.insert({terms[i]});
+            for (size_t j = i + 1; all_pairs and j < terms.size(); ++j) {
+                tuples.insert({terms[i], terms[j]});
+            }
+            for (size_t j = i + 1; all_triples and j < terms.size(); ++j) {
+                for (size_t s = j + 1; s < terms.size(); ++s) {
+                    tuples.insert({terms[i], terms[j], terms[s]});
+                }
+            }
+        }
+    }
+
+    threshold_store::builder builder(ks);
+    auto max_k = builder.ks().back();
+    auto num_ks = builder.ks().size();
+    std::vector<std::vector<uint32_t>> tuple_terms;
+    for (auto const& tuple: tuples) {
+        tuple_terms.emplace_back(tuple.begin(), tuple.end());
+    }
+    std::vector<Score> scores(tuple_terms.size() * num_ks, 0.0F);
+    {
+        pisa::progress progress("Compute k-th scores", tuple_terms.size());
+        tbb::parallel_for(size_t(0), tuple_terms.size(), [&](size_t idx) {
+            Query query;
+            query.terms = tuple_terms[idx];
+            topk_queue topk(max_k);
+            wand_query wand_q(topk);
+            wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+            topk.finalize();
+            for (size_t pos = 0; pos < num_ks; ++pos) {
+                auto k = builder.ks()[pos];
+                if (topk.topk().size() >= k) {
+                    scores[idx * num_ks + pos] = topk.topk()[k - 1].first;
+                }
+            }
+            progress.update(1);
+        });
+    }
+    for (size_t idx = 0; idx < tuple_terms.size(); ++idx) {
+        builder.add(tuple_terms[idx], gsl::make_span(&scores[idx * num_ks], num_ks));
+    }
+    threshold_store store;
+    builder.build(store);
+    spdlog::info("Stored k-th scores of {} terms, pairs and triples", store.size());
+    mapper::freeze(store, output.c_str());
+}
+
+template <typename IndexType, typename WandType, typename Params, typename StoreParams>
+void run(bool build_store, Params const& params, StoreParams const& store_params)
+{
+    if (build_store) {
+        std::apply(build_threshold_store<IndexType, WandType>, store_params);
+    } else {
+        std::apply(kt_thresholds<IndexType, WandType>, params);
+    }
+}
+
 using wand_raw_index = wand_data<wand_data_raw>;
 using wand_uniform_index = wand_data<wand_data_compressed<>>;
 using wand_uniform_index_quantized = wand_data<wand_data_compressed<PayloadType::Quantized>>;
@@ -171,8 +266,14 @@ int main(int argc, const char** argv)
 
     bool all_pairs = false;
     bool all_triples = false;
+    std::optional<std::string> store_filename;
+    std::vector<std::uint32_t> store_ks;
 
-    App<arg::Index, arg::WandData<arg::WandMode::Required>, arg::Query<arg::QueryMode::Ranked>, arg::Scorer>
+    App<arg::Index,
+        arg::WandData<arg::WandMode::Required>,
+        arg::Query<arg::QueryMode::Ranked>,
+        arg::Scorer,
+        arg::Threads>
         app{"A tool for performing threshold estimation using the k-highest impact score for each "
             "term, pair or triple of a query. Pairs and triples are only used if provided with "
             "--pairs and --triples respectively."};
@@ -185,9 +286,23 @@ int main(int argc, const char** argv)
     app.add_flag("--all-pairs", all_pairs, "Consider all term pairs of a query")->excludes(pairs);
     app.add_flag("--all-triples", all_triples, "Consider all term triples of a query")->excludes(triples);
     app.add_flag("--quantized", quantized, "Quantizes the scores");
+    auto store = app.add_option(
+        "--store",
+        store_filename,
+        "Instead of printing query thresholds, write a threshold store with the k-th scores of "
+        "all query terms, and of the pairs and triples selected as above");
+    app.add_option("--store-k", store_ks, "Values of k in the threshold store (default: -k)")
+        ->needs(store);
 
     CLI11_PARSE(app, argc, argv);
 
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, app.threads() + 1);
+    spdlog::info("Number of worker threads: {}", app.threads());
+
+    if (store_ks.empty()) {
+        store_ks.push_back(app.k());
+    }
+
     auto params = std::make_tuple(
         app.index_filename(),
         app.wand_data_path(),
@@ -200,6 +315,18 @@ int main(int argc, const char** argv)
         triples_filename,
         all_pairs,
         all_triples);
+    auto store_params = std::make_tuple(
+        app.index_filename(),
+        app.wand_data_path(),
+        app.queries(),
+        app.scorer_params(),
+        store_ks,
+        pairs_filename,
+        triples_filename,
+        all_pairs,
+        all_triples,
+        store_filename.value_or(""));
+    bool build_store = store_filename.has_value();
 
     /**/
     if (false) {
@@ -209,13 +336,14 @@ int main(int argc, const char** argv)
     {                                                                                              \
         if (app.is_wand_compressed()) {                                                            \
             if (quantized) {                                                                       \
-                std::apply(                                                                        \
-                    kt_thresholds<BOOST_PP_CAT(T, _index), wand_uniform_index_quantized>, params); \
+                run<BOOST_PP_CAT(T, _index), wand_uniform_index_quantized>(                        \
+                    build_store, params, store_params);                                            \
             } else {                                                                               \
-                std::apply(kt_thresholds<BOOST_PP_CAT(T, _index), wand_uniform_index>, params);    \
+                run<BOOST_PP_CAT(T, _index), wand_uniform_index>(                                  \
+                    build_store, params, store_params);                                            \
             }                                                                                      \
         } else {                                                                                   \
-            std::apply(kt_thresholds<BOOST_PP_CAT(T, _index), wand_raw_index>, params);            \
+            run<BOOST_PP_CAT(T, _index), wand_raw_index>(build_store, params, store_params);       \
         }
         /**/
         BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
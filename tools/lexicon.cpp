@@ -2,6 +2,7 @@
 #include <mio/mmap.hpp>
 #include <spdlog/spdlog.h>
 
+#include "hashed_lexicon.hpp"
 #include "io.hpp"
 #include "payload_vector.hpp"
 
@@ -13,12 +14,17 @@ int main(int argc, char** argv)
     std::string lexicon_file;
     std::size_t idx;
     std::string value;
+    bool hashed = false;
 
     CLI::App app{"Build, print, or query lexicon"};
     app.require_subcommand();
     auto build = app.add_subcommand("build", "Build a lexicon");
     build->add_option("input", text_file, "Input text file")->required();
     build->add_option("output", lexicon_file, "Output file")->required();
+    build->add_flag(
+        "--hashed",
+        hashed,
+        "Build a hashed lexicon with constant-time reverse lookup; input need not be sorted");
     auto lookup = app.add_subcommand("lookup", "Retrieve the payload at index");
     lookup->add_option("lexicon", lexicon_file, "Lexicon file path")->required();
     lookup->add_option("idx", idx, "Index of requested element")->required();
@@ -31,6 +37,12 @@ int main(int argc, char** argv)
 
     try {
         if (*build) {
+            if (hashed) {
+                auto terms = io::read_string_vector(text_file);
+                std::ofstream os(lexicon_file);
+                write_hashed_lexicon(terms, os);
+                return 0;
+            }
             std::ifstream is(text_file);
             encode_payload_vector(
                 std::istream_iterator<io::Line>(is), std::istream_iterator<io::Line>())
@@ -38,7 +50,11 @@ int main(int argc, char** argv)
             return 0;
         }
         mio::mmap_source m(lexicon_file.c_str());
-        auto lexicon = Payload_Vector<>::from(m);
+        std::optional<Hashed_Lexicon> hashed_lexicon = std::nullopt;
+        if (Hashed_Lexicon::is_hashed_lexicon(m)) {
+            hashed_lexicon = Hashed_Lexicon::from(m);
+        }
+        auto lexicon = hashed_lexicon ? hashed_lexicon->terms() : Payload_Vector<>::from(m);
         if (*print) {
             for (auto const& elem: lexicon) {
                 std::cout << elem << '\n';
@@ -54,7 +70,15 @@ int main(int argc, char** argv)
             return 1;
         }
         if (*rlookup) {
-            auto pos = pisa::binary_search(lexicon.begin(), lexicon.end(), std::string_view(value));
+            auto pos = [&]() -> std::optional<std::ptrdiff_t> {
+                if (hashed_lexicon) {
+                    if (auto id = hashed_lexicon->find(value); id) {
+                        return *id;
+                    }
+                    return std::nullopt;
+                }
+                return pisa::binary_search(lexicon.begin(), lexicon.end(), std::string_view(value));
+            }();
             if (pos) {
                 std::cout << *pos << '\n';
                 return 0;
@@ -0,0 +1,95 @@
+#include <optional>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/spdlog.h>
+#include <tbb/global_control.h>
+
+#include "app.hpp"
+#include "index_types.hpp"
+#include "merge_index.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+template <typename IndexType>
+void merge(MergeIndexArgs const& args)
+{
+    std::optional<TermMapping> term_mapping{};
+    if (args.output_term_lexicon()) {
+        term_mapping = merge_term_lexicons(args.term_lexicons(), *args.output_term_lexicon());
+    }
+    if (args.output_document_lexicon()) {
+        concatenate_document_lexicons(args.document_lexicons(), *args.output_document_lexicon());
+    }
+
+    std::optional<MergeWandOptions> wand_options{};
+    if (args.output_wand()) {
+        wand_options = MergeWandOptions{
+            .inputs = args.wand_data_path(),
+            .output = *args.output_wand(),
+            .scorer_params = args.scorer_params(),
+            .block_size = args.block_size(),
+            .quantize = args.quantize(),
+        };
+    }
+    if (args.compress()) {
+        merge_indexes<IndexType, wand_data<wand_data_compressed<>>>(
+            args.indexes(), args.output(), term_mapping, wand_options);
+    } else if (args.range()) {
+        merge_indexes<IndexType, wand_data<wand_data_range<128, 1024>>>(
+            args.indexes(), args.output(), term_mapping, wand_options);
+    } else {
+        merge_indexes<IndexType, wand_data<wand_data_raw>>(
+            args.indexes(), args.output(), term_mapping, wand_options);
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    CLI::App app{"Merges compressed indexes of consecutive document ranges."};
+    MergeIndexArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+
+    if (args.output_term_lexicon() && args.term_lexicons().size() != args.indexes().size()) {
+        spdlog::error("Number of term lexicons must match the number of indexes");
+        return 1;
+    }
+    if (args.output_document_lexicon()
+        && args.document_lexicons().size() != args.indexes().size()) {
+        spdlog::error("Number of document lexicons must match the number of indexes");
+        return 1;
+    }
+    if (args.output_wand() && not args.has_block_size()) {
+        spdlog::error("WAND data requires one of: --block-size, --lambda, --range");
+        return 1;
+    }
+    if (args.output_wand() && args.scorer_params().name.empty()) {
+        spdlog::error("WAND data requires a scorer");
+        return 1;
+    }
+
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, args.threads() + 1);
+    spdlog::info("Number of worker threads: {}", args.threads());
+
+    try {
+        auto const& encoding = args.index_encoding();
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                   \
+    }                                           \
+    else if (encoding == BOOST_PP_STRINGIZE(T)) \
+    {                                           \
+        merge<BOOST_PP_CAT(T, _index)>(args);   \
+        /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown type {}", encoding);
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -7,6 +7,7 @@
 
 #include "forward_index_builder.hpp"
 #include "parser.hpp"
+#include "query/stemming_cache.hpp"
 #include "query/term_processor.hpp"
 
 using namespace pisa;
@@ -32,6 +33,7 @@ int main(int argc, char** argv)
     ptrdiff_t batch_size = 100'000;
     std::optional<std::string> stemmer = std::nullopt;
     std::optional<std::string> content_parser_type = std::nullopt;
+    std::optional<std::size_t> chunk_size = std::nullopt;
     bool debug = false;
 
     CLI::App app{"parse_collection - parse collection and store as forward index."};
@@ -42,6 +44,11 @@ int main(int argc, char** argv)
     app.add_option(
         "-b,--batch-size", batch_size, "Number of documents to process in one thread", true);
     app.add_option("-f,--format", format, "Input format", true);
+    app.add_option(
+        "--chunk-size",
+        chunk_size,
+        "Parse records in parallel from chunks of this many bytes (plaintext, trectext, "
+        "trecweb, warc); overrides --batch-size");
     app.add_option("--stemmer", stemmer, "Stemmer type");
     app.add_option("--content-parser", content_parser_type, "Content parser type");
     app.add_flag("--debug", debug, "Print debug messages");
@@ -69,6 +76,15 @@ int main(int argc, char** argv)
         Forward_Index_Builder builder;
         if (*merge_cmd) {
             builder.merge(output_filename, document_count, batch_count);
+        } else if (chunk_size) {
+            builder.build_chunked(
+                std::cin,
+                output_filename,
+                format,
+                *chunk_size,
+                term_transformer_builder(stemmer),
+                content_parser(content_parser_type),
+                threads);
         } else {
             builder.build(
                 std::cin,
@@ -79,6 +95,11 @@ int main(int argc, char** argv)
                 batch_size,
                 threads);
         }
+        if (stemmer) {
+            auto stats = StemmingCache::global_stats();
+            spdlog::info(
+                "Stemming cache: {} lookups, {:.2f}% hits", stats.lookups(), stats.hit_rate() * 100);
+        }
     } catch (std::exception& err) {
         spdlog::error(err.what());
         return EXIT_FAILURE;
@@ -0,0 +1,110 @@
+#include <fstream>
+#include <unordered_set>
+
+#include <CLI/CLI.hpp>
+#include <boost/filesystem.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <tbb/global_control.h>
+
+#include "app.hpp"
+#include "binary_freq_collection.hpp"
+#include "compress.hpp"
+#include "memory_source.hpp"
+#include "prune_index.hpp"
+#include "scorer/scorer.hpp"
+#include "util/util.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+auto collection_bytes(std::string const& basename) -> std::uint64_t
+{
+    return boost::filesystem::file_size(basename + ".docs")
+        + boost::filesystem::file_size(basename + ".freqs");
+}
+
+template <typename Wand>
+void prune(PruneIndexArgs& args)
+{
+    Wand wdata(MemorySource::mapped_file(args.wand_data_path()));
+    auto scorer = scorer::from_params(args.scorer_params(), wdata);
+    std::unordered_set<std::size_t> terms_to_drop;
+    auto stats = prune_inverted_index(
+        args.input_basename(), args.output_basename(), *scorer, args.pruning_options(), terms_to_drop);
+
+    if (args.term_lexicon()) {
+        auto output_lexicon = fmt::format("{}.termlex", args.output_basename());
+        binary_freq_collection input(args.input_basename().c_str());
+        write_pruned_lexicon(*args.term_lexicon(), output_lexicon, input.size(), terms_to_drop);
+        spdlog::info("Term lexicon of the pruned collection written to {}", output_lexicon);
+    }
+    if (args.terms_to_drop_file()) {
+        std::ofstream dropped_terms_file(*args.terms_to_drop_file());
+        for (auto term: terms_to_drop) {
+            dropped_terms_file << term << '\n';
+        }
+    }
+    auto input_bytes = collection_bytes(args.input_basename());
+    auto output_bytes = collection_bytes(args.output_basename());
+    spdlog::info(
+        "Kept {} out of {} postings ({:.2f}%), dropped {} terms",
+        stats.output_postings,
+        stats.input_postings,
+        100.0 * stats.output_postings / stats.input_postings,
+        stats.dropped_terms);
+    spdlog::info(
+        "Collection size reduced from {} to {} bytes ({:.2f}%)",
+        input_bytes,
+        output_bytes,
+        100.0 * output_bytes / input_bytes);
+
+    stats_line line;
+    line("input_postings", stats.input_postings)("output_postings", stats.output_postings)(
+        "dropped_terms", stats.dropped_terms)("input_bytes", input_bytes)(
+        "output_bytes", output_bytes);
+
+    if (args.query_file()) {
+        binary_freq_collection original(args.input_basename().c_str());
+        binary_freq_collection pruned(args.output_basename().c_str());
+        auto overlap =
+            topk_overlap(original, pruned, terms_to_drop, *scorer, args.queries(), args.k());
+        spdlog::info("Mean top-{} overlap: {:.4f}", args.k(), overlap);
+        line("k", args.k())("topk_overlap", overlap);
+    }
+
+    if (args.index_filename()) {
+        compress(
+            args.output_basename(),
+            std::nullopt,
+            *args.index_encoding(),
+            *args.index_filename(),
+            args.scorer_params(),
+            false,
+            false);
+        auto index_bytes = boost::filesystem::file_size(*args.index_filename());
+        spdlog::info("Pruned index size: {} bytes", index_bytes);
+        line("index_bytes", index_bytes);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"Prunes postings with low score contributions from a collection."};
+    PruneIndexArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, args.threads() + 1);
+
+    try {
+        if (args.is_wand_compressed()) {
+            prune<wand_data<wand_data_compressed<>>>(args);
+        } else {
+            prune<wand_data<wand_data_raw>>(args);
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
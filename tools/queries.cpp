@@ -18,11 +18,13 @@
 #include "cursor/cursor.hpp"
 #include "cursor/max_scored_cursor.hpp"
 #include "cursor/scored_cursor.hpp"
+#include "impact_tiers.hpp"
 #include "index_types.hpp"
 #include "mappable/mapper.hpp"
 #include "memory_source.hpp"
 #include "query/algorithm.hpp"
 #include "scorer/scorer.hpp"
+#include "threshold_store.hpp"
 #include "timer.hpp"
 #include "topk_queue.hpp"
 #include "type_alias.hpp"
@@ -127,15 +129,22 @@ void perftest(
     const ScorerParams& scorer_params,
     const bool weighted,
     bool extract,
-    bool safe)
+    bool safe,
+    const std::optional<std::string>& tiers_filename,
+    const std::optional<std::string>& threshold_store_filename)
 {
     spdlog::info("Loading index from {}", index_filename);
     IndexType index(MemorySource::mapped_file(index_filename));
 
+    std::optional<impact_tiers> tiers;
+    if (tiers_filename) {
+        tiers = impact_tiers::from_file(*tiers_filename);
+    }
+
     spdlog::info("Warming up posting lists");
     std::unordered_set<term_id_type> warmed_up;
     for (auto const& q: queries) {
-        for (auto t: q.terms) {
+        for (auto t: tiers ? tiers->all_tiers(q).terms : q.terms) {
             if (!warmed_up.count(t)) {
                 index.warmup(t);
                 warmed_up.insert(t);
@@ -164,6 +173,11 @@ void perftest(
         }
     }
 
+    std::optional<threshold_store> store;
+    if (threshold_store_filename) {
+        store.emplace(MemorySource::mapped_file(*threshold_store_filename));
+    }
+
     auto scorer = scorer::from_params(scorer_params, wdata);
 
     spdlog::info("Performing {} queries", type);
@@ -210,6 +224,22 @@ void perftest(
                 topk.finalize();
                 return topk.topk().size();
             };
+        } else if (t == "two_tier_block_max_wand" && wand_data_filename && tiers) {
+            query_fun = [&](Query query, Score threshold) {
+                topk_queue topk(k, threshold);
+                two_tier_block_max_wand_query two_tier_q(topk);
+                two_tier_q(
+                    make_block_max_scored_cursors(index, wdata, *scorer, query, weighted),
+                    make_block_max_scored_cursors(
+                        index, wdata, *scorer, tiers->low_tiers(query), weighted),
+                    [&] {
+                        return make_block_max_scored_cursors(
+                            index, wdata, *scorer, tiers->all_tiers(query), weighted);
+                    },
+                    index.num_docs());
+                topk.finalize();
+                return topk.topk().size();
+            };
         } else if (t == "block_max_maxscore" && wand_data_filename) {
             query_fun = [&](Query query, Score threshold) {
                 topk_queue topk(k, threshold);
@@ -286,6 +316,15 @@ void perftest(
             spdlog::error("Unsupported query type: {}", t);
             break;
         }
+        // Thresholds of term subsets only bound disjunctive queries.
+        bool conjunctive = t == "and" || t == "ranked_and" || t == "block_max_ranked_and";
+        if (store && conjunctive) {
+            spdlog::warn("Threshold store is not used for conjunctive query type {}", t);
+        } else if (store) {
+            query_fun = [&, query_fun](Query query, Score threshold) {
+                return query_fun(query, std::max(threshold, store->threshold(query, k)));
+            };
+        }
         if (extract) {
             extract_times(query_fun, queries, thresholds, type, t, 2, std::cout);
         } else {
@@ -304,6 +343,8 @@ int main(int argc, const char** argv)
     bool silent = false;
     bool safe = false;
     bool quantized = false;
+    std::optional<std::string> tiers_filename;
+    std::optional<std::string> threshold_store_filename;
 
     App<arg::Index,
         arg::WandData<arg::WandMode::Optional>,
@@ -317,6 +358,15 @@ int main(int argc, const char** argv)
     app.add_flag("--silent", silent, "Suppress logging");
     app.add_flag("--safe", safe, "Rerun if not enough results with pruning.")
         ->needs(app.thresholds_option());
+    app.add_option(
+        "--tiers",
+        tiers_filename,
+        "Low tiers of an index split by impact, required by two_tier_block_max_wand");
+    app.add_option(
+        "--threshold-store",
+        threshold_store_filename,
+        "Threshold store built by kth_threshold, used to seed each disjunctive query with a safe "
+        "threshold");
     CLI11_PARSE(app, argc, argv);
 
     if (silent) {
@@ -339,7 +389,9 @@ int main(int argc, const char** argv)
         app.scorer_params(),
         app.weighted(),
         extract,
-        safe);
+        safe,
+        tiers_filename,
+        threshold_store_filename);
     /**/
     if (false) {
 #define LOOP_BODY(R, DATA, T)                                                                        \
@@ -23,6 +23,7 @@ auto reorder_docids(ReorderDocuments args) -> int
                 .min_length = args.min_length(),
                 .compress_fwd = not args.nogb(),
                 .print_args = args.print(),
+                .max_postings = args.max_postings(),
             });
         }
         ReorderOptions options{.input_basename = args.input_basename(),
@@ -0,0 +1,80 @@
+#include <optional>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/spdlog.h>
+#include <tbb/global_control.h>
+
+#include "app.hpp"
+#include "index_types.hpp"
+#include "reorder_docids.hpp"
+#include "reorder_index.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+template <typename IndexType>
+void reorder(ReorderIndexArgs const& args, gsl::span<std::uint32_t const> mapping)
+{
+    std::optional<ReorderWandOptions> wand_options{};
+    if (args.wand_data_path()) {
+        wand_options = ReorderWandOptions{
+            .input = *args.wand_data_path(),
+            .output = *args.output_wand(),
+            .scorer_params = args.scorer_params(),
+            .block_size = args.block_size(),
+            .quantize = args.quantize(),
+        };
+    }
+    if (args.compress()) {
+        reorder_index<IndexType, wand_data<wand_data_compressed<>>>(
+            args.index_filename(), args.output(), mapping, wand_options);
+    } else if (args.range()) {
+        reorder_index<IndexType, wand_data<wand_data_range<128, 1024>>>(
+            args.index_filename(), args.output(), mapping, wand_options);
+    } else {
+        reorder_index<IndexType, wand_data<wand_data_raw>>(
+            args.index_filename(), args.output(), mapping, wand_options);
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    CLI::App app{"Reassigns the document IDs of a compressed index and its WAND data."};
+    ReorderIndexArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+
+    if (args.wand_data_path() && not args.has_block_size()) {
+        spdlog::error("WAND data requires one of: --block-size, --lambda, --range");
+        return 1;
+    }
+    if (args.wand_data_path() && args.scorer_params().name.empty()) {
+        spdlog::error("WAND data requires a scorer");
+        return 1;
+    }
+
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, args.threads() + 1);
+    spdlog::info("Number of worker threads: {}", args.threads());
+
+    try {
+        auto mapping = read_mapping(args.mapping_file());
+        auto const& encoding = args.index_encoding();
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                            \
+    }                                                    \
+    else if (encoding == BOOST_PP_STRINGIZE(T))          \
+    {                                                    \
+        reorder<BOOST_PP_CAT(T, _index)>(args, mapping); \
+        /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown type {}", encoding);
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "accumulator/lazy_accumulator.hpp"
+#include "accumulator/simple_accumulator.hpp"
+#include "app.hpp"
+#include "impact_ordered_index.hpp"
+#include "index_types.hpp"
+#include "memory_source.hpp"
+#include "query/algorithm/ranked_or_saat_query.hpp"
+#include "timer.hpp"
+#include "topk_queue.hpp"
+#include "util/do_not_optimize_away.hpp"
+#include "util/util.hpp"
+
+using namespace pisa;
+
+template <typename BlockCodec, typename Acc>
+void perftest(
+    std::string const& index_filename,
+    std::vector<Query> const& queries,
+    std::string const& encoding,
+    std::uint64_t k,
+    std::uint64_t postings_budget,
+    bool weighted,
+    std::size_t runs)
+{
+    impact_ordered_index<BlockCodec> index(MemorySource::mapped_file(index_filename));
+    spdlog::info("Warming up posting lists");
+    for (auto const& query: queries) {
+        for (auto term: query.terms) {
+            index.warmup(term);
+        }
+    }
+
+    Acc accumulator(index.num_docs());
+    topk_queue topk(k);
+    ranked_or_saat_query saat_q(topk, postings_budget);
+    std::vector<double> query_times;
+    double processed_postings = 0;
+    for (std::size_t run = 0; run <= runs; ++run) {
+        for (auto const& query: queries) {
+            auto usecs = run_with_timer<std::chrono::microseconds>([&]() {
+                topk = topk_queue(k);
+                saat_q(make_impact_segments(index, query, weighted), accumulator);
+                topk.finalize();
+                do_not_optimize_away(topk.topk().size());
+            });
+            if (run != 0) {  // first run is not timed
+                query_times.push_back(usecs.count());
+                processed_postings += saat_q.processed_postings();
+            }
+        }
+    }
+    if (query_times.empty()) {
+        spdlog::warn("No queries were processed");
+        return;
+    }
+
+    std::sort(query_times.begin(), query_times.end());
+    double avg =
+        std::accumulate(query_times.begin(), query_times.end(), double()) / query_times.size();
+    double q50 = query_times[query_times.size() / 2];
+    double q90 = query_times[90 * query_times.size() / 100];
+    double q95 = query_times[95 * query_times.size() / 100];
+    double q99 = query_times[99 * query_times.size() / 100];
+    double avg_postings = processed_postings / query_times.size();
+
+    spdlog::info("---- {} saat", encoding);
+    spdlog::info("Mean: {}", avg);
+    spdlog::info("50% quantile: {}", q50);
+    spdlog::info("90% quantile: {}", q90);
+    spdlog::info("95% quantile: {}", q95);
+    spdlog::info("99% quantile: {}", q99);
+    spdlog::info("Mean processed postings: {}", avg_postings);
+
+    stats_line()("type", encoding)("query", "saat")("budget", postings_budget)("avg", avg)(
+        "q50", q50)("q90", q90)("q95", q95)("q99", q99)("processed_postings", avg_postings);
+}
+
+int main(int argc, const char** argv)
+{
+    spdlog::drop("");
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    std::uint64_t postings_budget = std::numeric_limits<std::uint64_t>::max();
+    std::string accumulator = "simple";
+    std::size_t runs = 2;
+
+    App<arg::Index, arg::Query<arg::QueryMode::Ranked>> app{
+        "Benchmarks score-at-a-time queries on an impact-ordered index."};
+    app.add_option(
+        "--budget", postings_budget, "Maximum number of postings processed by a query");
+    app.add_option("--accumulator", accumulator, "Accumulator type: simple or lazy", true);
+    app.add_option("--runs", runs, "Number of timed runs", true);
+    CLI11_PARSE(app, argc, argv);
+
+    auto const& encoding = app.index_encoding();
+    auto run = [&](auto codec) {
+        using codec_type = decltype(codec);
+        auto params = std::make_tuple(
+            app.index_filename(),
+            app.queries(),
+            encoding,
+            app.k(),
+            postings_budget,
+            app.weighted(),
+            runs);
+        if (accumulator == "lazy") {
+            std::apply(perftest<codec_type, Lazy_Accumulator<4>>, params);
+        } else if (accumulator == "simple") {
+            std::apply(perftest<codec_type, Simple_Accumulator>, params);
+        } else {
+            throw std::invalid_argument(fmt::format("Unknown accumulator: {}", accumulator));
+        }
+    };
+
+    try {
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                             \
+    }                                                     \
+    else if (encoding == BOOST_PP_STRINGIZE(T))           \
+    {                                                     \
+        run(BOOST_PP_CAT(T, _index)::block_codec_type{}); \
+        /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_BLOCK_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown block encoding {}", encoding);
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <signal.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "app.hpp"
+#include "scatter_gather.hpp"
+#include "sharding.hpp"
+#include "util/util.hpp"
+#include "vec_map.hpp"
+
+using namespace pisa;
+
+/// Time to wait for a worker to load its shard and start listening.
+constexpr std::chrono::milliseconds worker_startup_timeout(60'000);
+
+/// Worker processes launched by the coordinator, terminated on destruction.
+class worker_processes {
+  public:
+    worker_processes() = default;
+    worker_processes(worker_processes const&) = delete;
+    worker_processes(worker_processes&&) = delete;
+    worker_processes& operator=(worker_processes const&) = delete;
+    worker_processes& operator=(worker_processes&&) = delete;
+    ~worker_processes()
+    {
+        for (auto pid: m_pids) {
+            ::kill(pid, SIGTERM);
+        }
+        for (auto pid: m_pids) {
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+    void launch(std::string const& executable, std::vector<std::string> const& args)
+    {
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(executable.c_str()));
+        for (auto const& arg: args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        auto pid = ::fork();
+        if (pid < 0) {
+            throw std::system_error(errno, std::generic_category(), "Failed launching worker");
+        }
+        if (pid == 0) {
+            ::execv(executable.c_str(), argv.data());
+            std::perror("Failed executing worker");
+            std::_Exit(127);
+        }
+        m_pids.push_back(pid);
+    }
+
+  private:
+    std::vector<pid_t> m_pids;
+};
+
+[[nodiscard]] auto worker_args(ScatterGatherArgs const& shard_args) -> std::vector<std::string>
+{
+    auto const& scorer_params = shard_args.scorer_params();
+    std::vector<std::string> args{
+        "-e",
+        shard_args.index_encoding(),
+        "-i",
+        shard_args.index_filename(),
+        "-w",
+        shard_args.wand_data_path(),
+        "-a",
+        shard_args.algorithm(),
+        "-s",
+        scorer_params.name,
+        "--bm25-k1",
+        std::to_string(scorer_params.bm25_k1),
+        "--bm25-b",
+        std::to_string(scorer_params.bm25_b),
+        "--pl2-c",
+        std::to_string(scorer_params.pl2_c),
+        "--qld-mu",
+        std::to_string(scorer_params.qld_mu),
+        "--socket",
+        shard_args.socket()};
+    if (shard_args.is_wand_compressed()) {
+        args.emplace_back("--compressed-wand");
+    }
+    return args;
+}
+
+void print_result(
+    std::size_t query_idx,
+    std::optional<std::string> const& query_id,
+    scatter_gather_coordinator::result_type const& result)
+{
+    auto print_shards = [](std::vector<Shard_Id> const& shards) {
+        for (std::size_t idx = 0; idx < shards.size(); ++idx) {
+            std::cout << (idx > 0 ? "," : "") << shards[idx].as_int();
+        }
+    };
+    std::cout << R"({"query":)";
+    if (query_id) {
+        std::cout << '"' << *query_id << '"';
+    } else {
+        std::cout << query_idx;
+    }
+    std::cout << R"(,"time":)" << result.time.count() << R"(,"partial":)" << std::boolalpha
+              << result.partial() << R"(,"shards":[)";
+    print_shards(result.shards);
+    std::cout << R"(],"missing_shards":[)";
+    print_shards(result.missing_shards);
+    std::cout << R"(],"results":[)";
+    for (std::size_t idx = 0; idx < result.topk.size(); ++idx) {
+        std::cout << (idx > 0 ? "," : "") << R"({"docid":)" << result.topk[idx].second
+                  << R"(,"score":)" << result.topk[idx].first << '}';
+    }
+    std::cout << "]}\n";
+}
+
+void scatter_gather(ScatterGatherArgs const& args)
+{
+    auto shards = resolve_shards(args.index_filename());
+    if (shards.empty()) {
+        throw std::invalid_argument("No shards found");
+    }
+
+    worker_processes workers;
+    std::vector<std::string> shard_documents;
+    std::vector<std::string> sockets;
+    VecMap<Shard_Id, std::vector<Query>> shard_queries;
+    for (auto shard: shards) {
+        auto shard_args = args;
+        shard_args.apply_shard(shard);
+        if (args.worker()) {
+            workers.launch(*args.worker(), worker_args(shard_args));
+        }
+        shard_documents.push_back(shard_args.shard_documents());
+        sockets.push_back(shard_args.socket());
+        shard_queries.push_back(shard_args.queries());
+    }
+    auto queries = args.queries();
+    for (auto const& sq: shard_queries) {
+        if (sq.size() != queries.size()) {
+            throw std::invalid_argument(
+                "Global queries and shard queries do not all have the same size.");
+        }
+    }
+
+    spdlog::info("Connecting to {} shard workers", shards.size());
+    VecMap<Shard_Id, Socket> connections;
+    for (auto const& socket: sockets) {
+        connections.push_back(connect_unix_socket(socket, worker_startup_timeout));
+    }
+    scatter_gather_coordinator coordinator(
+        std::move(connections),
+        global_document_ids(args.documents(), gsl::make_span(shard_documents)),
+        args.timeout());
+
+    spdlog::info("Performing {} queries over {} shards", queries.size(), coordinator.num_shards());
+    std::vector<double> query_times;
+    std::size_t partial = 0;
+    for (std::size_t query_idx = 0; query_idx < queries.size(); ++query_idx) {
+        VecMap<Shard_Id, Query> queries_by_shard;
+        for (auto shard: shards) {
+            queries_by_shard.push_back(shard_queries[shard][query_idx]);
+        }
+        auto result = coordinator(queries_by_shard, args.k());
+        print_result(query_idx, queries[query_idx].id, result);
+        query_times.push_back(result.time.count());
+        partial += result.partial() ? 1 : 0;
+    }
+    if (query_times.empty()) {
+        spdlog::warn("No queries were processed");
+        return;
+    }
+
+    std::sort(query_times.begin(), query_times.end());
+    double avg =
+        std::accumulate(query_times.begin(), query_times.end(), double()) / query_times.size();
+    double q50 = query_times[query_times.size() / 2];
+    double q90 = query_times[90 * query_times.size() / 100];
+    double q95 = query_times[95 * query_times.size() / 100];
+    double q99 = query_times[99 * query_times.size() / 100];
+
+    spdlog::info("---- {} {} scatter-gather", args.index_encoding(), args.algorithm());
+    spdlog::info("Mean: {}", avg);
+    spdlog::info("50% quantile: {}", q50);
+    spdlog::info("90% quantile: {}", q90);
+    spdlog::info("95% quantile: {}", q95);
+    spdlog::info("99% quantile: {}", q99);
+    spdlog::info("Partial results: {}", partial);
+
+    stats_line()("type", args.index_encoding())("query", args.algorithm())("avg", avg)("q50", q50)(
+        "q90", q90)("q95", q95)("q99", q99)("shards", shards.size())("partial", partial);
+}
+
+int main(int argc, const char** argv)
+{
+    spdlog::drop("");
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    CLI::App app{"Executes queries on shard worker processes and merges their results."};
+    ScatterGatherArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+
+    try {
+        scatter_gather(args);
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
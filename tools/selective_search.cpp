@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <taily.hpp>
+#include <tbb/global_control.h>
+
+#include "app.hpp"
+#include "index_types.hpp"
+#include "pisa/taily_stats.hpp"
+#include "selective_search.hpp"
+#include "sharding.hpp"
+#include "util/util.hpp"
+#include "vec_map.hpp"
+#include "wand_data.hpp"
+#include "wand_data_compressed.hpp"
+#include "wand_data_raw.hpp"
+
+using namespace pisa;
+
+void print_result(
+    std::size_t query_idx,
+    std::optional<std::string> const& query_id,
+    std::vector<topk_queue::entry_type> const& topk,
+    std::vector<Shard_Id> const& shards,
+    std::chrono::microseconds time)
+{
+    std::cout << R"({"query":)";
+    if (query_id) {
+        write_json_string(std::cout, *query_id);
+    } else {
+        std::cout << query_idx;
+    }
+    std::cout << R"(,"time":)" << time.count() << R"(,"shards":[)";
+    for (std::size_t idx = 0; idx < shards.size(); ++idx) {
+        std::cout << (idx > 0 ? "," : "") << shards[idx].as_int();
+    }
+    std::cout << R"(],"results":[)";
+    for (std::size_t idx = 0; idx < topk.size(); ++idx) {
+        std::cout << (idx > 0 ? "," : "") << R"({"docid":)" << topk[idx].second << R"(,"score":)"
+                  << topk[idx].first << '}';
+    }
+    std::cout << "]}\n";
+}
+
+template <typename IndexType, typename WandType>
+void selective_search(SelectiveSearchArgs const& args)
+{
+    auto shards = resolve_shards(args.index_filename());
+    if (shards.empty()) {
+        throw std::invalid_argument("No shards found");
+    }
+    spdlog::info("Loading {} shards", shards.size());
+
+    std::vector<std::unique_ptr<search_shard<IndexType, WandType>>> shard_data;
+    std::vector<TailyStats> shard_stats;
+    std::vector<std::string> shard_documents;
+    VecMap<Shard_Id, std::vector<Query>> shard_queries;
+    for (auto shard: shards) {
+        auto shard_args = args;
+        shard_args.apply_shard(shard);
+        shard_data.push_back(std::make_unique<search_shard<IndexType, WandType>>(
+            shard_args.index_filename(), shard_args.wand_data_path(), shard_args.scorer_params()));
+        shard_stats.push_back(TailyStats::from_mapped(shard_args.shard_stats()));
+        shard_documents.push_back(shard_args.shard_documents());
+        shard_queries.push_back(shard_args.queries());
+    }
+    auto global_docids = global_document_ids(args.documents(), gsl::make_span(shard_documents));
+    auto global_stats = TailyStats::from_mapped(args.global_stats());
+    auto queries = args.queries();
+    for (auto const& sq: shard_queries) {
+        if (sq.size() != queries.size()) {
+            throw std::invalid_argument(
+                "Global queries and shard queries do not all have the same size.");
+        }
+    }
+
+    selective_search_broker<IndexType, WandType> broker(
+        std::move(shard_data), std::move(global_docids), args.algorithm(), args.k());
+
+    spdlog::info("Performing {} queries over {} shards", queries.size(), broker.num_shards());
+    std::vector<double> query_times;
+    std::size_t shards_touched = 0;
+    for (std::size_t query_idx = 0; query_idx < queries.size(); ++query_idx) {
+        VecMap<Shard_Id, Query> queries_by_shard;
+        std::vector<taily::Query_Statistics> shard_query_stats;
+        for (auto shard: shards) {
+            auto const& query = shard_queries[shard][query_idx];
+            queries_by_shard.push_back(query);
+            shard_query_stats.push_back(shard_stats[shard.as_int()].query_stats(query));
+        }
+        auto [selected, selection_time] = run_with_timer_ret<std::chrono::microseconds>([&] {
+            auto scores = taily::score_shards(
+                global_stats.query_stats(queries[query_idx]), shard_query_stats, args.k());
+            return select_shards(gsl::make_span(scores), args.min_score(), args.max_shards());
+        });
+        auto result = broker(queries_by_shard, std::move(selected));
+        auto time = selection_time + result.time;
+        print_result(query_idx, queries[query_idx].id, result.topk, result.shards, time);
+        query_times.push_back(time.count());
+        shards_touched += result.shards.size();
+    }
+    if (query_times.empty()) {
+        spdlog::warn("No queries were processed");
+        return;
+    }
+
+    std::sort(query_times.begin(), query_times.end());
+    double avg =
+        std::accumulate(query_times.begin(), query_times.end(), double()) / query_times.size();
+    double q50 = query_times[query_times.size() / 2];
+    double q90 = query_times[90 * query_times.size() / 100];
+    double q95 = query_times[95 * query_times.size() / 100];
+    double q99 = query_times[99 * query_times.size() / 100];
+    double avg_shards = static_cast<double>(shards_touched) / query_times.size();
+
+    spdlog::info("---- {} {} selective search", args.index_encoding(), args.algorithm());
+    spdlog::info("Mean: {}", avg);
+    spdlog::info("50% quantile: {}", q50);
+    spdlog::info("90% quantile: {}", q90);
+    spdlog::info("95% quantile: {}", q95);
+    spdlog::info("99% quantile: {}", q99);
+    spdlog::info("Mean shards touched: {}", avg_shards);
+
+    stats_line()("type", args.index_encoding())("query", args.algorithm())("avg", avg)("q50", q50)(
+        "q90", q90)("q95", q95)("q99", q99)("shards", shards.size())("avg_shards", avg_shards);
+}
+
+using wand_raw_index = wand_data<wand_data_raw>;
+using wand_uniform_index = wand_data<wand_data_compressed<>>;
+
+int main(int argc, const char** argv)
+{
+    spdlog::drop("");
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    CLI::App app{"Executes queries on the shards selected with Taily for each query."};
+    SelectiveSearchArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, args.threads() + 1);
+    spdlog::info("Number of worker threads: {}", args.threads());
+
+    try {
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                                                    \
+    }                                                                            \
+    else if (args.index_encoding() == BOOST_PP_STRINGIZE(T))                     \
+    {                                                                            \
+        if (args.is_wand_compressed()) {                                         \
+            selective_search<BOOST_PP_CAT(T, _index), wand_uniform_index>(args); \
+        } else {                                                                 \
+            selective_search<BOOST_PP_CAT(T, _index), wand_raw_index>(args);     \
+        }
+            /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown encoding {}", args.index_encoding());
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <string>
+
+#include <CLI/CLI.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "app.hpp"
+#include "index_types.hpp"
+#include "scatter_gather.hpp"
+#include "selective_search.hpp"
+#include "wand_data.hpp"
+#include "wand_data_compressed.hpp"
+#include "wand_data_raw.hpp"
+
+using namespace pisa;
+
+template <typename IndexType, typename WandType>
+void serve(
+    std::string const& index_filename,
+    std::string const& wand_data_filename,
+    ScorerParams const& scorer_params,
+    std::string const& algorithm,
+    std::string const& socket_path)
+{
+    if (not is_shard_algorithm(algorithm)) {
+        throw std::invalid_argument(fmt::format("Unsupported algorithm: {}", algorithm));
+    }
+    search_shard<IndexType, WandType> shard(index_filename, wand_data_filename, scorer_params);
+    auto handler = [&](shard_request const& request) {
+        Query query;
+        query.terms = request.terms;
+        return shard_response{request.id, shard.search(query, algorithm, request.k)};
+    };
+    auto listener = listen_unix_socket(socket_path);
+    spdlog::info("Serving {} at {}", index_filename, socket_path);
+    while (true) {
+        auto connection = accept_connection(listener);
+        serve_shard_requests(connection, handler);
+    }
+}
+
+using wand_raw_index = wand_data<wand_data_raw>;
+using wand_uniform_index = wand_data<wand_data_compressed<>>;
+
+int main(int argc, const char** argv)
+{
+    spdlog::drop("");
+    spdlog::set_default_logger(spdlog::stderr_color_mt(""));
+
+    std::string socket_path;
+    App<arg::Index, arg::WandData<arg::WandMode::Required>, arg::Algorithm, arg::Scorer> app{
+        "Serves queries on a single shard for a scatter-gather coordinator."};
+    app.add_option("--socket", socket_path, "Unix domain socket path to listen at")->required();
+    CLI11_PARSE(app, argc, argv);
+
+    auto params = std::make_tuple(
+        app.index_filename(),
+        app.wand_data_path(),
+        app.scorer_params(),
+        app.algorithm(),
+        socket_path);
+    try {
+        if (false) {
+#define LOOP_BODY(R, DATA, T)                                                       \
+    }                                                                               \
+    else if (app.index_encoding() == BOOST_PP_STRINGIZE(T))                         \
+    {                                                                               \
+        if (app.is_wand_compressed()) {                                             \
+            std::apply(serve<BOOST_PP_CAT(T, _index), wand_uniform_index>, params); \
+        } else {                                                                    \
+            std::apply(serve<BOOST_PP_CAT(T, _index), wand_raw_index>, params);     \
+        }
+            /**/
+            BOOST_PP_SEQ_FOR_EACH(LOOP_BODY, _, PISA_INDEX_TYPES);
+#undef LOOP_BODY
+        } else {
+            spdlog::error("Unknown encoding {}", app.index_encoding());
+            return 1;
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include "app.hpp"
 #include "binary_collection.hpp"
 #include "compress.hpp"
+#include "global_statistics.hpp"
 #include "invert.hpp"
 #include "reorder_docids.hpp"
 #include "sharding.hpp"
@@ -23,7 +24,7 @@
 
 namespace invert = pisa::invert;
 using pisa::CompressArgs;
-using pisa::CreateWandDataArgs;
+using pisa::ShardWandDataArgs;
 using pisa::format_shard;
 using pisa::InvertArgs;
 using pisa::ReorderDocuments;
@@ -68,7 +69,7 @@ int main(int argc, char** argv)
     InvertArgs invert_args(invert);
     ReorderDocuments reorder_args(reorder);
     CompressArgs compress_args(compress);
-    CreateWandDataArgs wand_args(wand);
+    ShardWandDataArgs wand_args(wand);
     TailyStatsArgs taily_args(taily);
     TailyRankArgs taily_rank_args(taily_rank);
     TailyThresholds taily_thresholds_args(taily_thresholds);
@@ -107,6 +108,9 @@ int main(int argc, char** argv)
             return 0;
         }
         if (compress->parsed()) {
+            tbb::global_control control(
+                tbb::global_control::max_allowed_parallelism, compress_args.threads() + 1);
+            spdlog::info("Number of worker threads: {}", compress_args.threads());
             auto shards = resolve_shards(compress_args.input_basename(), ".docs");
             spdlog::info("Processing {} shards", shards.size());
             for (auto shard: shards) {
@@ -124,8 +128,36 @@ int main(int argc, char** argv)
             return 0;
         }
         if (wand->parsed()) {
+            tbb::global_control control(
+                tbb::global_control::max_allowed_parallelism, wand_args.threads() + 1);
             auto shards = resolve_shards(wand_args.input_basename(), ".docs");
             spdlog::info("Processing {} shards", shards.size());
+            if (wand_args.global_stats()) {
+                std::vector<std::string> collections;
+                std::vector<std::string> terms;
+                for (auto shard: shards) {
+                    auto shard_args = wand_args;
+                    shard_args.apply_shard(shard);
+                    collections.push_back(shard_args.input_basename());
+                    terms.push_back(shard_args.terms());
+                }
+                auto stats = pisa::shard_global_statistics(
+                    gsl::make_span(collections), gsl::make_span(terms));
+                for (auto shard: shards) {
+                    auto shard_args = wand_args;
+                    shard_args.apply_shard(shard);
+                    pisa::create_wand_data(
+                        shard_args.output(),
+                        shard_args.input_basename(),
+                        shard_args.block_size(),
+                        shard_args.scorer_params(),
+                        shard_args.range(),
+                        shard_args.compress(),
+                        shard_args.quantize(),
+                        std::move(stats[shard]));
+                }
+                return 0;
+            }
             for (auto shard: shards) {
                 auto shard_args = wand_args;
                 shard_args.apply_shard(shard);
@@ -141,6 +173,8 @@ int main(int argc, char** argv)
             }
         }
         if (taily->parsed()) {
+            tbb::global_control control(
+                tbb::global_control::max_allowed_parallelism, taily_args.threads() + 1);
             auto shards = resolve_shards(taily_args.collection_path(), ".docs");
             spdlog::info("Processing {} shards", shards.size());
             for (auto shard: shards) {
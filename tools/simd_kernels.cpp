@@ -0,0 +1,20 @@
+#include <iostream>
+
+#include <CLI/CLI.hpp>
+
+#include "cpu_dispatch.hpp"
+
+using namespace pisa;
+
+int main(int argc, const char** argv)
+{
+    CLI::App app{"Prints the SIMD level of this host and the kernels selected for it."};
+    CLI11_PARSE(app, argc, argv);
+
+    std::cout << "detected: " << to_string(detected_simd_level()) << '\n';
+    std::cout << "selected: " << to_string(simd_level()) << '\n';
+    for (auto const& kernel: DISPATCHED_KERNELS) {
+        std::cout << kernel.name << ": " << to_string(kernel_level(kernel)) << '\n';
+    }
+    return 0;
+}
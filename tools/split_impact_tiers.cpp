@@ -0,0 +1,59 @@
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#include "app.hpp"
+#include "impact_tiers.hpp"
+#include "util/util.hpp"
+#include "wand_data.hpp"
+
+using namespace pisa;
+
+template <typename Wand>
+void split(SplitTiersArgs const& args)
+{
+    auto stats = split_impact_tiers<Wand>(
+        args.input_basename(),
+        args.output_basename(),
+        *args.wand_data_path(),
+        *args.output_wand(),
+        args.scorer_params(),
+        args.block_size(),
+        args.quantize(),
+        args.tier_options());
+    stats_line()("split_terms", stats.split_terms)("high_tier_postings", stats.high_tier_postings)(
+        "low_tier_postings", stats.low_tier_postings);
+}
+
+int main(int argc, const char** argv)
+{
+    CLI::App app{"Splits long posting lists of a collection into high- and low-impact tiers."};
+    SplitTiersArgs args(&app);
+    CLI11_PARSE(app, argc, argv);
+
+    if (not args.wand_data_path()) {
+        spdlog::error("Splitting lists requires WAND data: --wand, --output-wand");
+        return 1;
+    }
+    if (not args.has_block_size()) {
+        spdlog::error("WAND data requires one of: --block-size, --lambda, --range");
+        return 1;
+    }
+    if (args.scorer_params().name.empty()) {
+        spdlog::error("WAND data requires a scorer");
+        return 1;
+    }
+
+    try {
+        if (args.compress()) {
+            split<wand_data<wand_data_compressed<>>>(args);
+        } else if (args.range()) {
+            split<wand_data<wand_data_range<128, 1024>>>(args);
+        } else {
+            split<wand_data<wand_data_raw>>(args);
+        }
+    } catch (std::exception const& err) {
+        spdlog::error("{}", err.what());
+        return 1;
+    }
+    return 0;
+}
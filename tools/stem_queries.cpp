@@ -6,6 +6,7 @@
 
 #include "io.hpp"
 #include "pisa/query/query_stemmer.hpp"
+#include "pisa/query/stemming_cache.hpp"
 
 int main(int argc, char const* argv[])
 {
@@ -30,6 +31,9 @@ int main(int argc, char const* argv[])
         pisa::io::for_each_line(input_file, [&](std::string const& line) {
             output_file << query_stemmer(line) << "\n";
         });
+        auto stats = pisa::StemmingCache::global_stats();
+        spdlog::info(
+            "Stemming cache: {} lookups, {:.2f}% hits", stats.lookups(), stats.hit_rate() * 100);
     } catch (const std::invalid_argument& ex) {
         spdlog::error(ex.what());
         std::exit(1);
@@ -6,6 +6,7 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <taily.hpp>
+#include <tbb/global_control.h>
 
 #include "./taily_stats.hpp"
 #include "app.hpp"
@@ -33,6 +34,9 @@ int main(int argc, const char** argv)
 
     CLI11_PARSE(app, argc, argv);
 
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, args.threads() + 1);
+    spdlog::info("Number of worker threads: {}", args.threads());
+
     try {
         pisa::extract_taily_stats(args);
     } catch (std::exception const& err) {
@@ -8,6 +8,8 @@
 #include <mio/mmap.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
 
 #include "app.hpp"
 #include "cursor/max_scored_cursor.hpp"
@@ -39,17 +41,19 @@ void thresholds(
 
     auto scorer = scorer::from_params(scorer_params, wdata);
 
-    topk_queue topk(k);
-    wand_query wand_q(topk);
-    for (auto const& query: queries) {
-        wand_q(make_max_scored_cursors(index, wdata, *scorer, query), index.num_docs());
+    std::vector<float> thresholds(queries.size(), 0.0);
+    tbb::parallel_for(size_t(0), queries.size(), [&](size_t query_idx) {
+        topk_queue topk(k);
+        wand_query wand_q(topk);
+        wand_q(
+            make_max_scored_cursors(index, wdata, *scorer, queries[query_idx]), index.num_docs());
         topk.finalize();
-        auto results = topk.topk();
-        topk.clear();
-        float threshold = 0.0;
+        auto const& results = topk.topk();
         if (results.size() == k) {
-            threshold = results.back().first;
+            thresholds[query_idx] = results.back().first;
         }
+    });
+    for (auto threshold: thresholds) {
         std::cout << threshold << '\n';
     }
 }
@@ -68,12 +72,19 @@ int main(int argc, const char** argv)
 
     bool quantized = false;
 
-    App<arg::Index, arg::WandData<arg::WandMode::Required>, arg::Query<arg::QueryMode::Ranked>, arg::Scorer>
+    App<arg::Index,
+        arg::WandData<arg::WandMode::Required>,
+        arg::Query<arg::QueryMode::Ranked>,
+        arg::Scorer,
+        arg::Threads>
         app{"Extracts query thresholds."};
     app.add_flag("--quantized", quantized, "Quantizes the scores");
 
     CLI11_PARSE(app, argc, argv);
 
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, app.threads() + 1);
+    spdlog::info("Number of worker threads: {}", app.threads());
+
     auto params = std::make_tuple(
         app.index_filename(),
         app.wand_data_path(),